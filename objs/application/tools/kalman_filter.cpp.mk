@@ -0,0 +1,312 @@
+objs/application/tools/kalman_filter.cpp.o: \
+ src/application/tools/kalman_filter.cpp /usr/include/stdc-predef.h \
+ src/application/tools/kalman_filter.hpp /usr/include/c++/12/vector \
+ /usr/include/c++/12/bits/stl_algobase.h \
+ /usr/include/x86_64-linux-gnu/c++/12/bits/c++config.h \
+ /usr/include/x86_64-linux-gnu/c++/12/bits/os_defines.h \
+ /usr/include/features.h /usr/include/features-time64.h \
+ /usr/include/x86_64-linux-gnu/bits/wordsize.h \
+ /usr/include/x86_64-linux-gnu/bits/timesize.h \
+ /usr/include/x86_64-linux-gnu/sys/cdefs.h \
+ /usr/include/x86_64-linux-gnu/bits/long-double.h \
+ /usr/include/x86_64-linux-gnu/gnu/stubs.h \
+ /usr/include/x86_64-linux-gnu/gnu/stubs-64.h \
+ /usr/include/x86_64-linux-gnu/c++/12/bits/cpu_defines.h \
+ /usr/include/c++/12/bits/functexcept.h \
+ /usr/include/c++/12/bits/exception_defines.h \
+ /usr/include/c++/12/bits/cpp_type_traits.h \
+ /usr/include/c++/12/ext/type_traits.h \
+ /usr/include/c++/12/ext/numeric_traits.h \
+ /usr/include/c++/12/bits/stl_pair.h /usr/include/c++/12/type_traits \
+ /usr/include/c++/12/bits/move.h /usr/include/c++/12/bits/utility.h \
+ /usr/include/c++/12/bits/stl_iterator_base_types.h \
+ /usr/include/c++/12/bits/stl_iterator_base_funcs.h \
+ /usr/include/c++/12/bits/concept_check.h \
+ /usr/include/c++/12/debug/assertions.h \
+ /usr/include/c++/12/bits/stl_iterator.h \
+ /usr/include/c++/12/bits/ptr_traits.h /usr/include/c++/12/debug/debug.h \
+ /usr/include/c++/12/bits/predefined_ops.h \
+ /usr/include/c++/12/bits/allocator.h \
+ /usr/include/x86_64-linux-gnu/c++/12/bits/c++allocator.h \
+ /usr/include/c++/12/bits/new_allocator.h /usr/include/c++/12/new \
+ /usr/include/c++/12/bits/exception.h \
+ /usr/include/c++/12/bits/memoryfwd.h \
+ /usr/include/c++/12/bits/stl_construct.h \
+ /usr/include/c++/12/bits/stl_uninitialized.h \
+ /usr/include/c++/12/ext/alloc_traits.h \
+ /usr/include/c++/12/bits/alloc_traits.h \
+ /usr/include/c++/12/bits/stl_vector.h \
+ /usr/include/c++/12/initializer_list \
+ /usr/include/c++/12/bits/stl_bvector.h \
+ /usr/include/c++/12/bits/functional_hash.h \
+ /usr/include/c++/12/bits/hash_bytes.h /usr/include/c++/12/bits/refwrap.h \
+ /usr/include/c++/12/bits/invoke.h \
+ /usr/include/c++/12/bits/stl_function.h \
+ /usr/include/c++/12/backward/binders.h \
+ /usr/include/c++/12/bits/range_access.h \
+ /usr/include/c++/12/bits/vector.tcc src/application/tools/Eigen/Core \
+ src/application/tools/Eigen/src/Core/util/DisableStupidWarnings.h \
+ src/application/tools/Eigen/src/Core/util/Macros.h \
+ /usr/include/c++/12/complex /usr/include/c++/12/cmath \
+ /usr/include/math.h \
+ /usr/include/x86_64-linux-gnu/bits/libc-header-start.h \
+ /usr/include/x86_64-linux-gnu/bits/types.h \
+ /usr/include/x86_64-linux-gnu/bits/typesizes.h \
+ /usr/include/x86_64-linux-gnu/bits/time64.h \
+ /usr/include/x86_64-linux-gnu/bits/math-vector.h \
+ /usr/include/x86_64-linux-gnu/bits/libm-simd-decl-stubs.h \
+ /usr/include/x86_64-linux-gnu/bits/floatn.h \
+ /usr/include/x86_64-linux-gnu/bits/floatn-common.h \
+ /usr/include/x86_64-linux-gnu/bits/flt-eval-method.h \
+ /usr/include/x86_64-linux-gnu/bits/fp-logb.h \
+ /usr/include/x86_64-linux-gnu/bits/fp-fast.h \
+ /usr/include/x86_64-linux-gnu/bits/mathcalls-helper-functions.h \
+ /usr/include/x86_64-linux-gnu/bits/mathcalls.h \
+ /usr/include/x86_64-linux-gnu/bits/mathcalls-narrow.h \
+ /usr/include/x86_64-linux-gnu/bits/iscanonical.h \
+ /usr/include/c++/12/bits/std_abs.h /usr/include/stdlib.h \
+ /usr/lib/gcc/x86_64-linux-gnu/12/include/stddef.h \
+ /usr/include/x86_64-linux-gnu/bits/waitflags.h \
+ /usr/include/x86_64-linux-gnu/bits/waitstatus.h \
+ /usr/include/x86_64-linux-gnu/bits/types/locale_t.h \
+ /usr/include/x86_64-linux-gnu/bits/types/__locale_t.h \
+ /usr/include/x86_64-linux-gnu/sys/types.h \
+ /usr/include/x86_64-linux-gnu/bits/types/clock_t.h \
+ /usr/include/x86_64-linux-gnu/bits/types/clockid_t.h \
+ /usr/include/x86_64-linux-gnu/bits/types/time_t.h \
+ /usr/include/x86_64-linux-gnu/bits/types/timer_t.h \
+ /usr/include/x86_64-linux-gnu/bits/stdint-intn.h /usr/include/endian.h \
+ /usr/include/x86_64-linux-gnu/bits/endian.h \
+ /usr/include/x86_64-linux-gnu/bits/endianness.h \
+ /usr/include/x86_64-linux-gnu/bits/byteswap.h \
+ /usr/include/x86_64-linux-gnu/bits/uintn-identity.h \
+ /usr/include/x86_64-linux-gnu/sys/select.h \
+ /usr/include/x86_64-linux-gnu/bits/select.h \
+ /usr/include/x86_64-linux-gnu/bits/types/sigset_t.h \
+ /usr/include/x86_64-linux-gnu/bits/types/__sigset_t.h \
+ /usr/include/x86_64-linux-gnu/bits/types/struct_timeval.h \
+ /usr/include/x86_64-linux-gnu/bits/types/struct_timespec.h \
+ /usr/include/x86_64-linux-gnu/bits/pthreadtypes.h \
+ /usr/include/x86_64-linux-gnu/bits/thread-shared-types.h \
+ /usr/include/x86_64-linux-gnu/bits/pthreadtypes-arch.h \
+ /usr/include/x86_64-linux-gnu/bits/atomic_wide_counter.h \
+ /usr/include/x86_64-linux-gnu/bits/struct_mutex.h \
+ /usr/include/x86_64-linux-gnu/bits/struct_rwlock.h /usr/include/alloca.h \
+ /usr/include/x86_64-linux-gnu/bits/stdlib-float.h \
+ /usr/include/c++/12/sstream /usr/include/c++/12/istream \
+ /usr/include/c++/12/ios /usr/include/c++/12/iosfwd \
+ /usr/include/c++/12/bits/stringfwd.h /usr/include/c++/12/bits/postypes.h \
+ /usr/include/c++/12/cwchar /usr/include/wchar.h \
+ /usr/lib/gcc/x86_64-linux-gnu/12/include/stdarg.h \
+ /usr/include/x86_64-linux-gnu/bits/wchar.h \
+ /usr/include/x86_64-linux-gnu/bits/types/wint_t.h \
+ /usr/include/x86_64-linux-gnu/bits/types/mbstate_t.h \
+ /usr/include/x86_64-linux-gnu/bits/types/__mbstate_t.h \
+ /usr/include/x86_64-linux-gnu/bits/types/__FILE.h \
+ /usr/include/x86_64-linux-gnu/bits/types/FILE.h \
+ /usr/include/c++/12/exception /usr/include/c++/12/bits/exception_ptr.h \
+ /usr/include/c++/12/bits/cxxabi_init_exception.h \
+ /usr/include/c++/12/typeinfo /usr/include/c++/12/bits/nested_exception.h \
+ /usr/include/c++/12/bits/char_traits.h /usr/include/c++/12/cstdint \
+ /usr/lib/gcc/x86_64-linux-gnu/12/include/stdint.h /usr/include/stdint.h \
+ /usr/include/x86_64-linux-gnu/bits/stdint-uintn.h \
+ /usr/include/c++/12/bits/localefwd.h \
+ /usr/include/x86_64-linux-gnu/c++/12/bits/c++locale.h \
+ /usr/include/c++/12/clocale /usr/include/locale.h \
+ /usr/include/x86_64-linux-gnu/bits/locale.h /usr/include/c++/12/cctype \
+ /usr/include/ctype.h /usr/include/c++/12/bits/ios_base.h \
+ /usr/include/c++/12/ext/atomicity.h \
+ /usr/include/x86_64-linux-gnu/c++/12/bits/gthr.h \
+ /usr/include/x86_64-linux-gnu/c++/12/bits/gthr-default.h \
+ /usr/include/pthread.h /usr/include/sched.h \
+ /usr/include/x86_64-linux-gnu/bits/sched.h \
+ /usr/include/x86_64-linux-gnu/bits/types/struct_sched_param.h \
+ /usr/include/x86_64-linux-gnu/bits/cpu-set.h /usr/include/time.h \
+ /usr/include/x86_64-linux-gnu/bits/time.h \
+ /usr/include/x86_64-linux-gnu/bits/timex.h \
+ /usr/include/x86_64-linux-gnu/bits/types/struct_tm.h \
+ /usr/include/x86_64-linux-gnu/bits/types/struct_itimerspec.h \
+ /usr/include/x86_64-linux-gnu/bits/setjmp.h \
+ /usr/include/x86_64-linux-gnu/bits/types/struct___jmp_buf_tag.h \
+ /usr/include/x86_64-linux-gnu/bits/pthread_stack_min-dynamic.h \
+ /usr/include/x86_64-linux-gnu/c++/12/bits/atomic_word.h \
+ /usr/include/x86_64-linux-gnu/sys/single_threaded.h \
+ /usr/include/c++/12/bits/locale_classes.h /usr/include/c++/12/string \
+ /usr/include/c++/12/bits/ostream_insert.h \
+ /usr/include/c++/12/bits/cxxabi_forced.h \
+ /usr/include/c++/12/bits/basic_string.h \
+ /usr/include/c++/12/ext/string_conversions.h /usr/include/c++/12/cstdlib \
+ /usr/include/c++/12/cstdio /usr/include/stdio.h \
+ /usr/include/x86_64-linux-gnu/bits/types/__fpos_t.h \
+ /usr/include/x86_64-linux-gnu/bits/types/__fpos64_t.h \
+ /usr/include/x86_64-linux-gnu/bits/types/struct_FILE.h \
+ /usr/include/x86_64-linux-gnu/bits/types/cookie_io_functions_t.h \
+ /usr/include/x86_64-linux-gnu/bits/stdio_lim.h \
+ /usr/include/c++/12/cerrno /usr/include/errno.h \
+ /usr/include/x86_64-linux-gnu/bits/errno.h /usr/include/linux/errno.h \
+ /usr/include/x86_64-linux-gnu/asm/errno.h \
+ /usr/include/asm-generic/errno.h /usr/include/asm-generic/errno-base.h \
+ /usr/include/x86_64-linux-gnu/bits/types/error_t.h \
+ /usr/include/c++/12/bits/charconv.h \
+ /usr/include/c++/12/bits/basic_string.tcc \
+ /usr/include/c++/12/bits/locale_classes.tcc \
+ /usr/include/c++/12/system_error \
+ /usr/include/x86_64-linux-gnu/c++/12/bits/error_constants.h \
+ /usr/include/c++/12/stdexcept /usr/include/c++/12/streambuf \
+ /usr/include/c++/12/bits/streambuf.tcc \
+ /usr/include/c++/12/bits/basic_ios.h \
+ /usr/include/c++/12/bits/locale_facets.h /usr/include/c++/12/cwctype \
+ /usr/include/wctype.h /usr/include/x86_64-linux-gnu/bits/wctype-wchar.h \
+ /usr/include/x86_64-linux-gnu/c++/12/bits/ctype_base.h \
+ /usr/include/c++/12/bits/streambuf_iterator.h \
+ /usr/include/x86_64-linux-gnu/c++/12/bits/ctype_inline.h \
+ /usr/include/c++/12/bits/locale_facets.tcc \
+ /usr/include/c++/12/bits/basic_ios.tcc /usr/include/c++/12/ostream \
+ /usr/include/c++/12/bits/ostream.tcc \
+ /usr/include/c++/12/bits/istream.tcc \
+ /usr/include/c++/12/bits/sstream.tcc \
+ src/application/tools/Eigen/src/Core/util/MKL_support.h \
+ /usr/lib/gcc/x86_64-linux-gnu/12/include/mmintrin.h \
+ /usr/lib/gcc/x86_64-linux-gnu/12/include/emmintrin.h \
+ /usr/lib/gcc/x86_64-linux-gnu/12/include/xmmintrin.h \
+ /usr/lib/gcc/x86_64-linux-gnu/12/include/mm_malloc.h \
+ /usr/include/c++/12/stdlib.h \
+ /usr/lib/gcc/x86_64-linux-gnu/12/include/omp.h \
+ /usr/include/c++/12/cstddef /usr/include/c++/12/cassert \
+ /usr/include/assert.h /usr/include/c++/12/functional \
+ /usr/include/c++/12/tuple /usr/include/c++/12/bits/uses_allocator.h \
+ /usr/include/c++/12/bits/std_function.h /usr/include/c++/12/cstring \
+ /usr/include/string.h /usr/include/strings.h /usr/include/c++/12/limits \
+ /usr/include/c++/12/climits \
+ /usr/lib/gcc/x86_64-linux-gnu/12/include/limits.h \
+ /usr/lib/gcc/x86_64-linux-gnu/12/include/syslimits.h \
+ /usr/include/limits.h /usr/include/x86_64-linux-gnu/bits/posix1_lim.h \
+ /usr/include/x86_64-linux-gnu/bits/local_lim.h \
+ /usr/include/linux/limits.h \
+ /usr/include/x86_64-linux-gnu/bits/posix2_lim.h \
+ /usr/include/x86_64-linux-gnu/bits/xopen_lim.h \
+ /usr/include/x86_64-linux-gnu/bits/uio_lim.h \
+ /usr/include/c++/12/algorithm /usr/include/c++/12/bits/stl_algo.h \
+ /usr/include/c++/12/bits/algorithmfwd.h \
+ /usr/include/c++/12/bits/stl_heap.h \
+ /usr/include/c++/12/bits/stl_tempbuf.h \
+ /usr/include/c++/12/bits/uniform_int_dist.h \
+ src/application/tools/Eigen/src/Core/util/Constants.h \
+ src/application/tools/Eigen/src/Core/util/Meta.h \
+ src/application/tools/Eigen/src/Core/util/ForwardDeclarations.h \
+ src/application/tools/Eigen/src/Core/util/StaticAssert.h \
+ src/application/tools/Eigen/src/Core/util/XprHelper.h \
+ src/application/tools/Eigen/src/Core/util/Memory.h \
+ src/application/tools/Eigen/src/Core/NumTraits.h \
+ src/application/tools/Eigen/src/Core/MathFunctions.h \
+ src/application/tools/Eigen/src/Core/GenericPacketMath.h \
+ src/application/tools/Eigen/src/Core/MathFunctionsImpl.h \
+ src/application/tools/Eigen/src/Core/arch/SSE/PacketMath.h \
+ src/application/tools/Eigen/src/Core/arch/SSE/MathFunctions.h \
+ src/application/tools/Eigen/src/Core/arch/SSE/Complex.h \
+ src/application/tools/Eigen/src/Core/arch/SSE/TypeCasting.h \
+ src/application/tools/Eigen/src/Core/arch/CUDA/Half.h \
+ src/application/tools/Eigen/src/Core/arch/CUDA/PacketMathHalf.h \
+ src/application/tools/Eigen/src/Core/arch/CUDA/TypeCasting.h \
+ src/application/tools/Eigen/src/Core/arch/Default/Settings.h \
+ src/application/tools/Eigen/src/Core/functors/TernaryFunctors.h \
+ src/application/tools/Eigen/src/Core/functors/BinaryFunctors.h \
+ src/application/tools/Eigen/src/Core/functors/UnaryFunctors.h \
+ src/application/tools/Eigen/src/Core/functors/NullaryFunctors.h \
+ src/application/tools/Eigen/src/Core/functors/StlFunctors.h \
+ src/application/tools/Eigen/src/Core/functors/AssignmentFunctors.h \
+ src/application/tools/Eigen/src/Core/arch/CUDA/Complex.h \
+ src/application/tools/Eigen/src/Core/IO.h \
+ src/application/tools/Eigen/src/Core/DenseCoeffsBase.h \
+ src/application/tools/Eigen/src/Core/DenseBase.h \
+ src/application/tools/Eigen/src/Core/../plugins/BlockMethods.h \
+ src/application/tools/Eigen/src/Core/MatrixBase.h \
+ src/application/tools/Eigen/src/Core/../plugins/CommonCwiseUnaryOps.h \
+ src/application/tools/Eigen/src/Core/../plugins/CommonCwiseBinaryOps.h \
+ src/application/tools/Eigen/src/Core/../plugins/MatrixCwiseUnaryOps.h \
+ src/application/tools/Eigen/src/Core/../plugins/MatrixCwiseBinaryOps.h \
+ src/application/tools/Eigen/src/Core/EigenBase.h \
+ src/application/tools/Eigen/src/Core/Product.h \
+ src/application/tools/Eigen/src/Core/CoreEvaluators.h \
+ src/application/tools/Eigen/src/Core/AssignEvaluator.h \
+ src/application/tools/Eigen/src/Core/Assign.h \
+ src/application/tools/Eigen/src/Core/ArrayBase.h \
+ src/application/tools/Eigen/src/Core/../plugins/ArrayCwiseUnaryOps.h \
+ src/application/tools/Eigen/src/Core/../plugins/ArrayCwiseBinaryOps.h \
+ src/application/tools/Eigen/src/Core/util/BlasUtil.h \
+ src/application/tools/Eigen/src/Core/DenseStorage.h \
+ src/application/tools/Eigen/src/Core/NestByValue.h \
+ src/application/tools/Eigen/src/Core/ReturnByValue.h \
+ src/application/tools/Eigen/src/Core/NoAlias.h \
+ src/application/tools/Eigen/src/Core/PlainObjectBase.h \
+ src/application/tools/Eigen/src/Core/Matrix.h \
+ src/application/tools/Eigen/src/Core/Array.h \
+ src/application/tools/Eigen/src/Core/CwiseTernaryOp.h \
+ src/application/tools/Eigen/src/Core/CwiseBinaryOp.h \
+ src/application/tools/Eigen/src/Core/CwiseUnaryOp.h \
+ src/application/tools/Eigen/src/Core/CwiseNullaryOp.h \
+ src/application/tools/Eigen/src/Core/CwiseUnaryView.h \
+ src/application/tools/Eigen/src/Core/SelfCwiseBinaryOp.h \
+ src/application/tools/Eigen/src/Core/Dot.h \
+ src/application/tools/Eigen/src/Core/StableNorm.h \
+ src/application/tools/Eigen/src/Core/Stride.h \
+ src/application/tools/Eigen/src/Core/MapBase.h \
+ src/application/tools/Eigen/src/Core/Map.h \
+ src/application/tools/Eigen/src/Core/Ref.h \
+ src/application/tools/Eigen/src/Core/Block.h \
+ src/application/tools/Eigen/src/Core/VectorBlock.h \
+ src/application/tools/Eigen/src/Core/Transpose.h \
+ src/application/tools/Eigen/src/Core/DiagonalMatrix.h \
+ src/application/tools/Eigen/src/Core/Diagonal.h \
+ src/application/tools/Eigen/src/Core/DiagonalProduct.h \
+ src/application/tools/Eigen/src/Core/Redux.h \
+ src/application/tools/Eigen/src/Core/Visitor.h \
+ src/application/tools/Eigen/src/Core/Fuzzy.h \
+ src/application/tools/Eigen/src/Core/Swap.h \
+ src/application/tools/Eigen/src/Core/CommaInitializer.h \
+ src/application/tools/Eigen/src/Core/GeneralProduct.h \
+ src/application/tools/Eigen/src/Core/Solve.h \
+ src/application/tools/Eigen/src/Core/Inverse.h \
+ src/application/tools/Eigen/src/Core/SolverBase.h \
+ src/application/tools/Eigen/src/Core/PermutationMatrix.h \
+ src/application/tools/Eigen/src/Core/Transpositions.h \
+ src/application/tools/Eigen/src/Core/TriangularMatrix.h \
+ src/application/tools/Eigen/src/Core/SelfAdjointView.h \
+ src/application/tools/Eigen/src/Core/products/GeneralBlockPanelKernel.h \
+ src/application/tools/Eigen/src/Core/products/Parallelizer.h \
+ src/application/tools/Eigen/src/Core/ProductEvaluators.h \
+ src/application/tools/Eigen/src/Core/products/GeneralMatrixVector.h \
+ src/application/tools/Eigen/src/Core/products/GeneralMatrixMatrix.h \
+ src/application/tools/Eigen/src/Core/SolveTriangular.h \
+ src/application/tools/Eigen/src/Core/products/GeneralMatrixMatrixTriangular.h \
+ src/application/tools/Eigen/src/Core/products/SelfadjointMatrixVector.h \
+ src/application/tools/Eigen/src/Core/products/SelfadjointMatrixMatrix.h \
+ src/application/tools/Eigen/src/Core/products/SelfadjointProduct.h \
+ src/application/tools/Eigen/src/Core/products/SelfadjointRank2Update.h \
+ src/application/tools/Eigen/src/Core/products/TriangularMatrixVector.h \
+ src/application/tools/Eigen/src/Core/products/TriangularMatrixMatrix.h \
+ src/application/tools/Eigen/src/Core/products/TriangularSolverMatrix.h \
+ src/application/tools/Eigen/src/Core/products/TriangularSolverVector.h \
+ src/application/tools/Eigen/src/Core/BandMatrix.h \
+ src/application/tools/Eigen/src/Core/CoreIterators.h \
+ src/application/tools/Eigen/src/Core/ConditionEstimator.h \
+ src/application/tools/Eigen/src/Core/BooleanRedux.h \
+ src/application/tools/Eigen/src/Core/Select.h \
+ src/application/tools/Eigen/src/Core/VectorwiseOp.h \
+ src/application/tools/Eigen/src/Core/Random.h \
+ src/application/tools/Eigen/src/Core/Replicate.h \
+ src/application/tools/Eigen/src/Core/Reverse.h \
+ src/application/tools/Eigen/src/Core/ArrayWrapper.h \
+ src/application/tools/Eigen/src/Core/GlobalFunctions.h \
+ src/application/tools/Eigen/src/Core/util/ReenableStupidWarnings.h \
+ src/application/tools/Eigen/Cholesky src/application/tools/Eigen/Core \
+ src/application/tools/Eigen/src/Cholesky/LLT.h \
+ src/application/tools/Eigen/src/Cholesky/LDLT.h \
+ src/application/tools/Eigen/LU \
+ src/application/tools/Eigen/src/misc/Kernel.h \
+ src/application/tools/Eigen/src/misc/Image.h \
+ src/application/tools/Eigen/src/LU/FullPivLU.h \
+ src/application/tools/Eigen/src/LU/PartialPivLU.h \
+ src/application/tools/Eigen/src/LU/Determinant.h \
+ src/application/tools/Eigen/src/LU/InverseImpl.h \
+ src/application/tools/Eigen/src/LU/arch/Inverse_SSE.h
@@ -0,0 +1,2 @@
+objs/tensorRT/import_lib.cpp.o: src/tensorRT/import_lib.cpp \
+ /usr/include/stdc-predef.h
@@ -126,12 +126,11 @@ namespace AlphaPose{
                         output_point.z = confidence;
                         tie(output_point.x, output_point.y) = affine_project(x, y, job.additional.d2i);
                     }
-                    job.pro->set_value(job.output);
+                    job.pro.set_value(job.output);
                 }
                 fetch_jobs.clear();
             }
             stream_ = nullptr;
-            tensor_allocator_.reset();
             INFO("Engine destroy.");
         }
 
@@ -136,12 +136,11 @@ namespace Arcface{
                     float* image_based_output = output->cpu<float>(ibatch);
 
                     memcpy(job.output.ptr<float>(0), image_based_output, sizeof(float) * feature_length_);
-                    job.pro->set_value(job.output);
+                    job.pro.set_value(job.output);
                 }
                 fetch_jobs.clear();
             }
             stream_ = nullptr;
-            tensor_allocator_.reset();
             INFO("Engine destroy.");
         }
 
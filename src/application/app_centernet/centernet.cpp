@@ -9,17 +9,22 @@
 #include <common/preprocess_kernel.cuh>
 #include <common/monopoly_allocator.hpp>
 #include <common/cuda_tools.hpp>
+#include <common/box_decoder.hpp>
 
 
 namespace CenterNet{
     using namespace cv;
     using namespace std;
 
-    void decode_kernel_invoker(float* predict, int num_boxes, int num_channels, int num_classes,
+    static void decode_kernel_invoker(float* predict, int num_boxes, int num_channels, int num_classes,
         int fm_width, int fm_height, int stride,
         float conf_T, float nms_threshold, float* invert_affine_matrix, float* parray, 
         int max_objects, cudaStream_t stream
-    );
+    ){
+        BoxDecoder::CenterNetHead head(predict, num_channels, num_classes, fm_width, stride, conf_T, invert_affine_matrix);
+        BoxDecoder::decode_gpu(head, num_boxes, parray, max_objects, stream);
+        BoxDecoder::fast_nms_gpu<BoxDecoder::ObjectBox>(parray, max_objects, nms_threshold, stream);
+    }
 
     struct AffineMatrix{
         float i2d[6];       // image to dst(network), 2x3 matrix
@@ -169,12 +174,11 @@ namespace CenterNet{
                             image_based_boxes.emplace_back(pbox[0], pbox[1], pbox[2], pbox[3], pbox[4], label);
                         }
                     }
-                    job.pro->set_value(image_based_boxes);
+                    job.pro.set_value(image_based_boxes);
                 }
                 fetch_jobs.clear();
             }
             stream_ = nullptr;
-            tensor_allocator_.reset();
             INFO("Engine destroy.");
         }
 
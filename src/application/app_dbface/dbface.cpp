@@ -9,17 +9,22 @@
 #include <common/preprocess_kernel.cuh>
 #include <common/monopoly_allocator.hpp>
 #include <common/cuda_tools.hpp>
+#include <common/box_decoder.hpp>
 
 
 namespace DBFace{
     using namespace cv;
     using namespace std;
 
-    void decode_kernel_invoker(float* pool_hm_ptr, float* hm_ptr, float* tlrb_ptr, float* landmark_ptr,
+    static void decode_kernel_invoker(float* pool_hm_ptr, float* hm_ptr, float* tlrb_ptr, float* landmark_ptr,
         int fm_width, int fm_height, int stride,
         float conf_T, float nms_threshold, float* invert_affine_matrix, float* parray, 
         int max_objects, cudaStream_t stream
-    );
+    ){
+        BoxDecoder::DBFaceHead head(pool_hm_ptr, hm_ptr, tlrb_ptr, landmark_ptr, fm_width, fm_height, stride, conf_T, invert_affine_matrix);
+        BoxDecoder::decode_gpu(head, fm_width * fm_height, parray, max_objects, stream);
+        BoxDecoder::fast_nms_gpu<BoxDecoder::DBFaceBox>(parray, max_objects, nms_threshold, stream);
+    }
 
     struct AffineMatrix{
         float i2d[6];       // image to dst(network), 2x3 matrix
@@ -181,12 +186,11 @@ namespace DBFace{
                             image_based_boxes.emplace_back(box);
                         }
                     }
-                    job.pro->set_value(image_based_boxes);
+                    job.pro.set_value(image_based_boxes);
                 }
                 fetch_jobs.clear();
             }
             stream_ = nullptr;
-            tensor_allocator_.reset();
             INFO("Engine destroy.");
         }
 
@@ -97,12 +97,11 @@ namespace FallGCN{
 
                     int label = std::max_element(item_based_output, item_based_output + output->channel()) - item_based_output;
                     output_state = make_tuple((FallState)label, item_based_output[label]);
-                    job.pro->set_value(output_state);
+                    job.pro.set_value(output_state);
                 }
                 fetch_jobs.clear();
             }
             stream_ = nullptr;
-            tensor_allocator_.reset();
             INFO("Engine destroy.");
         }
 
@@ -124,7 +124,7 @@ namespace AlphaPoseHighPerf{
                         output_point.z = confidence;
                         tie(output_point.x, output_point.y) = affine_project(x, y, job.additional.d2i);
                     }
-                    job.pro->set_value(image_based_keypoints);
+                    job.pro.set_value(image_based_keypoints);
                 }
                 fetch_jobs.clear();
             }
@@ -202,7 +202,7 @@ namespace YoloHighPerf{
                             image_based_boxes->emplace_back(pbox[0], pbox[1], pbox[2], pbox[3], pbox[4], label);
                         }
                     }
-                    job.pro->set_value(image_based_boxes);
+                    job.pro.set_value(image_based_boxes);
                 }
                 fetch_jobs.clear();
             }
@@ -9,17 +9,22 @@
 #include <common/preprocess_kernel.cuh>
 #include <common/monopoly_allocator.hpp>
 #include <common/cuda_tools.hpp>
+#include <common/box_decoder.hpp>
 
 namespace RetinaFace{
     using namespace cv;
     using namespace std;
 
-    void decode_kernel_invoker(
+    static void decode_kernel_invoker(
         float* predict, int num_bboxes, float confidence_threshold, 
         float nms_threshold, float* invert_affine_matrix, float* parray,
         int max_objects, float* prior,
         cudaStream_t stream
-    );
+    ){
+        BoxDecoder::RetinaFaceHead head(predict, prior, confidence_threshold, invert_affine_matrix);
+        BoxDecoder::decode_gpu(head, num_bboxes, parray, max_objects, stream);
+        BoxDecoder::fast_nms_gpu<BoxDecoder::FaceBox>(parray, max_objects, nms_threshold, stream);
+    }
 
     struct AffineMatrix{
         float i2d[6];       // image to dst(network), 2x3 matrix
@@ -207,12 +212,11 @@ namespace RetinaFace{
                             image_based_boxes.emplace_back(box);
                         }
                     }
-                    job.pro->set_value(image_based_boxes);
+                    job.pro.set_value(image_based_boxes);
                 }
                 fetch_jobs.clear();
             }
             stream_ = nullptr;
-            tensor_allocator_.reset();
             INFOV("Engine destroy.");
         }
 
@@ -177,6 +177,7 @@ int app_yolo(){
     test(Yolo::Type::V7, TRT::Mode::FP32, "yolov7");
     //test(Yolo::Type::V5, TRT::Mode::FP32, "yolov5s");
     //test(Yolo::Type::V3, TRT::Mode::FP32, "yolov3");
+    //test(Yolo::Type::V8, TRT::Mode::FP32, "yolov8s");
 
     // multi_gpu_test();
     //iLogger::set_log_level(iLogger::LogLevel::Debug);
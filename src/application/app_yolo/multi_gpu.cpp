@@ -1,7 +1,9 @@
 #include "multi_gpu.hpp"
 #include <atomic>
+#include <mutex>
 #include <ostream>
 #include <common/ilogger.hpp>
+#include <common/thread_pool.hpp>
 
 namespace Yolo{
 
@@ -10,7 +12,7 @@ namespace Yolo{
         virtual bool startup(
             const string& engine_file, Type type, const vector<int> gpuids, 
             float confidence_threshold, float nms_threshold,
-            NMSMethod nms_method, int max_objects
+            NMSMethod nms_method, int max_objects, RoutePolicy route_policy
         ){
             if(gpuids.empty()){
                 INFOE("gpuids is empty");
@@ -39,40 +41,249 @@ namespace Yolo{
                     return false;
                 }
             }
+
+            // 这里不能持有infers_的shared_ptr，否则回调中的balancer会让推理器无法析构
+            vector<Infer*> infers;
+            for(auto& infer : infers_)
+                infers.push_back(infer.get());
+
+            balancer_ = make_shared<LoadBalancer>(infers.size(), [infers](int device){
+                return infers[device]->num_outstanding_jobs();
+            }, route_policy);
+
+            // commits分片后并行提交到各个GPU，避免一个GPU的反压阻塞其他GPU的提交
+            if(infers_.size() > 1)
+                commit_pool_ = make_shared<ThreadPool>(infers_.size() - 1);
             return true;
         }
 
     protected:
         vector<shared_ptr<Infer>> infers_;
+        shared_ptr<LoadBalancer> balancer_;
+        shared_ptr<ThreadPool> commit_pool_;
     };
 
     class BalancedImpl : public MultiGPUInfer, public MultiGPUInferImpl{
     public:
-        int get_gpu_index(){
-            return ((cursor_++) + 1) % infers_.size();
+        /* 每张图的路由记录，结果交付时把耗时上报给balancer
+           提交过程中就交付的结果(被拒绝、预处理失败)没有经过推理，不上报，否则会把该GPU误判为很快
+           推理很快时结果也可能在commit返回前交付，此时先记下交付时间，由commit返回后根据提交结果决定是否上报
+        */
+        struct RouteTicket{
+            int device      = 0;
+            int outstanding = 0;
+            double commit_time = 0;
+
+            mutex lock;
+            bool submitted      = false;    // commit已经返回
+            bool accepted       = false;
+            double finish_time  = -1;       // 结果在commit返回前交付的时间，<0表示还没有交付
+        };
+
+        virtual void set_route_policy(RoutePolicy policy) override{
+            balancer_->set_policy(policy);
+        }
+
+        virtual RoutePolicy route_policy() override{
+            return balancer_->policy();
         }
 
         virtual shared_future<BoxArray> commit(const cv::Mat& image) override{
-            return infers_[get_gpu_index()]->commit(image);
+            return commit(image, (CommitError*)nullptr);
+        }
+
+        virtual shared_future<BoxArray> commit(const cv::Mat& image, CommitError* error) override{
+            auto pro = make_shared<promise<BoxArray>>();
+            CommitError result = commit_async(image, [pro](const BoxArray& boxes){
+                pro->set_value(boxes);
+            });
+
+            if(error) *error = result;
+            return pro->get_future();
+        }
+
+        virtual CommitError commit_async(const cv::Mat& image, const Callback& callback) override{
+            int device  = balancer_->select();
+            auto ticket = make_ticket(device);
+            auto error  = infers_[device]->commit_async(image, routed_callback(ticket, callback));
+            submit_ticket(ticket, error);
+            return error;
+        }
+
+        virtual CommitError commit(const cv::Mat& image, const shared_ptr<CompletionQueue<BoxArray>>& queue, uint64_t tag) override{
+            return commit_async(image, [queue, tag](const BoxArray& boxes){
+                queue->push(tag, boxes);
+            });
         }
 
         virtual vector<shared_future<BoxArray>> commits(const vector<cv::Mat>& images) override{
-            return infers_[get_gpu_index()]->commits(images);
+
+            vector<Callback> callbacks(images.size());
+            vector<shared_future<BoxArray>> results(images.size());
+            for(int i = 0; i < images.size(); ++i){
+                auto pro = make_shared<promise<BoxArray>>();
+                results[i]   = pro->get_future();
+                callbacks[i] = [pro](const BoxArray& boxes){
+                    pro->set_value(boxes);
+                };
+            }
+            commits_async(images, callbacks);
+            return results;
+        }
+
+        virtual vector<CommitError> commits(const vector<cv::Mat>& images, const shared_ptr<CompletionQueue<BoxArray>>& queue, uint64_t first_tag) override{
+
+            vector<Callback> callbacks(images.size());
+            for(int i = 0; i < images.size(); ++i){
+                uint64_t tag = first_tag + i;
+                callbacks[i] = [queue, tag](const BoxArray& boxes){
+                    queue->push(tag, boxes);
+                };
+            }
+            return commits_async(images, callbacks);
+        }
+
+        /* 按照各个GPU的处理能力把images切分为连续的分片，并行提交到各个GPU
+           每张图的结果通过各自的callback交付，因此future与tag的顺序与images一致
+        */
+        virtual vector<CommitError> commits_async(const vector<cv::Mat>& images, const vector<Callback>& callbacks) override{
+
+            vector<CommitError> errors(images.size(), CommitError::None);
+            if(images.empty())
+                return errors;
+
+            auto counts = balancer_->split(images.size());
+            vector<int> offsets(counts.size() + 1, 0);
+            for(int i = 0; i < counts.size(); ++i)
+                offsets[i + 1] = offsets[i] + counts[i];
+
+            auto commit_shard = [&](int device){
+                int begin = offsets[device];
+                int end   = offsets[device + 1];
+                if(begin == end) return;
+
+                vector<cv::Mat> shard_images(images.begin() + begin, images.begin() + end);
+                vector<shared_ptr<RouteTicket>> tickets(end - begin);
+                vector<Callback> shard_callbacks(end - begin);
+                for(int i = 0; i < tickets.size(); ++i){
+                    tickets[i]         = make_ticket(device);
+                    shard_callbacks[i] = routed_callback(tickets[i], callbacks[begin + i]);
+                }
+
+                auto shard_errors = infers_[device]->commits_async(shard_images, shard_callbacks);
+                for(int i = 0; i < shard_errors.size(); ++i){
+                    submit_ticket(tickets[i], shard_errors[i]);
+                    errors[begin + i] = shard_errors[i];
+                }
+            };
+
+            int num_shards = count_if(counts.begin(), counts.end(), [](int n){return n > 0;});
+            if(num_shards > 1 && commit_pool_){
+                commit_pool_->parallel_for(0, infers_.size(), commit_shard);
+            }else{
+                for(int device = 0; device < infers_.size(); ++device)
+                    commit_shard(device);
+            }
+            return errors;
+        }
+
+        virtual void set_batch_policy(int max_queue_delay_ms, int preferred_batch_size, int job_deadline_ms) override{
+            for(auto& infer : infers_)
+                infer->set_batch_policy(max_queue_delay_ms, preferred_batch_size, job_deadline_ms);
+        }
+
+        virtual void set_preprocess_threads(int num_threads) override{
+            for(auto& infer : infers_)
+                infer->set_preprocess_threads(num_threads);
+        }
+
+        virtual void set_queue_limit(int max_queue_size, QueueFullPolicy policy) override{
+            for(auto& infer : infers_)
+                infer->set_queue_limit(max_queue_size, policy);
+        }
+
+        virtual int queue_size() override{
+            int total = 0;
+            for(auto& infer : infers_)
+                total += infer->queue_size();
+            return total;
+        }
+
+        virtual int num_outstanding_jobs() override{
+            int total = 0;
+            for(auto& infer : infers_)
+                total += infer->num_outstanding_jobs();
+            return total;
+        }
+
+        virtual size_t num_rejected_jobs() override{
+            size_t total = 0;
+            for(auto& infer : infers_)
+                total += infer->num_rejected_jobs();
+            return total;
+        }
+
+        virtual size_t num_dropped_jobs() override{
+            size_t total = 0;
+            for(auto& infer : infers_)
+                total += infer->num_dropped_jobs();
+            return total;
         }
 
     private:
-        atomic<unsigned int> cursor_{0};
+        shared_ptr<RouteTicket> make_ticket(int device){
+            auto ticket = make_shared<RouteTicket>();
+            ticket->device      = device;
+            ticket->outstanding = infers_[device]->num_outstanding_jobs();
+            ticket->commit_time = iLogger::timestamp_now_float();
+            return ticket;
+        }
+
+        // commit返回后调用，被接受且结果已经交付时，补上交付时没有上报的耗时
+        void submit_ticket(const shared_ptr<RouteTicket>& ticket, CommitError error){
+            double finish_time = -1;
+            {
+                unique_lock<mutex> l(ticket->lock);
+                ticket->submitted = true;
+                ticket->accepted  = error == CommitError::None;
+                if(ticket->accepted)
+                    finish_time = ticket->finish_time;
+            };
+
+            if(finish_time >= 0)
+                balancer_->report(ticket->device, finish_time - ticket->commit_time, ticket->outstanding);
+        }
+
+        // balancer以shared_ptr捕获，析构时stop交付的结果仍然可以安全上报
+        Callback routed_callback(const shared_ptr<RouteTicket>& ticket, const Callback& callback){
+            auto balancer = balancer_;
+            return [balancer, ticket, callback](const BoxArray& boxes){
+                double now  = iLogger::timestamp_now_float();
+                bool report = false;
+                {
+                    unique_lock<mutex> l(ticket->lock);
+                    if(ticket->submitted)
+                        report = ticket->accepted;
+                    else
+                        ticket->finish_time = now;
+                };
+
+                if(report)
+                    balancer->report(ticket->device, now - ticket->commit_time, ticket->outstanding);
+                callback(boxes);
+            };
+        }
     };
 
     shared_ptr<MultiGPUInfer> create_multi_gpu_infer(
         const string& engine_file, Type type, const vector<int> gpuids, 
         float confidence_threshold, float nms_threshold,
-        NMSMethod nms_method, int max_objects
+        NMSMethod nms_method, int max_objects, RoutePolicy route_policy
     ){
         shared_ptr<MultiGPUInfer> instance(new BalancedImpl());
         auto impl = std::dynamic_pointer_cast<MultiGPUInferImpl>(instance);
         if(!impl->startup(
-            engine_file, type, gpuids, confidence_threshold, nms_threshold, nms_method, max_objects
+            engine_file, type, gpuids, confidence_threshold, nms_threshold, nms_method, max_objects, route_policy
         )){
             instance.reset();
         }
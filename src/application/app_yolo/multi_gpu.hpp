@@ -2,15 +2,22 @@
 #define YOLO_MULTI_GPU_HPP
 
 #include "yolo.hpp"
+#include <common/load_balancer.hpp>
 
 namespace Yolo{
 
-    class MultiGPUInfer : public Yolo::Infer{};
+    class MultiGPUInfer : public Yolo::Infer{
+    public:
+        // 单张图的commit按照路由策略选择GPU，默认为轮询
+        virtual void set_route_policy(RoutePolicy policy) = 0;
+        virtual RoutePolicy route_policy() = 0;
+    };
 
     shared_ptr<MultiGPUInfer> create_multi_gpu_infer(
         const string& engine_file, Type type, const vector<int> gpuids, 
         float confidence_threshold=0.25f, float nms_threshold=0.5f,
-        NMSMethod nms_method = NMSMethod::FastGPU, int max_objects = 1024
+        NMSMethod nms_method = NMSMethod::FastGPU, int max_objects = 1024,
+        RoutePolicy route_policy = RoutePolicy::RoundRobin
     );
 };
 
@@ -1,13 +1,23 @@
 #include "yolo.hpp"
+#include "yolo_decode_cpu.hpp"
 #include <atomic>
 #include <mutex>
-#include <queue>
+#include <thread>
 #include <condition_variable>
 #include <infer/trt_infer.hpp>
+#include <infer/dnn_infer.hpp>
 #include <common/ilogger.hpp>
 #include <common/infer_controller.hpp>
 #include <common/preprocess_kernel.cuh>
+#include <common/topk_kernel.cuh>
+#include <common/box_decoder.hpp>
+#include <common/topk_cpu.hpp>
+#include <common/preprocess_cpu.hpp>
+#include <common/remap_cache.hpp>
+#include <common/thread_pool.hpp>
+#include <common/nms.hpp>
 #include <common/monopoly_allocator.hpp>
+#include <common/ring_queue.hpp>
 #include <common/cuda_tools.hpp>
 
 namespace Yolo{
@@ -19,20 +29,52 @@ namespace Yolo{
         case Type::V5: return "YoloV5";
         case Type::V3: return "YoloV3";
         case Type::V7: return "YoloV7";
+        case Type::V8: return "YoloV8";
         case Type::X: return "YoloX";
         default: return "Unknow";
         }
     }
 
+    // 80类(COCO)时类别数在编译期确定，argmax的循环可以展开
+    // 这两个函数也被YoloHighPerf与direct_yolo使用
     void decode_kernel_invoker(
         float* predict, int num_bboxes, int num_classes, float confidence_threshold, 
         float* invert_affine_matrix, float* parray,
         int max_objects, cudaStream_t stream
-    );
+    ){
+        BoxDecoder::RowMajor layout(predict, 5 + num_classes);
+        BoxDecoder::AffineMatrix matrix(invert_affine_matrix);
+        if(num_classes == 80){
+            BoxDecoder::YoloRowHead80 head(layout, BoxDecoder::DecodedAnchor(), matrix, num_classes, confidence_threshold);
+            BoxDecoder::decode_gpu(head, num_bboxes, parray, max_objects, stream);
+        }else{
+            BoxDecoder::YoloRowHead head(layout, BoxDecoder::DecodedAnchor(), matrix, num_classes, confidence_threshold);
+            BoxDecoder::decode_gpu(head, num_bboxes, parray, max_objects, stream);
+        }
+    }
+
+    // [4 + C, N]的输出直接按通道读取，相邻线程访问相邻的地址，不需要转置
+    static void decode_channel_major_kernel_invoker(
+        float* predict, int num_bboxes, int num_classes, float confidence_threshold, 
+        float* invert_affine_matrix, float* parray,
+        int max_objects, cudaStream_t stream
+    ){
+        BoxDecoder::Planar layout(predict, 4 + num_classes, num_bboxes);
+        BoxDecoder::AffineMatrix matrix(invert_affine_matrix);
+        if(num_classes == 80){
+            BoxDecoder::YoloV8Head80 head(layout, matrix, num_classes, confidence_threshold);
+            BoxDecoder::decode_gpu(head, num_bboxes, parray, max_objects, stream);
+        }else{
+            BoxDecoder::YoloV8Head head(layout, matrix, num_classes, confidence_threshold);
+            BoxDecoder::decode_gpu(head, num_bboxes, parray, max_objects, stream);
+        }
+    }
 
     void nms_kernel_invoker(
         float* parray, float nms_threshold, int max_objects, cudaStream_t stream
-    );
+    ){
+        BoxDecoder::fast_nms_gpu<BoxDecoder::ObjectBox>(parray, max_objects, nms_threshold, stream);
+    }
 
     struct AffineMatrix{
         float i2d[6];       // image to dst(network), 2x3 matrix
@@ -101,50 +143,97 @@ namespace Yolo{
         }
     };
 
-    static float iou(const Box& a, const Box& b){
-        float cleft 	= max(a.left, b.left);
-        float ctop 		= max(a.top, b.top);
-        float cright 	= min(a.right, b.right);
-        float cbottom 	= min(a.bottom, b.bottom);
-        
-        float c_area = max(cright - cleft, 0.0f) * max(cbottom - ctop, 0.0f);
-        if(c_area == 0.0f)
-            return 0.0f;
-        
-        float a_area = max(0.0f, a.right - a.left) * max(0.0f, a.bottom - a.top);
-        float b_area = max(0.0f, b.right - b.left) * max(0.0f, b.bottom - b.top);
-        return c_area / (a_area + b_area - c_area);
-    }
+    /* 有界交接队列，用于worker内部各个stage之间传递数据
+       push在队列满时阻塞，pop在队列空时阻塞，close之后pop取完剩余数据后返回false
+       使用RingQueue存储，push/pop不申请内存
+    */
+    template<class _T>
+    class HandoffQueue{
+    public:
+        HandoffQueue(int capacity):capacity_(capacity), queue_(capacity){}
+
+        void push(_T&& item){
+            unique_lock<mutex> l(lock_);
+            cv_.wait(l, [&](){return closed_ || (int)queue_.size() < capacity_;});
+            if(closed_) return;
+
+            queue_.push(move(item));
+            cv_.notify_all();
+        }
 
-    static BoxArray cpu_nms(BoxArray& boxes, float threshold){
+        void push(const _T& item){
+            _T copyed = item;
+            push(move(copyed));
+        }
 
-        std::sort(boxes.begin(), boxes.end(), [](BoxArray::const_reference a, BoxArray::const_reference b){
-            return a.confidence > b.confidence;
-        });
+        bool pop(_T& item){
+            unique_lock<mutex> l(lock_);
+            cv_.wait(l, [&](){return closed_ || !queue_.empty();});
+            if(queue_.empty()) return false;
 
-        BoxArray output;
-        output.reserve(boxes.size());
+            item = move(queue_.front());
+            queue_.pop();
+            cv_.notify_all();
+            return true;
+        }
 
-        vector<bool> remove_flags(boxes.size());
-        for(int i = 0; i < boxes.size(); ++i){
+        void close(){
+            unique_lock<mutex> l(lock_);
+            closed_ = true;
+            cv_.notify_all();
+        }
 
-            if(remove_flags[i]) continue;
+    private:
+        int capacity_ = 0;
+        bool closed_  = false;
+        RingQueue<_T> queue_;
+        mutex lock_;
+        condition_variable cv_;
+    };
 
-            auto& a = boxes[i];
-            output.emplace_back(a);
+    // 各个stage的累计耗时(ms)，用于判断瓶颈在哪里，推理线程与后处理线程都会更新
+    class PipelineOccupancy{
+    public:
+        PipelineOccupancy(){begin_time_ = iLogger::timestamp_now_float();}
 
-            for(int j = i + 1; j < boxes.size(); ++j){
-                if(remove_flags[j]) continue;
-                
-                auto& b = boxes[j];
-                if(b.class_label == a.class_label){
-                    if(iou(a, b) >= threshold)
-                        remove_flags[j] = true;
-                }
-            }
+        // 拷贝输入、提交推理与decode的时间
+        void add_inference(double ms){
+            unique_lock<mutex> l(lock_);
+            inference_ += ms;
+            num_batches_++;
+        }
+
+        // gpu_wait_ms：后处理线程等待GPU完成的时间，postprocess_ms：解析输出、CPU NMS、set_value的时间
+        void add_postprocess(double gpu_wait_ms, double postprocess_ms){
+            unique_lock<mutex> l(lock_);
+            gpu_wait_    += gpu_wait_ms;
+            postprocess_ += postprocess_ms;
+        }
+
+        size_t num_batches(){
+            unique_lock<mutex> l(lock_);
+            return num_batches_;
         }
-        return output;
-    }
+
+        string description(){
+            unique_lock<mutex> l(lock_);
+            double elapsed = max(1e-3, iLogger::timestamp_now_float() - begin_time_);
+            return iLogger::format(
+                "Pipeline occupancy, batches = %d, inference = %.1f%%, gpu wait = %.1f%%, postprocess = %.1f%%",
+                (int)num_batches_, inference_ / elapsed * 100, gpu_wait_ / elapsed * 100, postprocess_ / elapsed * 100
+            );
+        }
+
+    private:
+        mutex lock_;
+        double begin_time_  = 0;
+        double inference_   = 0;
+        double gpu_wait_    = 0;
+        double postprocess_ = 0;
+        size_t num_batches_ = 0;
+    };
+
+    static const int NUM_PIPELINE_SLOTS = 2;
 
     using ControllerImpl = InferController
     <
@@ -155,19 +244,46 @@ namespace Yolo{
     >;
     class InferImpl : public Infer, public ControllerImpl{
     public:
+        // slot之间通过swap交换jobs，vector的容量在推理线程与后处理线程之间循环复用
+        struct PipelineSlot{
+            shared_ptr<TRT::Tensor> output_array;
+            cudaEvent_t ready = nullptr;
+            vector<Job> jobs;
+        };
+
+        /* 每个输入tensor一组事件，以allocator中的序号索引
+           ready：预处理完成，worker的stream在GPU上等待它，不阻塞host，也不与其他worker的推理串行
+           consumed：worker已经把数据拷贝走，下一次预处理写入同一个tensor前等待它
+        */
+        struct TensorEvents{
+            cudaEvent_t ready    = nullptr;
+            cudaEvent_t consumed = nullptr;
+        };
 
         /** 要求在InferImpl里面执行stop，而不是在基类执行stop **/
         virtual ~InferImpl(){
             stop();
+
+            // worker都已经退出，预处理共享的stream与事件在这里释放
+            if(preprocess_stream_ != nullptr || !tensor_events_.empty()){
+                CUDATools::AutoDevice auto_device(gpu_);
+                for(auto& events : tensor_events_){
+                    checkCudaRuntime(cudaEventDestroy(events.ready));
+                    checkCudaRuntime(cudaEventDestroy(events.consumed));
+                }
+                if(preprocess_stream_ != nullptr)
+                    checkCudaRuntime(cudaStreamDestroy(preprocess_stream_));
+            }
         }
 
         virtual bool startup(
             const string& file, Type type, int gpuid, 
             float confidence_threshold, float nms_threshold,
             NMSMethod nms_method, int max_objects,
-            bool use_multi_preprocess_stream
+            bool use_multi_preprocess_stream, int num_workers,
+            TRT::Backend backend
         ){
-            if(type == Type::V5 || type == Type::V3 || type == Type::V7){
+            if(type == Type::V5 || type == Type::V3 || type == Type::V7 || type == Type::V8){
                 normalize_ = CUDAKernel::Norm::alpha_beta(1 / 255.0f, 0.0f, CUDAKernel::ChannelType::Invert);
             }else if(type == Type::X){
                 //float mean[] = {0.485, 0.456, 0.406};
@@ -178,115 +294,336 @@ namespace Yolo{
                 INFOE("Unsupport type %d", type);
             }
             
+            type_                 = type;
             use_multi_preprocess_stream_ = use_multi_preprocess_stream;
             confidence_threshold_ = confidence_threshold;
             nms_threshold_        = nms_threshold;
             nms_method_           = nms_method;
             max_objects_          = max_objects;
-            return ControllerImpl::startup(make_tuple(file, gpuid));
+            backend_              = backend;
+            if(backend_ == TRT::Backend::OpenCVDNN){
+                cpu_preprocess_pool_ = make_shared<ThreadPool>();
+                remap_cache_         = make_shared<CPUKernel::RemapCache>();
+            }
+            return ControllerImpl::startup(make_tuple(file, gpuid), num_workers);
         }
 
         virtual void worker(promise<bool>& result) override{
+            worker(result, 0);
+        }
+
+        virtual void worker(promise<bool>& result, int worker_index) override{
+
+            if(backend_ == TRT::Backend::OpenCVDNN){
+                cpu_worker(result, worker_index);
+                return;
+            }
 
             string file = get<0>(start_param_);
             int gpuid   = get<1>(start_param_);
 
             TRT::set_device(gpuid);
-            auto engine = TRT::load_infer(file);
+            shared_ptr<TRT::Infer> engine;
+            if(worker_index == 0){
+                engine = TRT::load_infer(file);
+            }else{
+                // 其他worker与0号worker共享引擎，但使用独立的context和stream
+                engine = shared_engine_->clone_context();
+            }
+
             if(engine == nullptr){
-                INFOE("Engine %s load failed", file.c_str());
+                INFOE("Engine %s load failed, worker = %d", file.c_str(), worker_index);
                 result.set_value(false);
                 return;
             }
 
-            engine->print();
+            if(worker_index == 0)
+                engine->print();
 
             const int MAX_IMAGE_BBOX  = max_objects_;
             const int NUM_BOX_ELEMENT = 7;      // left, top, right, bottom, confidence, class, keepflag
             TRT::Tensor affin_matrix_device(TRT::DataType::Float);
-            TRT::Tensor output_array_device(TRT::DataType::Float);
             int max_batch_size = engine->get_max_batch_size();
             auto input         = engine->tensor("images");
             auto output        = engine->tensor("output");
-            int num_classes    = output->size(2) - 5;
-
-            input_width_       = input->size(3);
-            input_height_      = input->size(2);
-            tensor_allocator_  = make_shared<MonopolyAllocator<TRT::Tensor>>(max_batch_size * 2);
-            stream_            = engine->get_stream();
-            gpu_               = gpuid;
+            bool channel_major = type_ == Type::V8;
+            int num_bboxes     = channel_major ? output->size(2) : output->size(1);
+            int num_classes    = channel_major ? output->size(1) - 4 : output->size(2) - 5;
+            auto stream        = engine->get_stream();
+            auto decode_kernel = channel_major ? decode_channel_major_kernel_invoker : decode_kernel_invoker;
+
+            if(worker_index == 0){
+                input_width_       = input->size(3);
+                input_height_      = input->size(2);
+                tensor_allocator_  = make_shared<MonopolyAllocator<TRT::Tensor>>(max_batch_size * 2 * num_workers_);
+                gpu_               = gpuid;
+                shared_engine_     = engine;
+
+                // 共享的预处理stream独立于各个worker的推理stream，否则其他worker等待预处理时也要等0号worker的推理
+                if(!use_multi_preprocess_stream_)
+                    checkCudaRuntime(cudaStreamCreate(&preprocess_stream_));
+
+                tensor_events_.resize(tensor_allocator_->capacity());
+                for(auto& events : tensor_events_){
+                    checkCudaRuntime(cudaEventCreateWithFlags(&events.ready, cudaEventDisableTiming));
+                    checkCudaRuntime(cudaEventCreateWithFlags(&events.consumed, cudaEventDisableTiming));
+                }
+            }
             result.set_value(true);
 
             input->resize_single_dim(0, max_batch_size).to_gpu();
-            affin_matrix_device.set_stream(stream_);
+            affin_matrix_device.set_stream(stream);
 
             // 这里8个值的目的是保证 8 * sizeof(float) % 32 == 0
             affin_matrix_device.resize(max_batch_size, 8).to_gpu();
 
+            // 候选box多于MAX_IMAGE_BBOX时，先解码全部候选，再按分数保留前MAX_IMAGE_BBOX个
+            // 而不是按先到先得截断，避免密集场景下高分的box被丢掉。同一个stream上逐图像执行，只需要一份
+            bool use_topk = num_bboxes > MAX_IMAGE_BBOX;
+            TRT::Tensor candidates_device(TRT::DataType::Float);
+            if(use_topk){
+                candidates_device.set_stream(stream);
+                candidates_device.resize(1 + num_bboxes * NUM_BOX_ELEMENT).to_gpu();
+            }
+
+            // 输出使用双缓冲，后处理线程解析batch N时，推理线程可以继续推理batch N+1
             // 这里的 1 + MAX_IMAGE_BBOX结构是，counter + bboxes ...
-            output_array_device.resize(max_batch_size, 1 + MAX_IMAGE_BBOX * NUM_BOX_ELEMENT).to_gpu();
+            const int output_array_size = 1 + MAX_IMAGE_BBOX * NUM_BOX_ELEMENT;
+            vector<PipelineSlot> slots(NUM_PIPELINE_SLOTS);
+            HandoffQueue<int> free_slots(NUM_PIPELINE_SLOTS);
+            HandoffQueue<int> ready_slots(NUM_PIPELINE_SLOTS);
+            for(int islot = 0; islot < slots.size(); ++islot){
+                auto& slot = slots[islot];
+                slot.output_array = make_shared<TRT::Tensor>(TRT::DataType::Float);
+                slot.output_array->set_stream(stream);
+                slot.output_array->resize(max_batch_size, output_array_size).to_gpu();
+                slot.output_array->get_data()->cpu(slot.output_array->bytes());
+                slot.jobs.reserve(max_batch_size);
+                checkCudaRuntime(cudaEventCreateWithFlags(&slot.ready, cudaEventDisableTiming));
+                free_slots.push(islot);
+            }
+
+            PipelineOccupancy occupancy;
+
+            thread postprocess_thread([&](){
+
+                // 一个batch的所有图像一起做CPU NMS
+                NMS::Workspace nms_workspace;
+                vector<BoxArray*> nms_inputs;
+
+                TRT::set_device(gpuid);
+                int islot = 0;
+                while(ready_slots.pop(islot)){
+
+                    auto& slot = slots[islot];
+                    auto tic   = iLogger::timestamp_now_float();
+                    checkCudaRuntime(cudaEventSynchronize(slot.ready));
+
+                    auto toc   = iLogger::timestamp_now_float();
+                    float* host_output_array = (float*)slot.output_array->get_data()->cpu();
+                    for(int ibatch = 0; ibatch < slot.jobs.size(); ++ibatch){
+                        float* parray = host_output_array + ibatch * output_array_size;
+                        int count     = min(MAX_IMAGE_BBOX, (int)*parray);
+                        auto& job     = slot.jobs[ibatch];
+                        auto& image_based_boxes   = job.output;
+                        for(int i = 0; i < count; ++i){
+                            float* pbox  = parray + 1 + i * NUM_BOX_ELEMENT;
+                            int label    = pbox[5];
+                            int keepflag = pbox[6];
+                            if(keepflag == 1){
+                                image_based_boxes.emplace_back(pbox[0], pbox[1], pbox[2], pbox[3], pbox[4], label);
+                            }
+                        }
+                    }
+
+                    if(nms_method_ == NMSMethod::CPU){
+                        nms_inputs.clear();
+                        for(auto& job : slot.jobs)
+                            nms_inputs.emplace_back(&job.output);
+                        NMS::nms_batch(nms_inputs.data(), nms_inputs.size(), NMS::Config(nms_threshold_), nms_workspace);
+                    }
+
+                    for(auto& job : slot.jobs)
+                        job.pro.set_value(job.output);
+                    recycle_jobs(slot.jobs);
+                    free_slots.push(islot);
+
+                    occupancy.add_postprocess(toc - tic, iLogger::timestamp_now_float() - toc);
+                }
+            });
 
             vector<Job> fetch_jobs;
             while(get_jobs_and_wait(fetch_jobs, max_batch_size)){
 
+                // 两个输出缓冲都在后处理时，在这里等待，起到反压的作用
+                int islot = 0;
+                free_slots.pop(islot);
+
+                auto tic = iLogger::timestamp_now_float();
+                auto& slot = slots[islot];
                 int infer_batch_size = fetch_jobs.size();
                 input->resize_single_dim(0, infer_batch_size);
 
                 for(int ibatch = 0; ibatch < infer_batch_size; ++ibatch){
-                    auto& job  = fetch_jobs[ibatch];
-                    auto& mono = job.mono_tensor->data();
-
-                    if(mono->get_stream() != stream_){
-                        // synchronize preprocess stream finish
-                        checkCudaRuntime(cudaStreamSynchronize(mono->get_stream()));
-                    }
+                    auto& job    = fetch_jobs[ibatch];
+                    auto& mono   = job.mono_tensor->data();
+                    auto& events = tensor_events_[job.mono_tensor->index()];
 
+                    checkCudaRuntime(cudaStreamWaitEvent(stream, events.ready, 0));
                     affin_matrix_device.copy_from_gpu(affin_matrix_device.offset(ibatch), mono->get_workspace()->gpu(), 6);
                     input->copy_from_gpu(input->offset(ibatch), mono->gpu(), mono->count());
+                    checkCudaRuntime(cudaEventRecord(events.consumed, stream));
                     job.mono_tensor->release();
                 }
 
                 engine->forward(false);
-                output_array_device.to_gpu(false);
                 for(int ibatch = 0; ibatch < infer_batch_size; ++ibatch){
                     
-                    auto& job                 = fetch_jobs[ibatch];
                     float* image_based_output = output->gpu<float>(ibatch);
-                    float* output_array_ptr   = output_array_device.gpu<float>(ibatch);
+                    float* output_array_ptr   = slot.output_array->gpu<float>(ibatch);
                     auto affine_matrix        = affin_matrix_device.gpu<float>(ibatch);
-                    checkCudaRuntime(cudaMemsetAsync(output_array_ptr, 0, sizeof(int), stream_));
-                    decode_kernel_invoker(image_based_output, output->size(1), num_classes, confidence_threshold_, affine_matrix, output_array_ptr, MAX_IMAGE_BBOX, stream_);
+                    if(use_topk){
+                        float* candidates_ptr = candidates_device.gpu<float>();
+                        checkCudaRuntime(cudaMemsetAsync(candidates_ptr, 0, sizeof(int), stream));
+                        decode_kernel(image_based_output, num_bboxes, num_classes, confidence_threshold_, affine_matrix, candidates_ptr, num_bboxes, stream);
+                        CUDAKernel::topk_boxes(candidates_ptr, num_bboxes, output_array_ptr, MAX_IMAGE_BBOX, NUM_BOX_ELEMENT, 4, stream);
+                    }else{
+                        checkCudaRuntime(cudaMemsetAsync(output_array_ptr, 0, sizeof(int), stream));
+                        decode_kernel(image_based_output, num_bboxes, num_classes, confidence_threshold_, affine_matrix, output_array_ptr, MAX_IMAGE_BBOX, stream);
+                    }
 
                     if(nms_method_ == NMSMethod::FastGPU){
-                        nms_kernel_invoker(output_array_ptr, nms_threshold_, MAX_IMAGE_BBOX, stream_);
+                        nms_kernel_invoker(output_array_ptr, nms_threshold_, MAX_IMAGE_BBOX, stream);
                     }
                 }
 
-                output_array_device.to_cpu();
+                checkCudaRuntime(cudaMemcpyAsync(
+                    slot.output_array->get_data()->cpu(), slot.output_array->gpu(), 
+                    infer_batch_size * output_array_size * sizeof(float), cudaMemcpyDeviceToHost, stream
+                ));
+                checkCudaRuntime(cudaEventRecord(slot.ready, stream));
+
+                // slot.jobs在后处理完成后已经被清空，交换后fetch_jobs为空但保留容量
+                slot.jobs.swap(fetch_jobs);
+                occupancy.add_inference(iLogger::timestamp_now_float() - tic);
+                ready_slots.push(islot);
+
+                if(occupancy.num_batches() % 1000 == 0)
+                    INFOV("%s", occupancy.description().c_str());
+            }
+
+            ready_slots.close();
+            postprocess_thread.join();
+            for(auto& slot : slots)
+                checkCudaRuntime(cudaEventDestroy(slot.ready));
+
+            // shared_engine_可能仍被其他worker使用，由stop统一释放，tensor_allocator_、预处理的stream与事件在析构时释放
+            INFO("%s", occupancy.description().c_str());
+            INFO("Engine destroy, worker = %d.", worker_index);
+        }
+
+        // OpenCV dnn后端，预处理、推理、解码与NMS都在CPU上，没有流水线
+        void cpu_worker(promise<bool>& result, int worker_index){
+
+            string file = get<0>(start_param_);
+            shared_ptr<TRT::DNNInfer> engine;
+            if(worker_index == 0){
+                engine = TRT::load_dnn_infer(file);
+            }else{
+                // cv::dnn::Net不能在多个线程上同时forward，每个worker持有一份模型
+                engine = dynamic_pointer_cast<TRT::DNNInfer>(shared_engine_->clone_context());
+            }
+
+            if(engine == nullptr){
+                INFOE("Onnx %s load failed, worker = %d", file.c_str(), worker_index);
+                result.set_value(false);
+                return;
+            }
+
+            if(worker_index == 0)
+                engine->print();
+
+            int max_batch_size = engine->get_max_batch_size();
+            auto input         = engine->input();
+            auto output        = engine->output();
+            bool channel_major = type_ == Type::V8;
+            int num_bboxes     = channel_major ? output->size(2) : output->size(1);
+            int num_classes    = channel_major ? output->size(1) - 4 : output->size(2) - 5;
+            auto decode        = channel_major ? cpu_decode_channel_major : cpu_decode;
+
+            if(worker_index == 0){
+                input_width_       = input->size(3);
+                input_height_      = input->size(2);
+                tensor_allocator_  = make_shared<MonopolyAllocator<TRT::Tensor>>(max_batch_size * 2 * num_workers_);
+                shared_engine_     = engine;
+            }
+            result.set_value(true);
+
+            // 与GPU的output_array格式相同，counter + bboxes，只申请一次
+            // 先解码全部候选，再原地保留分数最高的max_objects_个
+            const int NUM_BOX_ELEMENT = 7;      // left, top, right, bottom, confidence, class, keepflag
+            vector<float> output_array(1 + max(num_bboxes, max_objects_) * NUM_BOX_ELEMENT);
+            NMS::Workspace nms_workspace;
+            vector<BoxArray*> nms_inputs(max_batch_size);
+
+            vector<Job> fetch_jobs;
+            while(get_jobs_and_wait(fetch_jobs, max_batch_size)){
+
+                int infer_batch_size = fetch_jobs.size();
+                input->resize_single_dim(0, infer_batch_size);
+                for(int ibatch = 0; ibatch < infer_batch_size; ++ibatch){
+                    auto& job  = fetch_jobs[ibatch];
+                    auto& mono = job.mono_tensor->data();
+                    memcpy(input->cpu<float>(ibatch), mono->cpu<float>(), mono->bytes());
+                    job.mono_tensor->release();
+                }
+
+                // 推理失败时这一批的job得到空结果，错误已经在forward中输出
+                if(!engine->try_forward()){
+                    for(auto& job : fetch_jobs)
+                        job.pro.set_value(job.output);
+                    continue;
+                }
+
                 for(int ibatch = 0; ibatch < infer_batch_size; ++ibatch){
-                    float* parray = output_array_device.cpu<float>(ibatch);
-                    int count     = min(MAX_IMAGE_BBOX, (int)*parray);
-                    auto& job     = fetch_jobs[ibatch];
-                    auto& image_based_boxes   = job.output;
-                    for(int i = 0; i < count; ++i){
-                        float* pbox  = parray + 1 + i * NUM_BOX_ELEMENT;
-                        int label    = pbox[5];
-                        int keepflag = pbox[6];
-                        if(keepflag == 1){
-                            image_based_boxes.emplace_back(pbox[0], pbox[1], pbox[2], pbox[3], pbox[4], label);
-                        }
-                    }
+                    auto& job = fetch_jobs[ibatch];
+                    decode(
+                        output->cpu<float>(ibatch), num_bboxes, num_classes, confidence_threshold_,
+                        job.additional.d2i, output_array.data(), num_bboxes, cpu_preprocess_pool_.get()
+                    );
 
-                    if(nms_method_ == NMSMethod::CPU){
-                        image_based_boxes = cpu_nms(image_based_boxes, nms_threshold_);
+                    int count = CPUKernel::topk_boxes(output_array.data(), output_array.data(), max_objects_, NUM_BOX_ELEMENT, 4);
+
+                    for(int i = 0; i < count; ++i){
+                        float* pbox = output_array.data() + 1 + i * NUM_BOX_ELEMENT;
+                        job.output.emplace_back(pbox[0], pbox[1], pbox[2], pbox[3], pbox[4], (int)pbox[5]);
                     }
-                    job.pro->set_value(image_based_boxes);
+                    nms_inputs[ibatch] = &job.output;
                 }
-                fetch_jobs.clear();
+
+                NMS::nms_batch(nms_inputs.data(), infer_batch_size, NMS::Config(nms_threshold_), nms_workspace, cpu_preprocess_pool_.get());
+                for(int ibatch = 0; ibatch < infer_batch_size; ++ibatch)
+                    fetch_jobs[ibatch].pro.set_value(fetch_jobs[ibatch].output);
             }
-            stream_ = nullptr;
-            tensor_allocator_.reset();
-            INFO("Engine destroy.");
+            INFO("%s", remap_cache_->description().c_str());
+            INFO("Engine destroy, worker = %d.", worker_index);
+        }
+
+        bool cpu_preprocess(Job& job, const Mat& image){
+
+            auto& tensor = job.mono_tensor->data();
+            if(tensor == nullptr){
+                // not init
+                tensor = make_shared<TRT::Tensor>(TRT::DataType::Float, nullptr, CPU_DEVICE_ID);
+            }
+
+            // 同一尺寸的图像共用一张重映射表，视频流除第一帧外都不再计算坐标与权重
+            auto table = remap_cache_->query(image.cols, image.rows, image.step, input_width_, input_height_, 114, normalize_);
+            memcpy(job.additional.i2d, table->i2d(), sizeof(job.additional.i2d));
+            memcpy(job.additional.d2i, table->d2i(), sizeof(job.additional.d2i));
+            tensor->resize(1, 3, input_height_, input_width_);
+            table->remap(image.data, tensor->cpu<float>(), cpu_preprocess_pool_.get());
+            return true;
         }
 
         virtual bool preprocess(Job& job, const Mat& image) override{
@@ -307,6 +644,9 @@ namespace Yolo{
                 return false;
             }
 
+            if(backend_ == TRT::Backend::OpenCVDNN)
+                return cpu_preprocess(job, image);
+
             CUDATools::AutoDevice auto_device(gpu_);
             auto& tensor = job.mono_tensor->data();
             TRT::CUStream preprocess_stream = nullptr;
@@ -322,7 +662,7 @@ namespace Yolo{
                     // owner = true, stream needs to be free during deconstruction
                     tensor->set_stream(preprocess_stream, true);
                 }else{
-                    preprocess_stream = stream_;
+                    preprocess_stream = preprocess_stream_;
 
                     // owner = false, tensor ignored the stream
                     tensor->set_stream(preprocess_stream, false);
@@ -346,6 +686,10 @@ namespace Yolo{
             float* affine_matrix_host     = (float*)cpu_workspace;
             uint8_t* image_host           = size_matrix + cpu_workspace;
 
+            // 上一个使用这个tensor的worker可能还没有把数据拷贝走
+            auto& events = tensor_events_[job.mono_tensor->index()];
+            checkCudaRuntime(cudaStreamWaitEvent(preprocess_stream, events.consumed, 0));
+
             //checkCudaRuntime(cudaMemcpyAsync(image_host,   image.data, size_image, cudaMemcpyHostToHost,   stream_));
             // speed up
             memcpy(image_host, image.data, size_image);
@@ -359,6 +703,7 @@ namespace Yolo{
                 affine_matrix_device, 114, 
                 normalize_, preprocess_stream
             );
+            checkCudaRuntime(cudaEventRecord(events.ready, preprocess_stream));
             return true;
         }
 
@@ -370,6 +715,58 @@ namespace Yolo{
             return ControllerImpl::commit(image);
         }
 
+        virtual std::shared_future<BoxArray> commit(const Mat& image, CommitError* error) override{
+            return ControllerImpl::commit(image, error);
+        }
+
+        virtual CommitError commit_async(const Mat& image, const Infer::Callback& callback) override{
+            return ControllerImpl::commit_async(image, callback);
+        }
+
+        virtual vector<CommitError> commits_async(const vector<Mat>& images, const vector<Infer::Callback>& callbacks) override{
+            return ControllerImpl::commits_async(images, callbacks);
+        }
+
+        virtual CommitError commit(const Mat& image, const shared_ptr<CompletionQueue<BoxArray>>& queue, uint64_t tag) override{
+            return ControllerImpl::commit(image, queue, tag);
+        }
+
+        virtual vector<CommitError> commits(const vector<Mat>& images, const shared_ptr<CompletionQueue<BoxArray>>& queue, uint64_t first_tag) override{
+            return ControllerImpl::commits(images, queue, first_tag);
+        }
+
+        virtual void set_batch_policy(int max_queue_delay_ms, int preferred_batch_size, int job_deadline_ms) override{
+            BatchPolicy policy;
+            policy.max_queue_delay_ms   = max_queue_delay_ms;
+            policy.preferred_batch_size = preferred_batch_size;
+            policy.job_deadline_ms      = job_deadline_ms;
+            ControllerImpl::set_batch_policy(policy);
+        }
+
+        virtual void set_preprocess_threads(int num_threads) override{
+            ControllerImpl::set_preprocess_threads(num_threads);
+        }
+
+        virtual void set_queue_limit(int max_queue_size, QueueFullPolicy policy) override{
+            ControllerImpl::set_queue_limit(max_queue_size, policy);
+        }
+
+        virtual int queue_size() override{
+            return ControllerImpl::queue_size();
+        }
+
+        virtual int num_outstanding_jobs() override{
+            return ControllerImpl::num_outstanding_jobs();
+        }
+
+        virtual size_t num_rejected_jobs() override{
+            return ControllerImpl::num_rejected_jobs();
+        }
+
+        virtual size_t num_dropped_jobs() override{
+            return ControllerImpl::num_dropped_jobs();
+        }
+
     private:
         int input_width_            = 0;
         int input_height_           = 0;
@@ -377,9 +774,14 @@ namespace Yolo{
         float confidence_threshold_ = 0;
         float nms_threshold_        = 0;
         int max_objects_            = 1024;
+        Type type_                  = Type::V5;
         NMSMethod nms_method_       = NMSMethod::FastGPU;
-        TRT::CUStream stream_       = nullptr;
+        TRT::CUStream preprocess_stream_ = nullptr;
+        vector<TensorEvents> tensor_events_;
         bool use_multi_preprocess_stream_ = false;
+        TRT::Backend backend_       = TRT::Backend::TensorRT;
+        shared_ptr<ThreadPool> cpu_preprocess_pool_;
+        shared_ptr<CPUKernel::RemapCache> remap_cache_;
         CUDAKernel::Norm normalize_;
     };
 
@@ -387,12 +789,13 @@ namespace Yolo{
         const string& engine_file, Type type, int gpuid, 
         float confidence_threshold, float nms_threshold,
         NMSMethod nms_method, int max_objects,
-        bool use_multi_preprocess_stream
+        bool use_multi_preprocess_stream, int num_workers,
+        TRT::Backend backend
     ){
         shared_ptr<InferImpl> instance(new InferImpl());
         if(!instance->startup(
             engine_file, type, gpuid, confidence_threshold, 
-            nms_threshold, nms_method, max_objects, use_multi_preprocess_stream)
+            nms_threshold, nms_method, max_objects, use_multi_preprocess_stream, num_workers, backend)
         ){
             instance.reset();
         }
@@ -402,7 +805,7 @@ namespace Yolo{
     void image_to_tensor(const cv::Mat& image, shared_ptr<TRT::Tensor>& tensor, Type type, int ibatch){
 
         CUDAKernel::Norm normalize;
-        if(type == Type::V5 || type == Type::V3 || type == Type::V7){
+        if(type == Type::V5 || type == Type::V3 || type == Type::V7 || type == Type::V8){
             normalize = CUDAKernel::Norm::alpha_beta(1 / 255.0f, 0.0f, CUDAKernel::ChannelType::Invert);
         }else if(type == Type::X){
             //float mean[] = {0.485, 0.456, 0.406};
@@ -417,6 +820,16 @@ namespace Yolo{
         AffineMatrix affine;
         affine.compute(image.size(), input_size);
 
+        if(tensor->device() == CPU_DEVICE_ID){
+            CPUKernel::warp_affine_bilinear_and_normalize_plane(
+                image.data,                 image.step,           image.cols,       image.rows,
+                tensor->cpu<float>(ibatch), input_size.width,     input_size.height,
+                affine.d2i,                 114,
+                normalize
+            );
+            return;
+        }
+
         size_t size_image      = image.cols * image.rows * 3;
         size_t size_matrix     = iLogger::upbound(sizeof(affine.d2i), 32);
         auto workspace         = tensor->get_workspace();
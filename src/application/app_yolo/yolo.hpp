@@ -5,9 +5,13 @@
 #include <memory>
 #include <string>
 #include <future>
+#include <functional>
 #include <opencv2/opencv.hpp>
 #include <common/trt_tensor.hpp>
+#include <infer/trt_infer.hpp>
 #include <common/object_detector.hpp>
+#include <common/job_admission.hpp>
+#include <common/completion_queue.hpp>
 
 /**
  * @brief 发挥极致的性能体验
@@ -22,7 +26,8 @@ namespace Yolo{
         V5 = 0,
         X  = 1,
         V3 = 2,
-        V7 = 3
+        V7 = 3,
+        V8 = 4      // [B, 4 + C, N]的channel-major输出，没有objectness
     };
 
     enum class NMSMethod : int{
@@ -36,13 +41,48 @@ namespace Yolo{
     public:
         virtual shared_future<BoxArray> commit(const cv::Mat& image) = 0;
         virtual vector<shared_future<BoxArray>> commits(const vector<cv::Mat>& images) = 0;
+
+        // error返回提交结果，被拒绝的图像立即得到空结果
+        virtual shared_future<BoxArray> commit(const cv::Mat& image, CommitError* error) = 0;
+
+        // 结果通过回调交付，回调在推理线程上执行，每次commit_async都会回调且只回调一次
+        typedef function<void(const BoxArray&)> Callback;
+        virtual CommitError commit_async(const cv::Mat& image, const Callback& callback) = 0;
+        virtual vector<CommitError> commits_async(const vector<cv::Mat>& images, const vector<Callback>& callbacks) = 0;
+
+        // 结果以(tag, boxes)的形式放入使用者持有的完成队列，commits时第i张图的tag为first_tag + i
+        virtual CommitError commit(const cv::Mat& image, const shared_ptr<CompletionQueue<BoxArray>>& queue, uint64_t tag) = 0;
+        virtual vector<CommitError> commits(const vector<cv::Mat>& images, const shared_ptr<CompletionQueue<BoxArray>>& queue, uint64_t first_tag) = 0;
+
+        // 动态批处理：最多等待max_queue_delay_ms以凑满preferred_batch_size(<=0为引擎的max_batch_size)
+        // job_deadline_ms > 0时，排队超过该时间的图像直接返回空结果
+        virtual void set_batch_policy(int max_queue_delay_ms, int preferred_batch_size = 0, int job_deadline_ms = 0) = 0;
+
+        // commits时使用num_threads个线程并行预处理，<=0表示在调用线程上串行预处理(默认)
+        virtual void set_preprocess_threads(int num_threads) = 0;
+
+        // 限制排队等待推理的图像数量，max_queue_size <= 0表示不限制(默认)
+        virtual void set_queue_limit(int max_queue_size, QueueFullPolicy policy = QueueFullPolicy::Block) = 0;
+        virtual int queue_size() = 0;
+
+        // 已经提交但还没有交付结果的图像数量，包括排队与推理中的图像
+        virtual int num_outstanding_jobs() = 0;
+        virtual size_t num_rejected_jobs() = 0;
+        virtual size_t num_dropped_jobs() = 0;
     };
 
+    /* backend为OpenCVDNN时，engine_file为onnx文件，在CPU上预处理、推理与解码
+       此时gpuid、use_multi_preprocess_stream被忽略，nms_method总是使用CPU NMS
+       onnx的输入节点名称需要为images，并且具有静态的输入维度，每个worker持有一份模型
+       OpenCVDNN时每次forward的batch固定为1，需要吞吐时增加num_workers
+       目前只有Yolo支持选择后端，其他应用仍然只能使用TensorRT
+    */
     shared_ptr<Infer> create_infer(
         const string& engine_file, Type type, int gpuid,
         float confidence_threshold=0.25f, float nms_threshold=0.5f,
         NMSMethod nms_method = NMSMethod::FastGPU, int max_objects = 1024,
-        bool use_multi_preprocess_stream = false
+        bool use_multi_preprocess_stream = false, int num_workers = 1,
+        TRT::Backend backend = TRT::Backend::TensorRT
     );
     const char* type_name(Type type);
 
@@ -0,0 +1,404 @@
+#include "yolo_decode_cpu.hpp"
+#include <common/thread_pool.hpp>
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   include <immintrin.h>
+#   define YOLO_DECODE_AVX2
+#elif defined(__aarch64__)
+#   include <arm_neon.h>
+#   define YOLO_DECODE_NEON
+#endif
+
+// 与参考实现使用相同的运算顺序，并且禁止乘加融合，结果才能逐位一致
+#if defined(__clang__)
+#   pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#   pragma GCC optimize("fp-contract=off")
+#endif
+
+// 在pragma之后包含，使decode_cpu的实例化同样不做乘加融合
+#include <common/box_decoder.hpp>
+
+namespace Yolo{
+
+    static const int NUM_BOX_ELEMENT    = 7;       // left, top, right, bottom, confidence, class, keepflag
+    static const int MIN_ROWS_PER_BLOCK = 2048;    // 每块至少的行数，行数太少时并行的开销大于收益
+
+    struct DecodeParam{
+        const float* predict;
+        int num_classes;
+        int stride;
+        float confidence_threshold;
+        const float* m;
+    };
+
+#ifdef YOLO_DECODE_AVX2
+    static bool support_avx2(){
+        static const bool support = __builtin_cpu_supports("avx2");
+        return support;
+    }
+#endif
+
+    // 类别置信度最大的类别，相等时取序号小的，与decode_kernel相同
+    static int class_argmax_scalar(const float* scores, int begin, int num_classes, int label, float& confidence){
+        for(int i = begin; i < num_classes; ++i){
+            if(scores[i] > confidence){
+                confidence = scores[i];
+                label      = i;
+            }
+        }
+        return label;
+    }
+
+#ifdef YOLO_DECODE_AVX2
+    // 每个lane保留各自最先出现的最大值，归约时相等取序号小的，与逐个比较的结果一致
+    __attribute__((target("avx2")))
+    static int class_argmax_avx2(const float* scores, int num_classes, float& confidence){
+
+        __m256 best        = _mm256_loadu_ps(scores);
+        __m256i index      = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256i best_index = index;
+        __m256i step       = _mm256_set1_epi32(8);
+
+        int i = 8;
+        for(; i + 8 <= num_classes; i += 8){
+            __m256 value   = _mm256_loadu_ps(scores + i);
+            __m256 greater = _mm256_cmp_ps(value, best, _CMP_GT_OQ);
+            index          = _mm256_add_epi32(index, step);
+            best           = _mm256_blendv_ps(best, value, greater);
+            best_index     = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(best_index), _mm256_castsi256_ps(index), greater));
+        }
+
+        alignas(32) float values[8];
+        alignas(32) int indexs[8];
+        _mm256_store_ps(values, best);
+        _mm256_store_si256((__m256i*)indexs, best_index);
+
+        int label  = indexs[0];
+        confidence = values[0];
+        for(int lane = 1; lane < 8; ++lane){
+            if(values[lane] > confidence || (values[lane] == confidence && indexs[lane] < label)){
+                confidence = values[lane];
+                label      = indexs[lane];
+            }
+        }
+        return class_argmax_scalar(scores, i, num_classes, label, confidence);
+    }
+#endif // YOLO_DECODE_AVX2
+
+#ifdef YOLO_DECODE_NEON
+    static int class_argmax_neon(const float* scores, int num_classes, float& confidence){
+
+        float32x4_t best        = vld1q_f32(scores);
+        const uint32_t init[]   = {0, 1, 2, 3};
+        uint32x4_t index        = vld1q_u32(init);
+        uint32x4_t best_index   = index;
+        uint32x4_t step         = vdupq_n_u32(4);
+
+        int i = 4;
+        for(; i + 4 <= num_classes; i += 4){
+            float32x4_t value  = vld1q_f32(scores + i);
+            uint32x4_t greater = vcgtq_f32(value, best);
+            index              = vaddq_u32(index, step);
+            best               = vbslq_f32(greater, value, best);
+            best_index         = vbslq_u32(greater, index, best_index);
+        }
+
+        float values[4];
+        uint32_t indexs[4];
+        vst1q_f32(values, best);
+        vst1q_u32(indexs, best_index);
+
+        int label  = indexs[0];
+        confidence = values[0];
+        for(int lane = 1; lane < 4; ++lane){
+            if(values[lane] > confidence || (values[lane] == confidence && (int)indexs[lane] < label)){
+                confidence = values[lane];
+                label      = indexs[lane];
+            }
+        }
+        return class_argmax_scalar(scores, i, num_classes, label, confidence);
+    }
+#endif // YOLO_DECODE_NEON
+
+    static int class_argmax(const float* scores, int num_classes, float& confidence){
+#if defined(YOLO_DECODE_AVX2)
+        if(num_classes >= 16 && support_avx2())
+            return class_argmax_avx2(scores, num_classes, confidence);
+#elif defined(YOLO_DECODE_NEON)
+        if(num_classes >= 8)
+            return class_argmax_neon(scores, num_classes, confidence);
+#endif
+        confidence = scores[0];
+        return class_argmax_scalar(scores, 1, num_classes, 0, confidence);
+    }
+
+    // objectness已经通过阈值的行，求类别并写出box，返回是否写出
+    static bool decode_candidate(const DecodeParam& p, int position, float* pout){
+
+        const float* pitem = p.predict + (size_t)p.stride * position;
+        float objectness   = pitem[4];
+        float confidence   = 0;
+        int label          = class_argmax(pitem + 5, p.num_classes, confidence);
+
+        confidence *= objectness;
+        if(confidence < p.confidence_threshold)
+            return false;
+
+        const float* m = p.m;
+        float left   = pitem[0] - pitem[2] * 0.5f;
+        float top    = pitem[1] - pitem[3] * 0.5f;
+        float right  = pitem[0] + pitem[2] * 0.5f;
+        float bottom = pitem[1] + pitem[3] * 0.5f;
+        pout[0] = m[0] * left  + m[1] * top    + m[2];
+        pout[1] = m[3] * left  + m[4] * top    + m[5];
+        pout[2] = m[0] * right + m[1] * bottom + m[2];
+        pout[3] = m[3] * right + m[4] * bottom + m[5];
+        pout[4] = confidence;
+        pout[5] = label;
+        pout[6] = 1;    // 1 = keep, 0 = ignore
+        return true;
+    }
+
+#ifdef YOLO_DECODE_AVX2
+    /* 一次gather 8行的objectness，只有通过阈值的行才会读取类别，大部分行只访问一个cache line
+       position更新为处理到的行，剩余不足8行由调用者处理
+    */
+    __attribute__((target("avx2")))
+    static int decode_rows_avx2(const DecodeParam& p, int& position, int end, float* pout, int capacity){
+
+        int count        = 0;
+        __m256i offset   = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(p.stride));
+        __m256 threshold = _mm256_set1_ps(p.confidence_threshold);
+        for(; position + 8 <= end && count < capacity; position += 8){
+            __m256 objectness = _mm256_i32gather_ps(p.predict + (size_t)p.stride * position + 4, offset, 4);
+
+            // 与objectness < threshold则跳过相反，NaN也需要进入后续的判断
+            int pass = _mm256_movemask_ps(_mm256_cmp_ps(objectness, threshold, _CMP_NLT_UQ));
+            while(pass != 0 && count < capacity){
+                int lane = __builtin_ctz(pass);
+                pass &= pass - 1;
+                if(decode_candidate(p, position + lane, pout + count * NUM_BOX_ELEMENT))
+                    count++;
+            }
+        }
+        return count;
+    }
+#endif // YOLO_DECODE_AVX2
+
+    // 解码[begin, end)的行，写入pout，最多capacity个，返回数量
+    static int decode_rows(const DecodeParam& p, int begin, int end, float* pout, int capacity){
+
+        int count    = 0;
+        int position = begin;
+
+#ifdef YOLO_DECODE_AVX2
+        if(support_avx2())
+            count = decode_rows_avx2(p, position, end, pout, capacity);
+#endif
+
+        for(; position < end && count < capacity; ++position){
+            if(p.predict[(size_t)p.stride * position + 4] < p.confidence_threshold)
+                continue;
+
+            if(decode_candidate(p, position, pout + count * NUM_BOX_ELEMENT))
+                count++;
+        }
+        return count;
+    }
+
+    /* decode_block(begin, end, pout, capacity)解码[begin, end)的行并返回数量
+       pool不为空且行数较多时按行分块并行，每块先写入各自的缓冲，再按块的顺序拷贝到parray，保证与逐行解码的顺序相同
+    */
+    template<class _DecodeBlock>
+    static int decode_parallel(int num_bboxes, float* parray, int max_objects, ThreadPool* pool, const _DecodeBlock& decode_block){
+
+        int num_blocks = 1;
+        if(pool != nullptr && pool->size() > 0)
+            num_blocks = std::min((pool->size() + 1) * 4, num_bboxes / MIN_ROWS_PER_BLOCK);
+
+        if(num_blocks <= 1){
+            int count = decode_block(0, num_bboxes, parray + 1, max_objects);
+            parray[0] = count;
+            return count;
+        }
+
+        // 每块最多写出块内的行数，max_objects等于num_bboxes(用于之后做top-K)时缓冲也不会过大
+        int max_block_rows = (num_bboxes + num_blocks - 1) / num_blocks;
+        int block_capacity = std::min(max_objects, max_block_rows);
+        std::unique_ptr<float[]> block_boxes(new float[(size_t)num_blocks * block_capacity * NUM_BOX_ELEMENT]);
+        std::vector<int> block_counts(num_blocks);
+        pool->parallel_for(0, num_blocks, [&](int iblock){
+            int begin = (int)((int64_t)num_bboxes * iblock / num_blocks);
+            int end   = (int)((int64_t)num_bboxes * (iblock + 1) / num_blocks);
+            block_counts[iblock] = decode_block(begin, end, block_boxes.get() + (size_t)iblock * block_capacity * NUM_BOX_ELEMENT, block_capacity);
+        });
+
+        int count = 0;
+        for(int iblock = 0; iblock < num_blocks && count < max_objects; ++iblock){
+            int n = std::min(block_counts[iblock], max_objects - count);
+            memcpy(parray + 1 + count * NUM_BOX_ELEMENT, block_boxes.get() + (size_t)iblock * block_capacity * NUM_BOX_ELEMENT, n * NUM_BOX_ELEMENT * sizeof(float));
+            count += n;
+        }
+        parray[0] = count;
+        return count;
+    }
+
+    int cpu_decode(
+        const float* predict, int num_bboxes, int num_classes, float confidence_threshold,
+        const float* invert_affine_matrix, float* parray, int max_objects, ThreadPool* pool
+    ){
+        DecodeParam p{predict, num_classes, 5 + num_classes, confidence_threshold, invert_affine_matrix};
+        return decode_parallel(num_bboxes, parray, max_objects, pool, [&](int begin, int end, float* pout, int capacity){
+            return decode_rows(p, begin, end, pout, capacity);
+        });
+    }
+
+    /////////////////////////////////////////////////////////////////////////////
+    // [4 + C, N]的channel-major输出
+
+    // 对[begin, begin + n)的列，逐个类别通道更新最大值与序号，每次读取一个通道中连续的n个值
+    static void column_argmax_scalar(const float* predict, int num_bboxes, int num_classes, int begin, int n, int start, float* best, int* label){
+        for(int ic = 1; ic < num_classes; ++ic){
+            const float* pclass = predict + (size_t)(4 + ic) * num_bboxes + begin;
+            for(int i = start; i < n; ++i){
+                if(pclass[i] > best[i]){
+                    best[i]  = pclass[i];
+                    label[i] = ic;
+                }
+            }
+        }
+    }
+
+#ifdef YOLO_DECODE_AVX2
+    // 返回处理到的列，剩余不足8列由调用者处理
+    __attribute__((target("avx2")))
+    static int column_argmax_avx2(const float* predict, int num_bboxes, int num_classes, int begin, int n, float* best, int* label){
+
+        int i = 0;
+        for(; i + 8 <= n; i += 8){
+            __m256 best_value  = _mm256_loadu_ps(best + i);
+            __m256i best_index = _mm256_setzero_si256();
+            for(int ic = 1; ic < num_classes; ++ic){
+                __m256 value   = _mm256_loadu_ps(predict + (size_t)(4 + ic) * num_bboxes + begin + i);
+                __m256 greater = _mm256_cmp_ps(value, best_value, _CMP_GT_OQ);
+                best_value     = _mm256_blendv_ps(best_value, value, greater);
+                best_index     = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(best_index), _mm256_castsi256_ps(_mm256_set1_epi32(ic)), greater));
+            }
+            _mm256_storeu_ps(best + i, best_value);
+            _mm256_storeu_si256((__m256i*)(label + i), best_index);
+        }
+        return i;
+    }
+#endif // YOLO_DECODE_AVX2
+
+#ifdef YOLO_DECODE_NEON
+    static int column_argmax_neon(const float* predict, int num_bboxes, int num_classes, int begin, int n, float* best, int* label){
+
+        int i = 0;
+        for(; i + 4 <= n; i += 4){
+            float32x4_t best_value = vld1q_f32(best + i);
+            uint32x4_t best_index  = vdupq_n_u32(0);
+            for(int ic = 1; ic < num_classes; ++ic){
+                float32x4_t value  = vld1q_f32(predict + (size_t)(4 + ic) * num_bboxes + begin + i);
+                uint32x4_t greater = vcgtq_f32(value, best_value);
+                best_value         = vbslq_f32(greater, value, best_value);
+                best_index         = vbslq_u32(greater, vdupq_n_u32(ic), best_index);
+            }
+            vst1q_f32(best + i, best_value);
+            vst1q_u32((uint32_t*)(label + i), best_index);
+        }
+        return i;
+    }
+#endif // YOLO_DECODE_NEON
+
+    /* 按COLUMN_BLOCK列为一块，块内逐个通道顺序读取，每个通道只访问连续的一段
+       逐列解码时每列要跨越4 + C个通道，几乎每次访问都不命中cache
+    */
+    static int decode_columns(
+        const float* predict, int num_bboxes, int num_classes, float confidence_threshold,
+        const float* m, int begin, int end, float* pout, int capacity
+    ){
+        const int COLUMN_BLOCK = 256;
+        float best[COLUMN_BLOCK];
+        int label[COLUMN_BLOCK];
+
+        int count = 0;
+        for(int block_begin = begin; block_begin < end && count < capacity; block_begin += COLUMN_BLOCK){
+            int n = std::min(COLUMN_BLOCK, end - block_begin);
+            memcpy(best, predict + (size_t)4 * num_bboxes + block_begin, n * sizeof(float));
+            memset(label, 0, n * sizeof(int));
+
+            int start = 0;
+#if defined(YOLO_DECODE_AVX2)
+            if(support_avx2())
+                start = column_argmax_avx2(predict, num_bboxes, num_classes, block_begin, n, best, label);
+#elif defined(YOLO_DECODE_NEON)
+            start = column_argmax_neon(predict, num_bboxes, num_classes, block_begin, n, best, label);
+#endif
+            column_argmax_scalar(predict, num_bboxes, num_classes, block_begin, n, start, best, label);
+
+            for(int i = 0; i < n && count < capacity; ++i){
+                if(best[i] < confidence_threshold)
+                    continue;
+
+                int position = block_begin + i;
+                float cx     = predict[position];
+                float cy     = predict[(size_t)num_bboxes + position];
+                float width  = predict[(size_t)num_bboxes * 2 + position];
+                float height = predict[(size_t)num_bboxes * 3 + position];
+                float left   = cx - width * 0.5f;
+                float top    = cy - height * 0.5f;
+                float right  = cx + width * 0.5f;
+                float bottom = cy + height * 0.5f;
+
+                float* pbox = pout + count * NUM_BOX_ELEMENT;
+                pbox[0] = m[0] * left  + m[1] * top    + m[2];
+                pbox[1] = m[3] * left  + m[4] * top    + m[5];
+                pbox[2] = m[0] * right + m[1] * bottom + m[2];
+                pbox[3] = m[3] * right + m[4] * bottom + m[5];
+                pbox[4] = best[i];
+                pbox[5] = label[i];
+                pbox[6] = 1;    // 1 = keep, 0 = ignore
+                count++;
+            }
+        }
+        return count;
+    }
+
+    int cpu_decode_channel_major(
+        const float* predict, int num_bboxes, int num_classes, float confidence_threshold,
+        const float* invert_affine_matrix, float* parray, int max_objects, ThreadPool* pool
+    ){
+        return decode_parallel(num_bboxes, parray, max_objects, pool, [&](int begin, int end, float* pout, int capacity){
+            return decode_columns(predict, num_bboxes, num_classes, confidence_threshold, invert_affine_matrix, begin, end, pout, capacity);
+        });
+    }
+
+    int cpu_decode_channel_major_reference(
+        const float* predict, int num_bboxes, int num_classes, float confidence_threshold,
+        const float* invert_affine_matrix, float* parray, int max_objects
+    ){
+        BoxDecoder::YoloV8Head head(
+            BoxDecoder::Planar(predict, 4 + num_classes, num_bboxes),
+            BoxDecoder::AffineMatrix(invert_affine_matrix), num_classes, confidence_threshold
+        );
+        return BoxDecoder::decode_cpu(head, num_bboxes, parray, max_objects);
+    }
+
+    int cpu_decode_reference(
+        const float* predict, int num_bboxes, int num_classes, float confidence_threshold,
+        const float* invert_affine_matrix, float* parray, int max_objects
+    ){
+        BoxDecoder::YoloRowHead head(
+            BoxDecoder::RowMajor(predict, 5 + num_classes), BoxDecoder::DecodedAnchor(),
+            BoxDecoder::AffineMatrix(invert_affine_matrix), num_classes, confidence_threshold
+        );
+        return BoxDecoder::decode_cpu(head, num_bboxes, parray, max_objects);
+    }
+
+}; // namespace Yolo
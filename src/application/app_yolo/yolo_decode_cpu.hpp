@@ -0,0 +1,46 @@
+#ifndef YOLO_DECODE_CPU_HPP
+#define YOLO_DECODE_CPU_HPP
+
+class ThreadPool;
+
+/**
+ * YoloRowHead解码的SIMD CPU实现，用于CPU后端以及需要在主机上解码的场景
+ * 输入为[N, 5 + C]的输出(cx, cy, width, height, objectness, classes...)，或[4 + C, N]的channel-major输出
+ * 输出与BoxDecoder::decode_gpu的parray格式相同：parray[0]为数量，之后每个box为
+ * left, top, right, bottom, confidence, class, keepflag共7个float，parray由调用者预先分配1 + max_objects * 7个float
+ **/
+namespace Yolo{
+
+    /* objectness低于阈值的行直接跳过，不做类别的argmax，类别的argmax使用SIMD(AVX2/NEON)
+       pool不为空且行数较多时按行分块并行，各块的结果按行号顺序合并，结果与cpu_decode_reference完全一致
+       返回写入的box数量，最多max_objects个
+    */
+    int cpu_decode(
+        const float* predict, int num_bboxes, int num_classes, float confidence_threshold,
+        const float* invert_affine_matrix, float* parray, int max_objects, ThreadPool* pool = nullptr
+    );
+
+    // BoxDecoder::decode_cpu的逐行实现，与GPU的decode_kernel使用同一份代码，作为对照
+    int cpu_decode_reference(
+        const float* predict, int num_bboxes, int num_classes, float confidence_threshold,
+        const float* invert_affine_matrix, float* parray, int max_objects
+    );
+
+    /* 输入为[4 + C, N]的channel-major输出(cx, cy, width, height, classes...)，没有objectness(YoloV8)
+       直接读取，不需要转置，按列分块，块内逐通道连续读取并用SIMD求argmax
+       结果与cpu_decode_channel_major_reference完全一致
+    */
+    int cpu_decode_channel_major(
+        const float* predict, int num_bboxes, int num_classes, float confidence_threshold,
+        const float* invert_affine_matrix, float* parray, int max_objects, ThreadPool* pool = nullptr
+    );
+
+    // BoxDecoder::YoloV8Head的逐列实现，作为对照
+    int cpu_decode_channel_major_reference(
+        const float* predict, int num_bboxes, int num_classes, float confidence_threshold,
+        const float* invert_affine_matrix, float* parray, int max_objects
+    );
+
+}; // namespace Yolo
+
+#endif // YOLO_DECODE_CPU_HPP
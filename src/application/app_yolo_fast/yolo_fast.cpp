@@ -9,6 +9,7 @@
 #include <common/preprocess_kernel.cuh>
 #include <common/monopoly_allocator.hpp>
 #include <common/cuda_tools.hpp>
+#include <common/box_decoder.hpp>
 
 namespace YoloFast{
     using namespace cv;
@@ -84,17 +85,32 @@ namespace YoloFast{
         }
     }
 
-    void yolov5_decode_kernel_invoker(
+    // predict为[anchors, 5 + classes, area]的原始输出，解码后直接做fast nms
+    static void yolov5_decode_kernel_invoker(
         float* predict, int num_bboxes, int fm_area, int num_classes, float confidence_threshold, 
         float nms_threshold, float* invert_affine_matrix, float* parray, const float* prior_box,
         int max_objects, cudaStream_t stream
-    );
+    ){
+        BoxDecoder::YoloV5FastHead head(
+            BoxDecoder::Planar(predict, 5 + num_classes, fm_area), BoxDecoder::YoloV5Anchor(prior_box),
+            BoxDecoder::ScaleMatrix(invert_affine_matrix), num_classes, confidence_threshold
+        );
+        BoxDecoder::decode_gpu(head, num_bboxes, parray, max_objects, stream);
+        BoxDecoder::fast_nms_gpu<BoxDecoder::ObjectBox>(parray, max_objects, nms_threshold, stream);
+    }
 
-    void yolox_decode_kernel_invoker(
+    static void yolox_decode_kernel_invoker(
         float* predict, int num_bboxes, int fm_area, int num_classes, float confidence_threshold, 
         float nms_threshold, float* invert_affine_matrix, float* parray, const float* prior_box,
         int max_objects, cudaStream_t stream
-    );
+    ){
+        BoxDecoder::YoloXFastHead head(
+            BoxDecoder::Planar(predict, 5 + num_classes, fm_area), BoxDecoder::YoloXAnchor(prior_box),
+            BoxDecoder::ScaleMatrix(invert_affine_matrix), num_classes, confidence_threshold
+        );
+        BoxDecoder::decode_gpu(head, num_bboxes, parray, max_objects, stream);
+        BoxDecoder::fast_nms_gpu<BoxDecoder::ObjectBox>(parray, max_objects, nms_threshold, stream);
+    }
 
     struct AffineMatrix{
         float i2d[3];       // image to dst(network)
@@ -301,12 +317,11 @@ namespace YoloFast{
                             image_based_boxes.emplace_back(pbox[0], pbox[1], pbox[2], pbox[3], pbox[4], label);
                         }
                     }
-                    job.pro->set_value(image_based_boxes);
+                    job.pro.set_value(image_based_boxes);
                 }
                 fetch_jobs.clear();
             }
             stream_ = nullptr;
-            tensor_allocator_.reset();
             INFO("Engine destroy.");
         }
 
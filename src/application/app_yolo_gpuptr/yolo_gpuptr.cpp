@@ -7,8 +7,11 @@
 #include <common/ilogger.hpp>
 #include <common/infer_controller.hpp>
 #include <common/preprocess_kernel.cuh>
+#include <common/topk_kernel.cuh>
+#include <common/box_decoder.hpp>
 #include <common/monopoly_allocator.hpp>
 #include <common/cuda_tools.hpp>
+#include <common/nms.hpp>
 
 namespace YoloGPUPtr{
     using namespace cv;
@@ -22,15 +25,28 @@ namespace YoloGPUPtr{
         }
     }
 
-    void decode_kernel_invoker(
+    // 80类(COCO)时类别数在编译期确定，argmax的循环可以展开
+    static void decode_kernel_invoker(
         float* predict, int num_bboxes, int num_classes, float confidence_threshold, 
         float* invert_affine_matrix, float* parray,
         int max_objects, cudaStream_t stream
-    );
+    ){
+        BoxDecoder::RowMajor layout(predict, 5 + num_classes);
+        BoxDecoder::AffineMatrix matrix(invert_affine_matrix);
+        if(num_classes == 80){
+            BoxDecoder::YoloRowHead80 head(layout, BoxDecoder::DecodedAnchor(), matrix, num_classes, confidence_threshold);
+            BoxDecoder::decode_gpu(head, num_bboxes, parray, max_objects, stream);
+        }else{
+            BoxDecoder::YoloRowHead head(layout, BoxDecoder::DecodedAnchor(), matrix, num_classes, confidence_threshold);
+            BoxDecoder::decode_gpu(head, num_bboxes, parray, max_objects, stream);
+        }
+    }
 
-    void nms_kernel_invoker(
+    static void nms_kernel_invoker(
         float* parray, float nms_threshold, int max_objects, cudaStream_t stream
-    );
+    ){
+        BoxDecoder::fast_nms_gpu<BoxDecoder::ObjectBox>(parray, max_objects, nms_threshold, stream);
+    }
 
     struct AffineMatrix{
         float i2d[6];       // image to dst(network), 2x3 matrix
@@ -99,51 +115,6 @@ namespace YoloGPUPtr{
         }
     };
 
-    static float iou(const Box& a, const Box& b){
-        float cleft 	= max(a.left, b.left);
-        float ctop 		= max(a.top, b.top);
-        float cright 	= min(a.right, b.right);
-        float cbottom 	= min(a.bottom, b.bottom);
-        
-        float c_area = max(cright - cleft, 0.0f) * max(cbottom - ctop, 0.0f);
-        if(c_area == 0.0f)
-            return 0.0f;
-        
-        float a_area = max(0.0f, a.right - a.left) * max(0.0f, a.bottom - a.top);
-        float b_area = max(0.0f, b.right - b.left) * max(0.0f, b.bottom - b.top);
-        return c_area / (a_area + b_area - c_area);
-    }
-
-    static BoxArray cpu_nms(BoxArray& boxes, float threshold){
-
-        std::sort(boxes.begin(), boxes.end(), [](Box& a, Box& b){
-            return a.confidence > b.confidence;
-        });
-
-        BoxArray output;
-        output.reserve(boxes.size());
-
-        vector<bool> remove_flags(boxes.size());
-        for(int i = 0; i < boxes.size(); ++i){
-
-            if(remove_flags[i]) continue;
-
-            auto& a = boxes[i];
-            output.emplace_back(a);
-
-            for(int j = i + 1; j < boxes.size(); ++j){
-                if(remove_flags[j]) continue;
-                
-                auto& b = boxes[j];
-                if(b.class_label == a.class_label){
-                    if(iou(a, b) >= threshold)
-                        remove_flags[j] = true;
-                }
-            }
-        }
-        return output;
-    }
-
     using ControllerImpl = InferController
     <
         Image,                  // input
@@ -204,6 +175,7 @@ namespace YoloGPUPtr{
             int max_batch_size = engine->get_max_batch_size();
             auto input         = engine->tensor("images");
             auto output        = engine->tensor("output");
+            int num_bboxes     = output->size(1);
             int num_classes    = output->size(2) - 5;
 
             input_width_       = input->size(3);
@@ -222,6 +194,15 @@ namespace YoloGPUPtr{
             // 这里的 1 + MAX_IMAGE_BBOX结构是，counter + bboxes ...
             output_array_device.resize(max_batch_size, 1 + MAX_IMAGE_BBOX * NUM_BOX_ELEMENT).to_gpu();
 
+            // 候选box多于MAX_IMAGE_BBOX时，先解码全部候选，再按分数保留前MAX_IMAGE_BBOX个
+            bool use_topk = num_bboxes > MAX_IMAGE_BBOX;
+            TRT::Tensor candidates_device(TRT::DataType::Float);
+            if(use_topk){
+                candidates_device.set_stream(stream_);
+                candidates_device.resize(1 + num_bboxes * NUM_BOX_ELEMENT).to_gpu();
+            }
+
+            NMS::Workspace nms_workspace;
             vector<Job> fetch_jobs;
             while(get_jobs_and_wait(fetch_jobs, max_batch_size)){
 
@@ -251,8 +232,15 @@ namespace YoloGPUPtr{
                     float* image_based_output = output->gpu<float>(ibatch);
                     float* output_array_ptr   = output_array_device.gpu<float>(ibatch);
                     auto affine_matrix        = affin_matrix_device.gpu<float>(ibatch);
-                    checkCudaRuntime(cudaMemsetAsync(output_array_ptr, 0, sizeof(int), stream_));
-                    decode_kernel_invoker(image_based_output, output->size(1), num_classes, confidence_threshold_, affine_matrix, output_array_ptr, MAX_IMAGE_BBOX, stream_);
+                    if(use_topk){
+                        float* candidates_ptr = candidates_device.gpu<float>();
+                        checkCudaRuntime(cudaMemsetAsync(candidates_ptr, 0, sizeof(int), stream_));
+                        decode_kernel_invoker(image_based_output, num_bboxes, num_classes, confidence_threshold_, affine_matrix, candidates_ptr, num_bboxes, stream_);
+                        CUDAKernel::topk_boxes(candidates_ptr, num_bboxes, output_array_ptr, MAX_IMAGE_BBOX, NUM_BOX_ELEMENT, 4, stream_);
+                    }else{
+                        checkCudaRuntime(cudaMemsetAsync(output_array_ptr, 0, sizeof(int), stream_));
+                        decode_kernel_invoker(image_based_output, num_bboxes, num_classes, confidence_threshold_, affine_matrix, output_array_ptr, MAX_IMAGE_BBOX, stream_);
+                    }
 
                     if(nms_method_ == NMSMethod::FastGPU){
                         nms_kernel_invoker(output_array_ptr, nms_threshold_, MAX_IMAGE_BBOX, stream_);
@@ -275,14 +263,13 @@ namespace YoloGPUPtr{
                     }
 
                     if(nms_method_ == NMSMethod::CPU){
-                        image_based_boxes = cpu_nms(image_based_boxes, nms_threshold_);
+                        image_based_boxes = NMS::nms(image_based_boxes, NMS::Config(nms_threshold_), nms_workspace);
                     }
-                    job.pro->set_value(image_based_boxes);
+                    job.pro.set_value(image_based_boxes);
                 }
                 fetch_jobs.clear();
             }
             stream_ = nullptr;
-            tensor_allocator_.reset();
             INFO("Engine destroy.");
         }
 
@@ -0,0 +1,375 @@
+#include "nms.hpp"
+#include <common/thread_pool.hpp>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   include <immintrin.h>
+#   define NMS_AVX2
+#endif
+
+// SIMD与标量的IoU使用相同的运算顺序，并且禁止乘加融合，结果才能逐位一致
+#if defined(__clang__)
+#   pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#   pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace NMS{
+
+    static const int MIN_GRID_BOXES = 256;     // 桶内box数量达到该值时使用网格索引
+    static const int MAX_CELLS_PER_BOX = 4;    // 网格数量的上限，避免box分散时网格过多
+
+    // 与Yolo::cpu_nms中的iou相同
+    static inline float box_iou(float al, float at, float ar, float ab, float a_area, float bl, float bt, float br, float bb, float b_area){
+        float cleft   = std::max(al, bl);
+        float ctop    = std::max(at, bt);
+        float cright  = std::min(ar, br);
+        float cbottom = std::min(ab, bb);
+
+        float c_area = std::max(cright - cleft, 0.0f) * std::max(cbottom - ctop, 0.0f);
+        if(c_area == 0.0f)
+            return 0.0f;
+        return c_area / (a_area + b_area - c_area);
+    }
+
+    static inline float box_area(float left, float top, float right, float bottom){
+        return std::max(0.0f, right - left) * std::max(0.0f, bottom - top);
+    }
+
+#ifdef NMS_AVX2
+    static bool support_avx2(){
+        static const bool support = __builtin_cpu_supports("avx2");
+        return support;
+    }
+
+    __attribute__((target("avx2")))
+    static int suppress_avx2(
+        const float* left, const float* top, const float* right, const float* bottom, const float* area, const int* rank,
+        int begin, int end, const float box[5], int box_rank, float threshold, uint8_t* removed
+    ){
+        __m256 al = _mm256_set1_ps(box[0]), at = _mm256_set1_ps(box[1]);
+        __m256 ar = _mm256_set1_ps(box[2]), ab = _mm256_set1_ps(box[3]);
+        __m256 a_area = _mm256_set1_ps(box[4]);
+        __m256 zero   = _mm256_setzero_ps();
+        __m256 thresh = _mm256_set1_ps(threshold);
+        __m256i arank = _mm256_set1_epi32(box_rank);
+
+        int i = begin;
+        for(; i + 8 <= end; i += 8){
+            __m256 cleft   = _mm256_max_ps(al, _mm256_loadu_ps(left + i));
+            __m256 ctop    = _mm256_max_ps(at, _mm256_loadu_ps(top + i));
+            __m256 cright  = _mm256_min_ps(ar, _mm256_loadu_ps(right + i));
+            __m256 cbottom = _mm256_min_ps(ab, _mm256_loadu_ps(bottom + i));
+            __m256 c_area  = _mm256_mul_ps(_mm256_max_ps(_mm256_sub_ps(cright, cleft), zero), _mm256_max_ps(_mm256_sub_ps(cbottom, ctop), zero));
+            __m256 iou     = _mm256_div_ps(c_area, _mm256_sub_ps(_mm256_add_ps(a_area, _mm256_loadu_ps(area + i)), c_area));
+
+            // c_area为0时IoU为0，与标量实现相同
+            iou = _mm256_and_ps(iou, _mm256_cmp_ps(c_area, zero, _CMP_NEQ_UQ));
+            __m256i ranks = _mm256_loadu_si256((const __m256i*)(rank + i));
+            __m256 hit    = _mm256_and_ps(_mm256_cmp_ps(iou, thresh, _CMP_GE_OQ), _mm256_castsi256_ps(_mm256_cmpgt_epi32(ranks, arank)));
+            int mask      = _mm256_movemask_ps(hit);
+            while(mask != 0){
+                int lane = __builtin_ctz(mask);
+                mask &= mask - 1;
+                removed[rank[i + lane]] = 1;
+            }
+        }
+        return i;
+    }
+#endif // NMS_AVX2
+
+    /* [begin, end)为SoA中的一段，其中rank大于box_rank并且与box的IoU >= threshold的box标记为删除
+       rank为box在排序后的位置，box为left, top, right, bottom, area
+    */
+    static void suppress(
+        const float* left, const float* top, const float* right, const float* bottom, const float* area, const int* rank,
+        int begin, int end, const float box[5], int box_rank, float threshold, uint8_t* removed
+    ){
+        int i = begin;
+#ifdef NMS_AVX2
+        if(support_avx2())
+            i = suppress_avx2(left, top, right, bottom, area, rank, begin, end, box, box_rank, threshold, removed);
+#endif
+        for(; i < end; ++i){
+            if(rank[i] > box_rank && box_iou(box[0], box[1], box[2], box[3], box[4], left[i], top[i], right[i], bottom[i], area[i]) >= threshold)
+                removed[rank[i]] = 1;
+        }
+    }
+
+    void Workspace::clear(int num_groups){
+        num_groups_ = std::max(1, num_groups);
+        input_left_.clear();
+        input_top_.clear();
+        input_right_.clear();
+        input_bottom_.clear();
+        input_score_.clear();
+        input_label_.clear();
+        input_group_.clear();
+        input_index_.clear();
+        group_counts_.assign(num_groups_, 0);
+    }
+
+    void Workspace::add(float left, float top, float right, float bottom, float score, int label, int group){
+        input_left_.push_back(left);
+        input_top_.push_back(top);
+        input_right_.push_back(right);
+        input_bottom_.push_back(bottom);
+        input_score_.push_back(score);
+        input_label_.push_back(label);
+        input_group_.push_back(group);
+        input_index_.push_back(group_counts_[group]++);
+    }
+
+    void Workspace::run(const Config& config, ThreadPool* pool){
+
+        int n = input_score_.size();
+        order_.resize(n);
+        std::iota(order_.begin(), order_.end(), 0);
+
+        // 同一个桶的box连续存放，桶内按分数从高到低，分数相等时按输入顺序
+        bool agnostic = config.class_agnostic;
+        std::sort(order_.begin(), order_.end(), [&](int a, int b){
+            if(input_group_[a] != input_group_[b]) return input_group_[a] < input_group_[b];
+            if(!agnostic && input_label_[a] != input_label_[b]) return input_label_[a] < input_label_[b];
+            if(input_score_[a] != input_score_[b]) return input_score_[a] > input_score_[b];
+            return a < b;
+        });
+
+        rank_.resize(n);
+        left_.resize(n);
+        top_.resize(n);
+        right_.resize(n);
+        bottom_.resize(n);
+        area_.resize(n);
+        score_.resize(n);
+        removed_.assign(n, 0);
+        buckets_.clear();
+        for(int i = 0; i < n; ++i){
+            int index  = order_[i];
+            rank_[i]   = i;
+            left_[i]   = input_left_[index];
+            top_[i]    = input_top_[index];
+            right_[i]  = input_right_[index];
+            bottom_[i] = input_bottom_[index];
+            area_[i]   = box_area(left_[i], top_[i], right_[i], bottom_[i]);
+            score_[i]  = input_score_[index];
+
+            if(i == 0 || input_group_[index] != input_group_[order_[i - 1]] || (!agnostic && input_label_[index] != input_label_[order_[i - 1]]))
+                buckets_.push_back(i);
+        }
+        buckets_.push_back(n);
+
+        // 每个线程使用各自的Scratch，桶之间互不影响，结果与执行顺序无关
+        int num_buckets = buckets_.size() - 1;
+        int num_lanes   = 1;
+        if(pool != nullptr && pool->size() > 0)
+            num_lanes = std::min(pool->size() + 1, num_buckets);
+
+        if((int)scratchs_.size() < std::max(1, num_lanes))
+            scratchs_.resize(std::max(1, num_lanes));
+
+        if(num_lanes <= 1){
+            for(int ibucket = 0; ibucket < num_buckets; ++ibucket)
+                process_bucket(buckets_[ibucket], buckets_[ibucket + 1], config, scratchs_[0]);
+        }else{
+            std::atomic<int> next_bucket{0};
+            pool->parallel_for(0, num_lanes, [&](int lane){
+                int ibucket = 0;
+                while((ibucket = next_bucket++) < num_buckets)
+                    process_bucket(buckets_[ibucket], buckets_[ibucket + 1], config, scratchs_[lane]);
+            });
+        }
+
+        // 按组收集保留的box，组内按分数排序
+        keeps_.clear();
+        group_offsets_.assign(num_groups_ + 1, 0);
+        for(int i = 0; i < n; ++i){
+            if(!removed_[i])
+                group_offsets_[input_group_[order_[i]] + 1]++;
+        }
+
+        for(int group = 0; group < num_groups_; ++group)
+            group_offsets_[group + 1] += group_offsets_[group];
+
+        keeps_.resize(group_offsets_[num_groups_]);
+        group_fill_.assign(group_offsets_.begin(), group_offsets_.end() - 1);
+        for(int i = 0; i < n; ++i){
+            if(removed_[i]) continue;
+
+            int index = order_[i];
+            keeps_[group_fill_[input_group_[index]]++] = Keep{input_index_[index], score_[i]};
+        }
+
+        for(int group = 0; group < num_groups_; ++group){
+            std::sort(keeps_.begin() + group_offsets_[group], keeps_.begin() + group_offsets_[group + 1], [](const Keep& a, const Keep& b){
+                if(a.score != b.score) return a.score > b.score;
+                return a.index < b.index;
+            });
+        }
+    }
+
+    const Keep* Workspace::keeps(int group) const{
+        if(group < 0 || group >= num_groups_ || group_offsets_.empty()) return nullptr;
+        return keeps_.data() + group_offsets_[group];
+    }
+
+    int Workspace::num_keep(int group) const{
+        if(group < 0 || group >= num_groups_ || group_offsets_.empty()) return 0;
+        return group_offsets_[group + 1] - group_offsets_[group];
+    }
+
+    void Workspace::process_bucket(int begin, int end, const Config& config, Scratch& scratch){
+
+        if(config.method != Method::Hard){
+            soft_nms(begin, end, config, scratch);
+            return;
+        }
+
+        // 网格只能跳过IoU为0的box，阈值<=0时IoU为0的box也要删除，不能使用网格
+        if(end - begin >= MIN_GRID_BOXES && config.iou_threshold > 0)
+            hard_nms_grid(begin, end, config.iou_threshold, scratch);
+        else
+            hard_nms(begin, end, config.iou_threshold);
+    }
+
+    void Workspace::hard_nms(int begin, int end, float threshold){
+
+        uint8_t* removed = removed_.data();
+        for(int i = begin; i < end; ++i){
+            if(removed[i]) continue;
+
+            float box[] = {left_[i], top_[i], right_[i], bottom_[i], area_[i]};
+            suppress(left_.data(), top_.data(), right_.data(), bottom_.data(), area_.data(), rank_.data(), i + 1, end, box, i, threshold, removed);
+        }
+    }
+
+    /* 网格的边长不小于桶内box的最大宽高，相交的两个box的left、top之差小于边长
+       因此按left、top划分网格后，与一个box相交的box只会在它周围的3x3个网格内
+    */
+    void Workspace::hard_nms_grid(int begin, int end, float threshold, Scratch& scratch){
+
+        float min_left = left_[begin], max_left = left_[begin];
+        float min_top  = top_[begin],  max_top  = top_[begin];
+        float cell     = 0;
+        for(int i = begin; i < end; ++i){
+            min_left = std::min(min_left, left_[i]);
+            max_left = std::max(max_left, left_[i]);
+            min_top  = std::min(min_top,  top_[i]);
+            max_top  = std::max(max_top,  top_[i]);
+            cell     = std::max(cell, std::max(right_[i] - left_[i], bottom_[i] - top_[i]));
+        }
+
+        int num_boxes = end - begin;
+        cell = std::max(cell, 1e-3f);
+        if(!std::isfinite(cell) || !std::isfinite(max_left - min_left) || !std::isfinite(max_top - min_top)){
+            hard_nms(begin, end, threshold);
+            return;
+        }
+
+        int64_t grid_width = 0, grid_height = 0;
+        while(true){
+            grid_width  = (int64_t)((max_left - min_left) / cell) + 1;
+            grid_height = (int64_t)((max_top  - min_top)  / cell) + 1;
+            if(grid_width * grid_height <= (int64_t)num_boxes * MAX_CELLS_PER_BOX) break;
+            cell *= 2;
+        }
+
+        // 按网格的计数排序，网格内的box按rank从小到大，并复制为网格顺序的SoA
+        int num_cells = grid_width * grid_height;
+        auto cell_of = [&](int i){
+            int x = std::min((int64_t)((left_[i] - min_left) / cell), grid_width - 1);
+            int y = std::min((int64_t)((top_[i]  - min_top)  / cell), grid_height - 1);
+            return y * (int)grid_width + x;
+        };
+
+        scratch.cell_start.assign(num_cells + 1, 0);
+        for(int i = begin; i < end; ++i)
+            scratch.cell_start[cell_of(i) + 1]++;
+
+        for(int icell = 0; icell < num_cells; ++icell)
+            scratch.cell_start[icell + 1] += scratch.cell_start[icell];
+
+        scratch.cell_rank.resize(num_boxes);
+        scratch.cell_left.resize(num_boxes);
+        scratch.cell_top.resize(num_boxes);
+        scratch.cell_right.resize(num_boxes);
+        scratch.cell_bottom.resize(num_boxes);
+        scratch.cell_area.resize(num_boxes);
+        scratch.cell_fill.assign(scratch.cell_start.begin(), scratch.cell_start.end() - 1);
+        for(int i = begin; i < end; ++i){
+            int pos = scratch.cell_fill[cell_of(i)]++;
+            scratch.cell_rank[pos]   = i;
+            scratch.cell_left[pos]   = left_[i];
+            scratch.cell_top[pos]    = top_[i];
+            scratch.cell_right[pos]  = right_[i];
+            scratch.cell_bottom[pos] = bottom_[i];
+            scratch.cell_area[pos]   = area_[i];
+        }
+
+        uint8_t* removed = removed_.data();
+        for(int i = begin; i < end; ++i){
+            if(removed[i]) continue;
+
+            float box[] = {left_[i], top_[i], right_[i], bottom_[i], area_[i]};
+            int icell = cell_of(i);
+            int cx    = icell % grid_width;
+            int cy    = icell / grid_width;
+            for(int y = std::max(cy - 1, 0); y <= std::min<int>(cy + 1, grid_height - 1); ++y){
+                int row_begin = y * grid_width + std::max(cx - 1, 0);
+                int row_end   = y * grid_width + std::min<int>(cx + 1, grid_width - 1);
+
+                // 同一行相邻的网格在SoA中是连续的
+                suppress(
+                    scratch.cell_left.data(), scratch.cell_top.data(), scratch.cell_right.data(), scratch.cell_bottom.data(),
+                    scratch.cell_area.data(), scratch.cell_rank.data(),
+                    scratch.cell_start[row_begin], scratch.cell_start[row_end + 1], box, i, threshold, removed
+                );
+            }
+        }
+    }
+
+    /* Soft-NMS：每次取剩余box中分数最高的保留，其他box按IoU衰减分数，低于score_threshold的删除
+       桶内box数量通常不多，使用O(n^2)的实现
+    */
+    void Workspace::soft_nms(int begin, int end, const Config& config, Scratch& scratch){
+
+        auto& alive = scratch.alive;
+        alive.resize(end - begin);
+        std::iota(alive.begin(), alive.end(), begin);
+
+        uint8_t* removed = removed_.data();
+        while(!alive.empty()){
+
+            int best = 0;
+            for(int j = 1; j < (int)alive.size(); ++j){
+                if(score_[alive[j]] > score_[alive[best]] || (score_[alive[j]] == score_[alive[best]] && alive[j] < alive[best]))
+                    best = j;
+            }
+
+            int i = alive[best];
+            alive[best] = alive.back();
+            alive.pop_back();
+
+            for(int j = 0; j < (int)alive.size(); ++j){
+                int k     = alive[j];
+                float iou = box_iou(left_[i], top_[i], right_[i], bottom_[i], area_[i], left_[k], top_[k], right_[k], bottom_[k], area_[k]);
+                if(config.method == Method::SoftLinear){
+                    if(iou > config.iou_threshold)
+                        score_[k] *= 1 - iou;
+                }else{
+                    score_[k] *= std::exp(-(iou * iou) / config.sigma);
+                }
+
+                if(score_[k] < config.score_threshold){
+                    removed[k] = 1;
+                    alive[j--] = alive.back();
+                    alive.pop_back();
+                }
+            }
+        }
+    }
+
+}; // namespace NMS
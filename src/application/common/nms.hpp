@@ -0,0 +1,142 @@
+#ifndef NMS_HPP
+#define NMS_HPP
+
+#include <vector>
+#include <cstdint>
+
+class ThreadPool;
+
+/**
+ * CPU上的NMS，可用于ObjectDetector::Box、FaceDetector::Box等任何有left/top/right/bottom/confidence的box
+ * box按(图像, 类别)分桶，每个桶内按分数排序后贪心抑制，box以SoA存储，IoU使用SIMD一次计算8个
+ * box较多的桶使用均匀网格索引，只与相邻网格内的box计算IoU
+ * 支持一次处理一个batch内所有图像的box，pool不为空时各个桶并行处理
+ **/
+namespace NMS{
+
+    enum class Method : int{
+        Hard         = 0,   // IoU >= iou_threshold的box被删除
+        SoftLinear   = 1,   // IoU > iou_threshold时分数乘以(1 - IoU)
+        SoftGaussian = 2    // 分数乘以exp(-IoU^2 / sigma)
+    };
+
+    struct Config{
+        Method method         = Method::Hard;
+        float iou_threshold   = 0.5f;
+        bool class_agnostic   = false;    // 为true时不区分类别，所有box一起抑制
+        float sigma           = 0.5f;     // SoftGaussian的参数
+        float score_threshold = 0.001f;   // Soft-NMS衰减后分数低于该值的box被删除
+
+        Config() = default;
+        Config(float iou_threshold, Method method = Method::Hard, bool class_agnostic = false)
+        :method(method), iou_threshold(iou_threshold), class_agnostic(class_agnostic){}
+    };
+
+    struct Keep{
+        int index;      // box在该组内add的顺序
+        float score;    // Hard时为原始分数，Soft-NMS时为衰减后的分数
+    };
+
+    /* NMS的工作区，保存SoA的box、排序与网格索引，重复使用时不再申请内存
+       用法：clear(num_groups) -> add(...) -> run(config) -> keeps(group)
+    */
+    class Workspace{
+    public:
+        // group为box所属的图像，[0, num_groups)
+        void clear(int num_groups = 1);
+        void add(float left, float top, float right, float bottom, float score, int label, int group = 0);
+
+        void run(const Config& config, ThreadPool* pool = nullptr);
+
+        // 该组保留的box，按分数从高到低，分数相等时按index从小到大
+        const Keep* keeps(int group) const;
+        int num_keep(int group) const;
+
+    private:
+        struct Scratch{
+            std::vector<int> cell_start;
+            std::vector<int> cell_fill;
+            std::vector<int> cell_rank;
+            std::vector<float> cell_left, cell_top, cell_right, cell_bottom, cell_area;
+            std::vector<int> alive;
+        };
+
+        void process_bucket(int begin, int end, const Config& config, Scratch& scratch);
+        void hard_nms(int begin, int end, float threshold);
+        void hard_nms_grid(int begin, int end, float threshold, Scratch& scratch);
+        void soft_nms(int begin, int end, const Config& config, Scratch& scratch);
+
+    private:
+        int num_groups_ = 1;
+
+        // add顺序的输入
+        std::vector<float> input_left_, input_top_, input_right_, input_bottom_, input_score_;
+        std::vector<int> input_label_, input_group_, input_index_;
+        std::vector<int> group_counts_;
+
+        // 按(组, 类别, 分数)排序后的SoA
+        std::vector<int> order_;
+        std::vector<int> rank_;
+        std::vector<float> left_, top_, right_, bottom_, area_, score_;
+        std::vector<uint8_t> removed_;
+        std::vector<int> buckets_;
+        std::vector<Scratch> scratchs_;
+
+        std::vector<Keep> keeps_;
+        std::vector<int> group_offsets_;
+        std::vector<int> group_fill_;
+    };
+
+    // 有class_label成员的box按类别分桶，否则视为同一个类别
+    template<class _Box>
+    auto box_label(const _Box& box, int) -> decltype((int)box.class_label){return box.class_label;}
+
+    template<class _Box>
+    int box_label(const _Box&, long){return 0;}
+
+    /* 对一个batch内每个图像的box分别做NMS，batch[i]为第i个图像的BoxArray，结果直接写回
+       保留的box按分数从高到低，Soft-NMS时confidence更新为衰减后的分数
+    */
+    template<class _BoxArray>
+    void nms_batch(_BoxArray* const* batch, int batch_size, const Config& config, Workspace& workspace, ThreadPool* pool = nullptr){
+
+        workspace.clear(batch_size);
+        for(int ibatch = 0; ibatch < batch_size; ++ibatch){
+            for(auto& box : *batch[ibatch])
+                workspace.add(box.left, box.top, box.right, box.bottom, box.confidence, box_label(box, 0), ibatch);
+        }
+
+        workspace.run(config, pool);
+        for(int ibatch = 0; ibatch < batch_size; ++ibatch){
+            _BoxArray& boxes = *batch[ibatch];
+            const Keep* keeps = workspace.keeps(ibatch);
+            int num_keep      = workspace.num_keep(ibatch);
+
+            _BoxArray output;
+            output.reserve(num_keep);
+            for(int i = 0; i < num_keep; ++i){
+                output.emplace_back(boxes[keeps[i].index]);
+                output.back().confidence = keeps[i].score;
+            }
+            boxes.swap(output);
+        }
+    }
+
+    // 单个图像的NMS，返回保留的box
+    template<class _BoxArray>
+    _BoxArray nms(const _BoxArray& boxes, const Config& config, Workspace& workspace){
+        _BoxArray output = boxes;
+        _BoxArray* batch[] = {&output};
+        nms_batch(batch, 1, config, workspace);
+        return output;
+    }
+
+    template<class _BoxArray>
+    _BoxArray nms(const _BoxArray& boxes, const Config& config){
+        Workspace workspace;
+        return nms(boxes, config, workspace);
+    }
+
+}; // namespace NMS
+
+#endif // NMS_HPP
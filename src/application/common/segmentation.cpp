@@ -0,0 +1,339 @@
+#include "segmentation.hpp"
+#include <common/thread_pool.hpp>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   include <immintrin.h>
+#   define SEGMENTATION_AVX2
+#endif
+
+// 与对照实现使用相同的运算顺序，并且禁止乘加融合，结果才能逐位一致
+#if defined(__clang__)
+#   pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#   pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace Segmentation{
+
+    int RLEMask::area() const{
+        int value = 0;
+        for(size_t i = 1; i < counts.size(); i += 2)
+            value += counts[i];
+        return value;
+    }
+
+    void RLEMask::decode(uint8_t* mask, int stride) const{
+
+        int position = 0;
+        for(size_t i = 0; i < counts.size(); ++i){
+            uint8_t value = i % 2;
+            for(uint32_t j = 0; j < counts[i]; ++j, ++position)
+                mask[(top + position / width) * stride + left + position % width] = value;
+        }
+    }
+
+    RLEMask RLEMask::encode(const uint8_t* mask, int stride, int left, int top, int width, int height){
+
+        RLEMask output;
+        output.left   = left;
+        output.top    = top;
+        output.width  = width;
+        output.height = height;
+        if(width <= 0 || height <= 0)
+            return output;
+
+        uint8_t value = 0;
+        uint32_t run  = 0;
+        for(int y = 0; y < height; ++y){
+            const uint8_t* prow = mask + (top + y) * stride + left;
+            for(int x = 0; x < width; ++x){
+                uint8_t current = prow[x] != 0;
+                if(current != value){
+                    output.counts.push_back(run);
+                    value = current;
+                    run   = 0;
+                }
+                run++;
+            }
+        }
+        output.counts.push_back(run);
+        return output;
+    }
+
+    static inline float sigmoid(float x){
+        return 1.0f / (1.0f + expf(-x));
+    }
+
+    // 原图上的像素映射到原型上的坐标，双线性插值的两个相邻点与权重
+    struct AxisMap{
+        float scale, offset;    // 原图到网络输入
+        float ratio;            // 网络输入到原型
+        int size;               // 原型的大小
+
+        void map(int x, int& low, int& high, float& weight) const{
+            float p = (scale * x + offset + 0.5f) * ratio - 0.5f;
+            if(p < 0) p = 0;
+
+            low = (int)p;
+            if(low >= size - 1){
+                low    = size - 1;
+                high   = size - 1;
+                weight = 0;
+            }else{
+                high   = low + 1;
+                weight = p - low;
+            }
+        }
+    };
+
+    static inline float bilinear(const float* row0, const float* row1, int x_low, int x_high, float wx, float wy){
+        return (1 - wy) * ((1 - wx) * row0[x_low] + wx * row0[x_high]) + wy * ((1 - wx) * row1[x_low] + wx * row1[x_high]);
+    }
+
+    // box在原图上覆盖的像素，返回是否为空
+    static bool box_region(const ObjectDetector::Box& box, int image_width, int image_height, RLEMask& mask){
+        int left   = std::max(0, (int)floorf(box.left));
+        int top    = std::max(0, (int)floorf(box.top));
+        int right  = std::min(image_width,  (int)ceilf(box.right));
+        int bottom = std::min(image_height, (int)ceilf(box.bottom));
+
+        mask.left   = left;
+        mask.top    = top;
+        mask.width  = std::max(0, right - left);
+        mask.height = std::max(0, bottom - top);
+        mask.counts.clear();
+        return mask.width == 0 || mask.height == 0;
+    }
+
+    static void make_axis_maps(const Prototypes& prototypes, const float* i2d, AxisMap& xmap, AxisMap& ymap){
+        xmap = {i2d[0], i2d[2], prototypes.width  / (float)prototypes.input_width,  prototypes.width};
+        ymap = {i2d[4], i2d[5], prototypes.height / (float)prototypes.input_height, prototypes.height};
+    }
+
+    static void axpy_scalar(float* acc, const float* x, float alpha, int begin, int n){
+        for(int i = begin; i < n; ++i)
+            acc[i] += alpha * x[i];
+    }
+
+#ifdef SEGMENTATION_AVX2
+    static bool support_avx2(){
+        static const bool support = __builtin_cpu_supports("avx2");
+        return support;
+    }
+
+    // 乘与加分开计算，与标量的结果一致，返回处理到的位置
+    __attribute__((target("avx2")))
+    static int axpy_avx2(float* acc, const float* x, float alpha, int n){
+        __m256 a = _mm256_set1_ps(alpha);
+        int i = 0;
+        for(; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(a, _mm256_loadu_ps(x + i))));
+        return i;
+    }
+#endif // SEGMENTATION_AVX2
+
+    static void axpy(float* acc, const float* x, float alpha, int n){
+        int begin = 0;
+#ifdef SEGMENTATION_AVX2
+        if(support_avx2())
+            begin = axpy_avx2(acc, x, alpha, n);
+#endif
+        axpy_scalar(acc, x, alpha, begin, n);
+    }
+
+    /* 原型上[x0, x0 + n)的一行与系数的乘积，结果为sigmoid之后的值
+       逐个原型累加到同一行，这一行一直留在L1中，每个原型只连续读取n个值
+    */
+    static void mask_row(const Prototypes& prototypes, const float* coefficients, int y, int x0, int n, float* output){
+
+        size_t plane       = (size_t)prototypes.height * prototypes.width;
+        const float* pbase = prototypes.data + (size_t)y * prototypes.width + x0;
+        for(int i = 0; i < n; ++i)
+            output[i] = coefficients[0] * pbase[i];
+
+        for(int m = 1; m < prototypes.num_masks; ++m)
+            axpy(output, pbase + m * plane, coefficients[m], n);
+
+        for(int i = 0; i < n; ++i)
+            output[i] = sigmoid(output[i]);
+    }
+
+    void InstanceDecoder::decode_box(
+        const Prototypes& prototypes, const float* i2d, int image_width, int image_height,
+        const ObjectDetector::Box& box, const float* coefficients, float mask_threshold,
+        Scratch& scratch, RLEMask& mask
+    ){
+        if(box_region(box, image_width, image_height, mask))
+            return;
+
+        AxisMap xmap, ymap;
+        make_axis_maps(prototypes, i2d, xmap, ymap);
+
+        // 每列的插值位置只与x有关，先算好
+        int width  = mask.width;
+        int height = mask.height;
+        scratch.x_low.resize(width);
+        scratch.x_high.resize(width);
+        scratch.x_weight.resize(width);
+        for(int x = 0; x < width; ++x)
+            xmap.map(mask.left + x, scratch.x_low[x], scratch.x_high[x], scratch.x_weight[x]);
+
+        // box覆盖的原型区域，缩放为正数，坐标单调
+        int y0, y1, unused;
+        float unused_weight;
+        ymap.map(mask.top, y0, unused, unused_weight);
+        ymap.map(mask.top + height - 1, unused, y1, unused_weight);
+        int x0 = scratch.x_low[0];
+        int x1 = scratch.x_high[width - 1];
+        int crop_width  = x1 - x0 + 1;
+        int crop_height = y1 - y0 + 1;
+
+        scratch.logits.resize((size_t)crop_width * crop_height);
+        for(int y = y0; y <= y1; ++y)
+            mask_row(prototypes, coefficients, y, x0, crop_width, scratch.logits.data() + (size_t)(y - y0) * crop_width);
+
+        for(int x = 0; x < width; ++x){
+            scratch.x_low[x]  -= x0;
+            scratch.x_high[x] -= x0;
+        }
+
+        // 上采样的同时编码，不保存原图上的mask
+        uint8_t value = 0;
+        uint32_t run  = 0;
+        for(int y = 0; y < height; ++y){
+            int y_low, y_high;
+            float wy;
+            ymap.map(mask.top + y, y_low, y_high, wy);
+
+            const float* row0 = scratch.logits.data() + (size_t)(y_low  - y0) * crop_width;
+            const float* row1 = scratch.logits.data() + (size_t)(y_high - y0) * crop_width;
+            for(int x = 0; x < width; ++x){
+                uint8_t current = bilinear(row0, row1, scratch.x_low[x], scratch.x_high[x], scratch.x_weight[x], wy) > mask_threshold;
+                if(current != value){
+                    mask.counts.push_back(run);
+                    value = current;
+                    run   = 0;
+                }
+                run++;
+            }
+        }
+        mask.counts.push_back(run);
+    }
+
+    void InstanceDecoder::decode(
+        const Prototypes& prototypes, const float* i2d, int image_width, int image_height,
+        const ObjectDetector::Box* boxes, const float* coefficients, int num_boxes,
+        std::vector<RLEMask>& masks, float mask_threshold, ThreadPool* pool
+    ){
+        masks.resize(num_boxes);
+
+        int num_lanes = 1;
+        if(pool != nullptr && pool->size() > 0)
+            num_lanes = std::min(pool->size() + 1, num_boxes);
+
+        if((int)scratchs_.size() < std::max(1, num_lanes))
+            scratchs_.resize(std::max(1, num_lanes));
+
+        int num_masks = prototypes.num_masks;
+        if(num_lanes <= 1){
+            for(int i = 0; i < num_boxes; ++i)
+                decode_box(prototypes, i2d, image_width, image_height, boxes[i], coefficients + i * num_masks, mask_threshold, scratchs_[0], masks[i]);
+            return;
+        }
+
+        // box的大小差别很大，按顺序领取而不是平均分配
+        std::atomic<int> next_box{0};
+        pool->parallel_for(0, num_lanes, [&](int lane){
+            int i = 0;
+            while((i = next_box.fetch_add(1)) < num_boxes)
+                decode_box(prototypes, i2d, image_width, image_height, boxes[i], coefficients + i * num_masks, mask_threshold, scratchs_[lane], masks[i]);
+        });
+    }
+
+    void decode_instance_reference(
+        const Prototypes& prototypes, const float* i2d, int image_width, int image_height,
+        const ObjectDetector::Box* boxes, const float* coefficients, int num_boxes,
+        std::vector<RLEMask>& masks, float mask_threshold
+    ){
+        AxisMap xmap, ymap;
+        make_axis_maps(prototypes, i2d, xmap, ymap);
+
+        int proto_width  = prototypes.width;
+        int proto_height = prototypes.height;
+        std::vector<float> logits((size_t)proto_width * proto_height);
+        std::vector<uint8_t> image_mask((size_t)image_width * image_height);
+        masks.resize(num_boxes);
+        for(int i = 0; i < num_boxes; ++i){
+            const float* coefficient = coefficients + i * prototypes.num_masks;
+            for(int y = 0; y < proto_height; ++y){
+                float* prow = logits.data() + (size_t)y * proto_width;
+                for(int x = 0; x < proto_width; ++x){
+                    const float* pitem = prototypes.data + (size_t)y * proto_width + x;
+                    float value = coefficient[0] * pitem[0];
+                    for(int m = 1; m < prototypes.num_masks; ++m)
+                        value += coefficient[m] * pitem[(size_t)m * proto_width * proto_height];
+                    prow[x] = sigmoid(value);
+                }
+            }
+
+            for(int y = 0; y < image_height; ++y){
+                int y_low, y_high;
+                float wy;
+                ymap.map(y, y_low, y_high, wy);
+
+                const float* row0 = logits.data() + (size_t)y_low  * proto_width;
+                const float* row1 = logits.data() + (size_t)y_high * proto_width;
+                for(int x = 0; x < image_width; ++x){
+                    int x_low, x_high;
+                    float wx;
+                    xmap.map(x, x_low, x_high, wx);
+                    image_mask[(size_t)y * image_width + x] = bilinear(row0, row1, x_low, x_high, wx, wy) > mask_threshold;
+                }
+            }
+
+            RLEMask& mask = masks[i];
+            box_region(boxes[i], image_width, image_height, mask);
+            mask = RLEMask::encode(image_mask.data(), image_width, mask.left, mask.top, mask.width, mask.height);
+        }
+    }
+
+    static void argmax_rows(const float* predict, int begin, int end, int num_classes, float* prob, uint8_t* index){
+        for(int i = begin; i < end; ++i){
+            const float* pitem = predict + (size_t)i * num_classes;
+            float best = pitem[0];
+            int label  = 0;
+            for(int ic = 1; ic < num_classes; ++ic){
+                if(pitem[ic] > best){
+                    best  = pitem[ic];
+                    label = ic;
+                }
+            }
+            prob[i]  = best;
+            index[i] = label;
+        }
+    }
+
+    void semantic_argmax(const float* predict, int num_pixels, int num_classes, float* prob, uint8_t* index, ThreadPool* pool){
+
+        const int MIN_PIXELS_PER_BLOCK = 16384;
+        int num_blocks = 1;
+        if(pool != nullptr && pool->size() > 0)
+            num_blocks = std::min(pool->size() + 1, num_pixels / MIN_PIXELS_PER_BLOCK);
+
+        if(num_blocks <= 1){
+            argmax_rows(predict, 0, num_pixels, num_classes, prob, index);
+            return;
+        }
+
+        pool->parallel_for(0, num_blocks, [&](int iblock){
+            int begin = (int)((int64_t)num_pixels * iblock / num_blocks);
+            int end   = (int)((int64_t)num_pixels * (iblock + 1) / num_blocks);
+            argmax_rows(predict, begin, end, num_classes, prob, index);
+        });
+    }
+
+}; // namespace Segmentation
@@ -0,0 +1,99 @@
+#ifndef SEGMENTATION_HPP
+#define SEGMENTATION_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "object_detector.hpp"
+
+class ThreadPool;
+
+/**
+ * 分割的CPU后处理
+ * 实例分割(Yolo-seg)：只对保留的box计算mask，系数与原型的乘积只在box覆盖的原型区域内计算，
+ * 先裁剪再上采样到原图，结果直接编码为游程(RLE)，不产生原图大小的mask
+ * 语义分割：逐像素的argmax
+ **/
+namespace Segmentation{
+
+    /* 行优先的游程编码，counts交替为0与1的长度，第一个为0的长度(可以为0)
+       只覆盖原图上[left, left + width) x [top, top + height)的区域，区域外都是0
+    */
+    struct RLEMask{
+        int left   = 0;
+        int top    = 0;
+        int width  = 0;
+        int height = 0;
+        std::vector<uint32_t> counts;
+
+        int area() const;
+
+        // 编码后的字节数，用于估计传输的数据量
+        size_t bytes() const{return sizeof(int) * 4 + counts.size() * sizeof(uint32_t);}
+
+        // 把区域写入mask(原图大小，每行stride字节)，1为前景，区域外不修改
+        void decode(uint8_t* mask, int stride) const;
+
+        // mask中区域内非0的像素为前景
+        static RLEMask encode(const uint8_t* mask, int stride, int left, int top, int width, int height);
+    };
+
+    // 原型为[num_masks, height, width]，覆盖整个网络输入[input_height, input_width]
+    struct Prototypes{
+        const float* data = nullptr;
+        int num_masks     = 0;
+        int height        = 0;
+        int width         = 0;
+        int input_width   = 0;
+        int input_height  = 0;
+
+        Prototypes() = default;
+        Prototypes(const float* data, int num_masks, int height, int width, int input_width, int input_height)
+        :data(data), num_masks(num_masks), height(height), width(width), input_width(input_width), input_height(input_height){}
+    };
+
+    /* 实例mask的解码，重复使用时不再申请内存
+       i2d为原图到网络输入的2x3矩阵，只支持缩放与平移(letterbox)
+       boxes为原图上的box，coefficients为[num_boxes, num_masks]的mask系数
+       masks[i]为boxes[i]的mask：sigmoid(系数 x 原型)双线性上采样到原图后大于mask_threshold的像素，只保留box内
+    */
+    class InstanceDecoder{
+    public:
+        void decode(
+            const Prototypes& prototypes, const float* i2d, int image_width, int image_height,
+            const ObjectDetector::Box* boxes, const float* coefficients, int num_boxes,
+            std::vector<RLEMask>& masks, float mask_threshold = 0.5f, ThreadPool* pool = nullptr
+        );
+
+    private:
+        struct Scratch{
+            std::vector<float> logits;
+            std::vector<int> x_low, x_high;
+            std::vector<float> x_weight;
+        };
+
+        void decode_box(
+            const Prototypes& prototypes, const float* i2d, int image_width, int image_height,
+            const ObjectDetector::Box& box, const float* coefficients, float mask_threshold,
+            Scratch& scratch, RLEMask& mask
+        );
+
+    private:
+        std::vector<Scratch> scratchs_;
+    };
+
+    // 对照实现：对整个原型求mask并上采样到整个原图，再按box裁剪，结果与InstanceDecoder完全一致
+    void decode_instance_reference(
+        const Prototypes& prototypes, const float* i2d, int image_width, int image_height,
+        const ObjectDetector::Box* boxes, const float* coefficients, int num_boxes,
+        std::vector<RLEMask>& masks, float mask_threshold = 0.5f
+    );
+
+    /* 语义分割，predict为[num_pixels, num_classes]，每个像素取最大的类别，相等时取序号小的
+       prob与index为每个像素的最大值与类别，pool不为空时按行分块并行
+    */
+    void semantic_argmax(const float* predict, int num_pixels, int num_classes, float* prob, uint8_t* index, ThreadPool* pool = nullptr);
+
+}; // namespace Segmentation
+
+#endif // SEGMENTATION_HPP
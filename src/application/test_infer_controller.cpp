@@ -0,0 +1,911 @@
+#include <common/infer_controller.hpp>
+#include <common/ilogger.hpp>
+#include <common/load_balancer.hpp>
+#include <thread>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+/* 单独的测试程序(Makefile/CMake中的test_infer_controller目标)定义INFER_CONTROLLER_TEST_MAIN，
+   替换全局的operator new统计堆内存申请次数，用于验证稳态下不申请内存
+   pro中不替换，job_pool只检查job记录数
+*/
+#ifdef INFER_CONTROLLER_TEST_MAIN
+static atomic<bool>   g_count_allocations{false};
+static atomic<size_t> g_num_allocations{0};
+
+void* operator new(size_t size){
+    if(g_count_allocations.load(memory_order_relaxed))
+        g_num_allocations++;
+
+    void* ptr = malloc(size == 0 ? 1 : size);
+    if(ptr == nullptr)
+        throw bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept{
+    free(ptr);
+}
+
+static bool allocation_counting(){return true;}
+static void begin_count_allocations(){g_num_allocations = 0; g_count_allocations = true;}
+static size_t end_count_allocations(){g_count_allocations = false; return g_num_allocations;}
+#else
+static bool allocation_counting(){return false;}
+static void begin_count_allocations(){}
+static size_t end_count_allocations(){return 0;}
+#endif
+
+namespace{
+
+    // 统计同时在执行的调用数量的峰值，用于检查并行是否真的发生，不依赖耗时
+    class ConcurrencyMeter{
+    public:
+        void enter(){
+            int current = ++current_;
+            int peak    = peak_;
+            while(current > peak && !peak_.compare_exchange_weak(peak, current));
+        }
+
+        void leave(){--current_;}
+        int peak() const{return peak_;}
+
+    private:
+        atomic<int> current_{0};
+        atomic<int> peak_{0};
+    };
+
+    /* 模拟引擎，forward耗时固定且与batch大小无关，这与GPU上小batch的特性接近
+       用于在没有GPU的机器上验证InferController的调度逻辑 */
+    class FakeEngine{
+    public:
+        FakeEngine(int max_batch_size, int forward_ms)
+        :max_batch_size_(max_batch_size), forward_ms_(forward_ms){}
+
+        int get_max_batch_size(){return max_batch_size_;}
+        void forward(){iLogger::sleep(forward_ms_);}
+
+    private:
+        int max_batch_size_ = 0;
+        int forward_ms_     = 0;
+    };
+
+    using FakeControllerImpl = InferController
+    <
+        int,                    // input
+        int,                    // output
+        tuple<string, int>,     // start param
+        int                     // additional
+    >;
+    class FakeController : public FakeControllerImpl{
+    public:
+        FakeController(int max_batch_size, int forward_ms)
+        :engine_(max_batch_size, forward_ms){}
+
+        virtual ~FakeController(){
+            stop();
+        }
+
+        bool startup(int num_workers = 1){
+            return FakeControllerImpl::startup(make_tuple(string("fake"), 0), num_workers);
+        }
+
+        float average_batch_size(){
+            return num_batches_ == 0 ? 0 : num_jobs_ / (float)num_batches_;
+        }
+
+    protected:
+        virtual void worker(promise<bool>& result) override{
+            worker(result, 0);
+        }
+
+        virtual void worker(promise<bool>& result, int worker_index) override{
+
+            // 每个worker有独立的FakeEngine，对应真实引擎的clone_context
+            FakeEngine engine = engine_;
+            int max_batch_size = engine.get_max_batch_size();
+            if(worker_index == 0)
+                tensor_allocator_ = make_shared<MonopolyAllocator<TRT::Tensor>>(max_batch_size * 2 * num_workers_);
+            result.set_value(true);
+
+            vector<Job> fetch_jobs;
+            while(get_jobs_and_wait(fetch_jobs, max_batch_size)){
+
+                for(auto& job : fetch_jobs)
+                    job.mono_tensor->release();
+
+                forward_meter_.enter();
+                engine.forward();
+                forward_meter_.leave();
+
+                for(auto& job : fetch_jobs)
+                    job.pro.set_value(job.input * 2);
+
+                num_jobs_    += fetch_jobs.size();
+                num_batches_ += 1;
+                fetch_jobs.clear();
+            }
+        }
+
+        virtual bool preprocess(Job& job, const int& input) override{
+            if(input < 0)
+                return false;
+
+            job.mono_tensor = tensor_allocator_->query();
+            if(job.mono_tensor == nullptr)
+                return false;
+
+            // 模拟拷贝大图到pinned memory的耗时
+            preprocess_meter_.enter();
+            if(preprocess_ms_ > 0)
+                iLogger::sleep(preprocess_ms_);
+            preprocess_meter_.leave();
+
+            job.input = input;
+            return true;
+        }
+
+    public:
+        int preprocess_ms_ = 0;
+        ConcurrencyMeter forward_meter_;
+        ConcurrencyMeter preprocess_meter_;
+
+    private:
+        FakeEngine engine_;
+        atomic<int> num_jobs_{0};
+        atomic<int> num_batches_{0};
+    };
+
+    /* 输出为定长数组的模拟推理器，与BoxArray一样支持clear()，用于验证job记录与输出存储的复用
+       worker的局部变量在启动时就申请好，稳态下不申请内存
+    */
+    class PooledController : public InferController<int, vector<int>, tuple<string, int>, int>{
+    public:
+        virtual ~PooledController(){
+            stop();
+        }
+
+        bool startup(){
+            return InferController::startup(make_tuple(string("pooled"), 0));
+        }
+
+    protected:
+        virtual void worker(promise<bool>& result) override{
+
+            const int max_batch_size = 4;
+            tensor_allocator_ = make_shared<MonopolyAllocator<TRT::Tensor>>(max_batch_size * 2);
+            result.set_value(true);
+
+            vector<Job> fetch_jobs;
+            fetch_jobs.reserve(max_batch_size);
+            while(get_jobs_and_wait(fetch_jobs, max_batch_size)){
+
+                for(auto& job : fetch_jobs){
+                    job.mono_tensor->release();
+                    for(int i = 0; i < 16; ++i)
+                        job.output.push_back(job.input + i);
+                    job.pro.set_value(job.output);
+                }
+            }
+        }
+
+        virtual bool preprocess(Job& job, const int& input) override{
+            job.mono_tensor = tensor_allocator_->query();
+            if(job.mono_tensor == nullptr)
+                return false;
+
+            job.input = input;
+            return true;
+        }
+    };
+
+    // 每隔interval_ms提交一个job，模拟中等负载
+    static bool run_trickle(FakeController& controller, int njobs, int interval_ms, vector<int>& outputs){
+
+        vector<shared_future<int>> futures;
+        for(int i = 0; i < njobs; ++i){
+            futures.emplace_back(controller.commit(i));
+            iLogger::sleep(interval_ms);
+        }
+
+        outputs.clear();
+        for(auto& fut : futures)
+            outputs.emplace_back(fut.get());
+        return true;
+    }
+};
+
+static bool test_dynamic_batching(){
+
+    vector<int> outputs;
+    FakeController baseline(16, 4);
+    if(!baseline.startup()) return false;
+    run_trickle(baseline, 64, 2, outputs);
+
+    FakeController batched(16, 4);
+    if(!batched.startup()) return false;
+
+    FakeController::BatchPolicy policy;
+    policy.max_queue_delay_ms   = 20;
+    policy.preferred_batch_size = 8;
+    batched.set_batch_policy(policy);
+    run_trickle(batched, 64, 2, outputs);
+
+    for(int i = 0; i < outputs.size(); ++i){
+        if(outputs[i] != i * 2){
+            INFOE("Output mismatch at %d, %d != %d", i, outputs[i], i * 2);
+            return false;
+        }
+    }
+
+    INFO("Average batch size, baseline = %.2f, dynamic batching = %.2f",
+        baseline.average_batch_size(), batched.average_batch_size());
+
+    if(batched.average_batch_size() <= baseline.average_batch_size()){
+        INFOE("Dynamic batching did not increase the batch size");
+        return false;
+    }
+    return true;
+}
+
+static bool test_job_deadline(){
+
+    // 引擎很慢，截止时间很短，排在后面的job会过期
+    FakeController controller(2, 30);
+    if(!controller.startup()) return false;
+
+    FakeController::BatchPolicy policy;
+    policy.job_deadline_ms = 15;
+    controller.set_batch_policy(policy);
+
+    vector<int> outputs;
+    run_trickle(controller, 4, 0, outputs);
+
+    INFO("Expired jobs = %d", (int)controller.num_expired_jobs());
+    if(controller.num_expired_jobs() == 0){
+        INFOE("Expect some jobs expired");
+        return false;
+    }
+
+    // 截止时间从commit开始计算，预处理超时的job即使队列为空也会过期
+    FakeController slow_preprocess(2, 1);
+    if(!slow_preprocess.startup()) return false;
+
+    slow_preprocess.preprocess_ms_ = 30;
+    slow_preprocess.set_batch_policy(policy);
+    if(slow_preprocess.commit(1).get() != 0 || slow_preprocess.num_expired_jobs() != 1){
+        INFOE("Expect the job expired during preprocess, expired jobs = %d", (int)slow_preprocess.num_expired_jobs());
+        return false;
+    }
+    return true;
+}
+
+static bool test_multi_worker(){
+
+    auto run = [](int num_workers, double& elapsed, int& peak_forwards){
+        FakeController controller(4, 10);
+        if(!controller.startup(num_workers))
+            return false;
+
+        vector<int> inputs(48);
+        for(int i = 0; i < inputs.size(); ++i)
+            inputs[i] = i;
+
+        auto tic     = iLogger::timestamp_now_float();
+        auto futures = controller.commits(inputs);
+        for(int i = 0; i < futures.size(); ++i){
+            if(futures[i].get() != i * 2){
+                INFOE("Output mismatch at %d", i);
+                return false;
+            }
+        }
+        elapsed       = iLogger::timestamp_now_float() - tic;
+        peak_forwards = controller.forward_meter_.peak();
+        return true;
+    };
+
+    double single_elapsed = 0, multi_elapsed = 0;
+    int single_peak = 0, multi_peak = 0;
+    if(!run(1, single_elapsed, single_peak) || !run(3, multi_elapsed, multi_peak))
+        return false;
+
+    // 耗时受机器负载影响，只打印，检查同时执行的forward数量
+    INFO("Elapsed, 1 worker = %.2f ms, 3 workers = %.2f ms", single_elapsed, multi_elapsed);
+    INFO("Max concurrent forwards, 1 worker = %d, 3 workers = %d", single_peak, multi_peak);
+    if(single_peak != 1 || multi_peak < 2){
+        INFOE("Expect forwards overlapped only with multiple workers");
+        return false;
+    }
+    return true;
+}
+
+static bool test_parallel_preprocess(){
+
+    auto run = [](int num_threads, double& elapsed, int& peak_preprocess){
+        FakeController controller(8, 1);
+        if(!controller.startup())
+            return false;
+
+        controller.preprocess_ms_ = 5;
+        controller.set_preprocess_threads(num_threads);
+
+        // 负数输入会预处理失败，应当立即得到空结果，且不影响其他job的顺序
+        vector<int> inputs(32);
+        for(int i = 0; i < inputs.size(); ++i)
+            inputs[i] = i % 7 == 3 ? -i : i;
+
+        auto tic     = iLogger::timestamp_now_float();
+        auto futures = controller.commits(inputs);
+        for(int i = 0; i < futures.size(); ++i){
+            int expect = inputs[i] < 0 ? 0 : inputs[i] * 2;
+            if(futures[i].get() != expect){
+                INFOE("Output mismatch at %d", i);
+                return false;
+            }
+        }
+        elapsed         = iLogger::timestamp_now_float() - tic;
+        peak_preprocess = controller.preprocess_meter_.peak();
+        return true;
+    };
+
+    double serial_elapsed = 0, parallel_elapsed = 0;
+    int serial_peak = 0, parallel_peak = 0;
+    if(!run(0, serial_elapsed, serial_peak) || !run(4, parallel_elapsed, parallel_peak))
+        return false;
+
+    // 耗时受机器负载影响，只打印，检查同时执行的预处理数量
+    INFO("Elapsed, serial preprocess = %.2f ms, 4 threads = %.2f ms", serial_elapsed, parallel_elapsed);
+    INFO("Max concurrent preprocess, serial = %d, 4 threads = %d", serial_peak, parallel_peak);
+    if(serial_peak != 1 || parallel_peak < 2){
+        INFOE("Expect preprocess overlapped only with the preprocess threads");
+        return false;
+    }
+    return true;
+}
+
+static bool test_queue_limit(){
+
+    // 引擎很慢，队列很快被填满
+    auto run = [](QueueFullPolicy policy, vector<CommitError>& errors, vector<int>& outputs, unique_ptr<FakeController>& pcontroller){
+        pcontroller.reset(new FakeController(1, 30));
+        if(!pcontroller->startup()) return false;
+
+        pcontroller->set_queue_limit(2, policy);
+        vector<shared_future<int>> futures;
+        errors.clear();
+        for(int i = 0; i < 8; ++i){
+            CommitError error;
+            futures.emplace_back(pcontroller->commit(i + 1, &error));
+            errors.emplace_back(error);
+            if(pcontroller->queue_size() > 2 && policy != QueueFullPolicy::DropOldest){
+                INFOE("Queue size %d exceed the limit", pcontroller->queue_size());
+                return false;
+            }
+        }
+
+        outputs.clear();
+        for(auto& fut : futures)
+            outputs.emplace_back(fut.get());
+        return true;
+    };
+
+    vector<CommitError> errors;
+    vector<int> outputs;
+
+    // Reject: 队列满时立即返回QueueFull和空结果
+    unique_ptr<FakeController> reject;
+    if(!run(QueueFullPolicy::Reject, errors, outputs, reject)) return false;
+    int nrejected = count(errors.begin(), errors.end(), CommitError::QueueFull);
+    INFO("Reject policy, rejected = %d", (int)reject->num_rejected_jobs());
+    if(nrejected == 0 || nrejected != reject->num_rejected_jobs()){
+        INFOE("Expect some jobs rejected");
+        return false;
+    }
+    for(int i = 0; i < outputs.size(); ++i){
+        int expect = errors[i] == CommitError::None ? (i + 1) * 2 : 0;
+        if(outputs[i] != expect){
+            INFOE("Output mismatch at %d, %d != %d", i, outputs[i], expect);
+            return false;
+        }
+    }
+
+    // DropOldest: 最新的job总是被接受，最旧的job得到空结果
+    unique_ptr<FakeController> drop;
+    if(!run(QueueFullPolicy::DropOldest, errors, outputs, drop)) return false;
+    INFO("DropOldest policy, dropped = %d", (int)drop->num_dropped_jobs());
+    if(drop->num_dropped_jobs() == 0 || count(errors.begin(), errors.end(), CommitError::None) != errors.size()){
+        INFOE("Expect some jobs dropped and all jobs accepted");
+        return false;
+    }
+    if(outputs.back() != 8 * 2 || count(outputs.begin(), outputs.end(), 0) != drop->num_dropped_jobs()){
+        INFOE("Expect the latest job done and dropped jobs empty");
+        return false;
+    }
+
+    // Block: 所有job都被接受并完成，commit被阻塞直到队列有空位
+    unique_ptr<FakeController> block;
+    if(!run(QueueFullPolicy::Block, errors, outputs, block)) return false;
+    for(int i = 0; i < outputs.size(); ++i){
+        if(errors[i] != CommitError::None || outputs[i] != (i + 1) * 2){
+            INFOE("Block policy, job %d failed, %s", i, commit_error_string(errors[i]));
+            return false;
+        }
+    }
+    return block->num_rejected_jobs() == 0 && block->num_dropped_jobs() == 0;
+}
+
+static bool test_concurrent_block(){
+
+    /* 多个线程同时commits，每批job数等于队列上限
+       逐个接受job时，每个线程可能各自持有一部分名额并等待剩下的名额，导致死锁
+       先用慢的引擎把队列填满，名额逐个释放时两个线程交替得到名额，容易出现这种情况
+       4个worker时allocator有8个tensor，足够队列与两个线程的预处理同时使用
+    */
+    const int nthreads = 2, batch_size = 4, nrounds = 5;
+    for(int round = 0; round < nrounds; ++round){
+        FakeController controller(1, 5);
+        if(!controller.startup(4)) return false;
+        controller.set_queue_limit(batch_size, QueueFullPolicy::Block);
+
+        vector<shared_future<int>> prefill;
+        for(int i = 0; i < batch_size * 2; ++i)
+            prefill.emplace_back(controller.commit(i));
+
+        atomic<int> ndone{0};
+        vector<vector<CommitError>> errors(nthreads);
+        vector<thread> threads;
+        for(int t = 0; t < nthreads; ++t){
+            threads.emplace_back([&, t](){
+                vector<int> inputs(batch_size, t + 1);
+                iLogger::sleep(t);
+                controller.commits(inputs, &errors[t]);
+                ndone++;
+            });
+        }
+
+        auto begin = iLogger::timestamp_now_float();
+        while(ndone < nthreads && iLogger::timestamp_now_float() - begin < 2000)
+            iLogger::sleep(1);
+
+        bool deadlock = ndone < nthreads;
+
+        // stop会唤醒阻塞的commits，保证线程可以结束
+        controller.stop();
+        for(auto& t : threads)
+            t.join();
+
+        if(deadlock){
+            INFOE("Round %d, commits blocked, done = %d, pending = %d", round, (int)ndone, controller.queue_size());
+            return false;
+        }
+
+        for(auto& item : errors){
+            if(count(item.begin(), item.end(), CommitError::None) != batch_size){
+                INFOE("Round %d, expect all jobs accepted", round);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool test_stop_during_preprocess(){
+
+    /* 预处理期间stop()，stop已经取走了队列中的job，之后入队的job不会再有worker处理
+       commit与commits都应当直接交付空结果并返回Stopped，每个回调仍然只调用一次
+       commits的第二个job在stop之后才预处理，allocator拒绝query，同样返回Stopped
+       stop之后的commit与commits不再访问allocator，直接返回Stopped
+    */
+    FakeController controller(4, 1);
+    if(!controller.startup()) return false;
+    controller.preprocess_ms_ = 200;
+
+    atomic<int> ncallback{0};
+    CommitError single = CommitError::None;
+    vector<CommitError> batch;
+    vector<thread> threads;
+    threads.emplace_back([&](){
+        single = controller.commit_async(1, [&](const int& output){ncallback++;});
+    });
+    threads.emplace_back([&](){
+        vector<int> inputs(2, 1);
+        vector<FakeController::Callback> callbacks(inputs.size(), [&](const int& output){ncallback++;});
+        batch = controller.commits_async(inputs, callbacks);
+    });
+
+    iLogger::sleep(50);
+    controller.stop();
+    for(auto& t : threads)
+        t.join();
+
+    // 未交付的job不会再被交付，不需要继续等待
+    bool delivered = ncallback == 3 && controller.num_outstanding_jobs() == 0;
+    bool stopped   = single == CommitError::Stopped && count(batch.begin(), batch.end(), CommitError::Stopped) == 2;
+
+    auto after_single = controller.commit_async(1, [&](const int& output){ncallback++;});
+    auto after_batch  = controller.commits_async(vector<int>(3, 1), vector<FakeController::Callback>(3, [&](const int& output){ncallback++;}));
+    stopped = stopped && after_single == CommitError::Stopped && count(after_batch.begin(), after_batch.end(), CommitError::Stopped) == 3;
+    delivered = delivered && ncallback == 7;
+    if(!delivered || !stopped || controller.queue_size() != 0){
+        INFOE("Stop during preprocess, callbacks = %d, outstanding = %d, single = %s, pending = %d",
+            (int)ncallback, controller.num_outstanding_jobs(), commit_error_string(single), controller.queue_size()
+        );
+        return false;
+    }
+    return true;
+}
+
+static bool test_completion_queue(){
+
+    FakeController controller(4, 2);
+    if(!controller.startup()) return false;
+
+    // 回调：每个job回调且只回调一次，包括预处理失败的job
+    const int njobs = 32;
+    vector<atomic<int>> ncalled(njobs);
+    vector<int> outputs(njobs);
+    atomic<int> nfinished{0};
+    for(int i = 0; i < njobs; ++i){
+        int input = i % 5 == 4 ? -1 : i;
+        auto error = controller.commit_async(input, [&, i](const int& output){
+            outputs[i] = output;
+            ncalled[i]++;
+            nfinished++;
+        });
+
+        if((input < 0) != (error == CommitError::PreprocessFailed)){
+            INFOE("Unexpect commit error %s at %d", commit_error_string(error), i);
+            return false;
+        }
+    }
+
+    while(nfinished < njobs)
+        iLogger::sleep(1);
+
+    for(int i = 0; i < njobs; ++i){
+        int expect = i % 5 == 4 ? 0 : i * 2;
+        if(ncalled[i] != 1 || outputs[i] != expect){
+            INFOE("Callback %d called %d times, output %d != %d", i, (int)ncalled[i], outputs[i], expect);
+            return false;
+        }
+    }
+
+    // 完成队列：结果通过tag对应到输入
+    auto queue = make_shared<CompletionQueue<int>>();
+    vector<int> inputs(njobs);
+    for(int i = 0; i < njobs; ++i)
+        inputs[i] = i;
+
+    const uint64_t first_tag = 1000;
+    controller.commits(inputs, queue, first_tag);
+    controller.commit(njobs, queue, first_tag + njobs);
+
+    CompletionQueue<int>::Item item;
+    for(int i = 0; i <= njobs; ++i){
+        if(!queue->next(item, 1000)){
+            INFOE("Completion queue timeout");
+            return false;
+        }
+
+        int input = (int)(item.tag - first_tag);
+        if(item.output != input * 2){
+            INFOE("Tag %d, output %d != %d", (int)item.tag, item.output, input * 2);
+            return false;
+        }
+    }
+
+    queue->shutdown();
+    return !queue->next(item) && queue->size() == 0;
+}
+
+static bool test_job_pool(){
+
+    PooledController controller;
+    if(!controller.startup()) return false;
+
+    // 回调只捕获指针，可以放进std::function的内部缓冲
+    struct Counter{
+        atomic<int> nfinished{0};
+        atomic<int> nmismatch{0};
+    } counter;
+
+    const int njobs = 1024;
+    auto run = [&](){
+        counter.nfinished = 0;
+        Counter* pcounter = &counter;
+        for(int i = 0; i < njobs; ++i){
+            controller.commit_async(i, [pcounter, i](const vector<int>& output){
+                if(output.size() != 16 || output[0] != i)
+                    pcounter->nmismatch++;
+                pcounter->nfinished++;
+            });
+        }
+
+        while(counter.nfinished < njobs)
+            this_thread::yield();
+    };
+
+    /* 在途的job记录有上限：队列中与预处理中的job各持有一个tensor(allocator容量8)，
+       worker正在处理的一批(最多4个)已经释放了tensor，再加上正在commit的一个
+       job记录池复用时，记录总数不超过这个上限，与提交的job数无关
+       新的记录在第一次使用时得到输出的容量，队列与记录池的空间也在新建记录时预留，
+       因此没有新建记录的一轮就是稳态，这一轮的内存申请次数必须为0
+    */
+    const int max_records = 8 + 4 + 1, nrounds = 8;
+    int nsteady = 0;
+    size_t steady_allocations = 0;
+    for(int round = 0; round < nrounds; ++round){
+        size_t records = controller.num_job_records();
+        begin_count_allocations();
+        run();
+        size_t allocations = end_count_allocations();
+
+        bool steady = controller.num_job_records() == records;
+        if(steady){
+            nsteady++;
+            steady_allocations += allocations;
+        }
+        INFO("Round %d, %d jobs, job records = %d, new records = %d, allocations = %s",
+            round, njobs, (int)controller.num_job_records(), (int)(controller.num_job_records() - records),
+            allocation_counting() ? to_string(allocations).c_str() : "not counted"
+        );
+    }
+
+    // 作为对照，future接口每个job至少需要申请promise的共享状态并拷贝输出
+    vector<shared_future<vector<int>>> futures;
+    futures.reserve(njobs);
+    begin_count_allocations();
+    for(int i = 0; i < njobs; ++i)
+        futures.emplace_back(controller.commit(i));
+    for(auto& fut : futures)
+        fut.get();
+    size_t future_allocations = end_count_allocations();
+
+    size_t records = controller.num_job_records();
+    INFO("Job records = %d, limit = %d, steady rounds = %d / %d, steady allocations = %s, future allocations = %s, mismatch = %d",
+        (int)records, max_records, nsteady, nrounds,
+        allocation_counting() ? to_string(steady_allocations).c_str() : "not counted",
+        allocation_counting() ? to_string(future_allocations).c_str() : "not counted", (int)counter.nmismatch);
+    return records <= max_records && nsteady > 0 && steady_allocations == 0 && counter.nmismatch == 0;
+}
+
+static bool test_load_balancer(){
+
+    // 负载与耗时固定时，路由的结果是确定的
+    vector<int> loads{0, 0};
+    LoadBalancer fixed(loads.size(), [&](int device){
+        return loads[device];
+    });
+
+    // 连续选择多次，覆盖轮询位置的各种取值
+    auto always_select = [&](RoutePolicy policy, int expect){
+        fixed.set_policy(policy);
+        for(int i = 0; i < 8; ++i){
+            int device = fixed.select();
+            if(device != expect){
+                INFOE("%s selected device %d with loads %d, %d, expect %d",
+                    route_policy_string(policy), device, loads[0], loads[1], expect);
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // 0号设备单个job耗时1ms，1号为4ms
+    fixed.report(0, 1, 0);
+    fixed.report(1, 4, 0);
+
+    bool ok = true;
+    loads = {2, 1};
+    ok = always_select(RoutePolicy::LeastOutstanding, 1) && ok;
+    ok = always_select(RoutePolicy::PowerOfTwo,       1) && ok;
+
+    // 负载相同时PowerOfTwo选择更快的设备
+    loads = {1, 1};
+    ok = always_select(RoutePolicy::PowerOfTwo, 0) && ok;
+
+    // 预计完成时间：(2 + 1) * 1 < (0 + 1) * 4，快的设备排队更多也更早完成；(4 + 1) * 1 > 4
+    loads = {2, 0};
+    ok = always_select(RoutePolicy::EWMALatency, 0) && ok;
+    loads = {4, 0};
+    ok = always_select(RoutePolicy::EWMALatency, 1) && ok;
+    if(!ok) return false;
+
+    // 两个速度不同的模拟设备，慢的设备forward耗时是快的4倍
+    auto run = [](RoutePolicy policy, double& elapsed, int& num_fast){
+        vector<shared_ptr<FakeController>> devices{
+            make_shared<FakeController>(4, 4),
+            make_shared<FakeController>(4, 16)
+        };
+        for(auto& device : devices){
+            if(!device->startup()) return false;
+        }
+
+        LoadBalancer balancer(devices.size(), [&](int device){
+            return devices[device]->num_outstanding_jobs();
+        }, policy);
+
+        const int njobs = 200;
+        atomic<int> nfinished{0};
+        num_fast = 0;
+
+        auto tic = iLogger::timestamp_now_float();
+        for(int i = 0; i < njobs; ++i){
+            int device       = balancer.select();
+            int outstanding  = devices[device]->num_outstanding_jobs();
+            auto commit_time = iLogger::timestamp_now_float();
+            devices[device]->commit_async(i, [&, device, outstanding, commit_time](const int& output){
+                balancer.report(device, iLogger::timestamp_now_float() - commit_time, outstanding);
+                nfinished++;
+            });
+
+            if(device == 0) num_fast++;
+            iLogger::sleep(1);
+        }
+
+        while(nfinished < njobs)
+            iLogger::sleep(1);
+
+        elapsed = iLogger::timestamp_now_float() - tic;
+        return true;
+    };
+
+    // 实际耗时受机器负载影响，只打印用于对比
+    for(auto policy : {RoutePolicy::RoundRobin, RoutePolicy::LeastOutstanding, RoutePolicy::EWMALatency, RoutePolicy::PowerOfTwo}){
+        double elapsed = 0;
+        int num_fast   = 0;
+        if(!run(policy, elapsed, num_fast)) return false;
+        INFO("%s, elapsed = %.2f ms, fast device jobs = %d", route_policy_string(policy), elapsed, num_fast);
+    }
+    return true;
+}
+
+static bool test_load_split(){
+
+    vector<int> loads{0, 0, 0};
+    LoadBalancer balancer(loads.size(), [&](int device){
+        return loads[device];
+    }, RoutePolicy::RoundRobin);
+
+    // 能力未知时均分，余数不超过1
+    auto counts = balancer.split(100);
+    if(*max_element(counts.begin(), counts.end()) - *min_element(counts.begin(), counts.end()) > 1){
+        INFOE("RoundRobin split is not even, %d, %d, %d", counts[0], counts[1], counts[2]);
+        return false;
+    }
+
+    // 0号设备的单个job耗时为1ms，1号为3ms，2号还没有上报过(按平均值2ms估计)
+    balancer.set_policy(RoutePolicy::EWMALatency);
+    balancer.report(0, 1, 0);
+    balancer.report(1, 3, 0);
+    counts = balancer.split(110);
+    INFO("EWMALatency split = %d, %d, %d", counts[0], counts[1], counts[2]);
+    if(counts[0] + counts[1] + counts[2] != 110 || abs(counts[0] - 60) > 1 || abs(counts[1] - 20) > 1 || abs(counts[2] - 30) > 1){
+        INFOE("Expect split in proportion to throughput, 60, 20, 30");
+        return false;
+    }
+
+    // 已有积压的设备少分
+    balancer.set_policy(RoutePolicy::LeastOutstanding);
+    loads  = {30, 0, 0};
+    counts = balancer.split(30);
+    INFO("LeastOutstanding split = %d, %d, %d", counts[0], counts[1], counts[2]);
+    return counts[0] == 0 && counts[1] == 15 && counts[2] == 15;
+}
+
+static bool test_allocator(){
+
+    typedef MonopolyAllocator<TRT::Tensor> Allocator;
+    const int capacity = 8;
+
+    // 对象耗尽时，query应当阻塞并在超时后返回空指针
+    {
+        Allocator allocator(capacity);
+        vector<Allocator::MonopolyDataPointer> items;
+        for(int i = 0; i < capacity; ++i)
+            items.emplace_back(allocator.query());
+
+        if(allocator.query(1) != nullptr || allocator.num_waits() != 1 || allocator.num_timeouts() != 1){
+            INFOE("Expect query timeout when the pool is exhausted");
+            return false;
+        }
+
+        // 重复release只有第一次有效
+        items[0]->release();
+        items[0]->release();
+        if(allocator.num_available() != 1){
+            INFOE("Expect release to be idempotent");
+            return false;
+        }
+    }
+
+    // 多线程反复query/release，同一个对象不允许同时被两个线程持有
+    Allocator allocator(capacity);
+    vector<Allocator::MonopolyData*> slots;
+    {
+        vector<Allocator::MonopolyDataPointer> items;
+        for(int i = 0; i < capacity; ++i){
+            items.emplace_back(allocator.query());
+            slots.push_back(items.back().get());
+        }
+        for(auto& item : items)
+            item->release();
+    }
+
+    unique_ptr<atomic<int>[]> owners(new atomic<int>[capacity]);
+    for(int i = 0; i < capacity; ++i)
+        owners[i] = 0;
+
+    atomic<int> nconflict{0};
+    vector<thread> threads;
+    for(int t = 0; t < 16; ++t){
+        threads.emplace_back([&](){
+            for(int i = 0; i < 20000; ++i){
+                auto item = allocator.query();
+                if(item == nullptr){
+                    nconflict++;
+                    continue;
+                }
+
+                int index = find(slots.begin(), slots.end(), item.get()) - slots.begin();
+                if(owners[index].exchange(1) != 0) nconflict++;
+                owners[index] = 0;
+                item->release();
+            }
+        });
+    }
+
+    for(auto& t : threads)
+        t.join();
+
+    INFO("Allocator waits = %d, timeouts = %d, available = %d",
+        (int)allocator.num_waits(), (int)allocator.num_timeouts(), allocator.num_available());
+
+    if(nconflict != 0 || allocator.num_available() != capacity){
+        INFOE("Allocator conflict = %d, available = %d", (int)nconflict, allocator.num_available());
+        return false;
+    }
+    return true;
+}
+
+int test_infer_controller(){
+
+    struct{const char* name; bool (*func)();} cases[] = {
+        {"dynamic_batching",        test_dynamic_batching},
+        {"job_deadline",            test_job_deadline},
+        {"multi_worker",            test_multi_worker},
+        {"parallel_preprocess",     test_parallel_preprocess},
+        {"queue_limit",             test_queue_limit},
+        {"concurrent_block",        test_concurrent_block},
+        {"stop_during_preprocess",  test_stop_during_preprocess},
+        {"completion_queue",        test_completion_queue},
+        {"job_pool",                test_job_pool},
+        {"load_balancer",           test_load_balancer},
+        {"load_split",              test_load_split},
+        {"allocator",               test_allocator}
+    };
+
+    int nfailed = 0;
+    for(auto& item : cases){
+        bool ok = item.func();
+        if(!ok) nfailed++;
+        INFO("[%s] %s", ok ? "PASS" : "FAIL", item.name);
+    }
+    INFO("%d case(s) failed", nfailed);
+    return nfailed;
+}
+
+#ifdef INFER_CONTROLLER_TEST_MAIN
+int main(){
+    return test_infer_controller();
+}
+#endif
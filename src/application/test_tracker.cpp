@@ -0,0 +1,915 @@
+#include <common/ilogger.hpp>
+#include "tools/linear_assignment.hpp"
+#include "tools/kalman_filter.hpp"
+#include "tools/feature_bank.hpp"
+#include "tools/spatial_grid.hpp"
+#include "tools/deepsort.hpp"
+#include "tools/tracker_manager.hpp"
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <map>
+
+using namespace std;
+
+namespace{
+
+    // 模拟跟踪的代价矩阵：大部分配对距离很远，每个目标附近只有少数几个候选
+    vector<float> make_cost_matrix(int rows, int cols, unsigned int seed){
+
+        mt19937 rng(seed);
+        uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        vector<float> cost((size_t)rows * cols);
+        for(auto& item : cost)
+            item = uniform(rng) < 0.05f ? uniform(rng) * 100 : 100 + uniform(rng) * 900;
+        return cost;
+    }
+
+    bool valid_assignment(const vector<int>& row_assignment, int cols){
+        vector<int> used(cols, 0);
+        for(int col : row_assignment){
+            if(col < -1 || col >= cols) return false;
+            if(col >= 0 && used[col]++) return false;
+        }
+        return true;
+    }
+
+    int count_matched(const vector<int>& row_assignment){
+        return count_if(row_assignment.begin(), row_assignment.end(), [](int col){return col >= 0;});
+    }
+
+    bool near(double a, double b){
+        return fabs(a - b) <= 1e-4 * max(1.0, fabs(b));
+    }
+
+    // 与Munkres的总代价一致，有上限时与补充了虚拟行列的方阵上的Munkres一致
+    bool test_linear_assignment(){
+
+        struct Case{
+            int rows, cols;
+        };
+
+        Case cases[] = {
+            {1, 1}, {7, 7}, {50, 50}, {30, 80}, {80, 30}, {1, 40}, {40, 1}, {0, 5}
+        };
+
+        LinearAssignment::JonkerVolgenant solver;
+        bool ok = true;
+        for(auto& item : cases){
+            int rows = item.rows, cols = item.cols;
+            auto cost = make_cost_matrix(rows, cols, rows * 131 + cols);
+
+            vector<int> reference(rows), assignment(rows), col_assignment(cols);
+            double reference_cost = LinearAssignment::hungarian_reference(cost.data(), rows, cols, reference.data());
+            double total = solver.solve(cost.data(), rows, cols, assignment.data(), col_assignment.data());
+
+            bool consistent = true;
+            for(int i = 0; i < rows; ++i)
+                consistent = consistent && (assignment[i] < 0 || col_assignment[assignment[i]] == i);
+
+            bool same = near(total, reference_cost) && valid_assignment(assignment, cols) && consistent
+                && count_matched(assignment) == min(rows, cols);
+
+            // 不匹配的行与列各付出limit / 2，相当于在方阵上补充limit / 2的虚拟行列
+            const float limit = 150;
+            int n = rows + cols;
+            vector<float> extended((size_t)n * n, 0);
+            for(int i = 0; i < n; ++i){
+                for(int j = 0; j < n; ++j){
+                    float& value = extended[(size_t)i * n + j];
+                    if(i < rows && j < cols)        value = cost[(size_t)i * cols + j];
+                    else if(i < rows || j < cols)   value = limit / 2;
+                }
+            }
+
+            vector<int> extended_assignment(n), limited(rows);
+            double extended_cost = LinearAssignment::hungarian_reference(extended.data(), n, n, extended_assignment.data());
+            double limited_cost  = solver.solve(cost.data(), rows, cols, limited.data(), nullptr, limit);
+            int matched = count_matched(limited);
+            double limited_objective = limited_cost + limit / 2 * (rows - matched + cols - matched);
+
+            bool below_limit = true;
+            for(int i = 0; i < rows; ++i)
+                below_limit = below_limit && (limited[i] < 0 || cost[(size_t)i * cols + limited[i]] < limit);
+
+            bool same_limited = near(limited_objective, extended_cost) && valid_assignment(limited, cols) && below_limit;
+            INFO("[%s] assignment %d x %d, cost = %.3f / %.3f, cost limit %.0f, matched = %d, objective = %.3f / %.3f",
+                same && same_limited ? "PASS" : "FAIL", rows, cols, total, reference_cost, limit, matched, limited_objective, extended_cost
+            );
+            ok = ok && same && same_limited;
+        }
+        return ok;
+    }
+
+    bool test_linear_assignment_performance(){
+
+        LinearAssignment::JonkerVolgenant solver;
+        int sizes[] = {50, 200, 1000};
+        for(int size : sizes){
+            auto cost   = make_cost_matrix(size, size, size);
+            int repeat  = size >= 1000 ? 1 : 10;
+            vector<int> assignment(size);
+
+            auto t0 = iLogger::timestamp_now_float();
+            for(int i = 0; i < repeat; ++i)
+                LinearAssignment::hungarian_reference(cost.data(), size, size, assignment.data());
+
+            auto t1 = iLogger::timestamp_now_float();
+            for(int i = 0; i < repeat; ++i)
+                solver.solve(cost.data(), size, size, assignment.data());
+
+            auto t2 = iLogger::timestamp_now_float();
+            for(int i = 0; i < repeat; ++i)
+                solver.solve(cost.data(), size, size, assignment.data(), nullptr, 100);
+
+            auto t3 = iLogger::timestamp_now_float();
+            INFO("assignment %d x %d, munkres = %.3f ms, jonker-volgenant = %.3f ms, with cost limit = %.3f ms",
+                size, size, (t1 - t0) / repeat, (t2 - t1) / repeat, (t3 - t2) / repeat
+            );
+        }
+        return true;
+    }
+
+    DeepSORT::KalmanParameters make_kalman_parameters(){
+        DeepSORT::TrackerConfig config;
+        DeepSORT::KalmanParameters parameters;
+        memcpy(parameters.initiate_state, config.initiate_state, sizeof(parameters.initiate_state));
+        memcpy(parameters.per_frame_motion, config.per_frame_motion, sizeof(parameters.per_frame_motion));
+        memcpy(parameters.noise, config.noise, sizeof(parameters.noise));
+        return parameters;
+    }
+
+    // 测量为(cx, cy, a, h)，按分量连续存放，[4, num]
+    vector<float> make_measures(int num, unsigned int seed){
+        mt19937 rng(seed);
+        uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        vector<float> measures(num * 4);
+        for(int i = 0; i < num; ++i){
+            measures[0 * num + i] = (int)(uniform(rng) * 1920);
+            measures[1 * num + i] = (int)(uniform(rng) * 1080);
+            measures[2 * num + i] = 0.3f + uniform(rng) * 0.7f;
+            measures[3 * num + i] = (int)(20 + uniform(rng) * 200);
+        }
+        return measures;
+    }
+
+    bool near_relative(float a, float b, float tolerance){
+        return fabs(a - b) <= tolerance * max(1.0f, fabs(b));
+    }
+
+    // 批量的predict、gating、update与逐个目标的Eigen实现一致
+    bool test_kalman_batch(){
+
+        struct Track{
+            Eigen::Matrix<float, 8, 1> mean;
+            Eigen::Matrix<float, 8, 8> covariance;
+        };
+
+        const int num_tracks = 200, num_measures = 100;
+        auto parameters = make_kalman_parameters();
+        DeepSORT::KalmanFilter filter(parameters);
+        DeepSORT::KalmanBatch batch(parameters);
+        vector<Track> tracks;
+
+        auto initial = make_measures(num_tracks, 41);
+        for(int i = 0; i < num_tracks; ++i){
+            float measure[] = {initial[i], initial[num_tracks + i], initial[num_tracks * 2 + i], initial[num_tracks * 3 + i]};
+            Track track;
+            filter.initiate(measure, track.mean, track.covariance);
+            tracks.push_back(track);
+            batch.initiate(measure);
+        }
+
+        mt19937 rng(43);
+        bool ok = true;
+        for(int frame = 0; frame < 6; ++frame){
+            for(auto& track : tracks)
+                filter.predict(track.mean, track.covariance);
+            batch.predict();
+
+            // 测量在目标附近，gating的结果有大有小
+            int num = tracks.size();
+            vector<float> measures(num_measures * 4);
+            for(int j = 0; j < num_measures; ++j){
+                const Track& track = tracks[rng() % num];
+                for(int k = 0; k < 4; ++k)
+                    measures[k * num_measures + j] = track.mean(k, 0) + (int)(rng() % 21 - 10) * (k == 2 ? 0.01f : 1.0f);
+            }
+
+            vector<float> distances(num * num_measures);
+            batch.gating_distance(measures.data(), num_measures, distances.data());
+
+            bool same_gating = true;
+            for(int i = 0; i < num; ++i){
+                for(int j = 0; j < num_measures; ++j){
+                    float measure[] = {measures[j], measures[num_measures + j], measures[num_measures * 2 + j], measures[num_measures * 3 + j]};
+                    float reference = filter.ma_distance(tracks[i].mean, tracks[i].covariance, measure);
+                    same_gating = same_gating && near_relative(distances[i * num_measures + j], reference, 1e-3f);
+                }
+            }
+
+            // 一半的目标用测量更新
+            for(int i = 0; i < num; i += 2){
+                int j = rng() % num_measures;
+                float measure[] = {measures[j], measures[num_measures + j], measures[num_measures * 2 + j], measures[num_measures * 3 + j]};
+                filter.update(measure, tracks[i].mean, tracks[i].covariance);
+                batch.update(i, measure);
+            }
+
+            // 删除一部分目标
+            if(frame == 2){
+                vector<int> keep;
+                vector<Track> remain;
+                for(int i = 0; i < num; ++i){
+                    if(i % 3 != 0){
+                        keep.push_back(i);
+                        remain.push_back(tracks[i]);
+                    }
+                }
+                batch.keep(keep);
+                tracks = remain;
+            }
+
+            bool same_state = batch.size() == (int)tracks.size();
+            for(int i = 0; i < batch.size() && same_state; ++i){
+                for(int row = 0; row < 8; ++row){
+                    same_state = same_state && near_relative(batch.mean(i, row), tracks[i].mean(row, 0), 1e-4f);
+                    for(int col = 0; col < 8; ++col)
+                        same_state = same_state && near_relative(batch.covariance(i, row, col), tracks[i].covariance(row, col), 1e-3f);
+                }
+            }
+
+            INFO("[%s] kalman batch frame %d, tracks = %d, gating = %s, state = %s",
+                same_gating && same_state ? "PASS" : "FAIL", frame, batch.size(), same_gating ? "same" : "different", same_state ? "same" : "different"
+            );
+            ok = ok && same_gating && same_state;
+        }
+        return ok;
+    }
+
+    bool test_kalman_batch_performance(){
+
+        auto parameters = make_kalman_parameters();
+        int sizes[] = {100, 1000};
+        for(int size : sizes){
+            DeepSORT::KalmanFilter filter(parameters);
+            DeepSORT::KalmanBatch batch(parameters);
+            vector<Eigen::Matrix<float, 8, 1>> means(size);
+            vector<Eigen::Matrix<float, 8, 8>> covariances(size);
+
+            auto measures = make_measures(size, 47);
+            for(int i = 0; i < size; ++i){
+                float measure[] = {measures[i], measures[size + i], measures[size * 2 + i], measures[size * 3 + i]};
+                filter.initiate(measure, means[i], covariances[i]);
+                batch.initiate(measure);
+            }
+
+            vector<float> distances(size * size);
+            int repeat = size >= 1000 ? 1 : 10;
+            auto t0 = iLogger::timestamp_now_float();
+            for(int r = 0; r < repeat; ++r){
+                for(int i = 0; i < size; ++i)
+                    filter.predict(means[i], covariances[i]);
+
+                for(int i = 0; i < size; ++i){
+                    for(int j = 0; j < size; ++j){
+                        float measure[] = {measures[j], measures[size + j], measures[size * 2 + j], measures[size * 3 + j]};
+                        distances[i * size + j] = filter.ma_distance(means[i], covariances[i], measure);
+                    }
+                }
+            }
+
+            auto t1 = iLogger::timestamp_now_float();
+            for(int r = 0; r < repeat; ++r){
+                batch.predict();
+                batch.gating_distance(measures.data(), size, distances.data());
+            }
+
+            auto t2 = iLogger::timestamp_now_float();
+            INFO("kalman %d tracks x %d detections, per track = %.3f ms, batch = %.3f ms",
+                size, size, (t1 - t0) / repeat, (t2 - t1) / repeat
+            );
+        }
+        return true;
+    }
+
+    vector<float> make_features(int num, int dim, unsigned int seed){
+        mt19937 rng(seed);
+        normal_distribution<float> normal(0.0f, 1.0f);
+        vector<float> features((size_t)num * dim);
+        for(int i = 0; i < num; ++i){
+            float* pfeature = features.data() + (size_t)i * dim;
+            for(int k = 0; k < dim; ++k)
+                pfeature[k] = normal(rng);
+            DeepSORT::normalize_feature(pfeature, dim, pfeature);
+        }
+        return features;
+    }
+
+    // 构造num_tracks个目标，每个目标加入不同数量的特征，部分目标没有特征
+    void fill_bank(DeepSORT::FeatureBank& bank, int num_tracks, int dim, unsigned int seed){
+        mt19937 rng(seed);
+        auto features = make_features(num_tracks * 12, dim, seed + 1);
+        int cursor = 0;
+        for(int i = 0; i < num_tracks; ++i){
+            if(i % 17 == 5){
+                bank.add(nullptr, dim);
+                continue;
+            }
+
+            int index = bank.add(features.data() + (size_t)cursor++ * dim, dim);
+            int count = rng() % 12;
+            for(int j = 0; j < count; ++j)
+                bank.push(index, features.data() + (size_t)cursor++ * dim);
+        }
+    }
+
+    // 分块矩阵乘法与逐对求内积的结果逐位一致，环形覆盖只保留最近的nbuckets个特征
+    bool test_feature_bank(){
+
+        const int dim = 128, nbuckets = 5, num_tracks = 300, num_detections = 301;
+        DeepSORT::FeatureBank bank(nbuckets);
+        fill_bank(bank, num_tracks, dim, 53);
+
+        auto detections = make_features(num_detections, dim, 59);
+        vector<float> reference(num_tracks * num_detections), distances(num_tracks * num_detections);
+        DeepSORT::cosine_distance_reference(bank, detections.data(), num_detections, reference.data());
+        bank.cosine_distance(detections.data(), num_detections, distances.data());
+        bool same = memcmp(reference.data(), distances.data(), sizeof(float) * reference.size()) == 0;
+
+        // 删除一部分目标后不影响剩余目标的特征
+        vector<int> keep;
+        vector<float> expect;
+        for(int i = 0; i < num_tracks; ++i){
+            if(i % 4 != 1){
+                keep.push_back(i);
+                expect.insert(expect.end(), reference.begin() + i * num_detections, reference.begin() + (i + 1) * num_detections);
+            }
+        }
+        bank.keep(keep);
+        distances.resize(bank.size() * num_detections);
+        bank.cosine_distance(detections.data(), num_detections, distances.data());
+        bool same_keep = bank.size() == (int)keep.size() && memcmp(expect.data(), distances.data(), sizeof(float) * expect.size()) == 0;
+
+        // 写满后覆盖最早的特征
+        DeepSORT::FeatureBank ring(3);
+        auto features = make_features(5, dim, 61);
+        int index = ring.add(features.data(), dim);
+        for(int i = 1; i < 5; ++i)
+            ring.push(index, features.data() + i * dim);
+
+        vector<float> self(5);
+        ring.cosine_distance(features.data(), 5, self.data());
+        bool same_ring = ring.count(index) == 3 && self[0] > 0.5f && self[1] > 0.5f && self[2] < 1e-5f && self[3] < 1e-5f && self[4] < 1e-5f;
+
+        INFO("[%s] feature bank %d tracks x %d detections, gemm = %s, keep = %s, ring = %s",
+            same && same_keep && same_ring ? "PASS" : "FAIL", num_tracks, num_detections,
+            same ? "same" : "different", same_keep ? "same" : "different", same_ring ? "same" : "different"
+        );
+        return same && same_keep && same_ring;
+    }
+
+    bool test_feature_bank_performance(){
+
+        const int dim = 512, nbuckets = 10, num_tracks = 300, num_detections = 300;
+        DeepSORT::FeatureBank bank(nbuckets);
+        fill_bank(bank, num_tracks, dim, 67);
+
+        auto detections = make_features(num_detections, dim, 71);
+        vector<float> distances(num_tracks * num_detections);
+        const int repeat = 5;
+
+        auto t0 = iLogger::timestamp_now_float();
+        for(int i = 0; i < repeat; ++i)
+            DeepSORT::cosine_distance_reference(bank, detections.data(), num_detections, distances.data());
+
+        auto t1 = iLogger::timestamp_now_float();
+        for(int i = 0; i < repeat; ++i)
+            bank.cosine_distance(detections.data(), num_detections, distances.data());
+
+        auto t2 = iLogger::timestamp_now_float();
+        INFO("appearance cost %d tracks x %d buckets x %d detections, dim = %d, per pair = %.3f ms, blocked gemm = %.3f ms",
+            num_tracks, nbuckets, num_detections, dim, (t1 - t0) / repeat, (t2 - t1) / repeat
+        );
+        return true;
+    }
+
+    // 网格查询与逐个矩形判断的结果一致，包括退化的矩形与网格外的点
+    bool test_spatial_grid(){
+
+        mt19937 rng(73);
+        uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        const int num_rects = 2000, num_points = 5000;
+        vector<float> rects(num_rects * 4);
+        for(int i = 0; i < num_rects; ++i){
+            float* rect = rects.data() + i * 4;
+            float cx = uniform(rng) * 3840, cy = uniform(rng) * 2160;
+            float w  = i % 50 == 0 ? 0 : uniform(rng) * (i % 7 == 0 ? 1500 : 150);
+            float h  = i % 50 == 0 ? 0 : uniform(rng) * 150;
+            rect[0] = cx - w; rect[1] = cy - h; rect[2] = cx + w; rect[3] = cy + h;
+            if(i % 97 == 3) rect[0] = rect[2] + 1;
+        }
+
+        DeepSORT::SpatialGrid grid;
+        grid.build(rects.data(), num_rects);
+
+        bool same = true;
+        vector<int> found, expect;
+        for(int p = 0; p < num_points; ++p){
+            float x = uniform(rng) * 4400 - 280, y = uniform(rng) * 2600 - 220;
+            if(p % 100 == 0){
+                x = rects[(p % num_rects) * 4];
+                y = rects[(p % num_rects) * 4 + 1];
+            }
+
+            found.clear();
+            expect.clear();
+            grid.query(x, y, found);
+            for(int i = 0; i < num_rects; ++i){
+                const float* rect = rects.data() + i * 4;
+                if(rect[0] <= rect[2] && x >= rect[0] && x <= rect[2] && y >= rect[1] && y <= rect[3])
+                    expect.push_back(i);
+            }
+            same = same && found == expect;
+        }
+
+        DeepSORT::SpatialGrid empty;
+        empty.build(nullptr, 0);
+        found.clear();
+        empty.query(10, 10, found);
+        same = same && found.empty();
+
+        INFO("[%s] spatial grid %d rects, %d points", same ? "PASS" : "FAIL", num_rects, num_points);
+        return same;
+    }
+
+    // 门限矩形只是粗筛：网格找到的候选再判断马氏距离后，与所有配对逐一判断的结果一致
+    bool test_gating_candidates(){
+
+        const float gate = 9.4877f;
+        const int num_tracks = 1000, num_measures = 1200;
+        auto parameters = make_kalman_parameters();
+        DeepSORT::KalmanBatch batch(parameters);
+
+        auto initial = make_measures(num_tracks, 79);
+        for(int i = 0; i < num_tracks; ++i){
+            float measure[] = {initial[i], initial[num_tracks + i], initial[num_tracks * 2 + i], initial[num_tracks * 3 + i]};
+            batch.initiate(measure);
+        }
+
+        mt19937 rng(83);
+        for(int frame = 0; frame < 3; ++frame){
+            batch.predict();
+            for(int i = 0; i < num_tracks; i += 3){
+                float measure[4];
+                for(int k = 0; k < 4; ++k)
+                    measure[k] = batch.mean(i, k) + (int)(rng() % 9 - 4) * (k == 2 ? 0.01f : 1.0f);
+                batch.update(i, measure);
+            }
+        }
+        batch.predict();
+
+        // 测量在目标附近，门限内外都有
+        vector<float> measures(num_measures * 4);
+        for(int j = 0; j < num_measures; ++j){
+            int i = rng() % num_tracks;
+            for(int k = 0; k < 4; ++k)
+                measures[j * 4 + k] = batch.mean(i, k) + (int)(rng() % 61 - 30) * (k == 2 ? 0.002f : 1.0f);
+        }
+
+        batch.factor();
+        vector<float> rects(num_tracks * 4);
+        batch.gating_region(gate, rects.data());
+
+        DeepSORT::SpatialGrid grid;
+        grid.build(rects.data(), num_tracks);
+
+        long long num_candidates = 0, num_found = 0, num_expect = 0;
+        bool same = true;
+        vector<int> hits;
+        for(int j = 0; j < num_measures; ++j){
+            const float* measure = measures.data() + j * 4;
+            hits.clear();
+            grid.query(measure[0], measure[1], hits);
+            num_candidates += hits.size();
+
+            vector<int> found, expect;
+            for(int i : hits){
+                if(batch.gating_distance(i, measure) <= gate)
+                    found.push_back(i);
+            }
+            for(int i = 0; i < num_tracks; ++i){
+                if(batch.gating_distance(i, measure) <= gate)
+                    expect.push_back(i);
+            }
+            num_found  += found.size();
+            num_expect += expect.size();
+            same = same && found == expect;
+        }
+
+        INFO("[%s] gating %d tracks x %d measures, grid candidates = %lld, gated = %lld / %lld",
+            same ? "PASS" : "FAIL", num_tracks, num_measures, num_candidates, num_found, num_expect
+        );
+        return same;
+    }
+
+    // 稀疏的配对按连通分量求解，与在补充无穷大的稠密矩阵上求解的目标值一致
+    bool test_sparse_assignment(){
+
+        struct Case{
+            int rows, cols, degree;
+        };
+
+        Case cases[] = {
+            {1, 1, 1}, {40, 40, 3}, {300, 250, 4}, {250, 300, 2}, {500, 500, 1}, {60, 20, 6}, {0, 5, 1}
+        };
+
+        const float limit = 100;
+        LinearAssignment::JonkerVolgenant dense_solver;
+        LinearAssignment::SparseAssignment sparse_solver;
+        bool ok = true;
+        for(auto& item : cases){
+            int rows = item.rows, cols = item.cols;
+            mt19937 rng(rows * 7 + cols * 3 + item.degree);
+            uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+            // 每行只和附近的几列有配对，部分配对超过上限，有重复的配对
+            vector<LinearAssignment::Edge> edges;
+            vector<float> dense((size_t)rows * cols, numeric_limits<float>::infinity());
+            for(int i = 0; i < rows; ++i){
+                for(int d = 0; d < item.degree; ++d){
+                    int j = (int)((long long)i * cols / max(rows, 1) + rng() % 5) % cols;
+                    float cost = uniform(rng) * limit * 1.2f;
+                    edges.push_back({i, j, cost});
+                    float& value = dense[(size_t)i * cols + j];
+                    if(cost < limit)
+                        value = min(value, cost);
+                }
+            }
+
+            vector<int> expect(rows), assignment(rows), col_assignment(cols);
+            double expect_cost = dense_solver.solve(dense.data(), rows, cols, expect.data(), nullptr, limit);
+            double total       = sparse_solver.solve(edges.data(), edges.size(), rows, cols, assignment.data(), col_assignment.data(), limit);
+
+            int expect_matched = count_matched(expect), matched = count_matched(assignment);
+            double expect_objective = expect_cost + limit / 2 * (rows + cols - 2 * expect_matched);
+            double objective        = total + limit / 2 * (rows + cols - 2 * matched);
+
+            bool consistent = valid_assignment(assignment, cols);
+            for(int i = 0; i < rows; ++i)
+                consistent = consistent && (assignment[i] < 0 || (col_assignment[assignment[i]] == i && dense[(size_t)i * cols + assignment[i]] < limit));
+            for(int j = 0; j < cols; ++j)
+                consistent = consistent && (col_assignment[j] < 0 || assignment[col_assignment[j]] == j);
+
+            bool same = near(objective, expect_objective) && consistent;
+            INFO("[%s] sparse assignment %d x %d, edges = %d, matched = %d / %d, objective = %.3f / %.3f",
+                same ? "PASS" : "FAIL", rows, cols, (int)edges.size(), matched, expect_matched, objective, expect_objective
+            );
+            ok = ok && same;
+        }
+        return ok;
+    }
+
+    /* 4K画面中匀速运动的目标，检测带有小的抖动
+       目标分布在网格上，相互之间的距离远大于抖动，正确的匹配没有歧义
+    */
+    class LatticeScene{
+    public:
+        LatticeScene(int size, unsigned int seed):rng_(seed), uniform_(0.0f, 1.0f), objects_(size){
+
+            int grid_cols = (int)ceil(sqrt(size * 16.0f / 9.0f));
+            float spacing = 3840.0f / grid_cols;
+            for(int i = 0; i < size; ++i){
+                auto& obj = objects_[i];
+                obj.w  = spacing * (0.15f + uniform_(rng_) * 0.2f);
+                obj.h  = obj.w * (1.5f + uniform_(rng_));
+                obj.x  = (i % grid_cols) * spacing + uniform_(rng_) * spacing * 0.1f;
+                obj.y  = (i / grid_cols) * spacing + uniform_(rng_) * spacing * 0.1f;
+                obj.vx = 1.0f + uniform_(rng_) * 0.2f - 0.1f;
+                obj.vy = 0.5f + uniform_(rng_) * 0.2f - 0.1f;
+            }
+        }
+
+        // 下一帧的检测，第i个检测对应第i个目标
+        void next(DeepSORT::BBoxes& boxes){
+            boxes.resize(objects_.size());
+            for(int i = 0; i < objects_.size(); ++i){
+                auto& obj = objects_[i];
+                obj.x += obj.vx;
+                obj.y += obj.vy;
+                float jitter_x = uniform_(rng_) - 0.5f, jitter_y = uniform_(rng_) - 0.5f;
+                boxes[i] = DeepSORT::Box(obj.x + jitter_x, obj.y + jitter_y, obj.x + jitter_x + obj.w, obj.y + jitter_y + obj.h);
+            }
+        }
+
+    private:
+        struct Object{
+            float x, y, vx, vy, w, h;
+        };
+
+        mt19937 rng_;
+        uniform_real_distribution<float> uniform_;
+        vector<Object> objects_;
+    };
+
+    // 稳定跟踪后id不变，统计每帧的耗时
+    bool test_tracker_performance(){
+
+        int sizes[] = {100, 1000, 3000};
+        bool ok = true;
+        for(int size : sizes){
+            LatticeScene scene(size, size);
+            DeepSORT::TrackerConfig config;
+            auto tracker = DeepSORT::create_tracker(config);
+            const int warmup = 10, num_frames = 40;
+            vector<int> ids(size, -1);
+            int changed = 0;
+            double elapsed = 0;
+            DeepSORT::BBoxes boxes;
+            for(int frame = 0; frame < num_frames; ++frame){
+                scene.next(boxes);
+
+                auto t0 = iLogger::timestamp_now_float();
+                tracker->update(boxes);
+                auto t1 = iLogger::timestamp_now_float();
+                if(frame >= warmup)
+                    elapsed += t1 - t0;
+
+                // 匹配上的目标的位置就是检测框，由此找到对应的模拟目标
+                map<pair<float, float>, int> box_index;
+                for(int i = 0; i < size; ++i)
+                    box_index[make_pair(boxes[i].left, boxes[i].top)] = i;
+
+                for(auto track : tracker->get_objects()){
+                    if(track->time_since_update() != 0) continue;
+
+                    auto box = track->last_position();
+                    auto iter = box_index.find(make_pair(box.left, box.top));
+                    if(iter == box_index.end()) continue;
+
+                    int& id = ids[iter->second];
+                    if(frame >= warmup && id != track->id())
+                        changed++;
+                    id = track->id();
+                }
+            }
+
+            bool stable = changed == 0;
+            INFO("[%s] tracker %d objects, %d frames, per frame = %.3f ms, id switches = %d",
+                stable ? "PASS" : "FAIL", size, num_frames - warmup, elapsed / (num_frames - warmup), changed
+            );
+            ok = ok && stable;
+        }
+        return ok;
+    }
+
+    /* 带外观特征的跟踪，每个目标有固定的特征，检测的特征带有小的噪声，检测的顺序每帧打乱
+       网格分布时每个目标只有一个门限内的检测，逐对计算外观代价
+       聚集在一起时所有配对都在门限内，由一次矩阵乘法计算，此时只有外观能区分目标
+       feature_bucket为最近的特征，持有的拷贝在之后的update中不变
+    */
+    bool test_tracker_features(){
+
+        struct Case{
+            const char* name;
+            int size;
+            bool cluster;
+        };
+
+        Case cases[] = {
+            {"lattice", 200, false}, {"cluster", 20, true}
+        };
+
+        const int dim = 64, nbuckets = 5, warmup = 5, num_frames = 30;
+        bool ok = true;
+        for(auto& item : cases){
+            int size = item.size;
+            LatticeScene scene(size, 113 + size);
+            auto identities = make_features(size, dim, 127 + size);
+
+            DeepSORT::TrackerConfig config;
+            config.has_feature = true;
+            config.nbuckets    = nbuckets;
+            config.distance_threshold = 0.3f;
+            auto tracker = DeepSORT::create_tracker(config);
+
+            mt19937 rng(131 + size);
+            normal_distribution<float> normal(0.0f, 0.02f);
+            uniform_real_distribution<float> uniform(-5.0f, 5.0f);
+            vector<float> offsets(size * 2);
+            for(auto& offset : offsets)
+                offset = uniform(rng);
+
+            // 检测的特征在整个测试期间有效
+            vector<vector<float>> features(num_frames, vector<float>((size_t)size * dim));
+            vector<int> ids(size, -1), order(size);
+            int changed = 0, invalid_bucket = 0;
+            cv::Mat held;
+            vector<float> held_values;
+            DeepSORT::BBoxes scene_boxes, boxes(size);
+            for(int frame = 0; frame < num_frames; ++frame){
+                scene.next(scene_boxes);
+                for(int i = 0; i < size; ++i){
+                    order[i] = i;
+                    float* pfeature = features[frame].data() + (size_t)i * dim;
+                    for(int k = 0; k < dim; ++k)
+                        pfeature[k] = identities[(size_t)i * dim + k] + normal(rng);
+
+                    // 聚集时所有目标的框几乎重合
+                    auto& box = scene_boxes[i];
+                    if(item.cluster)
+                        box = DeepSORT::Box(500 + offsets[i * 2], 500 + offsets[i * 2 + 1], 600 + offsets[i * 2], 700 + offsets[i * 2 + 1]);
+                    box.feature = cv::Mat(1, dim, CV_32F, pfeature);
+                }
+                shuffle(order.begin(), order.end(), rng);
+                for(int i = 0; i < size; ++i)
+                    boxes[i] = scene_boxes[order[i]];
+
+                tracker->update(boxes);
+
+                map<pair<float, float>, int> box_index;
+                for(int i = 0; i < size; ++i)
+                    box_index[make_pair(scene_boxes[i].left, scene_boxes[i].top)] = i;
+
+                for(auto track : tracker->get_objects()){
+                    if(track->time_since_update() != 0) continue;
+
+                    auto box  = track->last_position();
+                    auto iter = box_index.find(make_pair(box.left, box.top));
+                    if(iter == box_index.end()) continue;
+
+                    int index = iter->second;
+                    int& id   = ids[index];
+                    if(frame >= warmup && id != track->id())
+                        changed++;
+                    id = track->id();
+
+                    // 最近的特征在bucket中，其余的行也属于这个目标
+                    vector<float> expect(dim);
+                    DeepSORT::normalize_feature(features[frame].data() + (size_t)index * dim, dim, expect.data());
+                    const cv::Mat& bucket = track->feature_bucket();
+                    bool found = false, valid = bucket.rows == min(frame + 1, nbuckets) && bucket.cols == dim;
+                    for(int r = 0; r < bucket.rows && valid; ++r){
+                        const float* row = bucket.ptr<float>(r);
+                        float dot = 0, diff = 0;
+                        for(int k = 0; k < dim; ++k){
+                            dot  += row[k] * identities[(size_t)index * dim + k];
+                            diff  = max(diff, fabs(row[k] - expect[k]));
+                        }
+                        found = found || diff < 1e-5f;
+                        valid = dot > 0.7f;
+                    }
+                    if(!(found && valid))
+                        invalid_bucket++;
+
+                    if(frame == warmup && index == 0){
+                        held = bucket;
+                        held_values.assign(bucket.ptr<float>(0), bucket.ptr<float>(0) + bucket.rows * dim);
+                    }
+                }
+            }
+
+            bool unchanged = !held.empty() && held.rows == nbuckets
+                && memcmp(held.ptr<float>(0), held_values.data(), held_values.size() * sizeof(float)) == 0;
+            bool pass = changed == 0 && invalid_bucket == 0 && unchanged;
+            INFO("[%s] tracker with feature, %s %d objects, %d frames, id switches = %d, invalid buckets = %d, held bucket = %s",
+                pass ? "PASS" : "FAIL", item.name, size, num_frames, changed, invalid_bucket, unchanged ? "unchanged" : "changed"
+            );
+            ok = ok && pass;
+        }
+        return ok;
+    }
+
+    // 分片到多个线程的结果与每个stream单独跟踪一致，同一批中重复的stream按顺序更新
+    bool test_tracker_manager(){
+
+        const int num_streams = 40, num_batches = 20;
+        DeepSORT::TrackerConfig config;
+        auto manager = DeepSORT::create_tracker_manager(config, 3);
+
+        vector<shared_ptr<LatticeScene>> scenes;
+        vector<shared_ptr<DeepSORT::Tracker>> trackers;
+        for(int i = 0; i < num_streams; ++i){
+            scenes.push_back(make_shared<LatticeScene>(20 + i, 89 + i));
+            trackers.push_back(DeepSORT::create_tracker(config));
+        }
+
+        int frames_stream0 = 0;
+        for(int b = 0; b < num_batches; ++b){
+            vector<DeepSORT::StreamBoxes> batch;
+            for(int i = 0; i < num_streams; ++i){
+                int stream_id = i * 1000 + 7;
+                int repeat    = i == 0 && b % 5 == 0 ? 2 : 1;
+                for(int r = 0; r < repeat; ++r){
+                    DeepSORT::BBoxes boxes;
+                    scenes[i]->next(boxes);
+                    trackers[i]->update(boxes);
+                    batch.emplace_back(stream_id, boxes);
+                }
+                if(i == 0) frames_stream0 += repeat;
+            }
+            manager->update(batch);
+        }
+
+        bool same = manager->num_streams() == num_streams && manager->num_workers() == 3;
+        for(int i = 0; i < num_streams; ++i){
+            auto expect = trackers[i]->get_objects();
+            auto found  = manager->get_objects(i * 1000 + 7);
+            same = same && expect.size() == found.size();
+            for(int k = 0; k < expect.size() && same; ++k){
+                auto a = expect[k]->last_position(), b = found[k]->last_position();
+                same = expect[k]->id() == found[k]->id() && expect[k]->state() == found[k]->state()
+                    && a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+            }
+        }
+
+        auto latency = manager->latency(7);
+        bool valid_latency = latency.frames == frames_stream0 && latency.max_ms >= latency.average_ms && latency.last_track_ms <= latency.last_ms;
+        bool removed = manager->remove_stream(7) && !manager->has_stream(7) && !manager->remove_stream(7)
+            && manager->num_streams() == num_streams - 1 && manager->get_objects(7).empty();
+
+        INFO("[%s] tracker manager %d streams x %d batches, tracks = %s, latency = %s, remove = %s",
+            same && valid_latency && removed ? "PASS" : "FAIL", num_streams, num_batches,
+            same ? "same" : "different", valid_latency ? "valid" : "invalid", removed ? "ok" : "failed"
+        );
+        return same && valid_latency && removed;
+    }
+
+    bool test_tracker_manager_performance(){
+
+        const int num_streams = 1000, num_objects = 30, num_batches = 10;
+        DeepSORT::TrackerConfig config;
+        vector<shared_ptr<LatticeScene>> scenes;
+        for(int i = 0; i < num_streams; ++i)
+            scenes.push_back(make_shared<LatticeScene>(num_objects, 97 + i));
+
+        vector<vector<DeepSORT::StreamBoxes>> batches(num_batches);
+        for(auto& batch : batches){
+            for(int i = 0; i < num_streams; ++i){
+                DeepSORT::BBoxes boxes;
+                scenes[i]->next(boxes);
+                batch.emplace_back(i, boxes);
+            }
+        }
+
+        vector<shared_ptr<DeepSORT::Tracker>> trackers;
+        for(int i = 0; i < num_streams; ++i)
+            trackers.push_back(DeepSORT::create_tracker(config));
+
+        auto manager = DeepSORT::create_tracker_manager(config);
+        auto t0 = iLogger::timestamp_now_float();
+        for(auto& batch : batches){
+            for(auto& item : batch)
+                trackers[item.stream_id]->update(item.boxes);
+        }
+
+        auto t1 = iLogger::timestamp_now_float();
+        for(auto& batch : batches)
+            manager->update(batch);
+
+        auto t2 = iLogger::timestamp_now_float();
+        float max_ms = 0, sum_ms = 0;
+        for(int i = 0; i < num_streams; ++i){
+            auto latency = manager->latency(i);
+            max_ms  = max(max_ms, latency.max_ms);
+            sum_ms += latency.average_ms;
+        }
+
+        INFO("tracker manager %d streams x %d objects, per batch: single thread = %.3f ms, %d workers = %.3f ms, stream latency average = %.3f ms, max = %.3f ms",
+            num_streams, num_objects, (t1 - t0) / num_batches, manager->num_workers(), (t2 - t1) / num_batches, sum_ms / num_streams, max_ms
+        );
+        return true;
+    }
+
+}; // namespace
+
+int test_tracker(){
+
+    struct{const char* name; bool (*func)();} cases[] = {
+        {"linear_assignment",             test_linear_assignment},
+        {"linear_assignment_performance", test_linear_assignment_performance},
+        {"kalman_batch",                  test_kalman_batch},
+        {"kalman_batch_performance",      test_kalman_batch_performance},
+        {"feature_bank",                  test_feature_bank},
+        {"feature_bank_performance",      test_feature_bank_performance},
+        {"spatial_grid",                  test_spatial_grid},
+        {"gating_candidates",             test_gating_candidates},
+        {"sparse_assignment",             test_sparse_assignment},
+        {"tracker_performance",           test_tracker_performance},
+        {"tracker_features",              test_tracker_features},
+        {"tracker_manager",               test_tracker_manager},
+        {"tracker_manager_performance",   test_tracker_manager_performance}
+    };
+
+    int nfailed = 0;
+    for(auto& item : cases){
+        bool ok = item.func();
+        if(!ok) nfailed++;
+        INFO("[%s] %s", ok ? "PASS" : "FAIL", item.name);
+    }
+    INFO("%d case(s) failed", nfailed);
+    return nfailed;
+}
@@ -1,8 +1,15 @@
 #include <common/preprocess_kernel.cuh>
+#include <common/preprocess_cpu.hpp>
+#include <common/remap_cache.hpp>
+#include <common/thread_pool.hpp>
 #include <common/trt_tensor.hpp>
+#include <common/ilogger.hpp>
 #include <opencv2/opencv.hpp>
 #include <cuda_runtime.h>
 #include <string>
+#include <vector>
+#include <random>
+#include <cstring>
 
 using namespace cv;
 
@@ -159,9 +166,353 @@ static int _warpaffine(){
     return 0;
 }
 
+// CPU的SIMD/多线程实现与逐像素的参考实现必须逐位一致，返回不一致的组合数
+static int _cpu_warpaffine(){
+
+    float mean[] = {0.485f, 0.456f, 0.406f};
+    float std[]  = {0.229f, 0.224f, 0.225f};
+    const char* norm_names[] = {"None", "AlphaBeta+Invert", "MeanStd+Invert"};
+    CUDAKernel::Norm norms[] = {
+        CUDAKernel::Norm::None(),
+        CUDAKernel::Norm::alpha_beta(1 / 255.0f, 0.0f, CUDAKernel::ChannelType::Invert),
+        CUDAKernel::Norm::mean_std(mean, std, 1 / 255.0f, CUDAKernel::ChannelType::Invert)
+    };
+
+    struct Case{
+        int src_width, src_height, dst_width, dst_height;
+        float angle;
+        uint8_t const_value;
+    };
+
+    // 下采样、上采样、宽度不是8的倍数、旋转后大量像素超出范围
+    Case cases[] = {
+        {1920, 1080, 640, 640,   0, 114},
+        {1200, 1200, 640, 640,   0, 114},
+        { 333,  517, 637, 479,   0,   0},
+        { 640,  480, 416, 416,  30, 114},
+        {  97,   61, 203, 101, -45,  77}
+    };
+
+    std::mt19937 rng(13);
+    ThreadPool pool(4);
+    int failed = 0;
+    INFO("CPU warpaffine simd = %s", CPUKernel::simd_name());
+
+    for(auto& item : cases){
+        std::vector<uint8_t> image(item.src_width * item.src_height * 3);
+        for(auto& value : image)
+            value = rng() & 0xFF;
+
+        // 与AffineMatrix相同的等比缩放居中，再绕dst中心旋转angle度，得到dst到src的矩阵
+        float scale = std::min(item.dst_width / (float)item.src_width, item.dst_height / (float)item.src_height);
+        float theta = item.angle / 180.0f * 3.1415926f;
+        float cos_t = std::cos(theta) / scale;
+        float sin_t = std::sin(theta) / scale;
+        float dcx   = item.dst_width * 0.5f,  dcy = item.dst_height * 0.5f;
+        float scx   = item.src_width * 0.5f,  scy = item.src_height * 0.5f;
+        float d2i[] = {
+            cos_t, -sin_t, scx - (cos_t * dcx - sin_t * dcy),
+            sin_t,  cos_t, scy - (sin_t * dcx + cos_t * dcy)
+        };
+
+        int dst_count = item.dst_width * item.dst_height * 3;
+        std::vector<float> reference(dst_count), fused(dst_count), threaded(dst_count);
+        for(int inorm = 0; inorm < 3; ++inorm){
+
+            auto& norm = norms[inorm];
+            auto t0 = iLogger::timestamp_now_float();
+            CPUKernel::warp_affine_bilinear_and_normalize_plane_reference(
+                image.data(), item.src_width * 3, item.src_width, item.src_height,
+                reference.data(), item.dst_width, item.dst_height, d2i, item.const_value, norm
+            );
+
+            auto t1 = iLogger::timestamp_now_float();
+            CPUKernel::warp_affine_bilinear_and_normalize_plane(
+                image.data(), item.src_width * 3, item.src_width, item.src_height,
+                fused.data(), item.dst_width, item.dst_height, d2i, item.const_value, norm
+            );
+
+            auto t2 = iLogger::timestamp_now_float();
+            CPUKernel::warp_affine_bilinear_and_normalize_plane(
+                image.data(), item.src_width * 3, item.src_width, item.src_height,
+                threaded.data(), item.dst_width, item.dst_height, d2i, item.const_value, norm, &pool
+            );
+
+            auto t3 = iLogger::timestamp_now_float();
+            int mismatch = 0;
+            for(int i = 0; i < dst_count; ++i){
+                if(memcmp(&reference[i], &fused[i], sizeof(float)) != 0 || memcmp(&reference[i], &threaded[i], sizeof(float)) != 0)
+                    mismatch++;
+            }
+
+            INFO("[%s] %dx%d -> %dx%d, angle = %.0f, norm = %s, reference = %.2f ms, fused = %.2f ms, fused x%d threads = %.2f ms, mismatch = %d",
+                mismatch == 0 ? "PASS" : "FAIL", item.src_width, item.src_height, item.dst_width, item.dst_height, item.angle, norm_names[inorm],
+                t1 - t0, t2 - t1, pool.size() + 1, t3 - t2, mismatch
+            );
+
+            if(mismatch != 0)
+                failed++;
+        }
+    }
+    INFO("%d case(s) failed", failed);
+    return failed;
+}
+
+/* CPU实现与cv::warpAffine(INTER_LINEAR, BORDER_CONSTANT)的对比，最多相差1
+   OpenCV把坐标量化到1/32像素，因此使用平滑的图像，梯度较大时量化误差会超过1
+   一部分邻域在图像外的边缘像素，常数与像素值之间的跳变同样会放大量化误差，不参与比较
+*/
+static int _cpu_warpaffine_opencv(){
+
+    struct Case{
+        int src_width, src_height, dst_width, dst_height;
+        float angle;
+        uint8_t const_value;
+    };
+
+    Case cases[] = {
+        {1920, 1080, 640, 640,   0, 114},
+        { 333,  517, 637, 479,   0,   0},
+        { 640,  480, 416, 416,  30, 114},
+        {  97,   61, 203, 101, -45,  77}
+    };
+
+    int failed = 0;
+    for(auto& item : cases){
+        cv::Mat image(item.src_height, item.src_width, CV_8UC3);
+        for(int y = 0; y < item.src_height; ++y){
+            uint8_t* pimage = image.ptr<uint8_t>(y);
+            for(int x = 0; x < item.src_width; ++x, pimage += 3){
+                pimage[0] = 128 + 100 * std::sin(x / 17.0f) * std::cos(y / 13.0f);
+                pimage[1] = 128 + 100 * std::sin((x + y) / 23.0f);
+                pimage[2] = 128 + 90 * std::cos((x - 2 * y) / 29.0f);
+            }
+        }
+
+        // 与_cpu_warpaffine相同的dst到src的矩阵，OpenCV使用WARP_INVERSE_MAP直接接受这个矩阵
+        float scale = std::min(item.dst_width / (float)item.src_width, item.dst_height / (float)item.src_height);
+        float theta = item.angle / 180.0f * 3.1415926f;
+        float cos_t = std::cos(theta) / scale;
+        float sin_t = std::sin(theta) / scale;
+        float dcx   = item.dst_width * 0.5f,  dcy = item.dst_height * 0.5f;
+        float scx   = item.src_width * 0.5f,  scy = item.src_height * 0.5f;
+        float d2i[] = {
+            cos_t, -sin_t, scx - (cos_t * dcx - sin_t * dcy),
+            sin_t,  cos_t, scy - (sin_t * dcx + cos_t * dcy)
+        };
+
+        cv::Mat opencv_warpaffine;
+        cv::Mat d2i_matrix(2, 3, CV_32F, d2i);
+        cv::warpAffine(
+            image, opencv_warpaffine, d2i_matrix, cv::Size(item.dst_width, item.dst_height),
+            cv::INTER_LINEAR | cv::WARP_INVERSE_MAP, cv::BORDER_CONSTANT, cv::Scalar::all(item.const_value)
+        );
+
+        int area = item.dst_width * item.dst_height;
+        std::vector<float> planes(area * 3);
+        CPUKernel::warp_affine_bilinear_and_normalize_plane(
+            image.data, item.src_width * 3, item.src_width, item.src_height,
+            planes.data(), item.dst_width, item.dst_height, d2i, item.const_value, CUDAKernel::Norm::None()
+        );
+
+        int compared = 0, exceeded = 0;
+        float max_diff = 0;
+        for(int y = 0; y < item.dst_height; ++y){
+            const uint8_t* popencv = opencv_warpaffine.ptr<uint8_t>(y);
+            for(int x = 0; x < item.dst_width; ++x, popencv += 3){
+                float src_x = d2i[0] * x + d2i[1] * y + d2i[2];
+                float src_y = d2i[3] * x + d2i[4] * y + d2i[5];
+                bool inside  = src_x >= 0 && src_x < item.src_width - 1 && src_y >= 0 && src_y < item.src_height - 1;
+                bool outside = src_x <= -1 || src_x >= item.src_width || src_y <= -1 || src_y >= item.src_height;
+                if(!inside && !outside) continue;
+
+                int position = y * item.dst_width + x;
+                for(int c = 0; c < 3; ++c){
+                    float diff = std::abs(planes[position + area * c] - popencv[c]);
+                    max_diff   = std::max(max_diff, diff);
+                    exceeded  += diff > 1;
+                }
+                compared++;
+            }
+        }
+
+        bool pass = exceeded == 0;
+        INFO("[%s] opencv %dx%d -> %dx%d, angle = %.0f, compared pixels = %d / %d, max diff = %.0f",
+            pass ? "PASS" : "FAIL", item.src_width, item.src_height, item.dst_width, item.dst_height, item.angle,
+            compared, area, max_diff
+        );
+        if(!pass) failed++;
+    }
+    INFO("%d case(s) failed", failed);
+    return failed;
+}
+
+// NV12的CPU实现：SIMD转BGR与参考实现一致，单遍的NV12仿射变换与先转BGR再仿射变换逐位一致
+static int _cpu_nv12(){
+
+    struct Case{
+        int width, height, linesize, dst_width, dst_height;
+    };
+
+    // 行宽带有对齐填充、宽度不是8/16的倍数
+    Case cases[] = {
+        {1920, 1080, 1920, 640, 640},
+        {1280,  720, 1344, 416, 416},
+        { 638,  358,  640, 321, 203}
+    };
+
+    std::mt19937 rng(29);
+    ThreadPool pool(4);
+    int failed = 0;
+    auto norm = CUDAKernel::Norm::alpha_beta(1 / 255.0f, 0.0f, CUDAKernel::ChannelType::Invert);
+
+    for(auto& item : cases){
+        std::vector<uint8_t> nv12(item.linesize * item.height * 3 / 2);
+        for(auto& value : nv12)
+            value = rng() & 0xFF;
+
+        const uint8_t* y  = nv12.data();
+        const uint8_t* uv = y + item.linesize * item.height;
+        std::vector<uint8_t> bgr_reference(item.width * item.height * 3), bgr(item.width * item.height * 3);
+
+        auto t0 = iLogger::timestamp_now_float();
+        CPUKernel::convert_nv12_to_bgr_reference(y, uv, item.width, item.height, item.linesize, bgr_reference.data());
+
+        auto t1 = iLogger::timestamp_now_float();
+        CPUKernel::convert_nv12_to_bgr(y, uv, item.width, item.height, item.linesize, bgr.data(), &pool);
+
+        auto t2 = iLogger::timestamp_now_float();
+        int bgr_mismatch = 0;
+        for(int i = 0; i < bgr.size(); ++i)
+            bgr_mismatch += bgr[i] != bgr_reference[i];
+
+        INFO("[%s] nv12 to bgr %dx%d, reference = %.2f ms, fused x%d threads = %.2f ms, mismatch = %d",
+            bgr_mismatch == 0 ? "PASS" : "FAIL", item.width, item.height, t1 - t0, pool.size() + 1, t2 - t1, bgr_mismatch
+        );
+        if(bgr_mismatch != 0) failed++;
+
+        float scale = std::min(item.dst_width / (float)item.width, item.dst_height / (float)item.height);
+        float d2i[] = {
+            1 / scale, 0, (-item.dst_width  * 0.5f - 0.5f * scale + 0.5f) / scale + item.width  * 0.5f,
+            0, 1 / scale, (-item.dst_height * 0.5f - 0.5f * scale + 0.5f) / scale + item.height * 0.5f
+        };
+
+        int dst_count = item.dst_width * item.dst_height * 3;
+        std::vector<float> reference(dst_count), two_pass(dst_count), fused(dst_count);
+        CPUKernel::warp_affine_bilinear_and_normalize_plane_reference(
+            bgr_reference.data(), item.width * 3, item.width, item.height,
+            reference.data(), item.dst_width, item.dst_height, d2i, 114, norm
+        );
+
+        auto t3 = iLogger::timestamp_now_float();
+        CPUKernel::convert_nv12_to_bgr(y, uv, item.width, item.height, item.linesize, bgr.data(), &pool);
+        CPUKernel::warp_affine_bilinear_and_normalize_plane(
+            bgr.data(), item.width * 3, item.width, item.height,
+            two_pass.data(), item.dst_width, item.dst_height, d2i, 114, norm, &pool
+        );
+
+        auto t4 = iLogger::timestamp_now_float();
+        CPUKernel::warp_affine_bilinear_and_normalize_plane_nv12(
+            y, uv, item.width, item.height, item.linesize,
+            fused.data(), item.dst_width, item.dst_height, d2i, 114, norm, &pool
+        );
+
+        auto t5 = iLogger::timestamp_now_float();
+        int mismatch = 0;
+        for(int i = 0; i < dst_count; ++i){
+            if(memcmp(&reference[i], &fused[i], sizeof(float)) != 0 || memcmp(&reference[i], &two_pass[i], sizeof(float)) != 0)
+                mismatch++;
+        }
+
+        INFO("[%s] nv12 %dx%d -> %dx%d, two pass = %.2f ms, fused = %.2f ms, mismatch = %d",
+            mismatch == 0 ? "PASS" : "FAIL", item.width, item.height, item.dst_width, item.dst_height, t4 - t3, t5 - t4, mismatch
+        );
+        if(mismatch != 0) failed++;
+    }
+    INFO("%d case(s) failed", failed);
+    return failed;
+}
+
+// 重映射表缓存：定点插值与浮点实现最多相差1，同一尺寸重复查询只建一次表
+static int _cpu_remap_cache(){
+
+    struct Case{
+        int src_width, src_height, line_size, dst_width, dst_height;
+    };
+
+    // 横图、竖图、上采样、行宽带有对齐填充
+    Case cases[] = {
+        {1920, 1080, 1920 * 3, 640, 640},
+        { 720, 1280,  720 * 3, 416, 416},
+        { 333,  517, 1024,     637, 479}
+    };
+
+    const int repeat = 20;
+    std::mt19937 rng(31);
+    ThreadPool pool(4);
+    CPUKernel::RemapCache cache(2);
+    int failed = 0;
+    auto norm = CUDAKernel::Norm::None();
+
+    for(auto& item : cases){
+        std::vector<uint8_t> image(item.line_size * item.src_height);
+        for(auto& value : image)
+            value = rng() & 0xFF;
+
+        int dst_count = item.dst_width * item.dst_height * 3;
+        std::vector<float> reference(dst_count), cached(dst_count);
+        auto table = cache.query(item.src_width, item.src_height, item.line_size, item.dst_width, item.dst_height, 114, norm);
+
+        auto t0 = iLogger::timestamp_now_float();
+        for(int i = 0; i < repeat; ++i){
+            CPUKernel::warp_affine_bilinear_and_normalize_plane(
+                image.data(), item.line_size, item.src_width, item.src_height,
+                reference.data(), item.dst_width, item.dst_height, table->d2i(), 114, norm, &pool
+            );
+        }
+
+        auto t1 = iLogger::timestamp_now_float();
+        for(int i = 0; i < repeat; ++i){
+            cache.query(item.src_width, item.src_height, item.line_size, item.dst_width, item.dst_height, 114, norm)
+                ->remap(image.data(), cached.data(), &pool);
+        }
+
+        auto t2 = iLogger::timestamp_now_float();
+        float max_diff = 0;
+        for(int i = 0; i < dst_count; ++i)
+            max_diff = std::max(max_diff, std::abs(reference[i] - cached[i]));
+
+        bool pass = max_diff <= 1;
+        INFO("[%s] remap %dx%d -> %dx%d, float x%d threads = %.3f ms, cached = %.3f ms, max diff = %.3f",
+            pass ? "PASS" : "FAIL", item.src_width, item.src_height, item.dst_width, item.dst_height,
+            pool.size() + 1, (t1 - t0) / repeat, (t2 - t1) / repeat, max_diff
+        );
+        if(!pass) failed++;
+    }
+
+    // 容量为2，3个尺寸各查询1 + repeat次，每个尺寸只在第一次未命中
+    int num_cases = sizeof(cases) / sizeof(cases[0]);
+    bool pass = cache.num_misses() == num_cases && cache.num_hits() == num_cases * repeat && cache.size() == 2;
+    INFO("[%s] %s", pass ? "PASS" : "FAIL", cache.description().c_str());
+    if(!pass) failed++;
+
+    // 淘汰最久未使用的表后再次查询，重新建表
+    cache.query(cases[0].src_width, cases[0].src_height, cases[0].line_size, cases[0].dst_width, cases[0].dst_height, 114, norm);
+    pass = cache.num_misses() == num_cases + 1;
+    INFO("[%s] query after evicted, %s", pass ? "PASS" : "FAIL", cache.description().c_str());
+    if(!pass) failed++;
+
+    INFO("%d case(s) failed", failed);
+    return failed;
+}
+
 int test_warpaffine(){
 
+    int failed = _cpu_warpaffine();
+    failed += _cpu_warpaffine_opencv();
+    failed += _cpu_nv12();
+    failed += _cpu_remap_cache();
     _resize();
     _warpaffine();
-    return 0;
+    return failed;
 }
\ No newline at end of file
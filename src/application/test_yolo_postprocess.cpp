@@ -0,0 +1,800 @@
+#include <common/ilogger.hpp>
+#include <common/thread_pool.hpp>
+#include <common/object_detector.hpp>
+#include <common/face_detector.hpp>
+#include <common/nms.hpp>
+#include <common/topk_cpu.hpp>
+#include <common/box_decoder.hpp>
+#include <common/segmentation.hpp>
+#include "app_yolo/yolo_decode_cpu.hpp"
+#include <vector>
+#include <random>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace{
+
+    const int NUM_BOX_ELEMENT = 7;
+
+    /* 模拟YoloV5的[N, 5 + C]输出，大部分行的objectness很小
+       类别置信度量化到1/16，使argmax中出现大量相等的值
+    */
+    vector<float> make_predict(int num_bboxes, int num_classes, unsigned int seed){
+
+        mt19937 rng(seed);
+        uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        vector<float> predict((size_t)num_bboxes * (5 + num_classes));
+        for(int i = 0; i < num_bboxes; ++i){
+            float* pitem = predict.data() + (size_t)i * (5 + num_classes);
+            pitem[0] = uniform(rng) * 640;
+            pitem[1] = uniform(rng) * 640;
+            pitem[2] = uniform(rng) * 200;
+            pitem[3] = uniform(rng) * 200;
+            pitem[4] = pow(uniform(rng), 64.0f);
+            for(int ic = 0; ic < num_classes; ++ic)
+                pitem[5 + ic] = (int)(uniform(rng) * 16) / 16.0f;
+        }
+        return predict;
+    }
+
+    // 不做objectness提前判断的朴素实现，每行都做完整的argmax，作为性能对照
+    int naive_decode(const float* predict, int num_bboxes, int num_classes, float confidence_threshold, const float* m, float* parray, int max_objects){
+
+        int count = 0;
+        for(int position = 0; position < num_bboxes; ++position){
+            const float* pitem = predict + (size_t)(5 + num_classes) * position;
+            int label = 0;
+            for(int i = 1; i < num_classes; ++i){
+                if(pitem[5 + i] > pitem[5 + label])
+                    label = i;
+            }
+
+            float confidence = pitem[5 + label] * pitem[4];
+            if(pitem[4] < confidence_threshold || confidence < confidence_threshold || count >= max_objects)
+                continue;
+
+            float left   = pitem[0] - pitem[2] * 0.5f;
+            float top    = pitem[1] - pitem[3] * 0.5f;
+            float right  = pitem[0] + pitem[2] * 0.5f;
+            float bottom = pitem[1] + pitem[3] * 0.5f;
+            float* pout  = parray + 1 + count * NUM_BOX_ELEMENT;
+            pout[0] = m[0] * left  + m[1] * top    + m[2];
+            pout[1] = m[3] * left  + m[4] * top    + m[5];
+            pout[2] = m[0] * right + m[1] * bottom + m[2];
+            pout[3] = m[3] * right + m[4] * bottom + m[5];
+            pout[4] = confidence;
+            pout[5] = label;
+            pout[6] = 1;
+            count++;
+        }
+        parray[0] = count;
+        return count;
+    }
+
+    // 单线程与多线程的解码结果都必须与参考实现逐位一致，包括max_objects截断时保留的box
+    bool test_cpu_decode(){
+
+        struct Case{
+            int num_bboxes, num_classes, max_objects;
+            float confidence_threshold;
+        };
+
+        // 80类、类别数不是8的倍数、单类别、截断
+        Case cases[] = {
+            {25200, 80, 1024, 0.25f},
+            { 8400, 21, 1024, 0.10f},
+            { 6300,  1, 1024, 0.25f},
+            {25200, 80,   32, 0.05f}
+        };
+
+        float d2i[] = {2.0f, 0, -80.0f, 0, 2.0f, -60.0f};
+        ThreadPool pool(4);
+        bool ok = true;
+        for(auto& item : cases){
+            auto predict = make_predict(item.num_bboxes, item.num_classes, item.num_bboxes + item.num_classes);
+            int array_size = 1 + item.max_objects * NUM_BOX_ELEMENT;
+            vector<float> reference(array_size), single(array_size), threaded(array_size);
+
+            int nref = Yolo::cpu_decode_reference(predict.data(), item.num_bboxes, item.num_classes, item.confidence_threshold, d2i, reference.data(), item.max_objects);
+            int n1   = Yolo::cpu_decode(predict.data(), item.num_bboxes, item.num_classes, item.confidence_threshold, d2i, single.data(), item.max_objects);
+            int n2   = Yolo::cpu_decode(predict.data(), item.num_bboxes, item.num_classes, item.confidence_threshold, d2i, threaded.data(), item.max_objects, &pool);
+
+            size_t bytes = (1 + nref * NUM_BOX_ELEMENT) * sizeof(float);
+            bool same    = nref > 0 && n1 == nref && n2 == nref && memcmp(reference.data(), single.data(), bytes) == 0 && memcmp(reference.data(), threaded.data(), bytes) == 0;
+            INFO("[%s] decode %d x %d, max_objects = %d, boxes = %d / %d / %d",
+                same ? "PASS" : "FAIL", item.num_bboxes, item.num_classes, item.max_objects, nref, n1, n2
+            );
+            ok = ok && same;
+        }
+        return ok;
+    }
+
+    bool test_cpu_decode_performance(){
+
+        const int num_bboxes  = 25200;
+        const int num_classes = 80;
+        const int max_objects = 1024;
+        const int repeat      = 50;
+        float d2i[] = {2.0f, 0, -80.0f, 0, 2.0f, -60.0f};
+        auto predict = make_predict(num_bboxes, num_classes, 7);
+        vector<float> parray(1 + max_objects * NUM_BOX_ELEMENT);
+        ThreadPool pool(4);
+
+        auto t0 = iLogger::timestamp_now_float();
+        for(int i = 0; i < repeat; ++i)
+            naive_decode(predict.data(), num_bboxes, num_classes, 0.25f, d2i, parray.data(), max_objects);
+
+        auto t1 = iLogger::timestamp_now_float();
+        for(int i = 0; i < repeat; ++i)
+            Yolo::cpu_decode_reference(predict.data(), num_bboxes, num_classes, 0.25f, d2i, parray.data(), max_objects);
+
+        auto t2 = iLogger::timestamp_now_float();
+        for(int i = 0; i < repeat; ++i)
+            Yolo::cpu_decode(predict.data(), num_bboxes, num_classes, 0.25f, d2i, parray.data(), max_objects);
+
+        auto t3 = iLogger::timestamp_now_float();
+        for(int i = 0; i < repeat; ++i)
+            Yolo::cpu_decode(predict.data(), num_bboxes, num_classes, 0.25f, d2i, parray.data(), max_objects, &pool);
+
+        auto t4 = iLogger::timestamp_now_float();
+        INFO("decode %d x %d, naive = %.3f ms, reference = %.3f ms, simd = %.3f ms, simd x%d threads = %.3f ms",
+            num_bboxes, num_classes, (t1 - t0) / repeat, (t2 - t1) / repeat, (t3 - t2) / repeat, pool.size() + 1, (t4 - t3) / repeat
+        );
+        return true;
+    }
+
+    /* 模拟YoloV8的[4 + C, N]输出，大部分位置的类别分数都很小
+       分数量化到1/64，使argmax中出现相等的值
+    */
+    vector<float> make_channel_major_predict(int num_bboxes, int num_classes, unsigned int seed){
+
+        mt19937 rng(seed);
+        uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        vector<float> predict((size_t)(4 + num_classes) * num_bboxes);
+        for(int i = 0; i < num_bboxes; ++i){
+            predict[i]                         = uniform(rng) * 640;
+            predict[(size_t)num_bboxes + i]    = uniform(rng) * 640;
+            predict[(size_t)num_bboxes * 2 + i] = uniform(rng) * 200;
+            predict[(size_t)num_bboxes * 3 + i] = uniform(rng) * 200;
+        }
+
+        for(int ic = 0; ic < num_classes; ++ic){
+            float* pclass = predict.data() + (size_t)(4 + ic) * num_bboxes;
+            for(int i = 0; i < num_bboxes; ++i)
+                pclass[i] = (int)(pow(uniform(rng), 2048.0f) * 64) / 64.0f;
+        }
+        return predict;
+    }
+
+    // channel-major的解码结果与逐列的参考实现逐位一致，包括截断
+    bool test_cpu_decode_channel_major(){
+
+        struct Case{
+            int num_bboxes, num_classes, max_objects;
+            float confidence_threshold;
+        };
+
+        Case cases[] = {
+            {8400, 80, 8400, 0.25f},
+            {8400, 21, 1024, 0.10f},
+            {8400,  1, 1024, 0.02f},
+            {8403, 80,   32, 0.05f}
+        };
+
+        float d2i[] = {2.0f, 0, -80.0f, 0, 2.0f, -60.0f};
+        ThreadPool pool(4);
+        bool ok = true;
+        for(auto& item : cases){
+            auto predict   = make_channel_major_predict(item.num_bboxes, item.num_classes, item.num_bboxes + item.num_classes);
+            int array_size = 1 + item.max_objects * NUM_BOX_ELEMENT;
+            vector<float> reference(array_size), single(array_size), threaded(array_size);
+
+            int nref = Yolo::cpu_decode_channel_major_reference(predict.data(), item.num_bboxes, item.num_classes, item.confidence_threshold, d2i, reference.data(), item.max_objects);
+            int n1   = Yolo::cpu_decode_channel_major(predict.data(), item.num_bboxes, item.num_classes, item.confidence_threshold, d2i, single.data(), item.max_objects);
+            int n2   = Yolo::cpu_decode_channel_major(predict.data(), item.num_bboxes, item.num_classes, item.confidence_threshold, d2i, threaded.data(), item.max_objects, &pool);
+
+            size_t bytes = (1 + nref * NUM_BOX_ELEMENT) * sizeof(float);
+            bool same    = nref > 0 && n1 == nref && n2 == nref && memcmp(reference.data(), single.data(), bytes) == 0 && memcmp(reference.data(), threaded.data(), bytes) == 0;
+            INFO("[%s] decode channel major %d x %d, max_objects = %d, boxes = %d / %d / %d",
+                same ? "PASS" : "FAIL", item.num_classes + 4, item.num_bboxes, item.max_objects, nref, n1, n2
+            );
+            ok = ok && same;
+        }
+        return ok;
+    }
+
+    bool test_cpu_decode_channel_major_performance(){
+
+        const int num_bboxes  = 8400;
+        const int num_classes = 80;
+        const int repeat      = 50;
+        float d2i[] = {2.0f, 0, -80.0f, 0, 2.0f, -60.0f};
+        auto predict = make_channel_major_predict(num_bboxes, num_classes, 7);
+        vector<float> parray(1 + num_bboxes * NUM_BOX_ELEMENT);
+        ThreadPool pool(4);
+
+        auto t0 = iLogger::timestamp_now_float();
+        for(int i = 0; i < repeat; ++i)
+            Yolo::cpu_decode_channel_major_reference(predict.data(), num_bboxes, num_classes, 0.25f, d2i, parray.data(), num_bboxes);
+
+        auto t1 = iLogger::timestamp_now_float();
+        for(int i = 0; i < repeat; ++i)
+            Yolo::cpu_decode_channel_major(predict.data(), num_bboxes, num_classes, 0.25f, d2i, parray.data(), num_bboxes);
+
+        auto t2 = iLogger::timestamp_now_float();
+        for(int i = 0; i < repeat; ++i)
+            Yolo::cpu_decode_channel_major(predict.data(), num_bboxes, num_classes, 0.25f, d2i, parray.data(), num_bboxes, &pool);
+
+        auto t3 = iLogger::timestamp_now_float();
+        INFO("decode channel major %d x %d, per column = %.3f ms, blocked = %.3f ms, blocked x%d threads = %.3f ms",
+            num_classes + 4, num_bboxes, (t1 - t0) / repeat, (t2 - t1) / repeat, pool.size() + 1, (t3 - t2) / repeat
+        );
+        return true;
+    }
+
+    // 模拟检测结果：box聚集在若干个目标周围，分数各不相同
+    ObjectDetector::BoxArray make_boxes(int num_boxes, int num_classes, int num_objects, unsigned int seed){
+
+        mt19937 rng(seed);
+        uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        vector<float> centers(num_objects * 4);
+        for(int i = 0; i < num_objects; ++i){
+            centers[i * 4 + 0] = uniform(rng) * 1920;
+            centers[i * 4 + 1] = uniform(rng) * 1080;
+            centers[i * 4 + 2] = 10 + uniform(rng) * 150;
+            centers[i * 4 + 3] = 10 + uniform(rng) * 150;
+        }
+
+        ObjectDetector::BoxArray boxes;
+        for(int i = 0; i < num_boxes; ++i){
+            const float* c = centers.data() + (rng() % num_objects) * 4;
+            float cx = c[0] + (uniform(rng) - 0.5f) * c[2] * 0.4f;
+            float cy = c[1] + (uniform(rng) - 0.5f) * c[3] * 0.4f;
+            float w  = c[2] * (0.8f + uniform(rng) * 0.4f);
+            float h  = c[3] * (0.8f + uniform(rng) * 0.4f);
+            boxes.emplace_back(cx - w * 0.5f, cy - h * 0.5f, cx + w * 0.5f, cy + h * 0.5f, uniform(rng), rng() % num_classes);
+        }
+        return boxes;
+    }
+
+    float legacy_iou(const ObjectDetector::Box& a, const ObjectDetector::Box& b){
+        float cleft   = max(a.left, b.left);
+        float ctop    = max(a.top, b.top);
+        float cright  = min(a.right, b.right);
+        float cbottom = min(a.bottom, b.bottom);
+
+        float c_area = max(cright - cleft, 0.0f) * max(cbottom - ctop, 0.0f);
+        if(c_area == 0.0f)
+            return 0.0f;
+
+        float a_area = max(0.0f, a.right - a.left) * max(0.0f, a.bottom - a.top);
+        float b_area = max(0.0f, b.right - b.left) * max(0.0f, b.bottom - b.top);
+        return c_area / (a_area + b_area - c_area);
+    }
+
+    // 原来Yolo::cpu_nms的实现，作为对照，class_agnostic为true时不比较类别
+    ObjectDetector::BoxArray legacy_nms(ObjectDetector::BoxArray boxes, float threshold, bool class_agnostic){
+
+        sort(boxes.begin(), boxes.end(), [](const ObjectDetector::Box& a, const ObjectDetector::Box& b){
+            return a.confidence > b.confidence;
+        });
+
+        ObjectDetector::BoxArray output;
+        vector<bool> remove_flags(boxes.size());
+        for(int i = 0; i < boxes.size(); ++i){
+            if(remove_flags[i]) continue;
+
+            auto& a = boxes[i];
+            output.emplace_back(a);
+            for(int j = i + 1; j < boxes.size(); ++j){
+                if(remove_flags[j]) continue;
+
+                auto& b = boxes[j];
+                if(class_agnostic || b.class_label == a.class_label){
+                    if(legacy_iou(a, b) >= threshold)
+                        remove_flags[j] = true;
+                }
+            }
+        }
+        return output;
+    }
+
+    // 逐个取最高分的Soft-NMS，作为对照
+    ObjectDetector::BoxArray legacy_soft_nms(ObjectDetector::BoxArray boxes, const NMS::Config& config){
+
+        ObjectDetector::BoxArray output;
+        while(!boxes.empty()){
+            int best = 0;
+            for(int i = 1; i < boxes.size(); ++i){
+                if(boxes[i].confidence > boxes[best].confidence)
+                    best = i;
+            }
+
+            auto a = boxes[best];
+            boxes.erase(boxes.begin() + best);
+            output.emplace_back(a);
+            for(int i = 0; i < boxes.size(); ++i){
+                if(!config.class_agnostic && boxes[i].class_label != a.class_label) continue;
+
+                float iou = legacy_iou(a, boxes[i]);
+                if(config.method == NMS::Method::SoftLinear){
+                    if(iou > config.iou_threshold)
+                        boxes[i].confidence *= 1 - iou;
+                }else{
+                    boxes[i].confidence *= exp(-(iou * iou) / config.sigma);
+                }
+
+                if(boxes[i].confidence < config.score_threshold)
+                    boxes.erase(boxes.begin() + i--);
+            }
+        }
+
+        sort(output.begin(), output.end(), [](const ObjectDetector::Box& a, const ObjectDetector::Box& b){
+            return a.confidence > b.confidence;
+        });
+        return output;
+    }
+
+    bool same_boxes(const ObjectDetector::BoxArray& a, const ObjectDetector::BoxArray& b){
+        if(a.size() != b.size()) return false;
+        for(int i = 0; i < a.size(); ++i){
+            if(a[i].left != b[i].left || a[i].top != b[i].top || a[i].right != b[i].right || a[i].bottom != b[i].bottom ||
+               a[i].confidence != b[i].confidence || a[i].class_label != b[i].class_label)
+                return false;
+        }
+        return true;
+    }
+
+    // 按类别、不区分类别、网格索引、batch并行与Soft-NMS的结果都必须与对照实现一致
+    bool test_nms(){
+
+        struct Case{
+            int num_boxes, num_classes, num_objects;
+            NMS::Config config;
+        };
+
+        // 少量box、单类别大量box使用网格、不区分类别、Soft-NMS
+        Case cases[] = {
+            { 200, 80,  10, NMS::Config(0.5f)},
+            {3000,  1, 100, NMS::Config(0.45f)},
+            {3000, 80, 100, NMS::Config(0.45f, NMS::Method::Hard, true)},
+            { 500,  3,  20, NMS::Config(0.3f,  NMS::Method::SoftLinear)},
+            { 500,  3,  20, NMS::Config(0.3f,  NMS::Method::SoftGaussian, true)}
+        };
+
+        const int batch_size = 4;
+        ThreadPool pool(4);
+        NMS::Workspace workspace;
+        bool ok = true;
+        for(auto& item : cases){
+            ObjectDetector::BoxArray inputs[batch_size], outputs[batch_size];
+            ObjectDetector::BoxArray* batch[batch_size];
+            for(int ibatch = 0; ibatch < batch_size; ++ibatch){
+                inputs[ibatch]  = make_boxes(item.num_boxes, item.num_classes, item.num_objects, ibatch * 100 + item.num_boxes);
+                outputs[ibatch] = inputs[ibatch];
+                batch[ibatch]   = &outputs[ibatch];
+            }
+
+            NMS::nms_batch(batch, batch_size, item.config, workspace, &pool);
+            bool same = true;
+            for(int ibatch = 0; ibatch < batch_size; ++ibatch){
+                ObjectDetector::BoxArray reference;
+                if(item.config.method == NMS::Method::Hard)
+                    reference = legacy_nms(inputs[ibatch], item.config.iou_threshold, item.config.class_agnostic);
+                else
+                    reference = legacy_soft_nms(inputs[ibatch], item.config);
+
+                auto single = NMS::nms(inputs[ibatch], item.config, workspace);
+                same = same && same_boxes(reference, outputs[ibatch]) && same_boxes(reference, single);
+            }
+
+            INFO("[%s] nms %d boxes x %d images, classes = %d, method = %d, agnostic = %d, keep = %d",
+                same ? "PASS" : "FAIL", item.num_boxes, batch_size, item.num_classes, (int)item.config.method,
+                item.config.class_agnostic, (int)outputs[0].size()
+            );
+            ok = ok && same;
+        }
+
+        // 没有class_label的FaceDetector::Box视为同一个类别
+        auto boxes = make_boxes(1000, 1, 50, 3);
+        FaceDetector::BoxArray faces(boxes.size());
+        for(int i = 0; i < boxes.size(); ++i){
+            faces[i].left       = boxes[i].left;
+            faces[i].top        = boxes[i].top;
+            faces[i].right      = boxes[i].right;
+            faces[i].bottom     = boxes[i].bottom;
+            faces[i].confidence = boxes[i].confidence;
+        }
+
+        auto reference  = legacy_nms(boxes, 0.5f, true);
+        auto keep_faces = NMS::nms(faces, NMS::Config(0.5f));
+        bool same = reference.size() == keep_faces.size();
+        for(int i = 0; same && i < reference.size(); ++i)
+            same = reference[i].left == keep_faces[i].left && reference[i].confidence == keep_faces[i].confidence;
+
+        INFO("[%s] nms face boxes, keep = %d", same ? "PASS" : "FAIL", (int)keep_faces.size());
+        return ok && same;
+    }
+
+    bool test_nms_performance(){
+
+        struct Case{
+            int num_boxes, num_classes, num_objects;
+        };
+
+        Case cases[] = {
+            {1000, 80,  50},
+            {5000, 80, 200},
+            {5000,  1, 200}
+        };
+
+        const int repeat = 10;
+        NMS::Workspace workspace;
+        NMS::Config config(0.45f);
+        for(auto& item : cases){
+            auto boxes = make_boxes(item.num_boxes, item.num_classes, item.num_objects, item.num_boxes);
+
+            auto t0 = iLogger::timestamp_now_float();
+            for(int i = 0; i < repeat; ++i)
+                legacy_nms(boxes, config.iou_threshold, false);
+
+            auto t1 = iLogger::timestamp_now_float();
+            for(int i = 0; i < repeat; ++i)
+                NMS::nms(boxes, config, workspace);
+
+            auto t2 = iLogger::timestamp_now_float();
+            INFO("nms %d boxes, classes = %d, legacy = %.3f ms, bucket + grid = %.3f ms",
+                item.num_boxes, item.num_classes, (t1 - t0) / repeat, (t2 - t1) / repeat
+            );
+        }
+        return true;
+    }
+
+    /* BoxDecoder的CPU实例：不同的张量布局与编译期类别数，解码结果必须逐位一致
+       fast nms只要与更高分的同类box重叠就抑制(即使那个box已被抑制)，保留的box一定也被贪心NMS保留
+    */
+    bool test_box_decoder(){
+
+        const int num_bboxes  = 8400;
+        const int num_classes = 80;
+        const int channels    = 5 + num_classes;
+        const int max_objects = 1024;
+        float d2i[] = {2.0f, 0, -80.0f, 0, 2.0f, -60.0f};
+        auto predict = make_predict(num_bboxes, num_classes, 13);
+
+        // [N, 5 + C] -> [5 + C, N]
+        vector<float> planar(predict.size());
+        for(int i = 0; i < num_bboxes; ++i)
+            for(int c = 0; c < channels; ++c)
+                planar[(size_t)c * num_bboxes + i] = predict[(size_t)i * channels + c];
+
+        BoxDecoder::AffineMatrix matrix(d2i);
+        BoxDecoder::YoloRowHead row_head(BoxDecoder::RowMajor(predict.data(), channels), BoxDecoder::DecodedAnchor(), matrix, num_classes, 0.05f);
+        BoxDecoder::YoloRowHead80 row_head80(BoxDecoder::RowMajor(predict.data(), channels), BoxDecoder::DecodedAnchor(), matrix, num_classes, 0.05f);
+        BoxDecoder::YoloHead<BoxDecoder::Planar, BoxDecoder::DecodedAnchor> planar_head(
+            BoxDecoder::Planar(planar.data(), channels, num_bboxes), BoxDecoder::DecodedAnchor(), matrix, num_classes, 0.05f
+        );
+
+        int array_size = 1 + max_objects * NUM_BOX_ELEMENT;
+        vector<float> row(array_size), row80(array_size), transposed(array_size);
+        int n0 = BoxDecoder::decode_cpu(row_head,    num_bboxes, row.data(),        max_objects);
+        int n1 = BoxDecoder::decode_cpu(row_head80,  num_bboxes, row80.data(),      max_objects);
+        int n2 = BoxDecoder::decode_cpu(planar_head, num_bboxes, transposed.data(), max_objects);
+
+        size_t bytes = (1 + n0 * NUM_BOX_ELEMENT) * sizeof(float);
+        bool same    = n0 > 0 && n1 == n0 && n2 == n0 && memcmp(row.data(), row80.data(), bytes) == 0 && memcmp(row.data(), transposed.data(), bytes) == 0;
+        INFO("[%s] box decoder row / row80 / planar, boxes = %d / %d / %d", same ? "PASS" : "FAIL", n0, n1, n2);
+
+        NMS::Workspace workspace;
+        workspace.clear();
+        for(int i = 0; i < n0; ++i){
+            const float* pbox = row.data() + 1 + i * NUM_BOX_ELEMENT;
+            workspace.add(pbox[0], pbox[1], pbox[2], pbox[3], pbox[4], (int)pbox[5]);
+        }
+        workspace.run(NMS::Config(0.1f));
+
+        vector<bool> greedy_keep(n0, false);
+        for(int i = 0; i < workspace.num_keep(0); ++i)
+            greedy_keep[workspace.keeps(0)[i].index] = true;
+
+        BoxDecoder::fast_nms_cpu<BoxDecoder::ObjectBox>(row.data(), max_objects, 0.1f);
+        int fast_count = 0;
+        bool subset    = true;
+        for(int i = 0; i < n0; ++i){
+            if(row[1 + i * NUM_BOX_ELEMENT + BoxDecoder::ObjectBox::KEEP_INDEX] == 1){
+                fast_count++;
+                subset = subset && greedy_keep[i];
+            }
+        }
+
+        bool nms_ok = subset && fast_count > 0;
+        INFO("[%s] fast nms keep = %d, greedy nms keep = %d", nms_ok ? "PASS" : "FAIL", fast_count, workspace.num_keep(0));
+        return same && nms_ok;
+    }
+
+    // 分数量化到1/8的候选，第K个分数处有大量相等的值
+    vector<float> make_candidates(int count, unsigned int seed){
+
+        mt19937 rng(seed);
+        uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        vector<float> candidates(1 + count * NUM_BOX_ELEMENT);
+        candidates[0] = count;
+        for(int i = 0; i < count; ++i){
+            float* pbox = candidates.data() + 1 + i * NUM_BOX_ELEMENT;
+            for(int j = 0; j < NUM_BOX_ELEMENT; ++j)
+                pbox[j] = i;
+            pbox[4] = (int)(uniform(rng) * 8) / 8.0f;
+        }
+        return candidates;
+    }
+
+    // 基数选择与排序的结果必须逐位一致，包括分数相等时保留靠前的box，以及原地执行
+    bool test_topk(){
+
+        float d2i[] = {2.0f, 0, -80.0f, 0, 2.0f, -60.0f};
+        auto predict = make_predict(25200, 80, 11);
+        vector<float> decoded(1 + 25200 * NUM_BOX_ELEMENT);
+        Yolo::cpu_decode(predict.data(), 25200, 80, 0.01f, d2i, decoded.data(), 25200);
+
+        struct Case{
+            const char* name;
+            vector<float> candidates;
+            int max_objects;
+        };
+
+        Case cases[] = {
+            {"decoded",   decoded,                   32},
+            {"decoded",   decoded,                 1024},
+            {"decoded",   decoded,                25200},
+            {"ties",      make_candidates(5000, 3),  100},
+            {"ties",      make_candidates(5000, 5), 4999},
+            {"ties",      make_candidates(5000, 7),    0}
+        };
+
+        bool ok = true;
+        for(auto& item : cases){
+            auto& candidates = item.candidates;
+            vector<float> reference(candidates.size()), radix(candidates.size()), inplace = candidates;
+            int nref = CPUKernel::topk_boxes_reference(candidates.data(), reference.data(), item.max_objects, NUM_BOX_ELEMENT, 4);
+            int n1   = CPUKernel::topk_boxes(candidates.data(), radix.data(), item.max_objects, NUM_BOX_ELEMENT, 4);
+            int n2   = CPUKernel::topk_boxes(inplace.data(), inplace.data(), item.max_objects, NUM_BOX_ELEMENT, 4);
+
+            size_t bytes = (1 + nref * NUM_BOX_ELEMENT) * sizeof(float);
+            bool same    = n1 == nref && n2 == nref && memcmp(reference.data(), radix.data(), bytes) == 0 && memcmp(reference.data(), inplace.data(), bytes) == 0;
+            INFO("[%s] topk %s, candidates = %d, max_objects = %d, keep = %d / %d / %d",
+                same ? "PASS" : "FAIL", item.name, (int)candidates[0], item.max_objects, nref, n1, n2
+            );
+            ok = ok && same;
+        }
+
+        // 密集场景下先到先得的截断会丢掉排在后面的高分box，top-K保留的一定是分数最高的
+        const int max_objects = 256;
+        vector<float> truncated(1 + max_objects * NUM_BOX_ELEMENT), topk(decoded.size());
+        int ntruncated = Yolo::cpu_decode(predict.data(), 25200, 80, 0.01f, d2i, truncated.data(), max_objects);
+        int ntopk      = CPUKernel::topk_boxes(decoded.data(), topk.data(), max_objects, NUM_BOX_ELEMENT, 4);
+
+        auto max_score = [](const float* parray, int count){
+            float value = 0;
+            for(int i = 0; i < count; ++i)
+                value = max(value, parray[1 + i * NUM_BOX_ELEMENT + 4]);
+            return value;
+        };
+
+        float best     = max_score(decoded.data(), (int)decoded[0]);
+        bool keep_best = ntopk == max_objects && max_score(topk.data(), ntopk) == best;
+        INFO("[%s] crowded, best score = %.4f, first-come keeps %.4f, top-k keeps %.4f",
+            keep_best ? "PASS" : "FAIL", best, max_score(truncated.data(), ntruncated), max_score(topk.data(), ntopk)
+        );
+        return ok && keep_best;
+    }
+
+    bool test_topk_performance(){
+
+        const int repeat = 50;
+        int counts[] = {2000, 25200};
+        for(int count : counts){
+            auto candidates = make_candidates(count, count);
+            vector<float> parray(candidates.size());
+
+            auto t0 = iLogger::timestamp_now_float();
+            for(int i = 0; i < repeat; ++i)
+                CPUKernel::topk_boxes_reference(candidates.data(), parray.data(), 1024, NUM_BOX_ELEMENT, 4);
+
+            auto t1 = iLogger::timestamp_now_float();
+            for(int i = 0; i < repeat; ++i)
+                CPUKernel::topk_boxes(candidates.data(), parray.data(), 1024, NUM_BOX_ELEMENT, 4);
+
+            auto t2 = iLogger::timestamp_now_float();
+            INFO("topk %d candidates, max_objects = 1024, sort = %.3f ms, radix select = %.3f ms",
+                count, (t1 - t0) / repeat, (t2 - t1) / repeat
+            );
+        }
+        return true;
+    }
+
+    // 平滑的原型，系数随机，得到的mask有成片的前景
+    vector<float> make_prototypes(int num_masks, int height, int width, unsigned int seed){
+
+        mt19937 rng(seed);
+        uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        vector<float> prototypes((size_t)num_masks * height * width);
+        for(int m = 0; m < num_masks; ++m){
+            float fx = 0.02f + uniform(rng) * 0.2f, fy = 0.02f + uniform(rng) * 0.2f;
+            float px = uniform(rng) * 6.28f, py = uniform(rng) * 6.28f;
+            float* pmask = prototypes.data() + (size_t)m * height * width;
+            for(int y = 0; y < height; ++y)
+                for(int x = 0; x < width; ++x)
+                    pmask[y * width + x] = sinf(x * fx + px) * cosf(y * fy + py) + (uniform(rng) - 0.5f) * 0.1f;
+        }
+        return prototypes;
+    }
+
+    vector<float> make_coefficients(int num_boxes, int num_masks, unsigned int seed){
+        mt19937 rng(seed);
+        normal_distribution<float> normal(0.0f, 1.0f);
+        vector<float> coefficients(num_boxes * num_masks);
+        for(auto& item : coefficients)
+            item = normal(rng);
+        return coefficients;
+    }
+
+    // 1920x1080的原图letterbox到640x640
+    void make_letterbox(int image_width, int image_height, int input_size, float* i2d){
+        float scale = min(input_size / (float)image_width, input_size / (float)image_height);
+        i2d[0] = scale;  i2d[1] = 0;  i2d[2] = -scale * image_width  * 0.5f + input_size * 0.5f + scale * 0.5f - 0.5f;
+        i2d[3] = 0;  i2d[4] = scale;  i2d[5] = -scale * image_height * 0.5f + input_size * 0.5f + scale * 0.5f - 0.5f;
+    }
+
+    bool same_masks(const vector<Segmentation::RLEMask>& a, const vector<Segmentation::RLEMask>& b){
+        if(a.size() != b.size()) return false;
+        for(size_t i = 0; i < a.size(); ++i){
+            if(a[i].left != b[i].left || a[i].top != b[i].top || a[i].width != b[i].width || a[i].height != b[i].height || a[i].counts != b[i].counts)
+                return false;
+        }
+        return true;
+    }
+
+    // 先裁剪再上采样的结果必须与整图计算后裁剪逐像素一致，包括越界、空与覆盖整图的box
+    bool test_instance_mask(){
+
+        const int image_width = 1920, image_height = 1080, num_masks = 32;
+        float i2d[6];
+        make_letterbox(image_width, image_height, 640, i2d);
+
+        auto proto = make_prototypes(num_masks, 160, 160, 13);
+        Segmentation::Prototypes prototypes{proto.data(), num_masks, 160, 160, 640, 640};
+
+        auto boxes = make_boxes(24, 80, 10, 17);
+        boxes.emplace_back(-50.0f, -20.0f, 2000.0f, 1200.0f, 0.9f, 0);
+        boxes.emplace_back(100.0f, 100.0f, 100.0f, 300.0f, 0.9f, 0);
+        boxes.emplace_back(1919.2f, 1079.5f, 1925.0f, 1090.0f, 0.9f, 0);
+        int num_boxes     = boxes.size();
+        auto coefficients = make_coefficients(num_boxes, num_masks, 19);
+
+        vector<Segmentation::RLEMask> reference, single, threaded;
+        Segmentation::decode_instance_reference(prototypes, i2d, image_width, image_height, boxes.data(), coefficients.data(), num_boxes, reference);
+
+        Segmentation::InstanceDecoder decoder;
+        ThreadPool pool(4);
+        decoder.decode(prototypes, i2d, image_width, image_height, boxes.data(), coefficients.data(), num_boxes, single);
+        decoder.decode(prototypes, i2d, image_width, image_height, boxes.data(), coefficients.data(), num_boxes, threaded, 0.5f, &pool);
+
+        bool same = same_masks(reference, single) && same_masks(reference, threaded);
+        int total_area = 0;
+        for(auto& item : reference)
+            total_area += item.area();
+
+        INFO("[%s] instance mask, %d boxes, foreground = %d pixels", same ? "PASS" : "FAIL", num_boxes, total_area);
+
+        // 解码再编码得到相同的游程，面积与前景像素数一致
+        bool roundtrip = true;
+        vector<uint8_t> image(image_width * image_height);
+        for(auto& item : reference){
+            memset(image.data(), 0, image.size());
+            item.decode(image.data(), image_width);
+
+            int foreground = count(image.begin(), image.end(), 1);
+            auto encoded   = Segmentation::RLEMask::encode(image.data(), image_width, item.left, item.top, item.width, item.height);
+            roundtrip      = roundtrip && encoded.counts == item.counts && foreground == item.area();
+        }
+        INFO("[%s] rle roundtrip", roundtrip ? "PASS" : "FAIL");
+        return same && roundtrip;
+    }
+
+    bool test_instance_mask_performance(){
+
+        const int image_width = 1920, image_height = 1080, num_masks = 32, num_boxes = 100;
+        float i2d[6];
+        make_letterbox(image_width, image_height, 640, i2d);
+
+        auto proto = make_prototypes(num_masks, 160, 160, 23);
+        Segmentation::Prototypes prototypes{proto.data(), num_masks, 160, 160, 640, 640};
+        auto boxes        = make_boxes(num_boxes, 80, 30, 29);
+        auto coefficients = make_coefficients(num_boxes, num_masks, 31);
+        const int repeat  = 10;
+
+        vector<Segmentation::RLEMask> masks;
+        Segmentation::InstanceDecoder decoder;
+        ThreadPool pool(4);
+
+        auto t0 = iLogger::timestamp_now_float();
+        Segmentation::decode_instance_reference(prototypes, i2d, image_width, image_height, boxes.data(), coefficients.data(), num_boxes, masks);
+
+        auto t1 = iLogger::timestamp_now_float();
+        for(int i = 0; i < repeat; ++i)
+            decoder.decode(prototypes, i2d, image_width, image_height, boxes.data(), coefficients.data(), num_boxes, masks);
+
+        auto t2 = iLogger::timestamp_now_float();
+        for(int i = 0; i < repeat; ++i)
+            decoder.decode(prototypes, i2d, image_width, image_height, boxes.data(), coefficients.data(), num_boxes, masks, 0.5f, &pool);
+
+        auto t3 = iLogger::timestamp_now_float();
+        size_t rle_bytes = 0;
+        for(auto& item : masks)
+            rle_bytes += item.bytes();
+
+        INFO("instance mask %d boxes, full image = %.3f ms, crop first = %.3f ms, crop first x%d threads = %.3f ms",
+            num_boxes, t1 - t0, (t2 - t1) / repeat, pool.size() + 1, (t3 - t2) / repeat
+        );
+        INFO("instance mask %d boxes, dense = %.2f MB, rle = %.2f KB",
+            num_boxes, (size_t)num_boxes * image_width * image_height / 1024.0f / 1024.0f, rle_bytes / 1024.0f
+        );
+        return true;
+    }
+
+    // 与std::max_element一致，相等时取序号小的类别
+    bool test_semantic_argmax(){
+
+        const int num_pixels = 512 * 512, num_classes = 21;
+        mt19937 rng(37);
+        vector<float> predict((size_t)num_pixels * num_classes);
+        for(auto& item : predict)
+            item = (rng() % 16) / 16.0f;
+
+        vector<float> prob(num_pixels), prob_threaded(num_pixels);
+        vector<uint8_t> index(num_pixels), index_threaded(num_pixels);
+        ThreadPool pool(4);
+        Segmentation::semantic_argmax(predict.data(), num_pixels, num_classes, prob.data(), index.data());
+        Segmentation::semantic_argmax(predict.data(), num_pixels, num_classes, prob_threaded.data(), index_threaded.data(), &pool);
+
+        bool ok = prob == prob_threaded && index == index_threaded;
+        for(int i = 0; i < num_pixels && ok; ++i){
+            const float* pitem = predict.data() + (size_t)i * num_classes;
+            int ic = max_element(pitem, pitem + num_classes) - pitem;
+            ok = index[i] == ic && prob[i] == pitem[ic];
+        }
+        INFO("[%s] semantic argmax %d pixels x %d classes", ok ? "PASS" : "FAIL", num_pixels, num_classes);
+        return ok;
+    }
+
+}; // namespace
+
+int test_yolo_postprocess(){
+
+    struct{const char* name; bool (*func)();} cases[] = {
+        {"cpu_decode",              test_cpu_decode},
+        {"cpu_decode_performance",  test_cpu_decode_performance},
+        {"cpu_decode_channel_major",             test_cpu_decode_channel_major},
+        {"cpu_decode_channel_major_performance", test_cpu_decode_channel_major_performance},
+        {"nms",                     test_nms},
+        {"nms_performance",         test_nms_performance},
+        {"box_decoder",             test_box_decoder},
+        {"topk",                    test_topk},
+        {"topk_performance",        test_topk_performance},
+        {"instance_mask",             test_instance_mask},
+        {"instance_mask_performance", test_instance_mask_performance},
+        {"semantic_argmax",           test_semantic_argmax}
+    };
+
+    int nfailed = 0;
+    for(auto& item : cases){
+        bool ok = item.func();
+        if(!ok) nfailed++;
+        INFO("[%s] %s", ok ? "PASS" : "FAIL", item.name);
+    }
+    INFO("%d case(s) failed", nfailed);
+    return nfailed;
+}
@@ -1,12 +1,13 @@
 #include "deepsort.hpp"
+#include "linear_assignment.hpp"
+#include "kalman_filter.hpp"
+#include "feature_bank.hpp"
+#include "spatial_grid.hpp"
 
 #include <vector>
 #include <set>
 #include <algorithm>
 #include <utility>
-#include "Eigen/Core"
-#include "Eigen/Cholesky"
-#include "Eigen/LU"
 
 namespace DeepSORT {
 
@@ -23,6 +24,13 @@ namespace DeepSORT {
             height = box.height();
             aspect_ratio = box.width() / height;
         }
+
+        void to_measure(float measure[4]) const{
+            measure[0] = center_x;
+            measure[1] = center_y;
+            measure[2] = aspect_ratio;
+            measure[3] = height;
+        }
     };
 
     static float chi2inv95_2[] = {
@@ -43,378 +51,6 @@ namespace DeepSORT {
         return hypot(center.x - center2.x, center.y - center2.y);
     }
 
-    class HungarianAlgorithm
-    {
-    public:
-        enum TMethod
-        {
-            optimal,
-            many_forbidden_assignments,
-            without_forbidden_assignments
-        };
-
-    public:
-        HungarianAlgorithm(){}
-        ~HungarianAlgorithm(){}
-
-        double Solve(std::vector<std::vector<double> >& DistMatrix, std::vector<int>& Assignment)
-        {
-            unsigned int nRows = DistMatrix.size();
-            unsigned int nCols = DistMatrix[0].size();
-
-            std::vector<double> distMatrixIn(nRows * nCols);
-            std::vector<int> assignment(nRows);
-            double cost = 0.0;
-
-            for (unsigned int i = 0; i < nRows; i++)
-                for (unsigned int j = 0; j < nCols; j++)
-                    distMatrixIn[i + nRows * j] = DistMatrix[i][j];
-            
-            // call solving function
-            assignmentoptimal(assignment.data(), &cost, distMatrixIn.data(), nRows, nCols);
-
-            Assignment.clear();
-            for (unsigned int r = 0; r < nRows; r++)
-                Assignment.push_back(assignment[r]);
-
-            return cost;
-        }
-
-    private:
-        void assignmentoptimal(int *assignment, double *cost, double *distMatrixIn, int nOfRows, int nOfColumns)
-        {
-            double *distMatrix, *distMatrixTemp, *distMatrixEnd, *columnEnd, value, minValue;
-            bool *coveredColumns, *coveredRows, *starMatrix, *newStarMatrix, *primeMatrix;
-            int nOfElements, minDim, row, col;
-
-            /* initialization */
-            *cost = 0;
-            for (row = 0; row<nOfRows; row++)
-                assignment[row] = -1;
-
-            /* generate working copy of distance Matrix */
-            /* check if all matrix elements are positive */
-            nOfElements = nOfRows * nOfColumns;
-            distMatrix = (double *)malloc(nOfElements * sizeof(double));
-            distMatrixEnd = distMatrix + nOfElements;
-
-            for (row = 0; row<nOfElements; row++)
-            {
-                value = distMatrixIn[row];
-                if (value < 0)
-                    std::cerr << "All matrix elements have to be non-negative." << std::endl;
-                distMatrix[row] = value;
-            }
-
-
-            /* memory allocation */
-            coveredColumns = (bool *)calloc(nOfColumns, sizeof(bool));
-            coveredRows = (bool *)calloc(nOfRows, sizeof(bool));
-            starMatrix = (bool *)calloc(nOfElements, sizeof(bool));
-            primeMatrix = (bool *)calloc(nOfElements, sizeof(bool));
-            newStarMatrix = (bool *)calloc(nOfElements, sizeof(bool)); /* used in step4 */
-
-            /* preliminary steps */
-            if (nOfRows <= nOfColumns)
-            {
-                minDim = nOfRows;
-
-                for (row = 0; row<nOfRows; row++)
-                {
-                    /* find the smallest element in the row */
-                    distMatrixTemp = distMatrix + row;
-                    minValue = *distMatrixTemp;
-                    distMatrixTemp += nOfRows;
-                    while (distMatrixTemp < distMatrixEnd)
-                    {
-                        value = *distMatrixTemp;
-                        if (value < minValue)
-                            minValue = value;
-                        distMatrixTemp += nOfRows;
-                    }
-
-                    /* subtract the smallest element from each element of the row */
-                    distMatrixTemp = distMatrix + row;
-                    while (distMatrixTemp < distMatrixEnd)
-                    {
-                        *distMatrixTemp -= minValue;
-                        distMatrixTemp += nOfRows;
-                    }
-                }
-
-                /* Steps 1 and 2a */
-                for (row = 0; row<nOfRows; row++)
-                    for (col = 0; col<nOfColumns; col++)
-                        if (fabs(distMatrix[row + nOfRows*col]) < DBL_EPSILON)
-                            if (!coveredColumns[col])
-                            {
-                                starMatrix[row + nOfRows*col] = true;
-                                coveredColumns[col] = true;
-                                break;
-                            }
-            }
-            else /* if(nOfRows > nOfColumns) */
-            {
-                minDim = nOfColumns;
-
-                for (col = 0; col<nOfColumns; col++)
-                {
-                    /* find the smallest element in the column */
-                    distMatrixTemp = distMatrix + nOfRows*col;
-                    columnEnd = distMatrixTemp + nOfRows;
-
-                    minValue = *distMatrixTemp++;
-                    while (distMatrixTemp < columnEnd)
-                    {
-                        value = *distMatrixTemp++;
-                        if (value < minValue)
-                            minValue = value;
-                    }
-
-                    /* subtract the smallest element from each element of the column */
-                    distMatrixTemp = distMatrix + nOfRows*col;
-                    while (distMatrixTemp < columnEnd)
-                        *distMatrixTemp++ -= minValue;
-                }
-
-                /* Steps 1 and 2a */
-                for (col = 0; col<nOfColumns; col++)
-                    for (row = 0; row<nOfRows; row++)
-                        if (fabs(distMatrix[row + nOfRows*col]) < DBL_EPSILON)
-                            if (!coveredRows[row])
-                            {
-                                starMatrix[row + nOfRows*col] = true;
-                                coveredColumns[col] = true;
-                                coveredRows[row] = true;
-                                break;
-                            }
-                for (row = 0; row<nOfRows; row++)
-                    coveredRows[row] = false;
-
-            }
-
-            /* move to step 2b */
-            step2b(assignment, distMatrix, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, minDim);
-
-            /* compute cost and remove invalid assignments */
-            computeassignmentcost(assignment, cost, distMatrixIn, nOfRows);
-
-            /* free allocated memory */
-            free(distMatrix);
-            free(coveredColumns);
-            free(coveredRows);
-            free(starMatrix);
-            free(primeMatrix);
-            free(newStarMatrix);
-
-            return;
-        }
-
-        void buildassignmentvector(int *assignment, bool *starMatrix, int nOfRows, int nOfColumns)
-        {
-            int row, col;
-
-            for (row = 0; row<nOfRows; row++)
-                for (col = 0; col<nOfColumns; col++)
-                    if (starMatrix[row + nOfRows*col])
-                    {
-        #ifdef ONE_INDEXING
-                        assignment[row] = col + 1; /* MATLAB-Indexing */
-        #else
-                        assignment[row] = col;
-        #endif
-                        break;
-                    }
-        }
-
-        void computeassignmentcost(int *assignment, double *cost, double *distMatrix, int nOfRows)
-        {
-            int row, col;
-
-            for (row = 0; row<nOfRows; row++)
-            {
-                col = assignment[row];
-                if (col >= 0)
-                    *cost += distMatrix[row + nOfRows*col];
-            }
-        }
-
-        void step2a(int *assignment, double *distMatrix, bool *starMatrix, bool *newStarMatrix, bool *primeMatrix, bool *coveredColumns, bool *coveredRows, int nOfRows, int nOfColumns, int minDim)
-        {
-            bool *starMatrixTemp, *columnEnd;
-            int col;
-
-            /* cover every column containing a starred zero */
-            for (col = 0; col<nOfColumns; col++)
-            {
-                starMatrixTemp = starMatrix + nOfRows*col;
-                columnEnd = starMatrixTemp + nOfRows;
-                while (starMatrixTemp < columnEnd){
-                    if (*starMatrixTemp++)
-                    {
-                        coveredColumns[col] = true;
-                        break;
-                    }
-                }
-            }
-
-            /* move to step 3 */
-            step2b(assignment, distMatrix, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, minDim);
-        }
-
-        void step2b(int *assignment, double *distMatrix, bool *starMatrix, bool *newStarMatrix, bool *primeMatrix, bool *coveredColumns, bool *coveredRows, int nOfRows, int nOfColumns, int minDim)
-        {
-            int col, nOfCoveredColumns;
-
-            /* count covered columns */
-            nOfCoveredColumns = 0;
-            for (col = 0; col<nOfColumns; col++)
-                if (coveredColumns[col])
-                    nOfCoveredColumns++;
-
-            if (nOfCoveredColumns == minDim)
-            {
-                /* algorithm finished */
-                buildassignmentvector(assignment, starMatrix, nOfRows, nOfColumns);
-            }
-            else
-            {
-                /* move to step 3 */
-                step3(assignment, distMatrix, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, minDim);
-            }
-
-        }
-
-        void step3(int *assignment, double *distMatrix, bool *starMatrix, bool *newStarMatrix, bool *primeMatrix, bool *coveredColumns, bool *coveredRows, int nOfRows, int nOfColumns, int minDim)
-        {
-            bool zerosFound;
-            int row, col, starCol;
-
-            zerosFound = true;
-            while (zerosFound)
-            {
-                zerosFound = false;
-                for (col = 0; col<nOfColumns; col++)
-                    if (!coveredColumns[col])
-                        for (row = 0; row<nOfRows; row++)
-                            if ((!coveredRows[row]) && (fabs(distMatrix[row + nOfRows*col]) < DBL_EPSILON))
-                            {
-                                /* prime zero */
-                                primeMatrix[row + nOfRows*col] = true;
-
-                                /* find starred zero in current row */
-                                for (starCol = 0; starCol<nOfColumns; starCol++)
-                                    if (starMatrix[row + nOfRows*starCol])
-                                        break;
-
-                                if (starCol == nOfColumns) /* no starred zero found */
-                                {
-                                    /* move to step 4 */
-                                    step4(assignment, distMatrix, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, minDim, row, col);
-                                    return;
-                                }
-                                else
-                                {
-                                    coveredRows[row] = true;
-                                    coveredColumns[starCol] = false;
-                                    zerosFound = true;
-                                    break;
-                                }
-                            }
-            }
-
-            /* move to step 5 */
-            step5(assignment, distMatrix, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, minDim);
-        }
-
-        void step4(int *assignment, double *distMatrix, bool *starMatrix, bool *newStarMatrix, bool *primeMatrix, bool *coveredColumns, bool *coveredRows, int nOfRows, int nOfColumns, int minDim, int row, int col)
-        {
-            int n, starRow, starCol, primeRow, primeCol;
-            int nOfElements = nOfRows*nOfColumns;
-
-            /* generate temporary copy of starMatrix */
-            for (n = 0; n<nOfElements; n++)
-                newStarMatrix[n] = starMatrix[n];
-
-            /* star current zero */
-            newStarMatrix[row + nOfRows*col] = true;
-
-            /* find starred zero in current column */
-            starCol = col;
-            for (starRow = 0; starRow<nOfRows; starRow++)
-                if (starMatrix[starRow + nOfRows*starCol])
-                    break;
-
-            while (starRow<nOfRows)
-            {
-                /* unstar the starred zero */
-                newStarMatrix[starRow + nOfRows*starCol] = false;
-
-                /* find primed zero in current row */
-                primeRow = starRow;
-                for (primeCol = 0; primeCol<nOfColumns; primeCol++)
-                    if (primeMatrix[primeRow + nOfRows*primeCol])
-                        break;
-
-                /* star the primed zero */
-                newStarMatrix[primeRow + nOfRows*primeCol] = true;
-
-                /* find starred zero in current column */
-                starCol = primeCol;
-                for (starRow = 0; starRow<nOfRows; starRow++)
-                    if (starMatrix[starRow + nOfRows*starCol])
-                        break;
-            }
-
-            /* use temporary copy as new starMatrix */
-            /* delete all primes, uncover all rows */
-            for (n = 0; n<nOfElements; n++)
-            {
-                primeMatrix[n] = false;
-                starMatrix[n] = newStarMatrix[n];
-            }
-            for (n = 0; n<nOfRows; n++)
-                coveredRows[n] = false;
-
-            /* move to step 2a */
-            step2a(assignment, distMatrix, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, minDim);
-        }
-
-        void step5(int *assignment, double *distMatrix, bool *starMatrix, bool *newStarMatrix, bool *primeMatrix, bool *coveredColumns, bool *coveredRows, int nOfRows, int nOfColumns, int minDim)
-        {
-            double h, value;
-            int row, col;
-
-            /* find smallest uncovered element h */
-            h = DBL_MAX;
-            for (row = 0; row<nOfRows; row++)
-                if (!coveredRows[row])
-                    for (col = 0; col<nOfColumns; col++)
-                        if (!coveredColumns[col])
-                        {
-                            value = distMatrix[row + nOfRows*col];
-                            if (value < h)
-                                h = value;
-                        }
-
-            /* add h to each covered row */
-            for (row = 0; row<nOfRows; row++)
-                if (coveredRows[row])
-                    for (col = 0; col<nOfColumns; col++)
-                        distMatrix[row + nOfRows*col] += h;
-
-            /* subtract h from each uncovered column */
-            for (col = 0; col<nOfColumns; col++)
-                if (!coveredColumns[col])
-                    for (row = 0; row<nOfRows; row++)
-                        distMatrix[row + nOfRows*col] -= h;
-
-            /* move to step 3 */
-            step3(assignment, distMatrix, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, minDim);
-        }
-    };
-
-
     TrackerConfig::TrackerConfig(){
         
         float std_weight_position_ = 1 / 20.f;
@@ -476,186 +112,21 @@ namespace DeepSORT {
         memcpy(this->noise, values.data(), sizeof(this->noise));
     }
 
-    class KalmanFilter
-    {
-    public:
-        KalmanFilter(const TrackerConfig& config):config_(config) {
-            /* 匀速直线运动 */
-            motion_mat_ = Eigen::Matrix<float, 8, 8>::Identity(8, 8);
-            for (int i = 0; i < 4; ++i) {
-                motion_mat_(i, 4 + i) = 1;
-            }
-            update_mat_ = Eigen::Matrix<float, 4, 8>::Identity(4, 8);
-        }
-        ~KalmanFilter() {
-
-        }
-
-        void project(const Eigen::Matrix<float, 8, 1> &mean, 
-                    const Eigen::Matrix<float, 8, 8> &covariance,
-                    Eigen::Matrix<float, 4, 1> &mean_ret,
-                    Eigen::Matrix<float, 4, 4> &covariance_ret) {
-            Eigen::Matrix<float, 4, 1> std_vel;
-            
-            /* 测量噪声标准差 */
-            // std_vel << std_weight_position_ * mean(3, 0),
-            //         std_weight_position_ * mean(3, 0),
-            //         1e-1,
-            //         std_weight_position_ * mean(3, 0);
-            std_vel <<  config_.noise[0] * mean(3, 0),
-                        config_.noise[1] * mean(3, 0),
-                        config_.noise[2],
-                        config_.noise[3] * mean(3, 0);
-            std_vel = std_vel.array().pow(2).matrix();
-            Eigen::Matrix<float, 4, 4> innovation_cov(std_vel.asDiagonal());
-
-            mean_ret = update_mat_ * mean;
-            covariance_ret = update_mat_ * covariance * update_mat_.transpose() + innovation_cov;
-        }
-
-        /**
-         * @brief 马氏距离计算
-         * 
-         * @param mean 
-         * @param covariance 
-         * @param boxah 
-         * @param only_position 
-         * @return float 
-         */
-        float ma_distance(const Eigen::Matrix<float, 8, 1> &mean, 
-                        const Eigen::Matrix<float, 8, 8> &covariance,
-                        const BBoxXYAH &boxah,
-                        bool only_position =  false) {
-            // 
-            Eigen::Matrix<float, 4, 1> mean_ret;
-            Eigen::Matrix<float, 4, 4> covariance_ret;
-            this->project(mean, covariance, mean_ret, covariance_ret);
-
-            float squared_maha = 0;
-            if (only_position) {
-
-            }
-            else {
-                auto cholesky_factor = covariance_ret.llt();
-                Eigen::Matrix<float, 4, 1> matrix_boxah;
-                matrix_boxah << boxah.center_x, boxah.center_y, boxah.aspect_ratio, boxah.height;
-                auto d = matrix_boxah - mean_ret;
-                auto z = cholesky_factor.solve(d);
-                squared_maha = z.array().pow(2).sum();
-
-                Eigen::LLT<Eigen::Matrix<float, 4, 4>> a_factor(covariance_ret);
-                Eigen::Matrix<float, 4, 4> a = a_factor.matrixL();
-                Eigen::Map<Eigen::MatrixXf> a_map(a.data(), a.rows(), a.cols());
-                auto a_inv = a_map.inverse();
-                auto zz = d.transpose() * a_inv;
-                squared_maha = zz.array().pow(2).sum();
-            }
-
-            return squared_maha;
-        }
-
-        void predict(Eigen::Matrix<float, 8, 1> &mean, 
-                    Eigen::Matrix<float, 8, 8> &covariance) {
-            Eigen::Matrix<float, 8, 1> std_pos_vel;
-
-            /* 预测下一步所在位置，那么std_pos则是模型对下一步预测的标准差。可以认为是一帧运动了多少 */
-            // std_pos_vel << std_weight_position_ * mean(3, 0),
-            //             std_weight_position_ * mean(3, 0),
-            //             1e-2,
-            //             std_weight_position_ * mean(3, 0),
-
-            //             std_weight_velocity_ * mean(3, 0),
-            //             std_weight_velocity_ * mean(3, 0),
-            //             1e-5,
-            //             std_weight_velocity_ * mean(3, 0);
-            std_pos_vel <<  config_.per_frame_motion[0] * mean(3, 0),
-                            config_.per_frame_motion[1] * mean(3, 0),
-                            config_.per_frame_motion[2],
-                            config_.per_frame_motion[3] * mean(3, 0),
-                            config_.per_frame_motion[4] * mean(3, 0),
-                            config_.per_frame_motion[5] * mean(3, 0),
-                            config_.per_frame_motion[6],
-                            config_.per_frame_motion[7] * mean(3, 0);
-            std_pos_vel = std_pos_vel.array().pow(2).matrix();
-            Eigen::Matrix<float, 8, 8> motion_cov(std_pos_vel.asDiagonal());
-
-            mean = motion_mat_ * mean;
-            covariance = motion_mat_ * covariance * motion_mat_.transpose() + motion_cov;
-        }
-
-        void update(const BBoxXYAH &boxah,
-                    Eigen::Matrix<float, 8, 1> &mean,
-                    Eigen::Matrix<float, 8, 8> &covariance) {
-            Eigen::Matrix<float, 4, 1> mean_ret;
-            Eigen::Matrix<float, 4, 4> covariance_ret;
-            project(mean, covariance, mean_ret, covariance_ret);
-
-            Eigen::Map<Eigen::MatrixXf> cov_map(covariance_ret.data(), covariance_ret.rows(), covariance_ret.cols());
-            auto cov_inv = cov_map.inverse();
-            auto kalman_gain = covariance * update_mat_.transpose() * cov_inv;
-
-            Eigen::Matrix<float, 4, 1> measure;
-            measure << boxah.center_x, boxah.center_y, boxah.aspect_ratio, boxah.height;
-            auto innovation = measure - mean_ret;
-            
-            mean = mean + kalman_gain * innovation;
-            covariance = covariance - kalman_gain * update_mat_ * covariance;
-        }
-
-        void initiate(const BBoxXYAH &boxah, Eigen::Matrix<float, 8, 1> &mean, 
-                    Eigen::Matrix<float, 8, 8> &covariance) {
-            mean << boxah.center_x, boxah.center_y, boxah.aspect_ratio,
-                boxah.height, 0.0f, 0.0f, 0.0f, 0.0f;
-
-            /** 初始状态 **/
-            Eigen::Matrix<float, 8, 1> std_val;
-            // std_val << 2.0f * std_weight_position_ * boxah.height,
-            //            2.0f * std_weight_position_ * boxah.height,
-            //            1e-2,
-            //            2.0f * std_weight_position_ * boxah.height,
-
-            //            10.0f * std_weight_velocity_ * boxah.height,
-            //            10.0f * std_weight_velocity_ * boxah.height,
-            //            1e-5,
-            //            10.0f * std_weight_velocity_ * boxah.height;
-            std_val << config_.initiate_state[0] * boxah.height,
-                       config_.initiate_state[1] * boxah.height,
-                       config_.initiate_state[2],
-                       config_.initiate_state[3] * boxah.height,
-                       config_.initiate_state[4] * boxah.height,
-                       config_.initiate_state[5] * boxah.height,
-                       config_.initiate_state[6],
-                       config_.initiate_state[7] * boxah.height;
-            covariance = Eigen::Matrix<float, 8, 8>(std_val.array().pow(2).matrix().asDiagonal());
-        }
-
-    private:
-        //float std_weight_position_{1.0f / 20};
-        //float std_weight_velocity_{1.0f / 160};
-
-        Eigen::Matrix<float, 8, 8> motion_mat_;
-        Eigen::Matrix<float, 4, 8> update_mat_;
-        TrackerConfig config_;
-    };
-
     class TrackObjectImpl : public TrackObject
     {
     public:
         TrackObjectImpl(const Box &box, 
-                    const Eigen::Matrix<float, 8, 1> &mean,
-                    const Eigen::Matrix<float, 8, 8> &covariance,
-                    int id_next, int nbuckets, int max_age, int nhit, bool has_feature)
-            :nbuckets_(nbuckets), max_age_(max_age), nhit_(nhit), has_feature_(has_feature)
+                    const KalmanBatch* kalman, int kalman_index, const FeatureBank* features,
+                    int id_next, int nbuckets, int max_age, int nhit)
+            :nbuckets_(nbuckets), max_age_(max_age), nhit_(nhit)
         {
             last_position_ = box;
-            covariance_    = covariance;
-            mean_          = mean;
+            kalman_        = kalman;
+            kalman_index_  = kalman_index;
+            features_      = features;
             id_            = id_next;
             state_         = State::Tentative;
             trace_.emplace_back(box);
-
-            if(has_feature_)
-                feature_bucket_.push_back(box.feature);
         }
 
         virtual int time_since_update() const {return time_since_update_;}
@@ -677,14 +148,14 @@ namespace DeepSORT {
             return trace_[(int)trace_.size() - 1 - time_since_update];
         }
 
-        Eigen::Matrix<float, 8, 1> get_mean() const {return mean_;}
-        Eigen::Matrix<float, 8, 8> get_covariance() const {return covariance_;}
+        int kalman_index() const {return kalman_index_;}
+        void set_kalman_index(int index) {kalman_index_ = index;}
 
         virtual Box predict_box() const {
-            float center_x = mean_(0, 0);
-            float center_y = mean_(1, 0);
-            float aspect_ratio = mean_(2, 0);
-            float height = mean_(3, 0);
+            float center_x = kalman_->mean(kalman_index_, 0);
+            float center_y = kalman_->mean(kalman_index_, 1);
+            float aspect_ratio = kalman_->mean(kalman_index_, 2);
+            float height = kalman_->mean(kalman_index_, 3);
             float width = aspect_ratio * height;
 
             float left = int(center_x - width / 2);
@@ -695,9 +166,7 @@ namespace DeepSORT {
             return Box(left, top, right, bottom);
         }
 
-        void predict(KalmanFilter &km_filter) {
-            km_filter.predict(mean_, covariance_);
-
+        void predict() {
             ++ age_;
             ++ time_since_update_;
         }
@@ -708,30 +177,13 @@ namespace DeepSORT {
             }
         }
 
-        void update(KalmanFilter &km_filter, const Box &box) {
-            
-            if(has_feature_ && box.feature.empty()){
-                fprintf(stderr, "Feature is empty, ignore has_feature_ flag\n");
-                has_feature_ = false;
-            }
-
-            if(has_feature_){
-                if(feature_bucket_.rows < nbuckets_){
-                    feature_bucket_.push_back(box.feature);
-                }else{
-                    box.feature.copyTo(feature_bucket_.row(feature_cursor_++));
-
-                    if(feature_cursor_ >= nbuckets_)
-                        feature_cursor_ = 0;
-                }
-            }
+        void update(const Box &box) {
 
             trace_.push_back(box);
             if (trace_.size() > nbuckets_) {
                 trace_.pop_front();
             }
 
-            km_filter.update(box, mean_, covariance_);
             last_position_ = box;
             ++ hits_;
             time_since_update_ = 0;
@@ -741,10 +193,20 @@ namespace DeepSORT {
             }
         }
 
+        /* 特征由tracker的FeatureBank统一保存，update时会被覆盖与移动
+           第一次访问时复制一份，返回的Mat拥有自己的数据，使用者持有的拷贝在之后的update中仍然有效
+        */
         virtual const cv::Mat& feature_bucket() const override{
+            if (feature_bucket_dirty_) {
+                int count = features_ == nullptr ? 0 : features_->count(kalman_index_);
+                feature_bucket_ = count > 0 ? cv::Mat(count, features_->dim(), CV_32F, (void*)features_->bucket(kalman_index_)).clone() : cv::Mat();
+                feature_bucket_dirty_ = false;
+            }
             return feature_bucket_;
         }
 
+        void invalidate_feature_bucket() {feature_bucket_dirty_ = true;}
+
         virtual std::vector<cv::Point> trace_line() const {
             std::vector<cv::Point> line;
             const int Count = trace_.size();
@@ -769,25 +231,36 @@ namespace DeepSORT {
         int age_{1};
         int hits_{1};
         int id_;
-        int feature_cursor_ = 0;
         std::deque<Box> trace_;
-        cv::Mat feature_bucket_;
-        bool has_feature_ = false;
+        mutable cv::Mat feature_bucket_;
+        mutable bool feature_bucket_dirty_ = true;
 
         int nbuckets_ = 100;
         int max_age_ = 100;
         int nhit_ = 3;
 
         Box last_position_;
-        Eigen::Matrix<float, 8, 1> mean_;
-        Eigen::Matrix<float, 8, 8> covariance_;
+
+        // 卡尔曼状态由tracker统一保存
+        const KalmanBatch* kalman_ = nullptr;
+        int kalman_index_ = 0;
+        const FeatureBank* features_ = nullptr;
     };
 
+    static KalmanParameters make_kalman_parameters(const TrackerConfig& config){
+        KalmanParameters parameters;
+        memcpy(parameters.initiate_state, config.initiate_state, sizeof(parameters.initiate_state));
+        memcpy(parameters.per_frame_motion, config.per_frame_motion, sizeof(parameters.per_frame_motion));
+        memcpy(parameters.noise, config.noise, sizeof(parameters.noise));
+        return parameters;
+    }
+
     class TrackerImpl : public Tracker
     {
     public:
         TrackerImpl(const TrackerConfig& config)
-        :kalman_(config), 
+        :kalman_(make_kalman_parameters(config)), 
+        features_(config.nbuckets), 
         distance_threshold_(config.distance_threshold), 
         nbuckets_(config.nbuckets), 
         max_age_(config.max_age), 
@@ -807,8 +280,9 @@ namespace DeepSORT {
         }
 
         void predict() {
+            kalman_.predict();
             for (auto &obj : objects_) {
-                obj.predict(kalman_);
+                obj.predict();
             }
         }
 
@@ -816,6 +290,31 @@ namespace DeepSORT {
 
             predict();
 
+            int nboxes = boxes.size();
+            measures_.resize(nboxes * 4);
+            for (int i = 0; i < nboxes; ++i)
+                BBoxXYAH(boxes[i]).to_measure(measures_.data() + i * 4);
+
+            // 检测的特征归一化后连续存放
+            int dim = 0;
+            if (has_feature_ && nboxes > 0) {
+                dim = boxes[0].feature.cols;
+                for (auto &box : boxes) {
+                    if (box.feature.empty() || box.feature.cols != dim || (features_.dim() != 0 && features_.dim() != dim)) {
+                        fprintf(stderr, "Feature is empty or has a different size, ignore has_feature_ flag\n");
+                        has_feature_ = false;
+                        break;
+                    }
+                }
+            }
+
+            if (has_feature_ && nboxes > 0) {
+                detection_features_.resize(nboxes * dim);
+                for (int i = 0; i < nboxes; ++i)
+                    normalize_feature(boxes[i].feature.ptr<float>(0), dim, detection_features_.data() + i * dim);
+            }
+            this->build_candidates(boxes, dim);
+
             int level_max = max_age_;
             State states[2] = {State::Confirmed, State::Tentative};
             std::vector<int> unmatched_boxes_index, unmatched_objects_index;
@@ -873,7 +372,12 @@ namespace DeepSORT {
                     // update
                     int count = std::min<int>(match_objects_index.size(), match_boxes_index.size());
                     for (int i = 0; i < count; ++i) {
-                        objects_[match_objects_index[i]].update(kalman_, boxes[match_boxes_index[i]]);
+                        auto &obj = objects_[match_objects_index[i]];
+                        auto &box = boxes[match_boxes_index[i]];
+                        kalman_.update(obj.kalman_index(), measures_.data() + match_boxes_index[i] * 4);
+                        if (has_feature_)
+                            features_.push(obj.kalman_index(), detection_features_.data() + match_boxes_index[i] * dim);
+                        obj.update(box);
                     }
                 }
             }
@@ -882,82 +386,166 @@ namespace DeepSORT {
                 objects_[index].mark_missed();
             }
             for (auto index : unmatched_boxes_index) {
-                this->new_object(boxes[index]);
+                this->new_object(boxes[index], has_feature_ ? detection_features_.data() + index * dim : nullptr, dim);
             }
             std::vector<TrackObjectImpl> objects_tmp;
-            std::copy_if(objects_.begin(), objects_.end(), std::back_inserter(objects_tmp),
-                        [](const TrackObject &obj){return obj.state() != State::Deleted;}
-                        );
+            std::vector<int> keep_index;
+            for (int i = 0; i < objects_.size(); ++i) {
+                if (objects_[i].state() != State::Deleted) {
+                    keep_index.push_back(i);
+                    objects_tmp.push_back(objects_[i]);
+                    objects_tmp.back().set_kalman_index(keep_index.size() - 1);
+                }
+            }
+            kalman_.keep(keep_index);
+            features_.keep(keep_index);
             objects_ = objects_tmp;
+
+            for (auto &obj : objects_)
+                obj.invalidate_feature_bucket();
         }
 
-        void match(const std::vector<int> &objects_index, 
-                const std::vector<int> &boxes_index, 
-                const std::vector<Box> &boxes,
-                std::vector<int> &match_boxes_index,
-                std::vector<int> &match_objects_index) {
-            std::vector<std::vector<double>> cost_matrix_data;
-            for (auto obj_idx : objects_index) {
-                std::vector<double> cost_matrix_item;
-                for (auto box_idx : boxes_index) {
-                    auto &TrackObject = objects_[obj_idx];
-                    auto &box = boxes[box_idx];
-                    BBoxXYAH boxah(box);
-
-                    auto maha_distance = kalman_.ma_distance(
-                        TrackObject.get_mean(), TrackObject.get_covariance(),
-                        boxah, false
-                    );
+        /* 只有门限内的配对才可能匹配，马氏距离平方不超过门限时检测的中心一定在目标的门限矩形内
+           用网格索引找到包含检测中心的目标，只对这些配对计算马氏距离与代价，按目标保存
+        */
+        void build_candidates(const BBoxes& boxes, int dim) {
+
+            int nobjects = objects_.size();
+            int nboxes   = boxes.size();
+            const float gate = chi2inv95_2[3];
+            kalman_.factor();
 
-                    double cost_data = 0;
-                    if (maha_distance > chi2inv95_2[3]) {
+            // 门限外的配对代价为1e5，阈值更大时门限外的配对也可能匹配，需要所有配对
+            bool all_pairs = distance_threshold_ > 1e5f;
+            if (!all_pairs) {
+                gate_rects_.resize(nobjects * 4);
+                kalman_.gating_region(gate, gate_rects_.data());
+                grid_.build(gate_rects_.data(), nobjects);
+            }
+
+            pair_objects_.clear();
+            pair_boxes_.clear();
+            for (int j = 0; j < nboxes; ++j) {
+                const float* measure = measures_.data() + j * 4;
+                hits_.clear();
+                if (all_pairs) {
+                    for (int i = 0; i < nobjects; ++i)
+                        hits_.push_back(i);
+                } else {
+                    grid_.query(measure[0], measure[1], hits_);
+                }
+
+                for (int i : hits_) {
+                    if (all_pairs || kalman_.gating_distance(i, measure) <= gate) {
+                        pair_objects_.push_back(i);
+                        pair_boxes_.push_back(j);
+                    }
+                }
+            }
+
+            // 按目标计数排序，同一个目标的box序号递增
+            int npairs = pair_objects_.size();
+            candidate_offsets_.assign(nobjects + 1, 0);
+            for (int i : pair_objects_)
+                candidate_offsets_[i + 1]++;
+            for (int i = 0; i < nobjects; ++i)
+                candidate_offsets_[i + 1] += candidate_offsets_[i];
+
+            cursor_.assign(candidate_offsets_.begin(), candidate_offsets_.end() - 1);
+            candidate_boxes_.resize(npairs);
+            for (int p = 0; p < npairs; ++p)
+                candidate_boxes_[cursor_[pair_objects_[p]]++] = pair_boxes_[p];
+
+            // 配对较多时一次矩阵乘法求出所有外观代价，否则逐对计算
+            bool dense_appearance = has_feature_ && (long long)npairs * 4 > (long long)nobjects * nboxes;
+            if (dense_appearance) {
+                appearance_.resize(nobjects * nboxes);
+                features_.cosine_distance(detection_features_.data(), nboxes, appearance_.data());
+            }
+
+            candidate_costs_.resize(npairs);
+            for (int i = 0; i < nobjects; ++i) {
+                auto &TrackObject = objects_[i];
+                for (int it = candidate_offsets_[i]; it < candidate_offsets_[i + 1]; ++it) {
+                    int j = candidate_boxes_[it];
+                    float cost_data = 0;
+                    if (all_pairs && kalman_.gating_distance(i, measures_.data() + j * 4) > gate) {
                         cost_data = 1e5;
                     }
                     else {
                         if(has_feature_){
-                            cv::Mat scores   = TrackObject.feature_bucket() * box.feature.t();
-                            double max_score = 0;
-                            cv::minMaxLoc(scores, nullptr, &max_score);
-                            cost_data = 1 - max_score;
+                            cost_data = dense_appearance ? appearance_[i * nboxes + j] : features_.cosine_distance(i, detection_features_.data() + j * dim);
                         }else{
-                            cost_data = distance(TrackObject.last_position(), box);
+                            cost_data = distance(TrackObject.last_position(), boxes[j]);
                         }
                     }
-                    cost_matrix_item.push_back(cost_data);
+                    candidate_costs_[it] = cost_data;
                 }
-                cost_matrix_data.push_back(cost_matrix_item);
             }
+        }
 
-            HungarianAlgorithm HungAlgo;
-            std::vector<int> assignment;
-            double cost = HungAlgo.Solve(cost_matrix_data, assignment);
-        
-            for (int i = 0; i < assignment.size(); ++i) {
-                if (assignment[i] < 0) {
-                    continue;
-                }
+        void match(const std::vector<int> &objects_index, 
+                const std::vector<int> &boxes_index, 
+                const std::vector<Box> &boxes,
+                std::vector<int> &match_boxes_index,
+                std::vector<int> &match_objects_index) {
+
+            box_available_.assign(boxes.size(), 0);
+            for (int j : boxes_index)
+                box_available_[j] = 1;
+
+            // 超过阈值的配对不参与匹配，剩下的配对按连通分量分别求解
+            int nobjects = objects_index.size();
+            edges_.clear();
+            for (int i = 0; i < nobjects; ++i) {
                 int obj_index = objects_index[i];
-                int box_index = boxes_index[assignment[i]];
-                if (cost_matrix_data[i][assignment[i]] < distance_threshold_) {
-                    match_boxes_index.push_back(box_index);
-                    match_objects_index.push_back(obj_index);
+                for (int it = candidate_offsets_[obj_index]; it < candidate_offsets_[obj_index + 1]; ++it) {
+                    int j = candidate_boxes_[it];
+                    if (box_available_[j] && candidate_costs_[it] < distance_threshold_)
+                        edges_.push_back({i, j, candidate_costs_[it]});
+                }
+            }
+
+            assignment_.resize(nobjects);
+            assignment_solver_.solve(edges_.data(), edges_.size(), nobjects, boxes.size(), assignment_.data(), nullptr, distance_threshold_);
+
+            for (int i = 0; i < nobjects; ++i) {
+                if (assignment_[i] < 0) {
+                    continue;
                 }
+                match_boxes_index.push_back(assignment_[i]);
+                match_objects_index.push_back(objects_index[i]);
             }
         }
 
-        void new_object(const Box &box) {
-            Eigen::Matrix<float, 8, 1> mean;
-            Eigen::Matrix<float, 8, 8> covariance;
-            kalman_.initiate(BBoxXYAH(box), mean, covariance);
+        void new_object(const Box &box, const float* feature, int dim) {
+            float measure[4];
+            BBoxXYAH(box).to_measure(measure);
+            int kalman_index = kalman_.initiate(measure);
+            features_.add(feature, dim);
 
-            objects_.emplace_back(box, mean, covariance, id_next_, nbuckets_, max_age_, nhit_, has_feature_);
+            objects_.emplace_back(box, &kalman_, kalman_index, &features_, id_next_, nbuckets_, max_age_, nhit_);
             ++ id_next_;
         }
 
     private:
         int id_next_{1};
         std::vector<TrackObjectImpl> objects_;
-        KalmanFilter kalman_;
+        KalmanBatch kalman_;
+        FeatureBank features_;
+        std::vector<float> detection_features_;
+        std::vector<float> appearance_;
+        LinearAssignment::SparseAssignment assignment_solver_;
+        std::vector<LinearAssignment::Edge> edges_;
+        std::vector<int> assignment_;
+        std::vector<float> measures_;          // [nboxes, 4]
+
+        SpatialGrid grid_;
+        std::vector<float> gate_rects_;
+        std::vector<int> hits_, pair_objects_, pair_boxes_, cursor_;
+        std::vector<int> candidate_offsets_, candidate_boxes_;
+        std::vector<float> candidate_costs_;
+        std::vector<unsigned char> box_available_;
         float distance_threshold_ = 0;
         int nbuckets_ = 100;
         int max_age_ = 100;
@@ -73,6 +73,8 @@ public:
     virtual std::vector<cv::Point> trace_line() const = 0;
     virtual int trace_size() const = 0;
     virtual Box& location(int time_since_update=0) = 0;
+
+    // 最近的nbuckets个特征，每行一个，拥有自己的数据，update之后仍然可以持有；不能与update同时调用
     virtual const cv::Mat& feature_bucket() const = 0;
 };
 
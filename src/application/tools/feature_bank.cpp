@@ -0,0 +1,234 @@
+#include "feature_bank.hpp"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   include <immintrin.h>
+#   define FEATURE_BANK_AVX2
+#endif
+
+// 与对照实现使用相同的累加顺序，并且禁止乘加融合，结果才能逐位一致
+#if defined(__clang__)
+#   pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#   pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace DeepSORT {
+
+    void normalize_feature(const float* feature, int dim, float* output){
+
+        float sum = 0;
+        for(int i = 0; i < dim; ++i)
+            sum += feature[i] * feature[i];
+
+        float scale = sum > 0 ? 1.0f / std::sqrt(sum) : 0.0f;
+        for(int i = 0; i < dim; ++i)
+            output[i] = feature[i] * scale;
+    }
+
+    static void axpy4_scalar(float* const acc[4], const float* x, const float* c, int begin, int n){
+        for(int j = begin; j < n; ++j){
+            acc[0][j] += c[0] * x[j];
+            acc[1][j] += c[1] * x[j];
+            acc[2][j] += c[2] * x[j];
+            acc[3][j] += c[3] * x[j];
+        }
+    }
+
+    static void axpy_scalar(float* acc, const float* x, float c, int begin, int n){
+        for(int j = begin; j < n; ++j)
+            acc[j] += c * x[j];
+    }
+
+#ifdef FEATURE_BANK_AVX2
+    static bool support_avx2(){
+        static const bool support = __builtin_cpu_supports("avx2");
+        return support;
+    }
+
+    // 乘与加分开计算，与标量的结果一致，返回处理到的位置
+    __attribute__((target("avx2")))
+    static int axpy4_avx2(float* const acc[4], const float* x, const float* c, int n){
+        __m256 c0 = _mm256_set1_ps(c[0]), c1 = _mm256_set1_ps(c[1]);
+        __m256 c2 = _mm256_set1_ps(c[2]), c3 = _mm256_set1_ps(c[3]);
+        int j = 0;
+        for(; j + 8 <= n; j += 8){
+            __m256 v = _mm256_loadu_ps(x + j);
+            _mm256_storeu_ps(acc[0] + j, _mm256_add_ps(_mm256_loadu_ps(acc[0] + j), _mm256_mul_ps(c0, v)));
+            _mm256_storeu_ps(acc[1] + j, _mm256_add_ps(_mm256_loadu_ps(acc[1] + j), _mm256_mul_ps(c1, v)));
+            _mm256_storeu_ps(acc[2] + j, _mm256_add_ps(_mm256_loadu_ps(acc[2] + j), _mm256_mul_ps(c2, v)));
+            _mm256_storeu_ps(acc[3] + j, _mm256_add_ps(_mm256_loadu_ps(acc[3] + j), _mm256_mul_ps(c3, v)));
+        }
+        return j;
+    }
+
+    __attribute__((target("avx2")))
+    static int axpy_avx2(float* acc, const float* x, float c, int n){
+        __m256 c0 = _mm256_set1_ps(c);
+        int j = 0;
+        for(; j + 8 <= n; j += 8)
+            _mm256_storeu_ps(acc + j, _mm256_add_ps(_mm256_loadu_ps(acc + j), _mm256_mul_ps(c0, _mm256_loadu_ps(x + j))));
+        return j;
+    }
+#endif // FEATURE_BANK_AVX2
+
+    static void axpy4(float* const acc[4], const float* x, const float* c, int n){
+        int begin = 0;
+#ifdef FEATURE_BANK_AVX2
+        if(support_avx2())
+            begin = axpy4_avx2(acc, x, c, n);
+#endif
+        axpy4_scalar(acc, x, c, begin, n);
+    }
+
+    static void axpy(float* acc, const float* x, float c, int n){
+        int begin = 0;
+#ifdef FEATURE_BANK_AVX2
+        if(support_avx2())
+            begin = axpy_avx2(acc, x, c, n);
+#endif
+        axpy_scalar(acc, x, c, begin, n);
+    }
+
+    FeatureBank::FeatureBank(int nbuckets):nbuckets_(std::max(1, nbuckets)){
+    }
+
+    int FeatureBank::add(const float* feature, int dim){
+
+        if(dim_ == 0 && feature != nullptr)
+            dim_ = dim;
+
+        int index = size_++;
+        features_.resize((size_t)size_ * nbuckets_ * dim_);
+        counts_.push_back(0);
+        cursors_.push_back(0);
+        if(feature != nullptr)
+            push(index, feature);
+        return index;
+    }
+
+    void FeatureBank::push(int index, const float* feature){
+
+        if(dim_ == 0)
+            return;
+
+        // 第一个特征决定维度之前加入的目标没有预留空间
+        if(features_.size() != (size_t)size_ * nbuckets_ * dim_)
+            features_.resize((size_t)size_ * nbuckets_ * dim_);
+
+        int row = cursors_[index];
+        memcpy(features_.data() + ((size_t)index * nbuckets_ + row) * dim_, feature, sizeof(float) * dim_);
+        cursors_[index] = (row + 1) % nbuckets_;
+        counts_[index]  = std::min(counts_[index] + 1, nbuckets_);
+    }
+
+    void FeatureBank::keep(const std::vector<int>& indices){
+
+        size_t block = (size_t)nbuckets_ * dim_;
+        int count    = indices.size();
+        for(int i = 0; i < count; ++i){
+            int from = indices[i];
+            if(from != i && block > 0)
+                memmove(features_.data() + i * block, features_.data() + from * block, sizeof(float) * block);
+            counts_[i]  = counts_[from];
+            cursors_[i] = cursors_[from];
+        }
+
+        size_ = count;
+        features_.resize(size_ * block);
+        counts_.resize(size_);
+        cursors_.resize(size_);
+    }
+
+    /* 检测的特征转置为[dim, num]，对每个目标的特征行做axpy，结果是num个连续的内积
+       检测按BLOCK个分块，累加的结果留在L1中，每次同时处理4行特征，检测特征读一次用4次
+    */
+    void FeatureBank::cosine_distance(const float* features, int num, float* distances){
+
+        if(num == 0) return;
+
+        const int BLOCK = 256;
+        transposed_.resize((size_t)dim_ * num);
+        for(int j = 0; j < num; ++j)
+            for(int k = 0; k < dim_; ++k)
+                transposed_[(size_t)k * num + j] = features[(size_t)j * dim_ + k];
+
+        float acc[4][BLOCK];
+        float best[BLOCK];
+        float* const pacc[4] = {acc[0], acc[1], acc[2], acc[3]};
+        for(int i = 0; i < size_; ++i){
+
+            float* pdistance = distances + (size_t)i * num;
+            int nrows        = counts_[i];
+            if(nrows == 0 || dim_ == 0){
+                std::fill(pdistance, pdistance + num, 1.0f);
+                continue;
+            }
+
+            const float* pbucket = bucket(i);
+            for(int j0 = 0; j0 < num; j0 += BLOCK){
+                int n = std::min(BLOCK, num - j0);
+                std::fill(best, best + n, -std::numeric_limits<float>::infinity());
+
+                int row = 0;
+                for(; row + 4 <= nrows; row += 4){
+                    const float* b0 = pbucket + (size_t)row * dim_;
+                    const float* b1 = b0 + dim_;
+                    const float* b2 = b1 + dim_;
+                    const float* b3 = b2 + dim_;
+                    for(int r = 0; r < 4; ++r)
+                        std::fill(acc[r], acc[r] + n, 0.0f);
+
+                    for(int k = 0; k < dim_; ++k){
+                        float c[] = {b0[k], b1[k], b2[k], b3[k]};
+                        axpy4(pacc, transposed_.data() + (size_t)k * num + j0, c, n);
+                    }
+
+                    for(int j = 0; j < n; ++j)
+                        best[j] = std::max(best[j], std::max(std::max(acc[0][j], acc[1][j]), std::max(acc[2][j], acc[3][j])));
+                }
+
+                for(; row < nrows; ++row){
+                    const float* b0 = pbucket + (size_t)row * dim_;
+                    std::fill(acc[0], acc[0] + n, 0.0f);
+                    for(int k = 0; k < dim_; ++k)
+                        axpy(acc[0], transposed_.data() + (size_t)k * num + j0, b0[k], n);
+
+                    for(int j = 0; j < n; ++j)
+                        best[j] = std::max(best[j], acc[0][j]);
+                }
+
+                for(int j = 0; j < n; ++j)
+                    pdistance[j0 + j] = 1 - best[j];
+            }
+        }
+    }
+
+    float FeatureBank::cosine_distance(int index, const float* feature) const{
+
+        int nrows = counts_[index];
+        if(nrows == 0 || dim_ == 0)
+            return 1.0f;
+
+        const float* pbucket = bucket(index);
+        float best = -std::numeric_limits<float>::infinity();
+        for(int row = 0; row < nrows; ++row){
+            const float* prow = pbucket + (size_t)row * dim_;
+            float dot = 0;
+            for(int k = 0; k < dim_; ++k)
+                dot += prow[k] * feature[k];
+            best = std::max(best, dot);
+        }
+        return 1 - best;
+    }
+
+    void cosine_distance_reference(const FeatureBank& bank, const float* features, int num, float* distances){
+        for(int i = 0; i < bank.size(); ++i)
+            for(int j = 0; j < num; ++j)
+                distances[(size_t)i * num + j] = bank.cosine_distance(i, features + (size_t)j * bank.dim());
+    }
+
+}; // namespace DeepSORT
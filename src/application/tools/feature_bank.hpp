@@ -0,0 +1,59 @@
+#ifndef FEATURE_BANK_HPP
+#define FEATURE_BANK_HPP
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * DeepSORT的外观特征
+ * 所有目标的特征归一化后连续存放为[size, nbuckets, dim]，每个目标最多nbuckets个，写满后循环覆盖
+ * 外观代价由一次分块的矩阵乘法得到：所有检测的特征与所有目标的特征求内积，再对每个目标取最大值
+ **/
+namespace DeepSORT {
+
+    // 归一化为单位长度，长度为0时输出0
+    void normalize_feature(const float* feature, int dim, float* output);
+
+    class FeatureBank{
+    public:
+        FeatureBank(int nbuckets = 1);
+
+        int size() const{return size_;}
+        int dim() const{return dim_;}
+        int count(int index) const{return counts_[index];}
+
+        // 目标index的特征，[count(index), dim]
+        const float* bucket(int index) const{return features_.data() + (size_t)index * nbuckets_ * dim_;}
+
+        // 新目标放在最后，feature为归一化后的特征，为空时没有特征，返回序号
+        int add(const float* feature, int dim);
+
+        // 加入目标index的一个特征，feature为归一化后的特征
+        void push(int index, const float* feature);
+
+        // 按顺序只保留indices中的目标，indices必须递增
+        void keep(const std::vector<int>& indices);
+
+        /* 所有目标与所有检测的余弦距离，features为[num, dim]的归一化特征
+           distances为[size(), num]，每个元素为1 - 目标所有特征与检测特征内积的最大值，没有特征的目标为1
+        */
+        void cosine_distance(const float* features, int num, float* distances);
+
+        // 一个目标与一个检测的余弦距离，只有少数配对需要计算时使用，结果与上面完全一致
+        float cosine_distance(int index, const float* feature) const;
+
+    private:
+        int nbuckets_ = 1;
+        int dim_      = 0;
+        int size_     = 0;
+        std::vector<float> features_;
+        std::vector<int> counts_, cursors_;
+        std::vector<float> transposed_;
+    };
+
+    // 对照实现：逐个目标、逐个检测求内积，结果与FeatureBank::cosine_distance完全一致
+    void cosine_distance_reference(const FeatureBank& bank, const float* features, int num, float* distances);
+
+}; // namespace DeepSORT
+
+#endif // FEATURE_BANK_HPP
@@ -0,0 +1,314 @@
+#include "kalman_filter.hpp"
+#include <cmath>
+#include "Eigen/Cholesky"
+#include "Eigen/LU"
+
+namespace DeepSORT {
+
+    KalmanFilter::KalmanFilter(const KalmanParameters& parameters):parameters_(parameters) {
+        /* 匀速直线运动 */
+        motion_mat_ = Eigen::Matrix<float, 8, 8>::Identity(8, 8);
+        for (int i = 0; i < 4; ++i) {
+            motion_mat_(i, 4 + i) = 1;
+        }
+        update_mat_ = Eigen::Matrix<float, 4, 8>::Identity(4, 8);
+    }
+
+    void KalmanFilter::project(const Eigen::Matrix<float, 8, 1> &mean,
+                const Eigen::Matrix<float, 8, 8> &covariance,
+                Eigen::Matrix<float, 4, 1> &mean_ret,
+                Eigen::Matrix<float, 4, 4> &covariance_ret) {
+        Eigen::Matrix<float, 4, 1> std_vel;
+
+        /* 测量噪声标准差 */
+        std_vel <<  parameters_.noise[0] * mean(3, 0),
+                    parameters_.noise[1] * mean(3, 0),
+                    parameters_.noise[2],
+                    parameters_.noise[3] * mean(3, 0);
+        std_vel = std_vel.array().pow(2).matrix();
+        Eigen::Matrix<float, 4, 4> innovation_cov(std_vel.asDiagonal());
+
+        mean_ret = update_mat_ * mean;
+        covariance_ret = update_mat_ * covariance * update_mat_.transpose() + innovation_cov;
+    }
+
+    float KalmanFilter::ma_distance(const Eigen::Matrix<float, 8, 1> &mean,
+                    const Eigen::Matrix<float, 8, 8> &covariance,
+                    const float measure[4]) {
+        Eigen::Matrix<float, 4, 1> mean_ret;
+        Eigen::Matrix<float, 4, 4> covariance_ret;
+        this->project(mean, covariance, mean_ret, covariance_ret);
+
+        /* d^T * S^-1 * d = |L^-1 * d|^2，S = L * L^T */
+        Eigen::Matrix<float, 4, 1> matrix_boxah;
+        matrix_boxah << measure[0], measure[1], measure[2], measure[3];
+        Eigen::Matrix<float, 4, 1> d = matrix_boxah - mean_ret;
+        Eigen::LLT<Eigen::Matrix<float, 4, 4>> cholesky_factor(covariance_ret);
+        Eigen::Matrix<float, 4, 1> z = cholesky_factor.matrixL().solve(d);
+        return z.squaredNorm();
+    }
+
+    void KalmanFilter::predict(Eigen::Matrix<float, 8, 1> &mean,
+                Eigen::Matrix<float, 8, 8> &covariance) {
+        Eigen::Matrix<float, 8, 1> std_pos_vel;
+
+        /* 预测下一步所在位置，那么std_pos则是模型对下一步预测的标准差。可以认为是一帧运动了多少 */
+        const float* motion = parameters_.per_frame_motion;
+        std_pos_vel <<  motion[0] * mean(3, 0),
+                        motion[1] * mean(3, 0),
+                        motion[2],
+                        motion[3] * mean(3, 0),
+                        motion[4] * mean(3, 0),
+                        motion[5] * mean(3, 0),
+                        motion[6],
+                        motion[7] * mean(3, 0);
+        std_pos_vel = std_pos_vel.array().pow(2).matrix();
+        Eigen::Matrix<float, 8, 8> motion_cov(std_pos_vel.asDiagonal());
+
+        mean = motion_mat_ * mean;
+        covariance = motion_mat_ * covariance * motion_mat_.transpose() + motion_cov;
+    }
+
+    void KalmanFilter::update(const float measure[4],
+                Eigen::Matrix<float, 8, 1> &mean,
+                Eigen::Matrix<float, 8, 8> &covariance) {
+        Eigen::Matrix<float, 4, 1> mean_ret;
+        Eigen::Matrix<float, 4, 4> covariance_ret;
+        project(mean, covariance, mean_ret, covariance_ret);
+
+        Eigen::Matrix<float, 4, 4> cov_inv = covariance_ret.inverse();
+        Eigen::Matrix<float, 8, 4> kalman_gain = covariance * update_mat_.transpose() * cov_inv;
+
+        Eigen::Matrix<float, 4, 1> matrix_measure;
+        matrix_measure << measure[0], measure[1], measure[2], measure[3];
+        Eigen::Matrix<float, 4, 1> innovation = matrix_measure - mean_ret;
+
+        mean = mean + kalman_gain * innovation;
+        covariance = covariance - kalman_gain * update_mat_ * covariance;
+    }
+
+    void KalmanFilter::initiate(const float measure[4], Eigen::Matrix<float, 8, 1> &mean,
+                Eigen::Matrix<float, 8, 8> &covariance) {
+        float height = measure[3];
+        mean << measure[0], measure[1], measure[2], height, 0.0f, 0.0f, 0.0f, 0.0f;
+
+        /** 初始状态 **/
+        const float* initiate_state = parameters_.initiate_state;
+        Eigen::Matrix<float, 8, 1> std_val;
+        std_val << initiate_state[0] * height,
+                   initiate_state[1] * height,
+                   initiate_state[2],
+                   initiate_state[3] * height,
+                   initiate_state[4] * height,
+                   initiate_state[5] * height,
+                   initiate_state[6],
+                   initiate_state[7] * height;
+        covariance = Eigen::Matrix<float, 8, 8>(std_val.array().pow(2).matrix().asDiagonal());
+    }
+
+    // a与va的噪声与h无关
+    static bool scaled_by_height(int k){
+        return k != 2 && k != 6;
+    }
+
+    KalmanBatch::KalmanBatch(const KalmanParameters& parameters):parameters_(parameters), filter_(parameters){
+    }
+
+    int KalmanBatch::initiate(const float measure[4]){
+
+        float height = measure[3];
+        for(int k = 0; k < 8; ++k)
+            mean_[k].push_back(k < 4 ? measure[k] : 0.0f);
+
+        for(int row = 0; row < 8; ++row){
+            for(int col = 0; col < 8; ++col){
+                float value = 0;
+                if(row == col){
+                    float std = parameters_.initiate_state[row] * (scaled_by_height(row) ? height : 1.0f);
+                    value = std * std;
+                }
+                covariance_[row * 8 + col].push_back(value);
+            }
+        }
+        return size_++;
+    }
+
+    void KalmanBatch::keep(const std::vector<int>& indices){
+
+        int count = indices.size();
+        auto compact = [&](std::vector<float>& values){
+            for(int i = 0; i < count; ++i)
+                values[i] = values[indices[i]];
+            values.resize(count);
+        };
+
+        for(auto& item : mean_)       compact(item);
+        for(auto& item : covariance_) compact(item);
+        size_ = count;
+    }
+
+    static void add_to(float* dst, const float* src, int n){
+        for(int i = 0; i < n; ++i)
+            dst[i] += src[i];
+    }
+
+    /* F = [I I; 0 I]，F * P * F^T只是行与列的相加
+       每个分量在所有目标上连续存放，循环都可以向量化
+    */
+    void KalmanBatch::predict(){
+
+        int n = size_;
+        if(n == 0) return;
+
+        // F * P，前4行加上后4行
+        for(int row = 0; row < 4; ++row)
+            for(int col = 0; col < 8; ++col)
+                add_to(covariance_[row * 8 + col].data(), covariance_[(row + 4) * 8 + col].data(), n);
+
+        // (F * P) * F^T，前4列加上后4列
+        for(int row = 0; row < 8; ++row)
+            for(int col = 0; col < 4; ++col)
+                add_to(covariance_[row * 8 + col].data(), covariance_[row * 8 + col + 4].data(), n);
+
+        // 运动噪声由预测前的h决定
+        const float* height = mean_[3].data();
+        for(int k = 0; k < 8; ++k){
+            float* pvalue = covariance_[k * 8 + k].data();
+            float std = parameters_.per_frame_motion[k];
+            if(scaled_by_height(k)){
+                for(int i = 0; i < n; ++i){
+                    float value = std * height[i];
+                    pvalue[i] += value * value;
+                }
+            }else{
+                for(int i = 0; i < n; ++i)
+                    pvalue[i] += std * std;
+            }
+        }
+
+        for(int k = 0; k < 4; ++k)
+            add_to(mean_[k].data(), mean_[k + 4].data(), n);
+    }
+
+    /* S = H * P * H^T + R，即P的左上角4x4加上测量噪声，S = L * L^T
+       按l00, l10, l11, l20, l21, l22, l30, l31, l32, l33保存，对角线保存倒数
+    */
+    void KalmanBatch::factor(){
+
+        int n = size_;
+        for(auto& item : cholesky_)
+            item.resize(n);
+
+        const float* noise  = parameters_.noise;
+        const float* height = mean_[3].data();
+        auto P = [&](int row, int col){return covariance_[row * 8 + col].data();};
+        float* L[10];
+        for(int k = 0; k < 10; ++k)
+            L[k] = cholesky_[k].data();
+
+        for(int i = 0; i < n; ++i){
+            float h   = height[i];
+            float r0  = noise[0] * h, r1 = noise[1] * h, r3 = noise[3] * h;
+            float s00 = P(0, 0)[i] + r0 * r0;
+            float s11 = P(1, 1)[i] + r1 * r1;
+            float s22 = P(2, 2)[i] + noise[2] * noise[2];
+            float s33 = P(3, 3)[i] + r3 * r3;
+
+            float i00 = 1.0f / std::sqrt(s00);
+            float l10 = P(1, 0)[i] * i00;
+            float l20 = P(2, 0)[i] * i00;
+            float l30 = P(3, 0)[i] * i00;
+            float i11 = 1.0f / std::sqrt(s11 - l10 * l10);
+            float l21 = (P(2, 1)[i] - l20 * l10) * i11;
+            float l31 = (P(3, 1)[i] - l30 * l10) * i11;
+            float i22 = 1.0f / std::sqrt(s22 - l20 * l20 - l21 * l21);
+            float l32 = (P(3, 2)[i] - l30 * l20 - l31 * l21) * i22;
+            float i33 = 1.0f / std::sqrt(s33 - l30 * l30 - l31 * l31 - l32 * l32);
+
+            L[0][i] = i00;
+            L[1][i] = l10;  L[2][i] = i11;
+            L[3][i] = l20;  L[4][i] = l21;  L[5][i] = i22;
+            L[6][i] = l30;  L[7][i] = l31;  L[8][i] = l32;  L[9][i] = i33;
+        }
+    }
+
+    void KalmanBatch::gating_distance(const float* measures, int num_measures, float* distances){
+
+        factor();
+
+        const float* z0 = measures;
+        const float* z1 = measures + num_measures;
+        const float* z2 = measures + num_measures * 2;
+        const float* z3 = measures + num_measures * 3;
+        for(int i = 0; i < size_; ++i){
+            float m0  = mean_[0][i], m1 = mean_[1][i], m2 = mean_[2][i], m3 = mean_[3][i];
+            float i00 = cholesky_[0][i];
+            float l10 = cholesky_[1][i], i11 = cholesky_[2][i];
+            float l20 = cholesky_[3][i], l21 = cholesky_[4][i], i22 = cholesky_[5][i];
+            float l30 = cholesky_[6][i], l31 = cholesky_[7][i], l32 = cholesky_[8][i], i33 = cholesky_[9][i];
+
+            // 同一个目标的分解用于所有测量，前代求L^-1 * d
+            float* pdistance = distances + (size_t)i * num_measures;
+            for(int j = 0; j < num_measures; ++j){
+                float y0 = (z0[j] - m0) * i00;
+                float y1 = (z1[j] - m1 - l10 * y0) * i11;
+                float y2 = (z2[j] - m2 - l20 * y0 - l21 * y1) * i22;
+                float y3 = (z3[j] - m3 - l30 * y0 - l31 * y1 - l32 * y2) * i33;
+                pdistance[j] = y0 * y0 + y1 * y1 + y2 * y2 + y3 * y3;
+            }
+        }
+    }
+
+    float KalmanBatch::gating_distance(int index, const float measure[4]) const{
+
+        float i00 = cholesky_[0][index];
+        float l10 = cholesky_[1][index], i11 = cholesky_[2][index];
+        float l20 = cholesky_[3][index], l21 = cholesky_[4][index], i22 = cholesky_[5][index];
+        float l30 = cholesky_[6][index], l31 = cholesky_[7][index], l32 = cholesky_[8][index], i33 = cholesky_[9][index];
+
+        float y0 = (measure[0] - mean_[0][index]) * i00;
+        float y1 = (measure[1] - mean_[1][index] - l10 * y0) * i11;
+        float y2 = (measure[2] - mean_[2][index] - l20 * y0 - l21 * y1) * i22;
+        float y3 = (measure[3] - mean_[3][index] - l30 * y0 - l31 * y1 - l32 * y2) * i33;
+        return y0 * y0 + y1 * y1 + y2 * y2 + y3 * y3;
+    }
+
+    void KalmanBatch::gating_region(float threshold, float* rects) const{
+
+        const float* noise = parameters_.noise;
+        for(int i = 0; i < size_; ++i){
+            float h   = mean_[3][i];
+            float r0  = noise[0] * h, r1 = noise[1] * h;
+            float s00 = covariance_[0][i] + r0 * r0;
+            float s11 = covariance_[9][i] + r1 * r1;
+
+            // 多留1个像素，避免舍入误差漏掉边界上的测量
+            float half_width  = std::sqrt(threshold * s00) * 1.001f + 1.0f;
+            float half_height = std::sqrt(threshold * s11) * 1.001f + 1.0f;
+            float* rect = rects + i * 4;
+            rect[0] = mean_[0][i] - half_width;
+            rect[1] = mean_[1][i] - half_height;
+            rect[2] = mean_[0][i] + half_width;
+            rect[3] = mean_[1][i] + half_height;
+        }
+    }
+
+    void KalmanBatch::update(int index, const float measure[4]){
+
+        Eigen::Matrix<float, 8, 1> mean;
+        Eigen::Matrix<float, 8, 8> covariance;
+        for(int row = 0; row < 8; ++row){
+            mean(row, 0) = mean_[row][index];
+            for(int col = 0; col < 8; ++col)
+                covariance(row, col) = covariance_[row * 8 + col][index];
+        }
+
+        filter_.update(measure, mean, covariance);
+        for(int row = 0; row < 8; ++row){
+            mean_[row][index] = mean(row, 0);
+            for(int col = 0; col < 8; ++col)
+                covariance_[row * 8 + col][index] = covariance(row, col);
+        }
+    }
+
+}; // namespace DeepSORT
@@ -0,0 +1,101 @@
+#ifndef KALMAN_FILTER_HPP
+#define KALMAN_FILTER_HPP
+
+#include <vector>
+#include "Eigen/Core"
+
+/**
+ * DeepSORT的卡尔曼滤波，状态为(cx, cy, a, h, vcx, vcy, va, vh)，测量为(cx, cy, a, h)
+ * 运动模型为匀速直线运动，噪声的标准差与h成正比(a与va除外)
+ * KalmanBatch：所有目标的状态按分量连续存放(SoA)，predict与gating对所有目标一次完成
+ * KalmanFilter：单个目标的Eigen实现，作为对照
+ **/
+namespace DeepSORT {
+
+    struct KalmanParameters{
+        float initiate_state[8];        // 初始状态的标准差
+        float per_frame_motion[8];      // 每一帧运动量的标准差
+        float noise[4];                 // 测量噪声的标准差
+    };
+
+    class KalmanFilter
+    {
+    public:
+        KalmanFilter(const KalmanParameters& parameters);
+
+        void project(const Eigen::Matrix<float, 8, 1> &mean,
+                    const Eigen::Matrix<float, 8, 8> &covariance,
+                    Eigen::Matrix<float, 4, 1> &mean_ret,
+                    Eigen::Matrix<float, 4, 4> &covariance_ret);
+
+        // 马氏距离的平方
+        float ma_distance(const Eigen::Matrix<float, 8, 1> &mean,
+                        const Eigen::Matrix<float, 8, 8> &covariance,
+                        const float measure[4]);
+
+        void predict(Eigen::Matrix<float, 8, 1> &mean,
+                    Eigen::Matrix<float, 8, 8> &covariance);
+
+        void update(const float measure[4],
+                    Eigen::Matrix<float, 8, 1> &mean,
+                    Eigen::Matrix<float, 8, 8> &covariance);
+
+        void initiate(const float measure[4], Eigen::Matrix<float, 8, 1> &mean,
+                    Eigen::Matrix<float, 8, 8> &covariance);
+
+    private:
+        Eigen::Matrix<float, 8, 8> motion_mat_;
+        Eigen::Matrix<float, 4, 8> update_mat_;
+        KalmanParameters parameters_;
+    };
+
+    class KalmanBatch
+    {
+    public:
+        KalmanBatch(const KalmanParameters& parameters);
+
+        int size() const{return size_;}
+
+        // 新目标放在最后，返回序号
+        int initiate(const float measure[4]);
+
+        // 按顺序只保留indices中的目标，indices必须递增
+        void keep(const std::vector<int>& indices);
+
+        // 所有目标预测到下一帧
+        void predict();
+
+        /* 所有目标与所有测量的马氏距离平方，measures为[4, num_measures]，每个分量连续存放
+           distances为[size(), num_measures]，每个目标只做一次Cholesky分解
+        */
+        void gating_distance(const float* measures, int num_measures, float* distances);
+
+        // 投影到测量空间，缓存协方差的Cholesky分解，predict或update之后需要重新调用
+        void factor();
+
+        // 使用factor缓存的分解，一个目标与一个测量的马氏距离平方
+        float gating_distance(int index, const float measure[4]) const;
+
+        /* 马氏距离平方不超过threshold的测量，中心一定在这个矩形内
+           因为d^T * S^-1 * d >= dx^2 / Sxx，rects为[size(), 4]的(left, top, right, bottom)
+        */
+        void gating_region(float threshold, float* rects) const;
+
+        // 用测量更新一个目标
+        void update(int index, const float measure[4]);
+
+        float mean(int index, int k) const{return mean_[k][index];}
+        float covariance(int index, int row, int col) const{return covariance_[row * 8 + col][index];}
+
+    private:
+        KalmanParameters parameters_;
+        KalmanFilter filter_;       // 单个目标的更新
+        int size_ = 0;
+        std::vector<float> mean_[8];
+        std::vector<float> covariance_[64];
+        std::vector<float> cholesky_[10];
+    };
+
+}; // namespace DeepSORT
+
+#endif // KALMAN_FILTER_HPP
@@ -0,0 +1,660 @@
+#include "linear_assignment.hpp"
+#include <cmath>
+#include <cfloat>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+namespace LinearAssignment{
+
+    float JonkerVolgenant::solve(const float* cost, int rows, int cols, int* row_assignment, int* col_assignment, float cost_limit){
+
+        for(int i = 0; i < rows; ++i) row_assignment[i] = -1;
+        if(col_assignment){
+            for(int j = 0; j < cols; ++j) col_assignment[j] = -1;
+        }
+
+        if(rows == 0 || cols == 0)
+            return 0;
+
+        // 行数多于列数时转置，保证每一行都能找到列
+        bool transpose = rows > cols;
+        bool limited   = cost_limit != std::numeric_limits<float>::infinity();
+        int num_real   = transpose ? rows : cols;
+        nrows_ = transpose ? cols : rows;
+        ncols_ = num_real + (limited ? nrows_ : 0);
+
+        /* 有上限时，不匹配的行与列各付出cost_limit / 2，由于行数不超过列数，
+           不匹配的列数 = 列数 - 行数 + 不匹配的行数，因此等价于每个不匹配的行付出cost_limit，
+           只需要为每一行补充一个代价为cost_limit的虚拟列
+        */
+        matrix_.resize((size_t)nrows_ * ncols_);
+        for(int i = 0; i < nrows_; ++i){
+            float* prow = matrix_.data() + (size_t)i * ncols_;
+            if(transpose){
+                for(int j = 0; j < num_real; ++j)
+                    prow[j] = cost[(size_t)j * cols + i];
+            }else{
+                memcpy(prow, cost + (size_t)i * cols, sizeof(float) * num_real);
+            }
+
+            for(int j = num_real; j < ncols_; ++j)
+                prow[j] = cost_limit;
+        }
+
+        u_.assign(nrows_, 0);
+        v_.assign(ncols_, 0);
+        col4row_.assign(nrows_, -1);
+        row4col_.assign(ncols_, -1);
+        path_.assign(ncols_, -1);
+        shortest_.resize(ncols_);
+        remaining_.resize(ncols_);
+        visited_rows_.resize(nrows_);
+        visited_cols_.resize(ncols_);
+
+        for(int row = 0; row < nrows_; ++row){
+
+            double min_value = 0;
+            int sink = augmenting_path(row, min_value);
+
+            // 只有代价为无穷大时才会找不到，这一行保持不匹配，对偶变量没有修改，不影响其他行
+            if(sink < 0)
+                continue;
+
+            // 更新对偶变量，保证约化代价非负
+            u_[row] += min_value;
+            for(int i = 0; i < nrows_; ++i){
+                if(visited_rows_[i] && i != row)
+                    u_[i] += min_value - shortest_[col4row_[i]];
+            }
+
+            for(int j = 0; j < ncols_; ++j){
+                if(visited_cols_[j])
+                    v_[j] -= min_value - shortest_[j];
+            }
+
+            // 沿增广路翻转匹配
+            int j = sink;
+            while(true){
+                int i = path_[j];
+                row4col_[j] = i;
+                std::swap(col4row_[i], j);
+                if(i == row) break;
+            }
+        }
+
+        float total = 0;
+        for(int i = 0; i < nrows_; ++i){
+            int j = col4row_[i];
+            if(j < 0 || j >= num_real)
+                continue;
+
+            float value = matrix_[(size_t)i * ncols_ + j];
+            if(limited && !(value < cost_limit))
+                continue;
+
+            int row = transpose ? j : i;
+            int col = transpose ? i : j;
+            row_assignment[row] = col;
+            if(col_assignment)
+                col_assignment[col] = row;
+            total += value;
+        }
+        return total;
+    }
+
+    int JonkerVolgenant::augmenting_path(int row, double& min_value){
+
+        const double inf = std::numeric_limits<double>::infinity();
+        int num_remaining = ncols_;
+        for(int it = 0; it < ncols_; ++it)
+            remaining_[it] = ncols_ - it - 1;
+
+        std::fill(visited_rows_.begin(), visited_rows_.end(), 0);
+        std::fill(visited_cols_.begin(), visited_cols_.end(), 0);
+        std::fill(shortest_.begin(), shortest_.end(), inf);
+
+        // Dijkstra，每次取约化代价最小的列，相等时优先没有匹配的列
+        min_value = 0;
+        int sink  = -1;
+        int i     = row;
+        while(sink == -1){
+
+            visited_rows_[i] = 1;
+            int index     = -1;
+            double lowest = inf;
+            double ui     = u_[i];
+            const float* prow = matrix_.data() + (size_t)i * ncols_;
+            for(int it = 0; it < num_remaining; ++it){
+                int j = remaining_[it];
+                double r = min_value + prow[j] - ui - v_[j];
+                if(r < shortest_[j]){
+                    path_[j]     = i;
+                    shortest_[j] = r;
+                }
+
+                if(shortest_[j] < lowest || (shortest_[j] == lowest && row4col_[j] == -1)){
+                    lowest = shortest_[j];
+                    index  = it;
+                }
+            }
+
+            min_value = lowest;
+            if(index == -1 || min_value == inf)
+                return -1;
+
+            int j = remaining_[index];
+            if(row4col_[j] == -1)
+                sink = j;
+            else
+                i = row4col_[j];
+
+            visited_cols_[j]  = 1;
+            remaining_[index] = remaining_[--num_remaining];
+        }
+        return sink;
+    }
+
+    int SparseAssignment::find(int node){
+        while(parent_[node] != node){
+            parent_[node] = parent_[parent_[node]];
+            node = parent_[node];
+        }
+        return node;
+    }
+
+    float SparseAssignment::solve(
+        const Edge* edges, int num_edges, int rows, int cols,
+        int* row_assignment, int* col_assignment, float cost_limit
+    ){
+        for(int i = 0; i < rows; ++i) row_assignment[i] = -1;
+        if(col_assignment){
+            for(int j = 0; j < cols; ++j) col_assignment[j] = -1;
+        }
+
+        // 行为[0, rows)，列为[rows, rows + cols)，按可以匹配的配对合并
+        int num_nodes = rows + cols;
+        parent_.resize(num_nodes);
+        for(int i = 0; i < num_nodes; ++i)
+            parent_[i] = i;
+
+        for(int i = 0; i < num_edges; ++i){
+            const Edge& edge = edges[i];
+            if(!(edge.cost < cost_limit)) continue;
+
+            int a = find(edge.row), b = find(rows + edge.col);
+            if(a != b) parent_[a] = b;
+        }
+
+        // 按连通分量对配对计数排序
+        component_.assign(num_nodes, -1);
+        offsets_.assign(1, 0);
+        int num_components = 0;
+        for(int i = 0; i < num_edges; ++i){
+            if(!(edges[i].cost < cost_limit)) continue;
+
+            int root = find(edges[i].row);
+            if(component_[root] == -1){
+                component_[root] = num_components++;
+                offsets_.push_back(0);
+            }
+            offsets_[component_[root] + 1]++;
+        }
+
+        for(int i = 0; i < num_components; ++i)
+            offsets_[i + 1] += offsets_[i];
+
+        order_.resize(offsets_[num_components]);
+        cursor_.assign(offsets_.begin(), offsets_.end() - 1);
+        for(int i = 0; i < num_edges; ++i){
+            if(!(edges[i].cost < cost_limit)) continue;
+            order_[cursor_[component_[find(edges[i].row)]]++] = i;
+        }
+
+        float total = 0;
+        local_.assign(num_nodes, -1);
+        for(int c = 0; c < num_components; ++c){
+
+            int begin = offsets_[c], end = offsets_[c + 1];
+            if(end - begin == 1){
+                const Edge& edge = edges[order_[begin]];
+                row_assignment[edge.row] = edge.col;
+                if(col_assignment) col_assignment[edge.col] = edge.row;
+                total += edge.cost;
+                continue;
+            }
+
+            // 分量内的行列重新编号，组成小的稠密矩阵，没有配对的位置为无穷大
+            component_rows_.clear();
+            component_cols_.clear();
+            for(int it = begin; it < end; ++it){
+                const Edge& edge = edges[order_[it]];
+                if(local_[edge.row] == -1){
+                    local_[edge.row] = component_rows_.size();
+                    component_rows_.push_back(edge.row);
+                }
+                if(local_[rows + edge.col] == -1){
+                    local_[rows + edge.col] = component_cols_.size();
+                    component_cols_.push_back(edge.col);
+                }
+            }
+
+            int nrows = component_rows_.size();
+            int ncols = component_cols_.size();
+            matrix_.assign((size_t)nrows * ncols, std::numeric_limits<float>::infinity());
+            for(int it = begin; it < end; ++it){
+                const Edge& edge = edges[order_[it]];
+                float& value = matrix_[(size_t)local_[edge.row] * ncols + local_[rows + edge.col]];
+                value = std::min(value, edge.cost);
+            }
+
+            row_assignment_.resize(nrows);
+            total += solver_.solve(matrix_.data(), nrows, ncols, row_assignment_.data(), nullptr, cost_limit);
+            for(int i = 0; i < nrows; ++i){
+                int row = component_rows_[i];
+                local_[row] = -1;
+                if(row_assignment_[i] < 0) continue;
+
+                int col = component_cols_[row_assignment_[i]];
+                row_assignment[row] = col;
+                if(col_assignment) col_assignment[col] = row;
+            }
+
+            for(int col : component_cols_)
+                local_[rows + col] = -1;
+        }
+        return total;
+    }
+
+    class HungarianAlgorithm
+    {
+    public:
+        enum TMethod
+        {
+            optimal,
+            many_forbidden_assignments,
+            without_forbidden_assignments
+        };
+
+    public:
+        HungarianAlgorithm(){}
+        ~HungarianAlgorithm(){}
+
+        double Solve(std::vector<std::vector<double> >& DistMatrix, std::vector<int>& Assignment)
+        {
+            unsigned int nRows = DistMatrix.size();
+            unsigned int nCols = DistMatrix[0].size();
+
+            std::vector<double> distMatrixIn(nRows * nCols);
+            std::vector<int> assignment(nRows);
+            double cost = 0.0;
+
+            for (unsigned int i = 0; i < nRows; i++)
+                for (unsigned int j = 0; j < nCols; j++)
+                    distMatrixIn[i + nRows * j] = DistMatrix[i][j];
+            
+            // call solving function
+            assignmentoptimal(assignment.data(), &cost, distMatrixIn.data(), nRows, nCols);
+
+            Assignment.clear();
+            for (unsigned int r = 0; r < nRows; r++)
+                Assignment.push_back(assignment[r]);
+
+            return cost;
+        }
+
+    private:
+        void assignmentoptimal(int *assignment, double *cost, double *distMatrixIn, int nOfRows, int nOfColumns)
+        {
+            double *distMatrix, *distMatrixTemp, *distMatrixEnd, *columnEnd, value, minValue;
+            bool *coveredColumns, *coveredRows, *starMatrix, *newStarMatrix, *primeMatrix;
+            int nOfElements, minDim, row, col;
+
+            /* initialization */
+            *cost = 0;
+            for (row = 0; row<nOfRows; row++)
+                assignment[row] = -1;
+
+            /* generate working copy of distance Matrix */
+            /* check if all matrix elements are positive */
+            nOfElements = nOfRows * nOfColumns;
+            distMatrix = (double *)malloc(nOfElements * sizeof(double));
+            distMatrixEnd = distMatrix + nOfElements;
+
+            for (row = 0; row<nOfElements; row++)
+            {
+                value = distMatrixIn[row];
+                if (value < 0)
+                    std::cerr << "All matrix elements have to be non-negative." << std::endl;
+                distMatrix[row] = value;
+            }
+
+
+            /* memory allocation */
+            coveredColumns = (bool *)calloc(nOfColumns, sizeof(bool));
+            coveredRows = (bool *)calloc(nOfRows, sizeof(bool));
+            starMatrix = (bool *)calloc(nOfElements, sizeof(bool));
+            primeMatrix = (bool *)calloc(nOfElements, sizeof(bool));
+            newStarMatrix = (bool *)calloc(nOfElements, sizeof(bool)); /* used in step4 */
+
+            /* preliminary steps */
+            if (nOfRows <= nOfColumns)
+            {
+                minDim = nOfRows;
+
+                for (row = 0; row<nOfRows; row++)
+                {
+                    /* find the smallest element in the row */
+                    distMatrixTemp = distMatrix + row;
+                    minValue = *distMatrixTemp;
+                    distMatrixTemp += nOfRows;
+                    while (distMatrixTemp < distMatrixEnd)
+                    {
+                        value = *distMatrixTemp;
+                        if (value < minValue)
+                            minValue = value;
+                        distMatrixTemp += nOfRows;
+                    }
+
+                    /* subtract the smallest element from each element of the row */
+                    distMatrixTemp = distMatrix + row;
+                    while (distMatrixTemp < distMatrixEnd)
+                    {
+                        *distMatrixTemp -= minValue;
+                        distMatrixTemp += nOfRows;
+                    }
+                }
+
+                /* Steps 1 and 2a */
+                for (row = 0; row<nOfRows; row++)
+                    for (col = 0; col<nOfColumns; col++)
+                        if (fabs(distMatrix[row + nOfRows*col]) < DBL_EPSILON)
+                            if (!coveredColumns[col])
+                            {
+                                starMatrix[row + nOfRows*col] = true;
+                                coveredColumns[col] = true;
+                                break;
+                            }
+            }
+            else /* if(nOfRows > nOfColumns) */
+            {
+                minDim = nOfColumns;
+
+                for (col = 0; col<nOfColumns; col++)
+                {
+                    /* find the smallest element in the column */
+                    distMatrixTemp = distMatrix + nOfRows*col;
+                    columnEnd = distMatrixTemp + nOfRows;
+
+                    minValue = *distMatrixTemp++;
+                    while (distMatrixTemp < columnEnd)
+                    {
+                        value = *distMatrixTemp++;
+                        if (value < minValue)
+                            minValue = value;
+                    }
+
+                    /* subtract the smallest element from each element of the column */
+                    distMatrixTemp = distMatrix + nOfRows*col;
+                    while (distMatrixTemp < columnEnd)
+                        *distMatrixTemp++ -= minValue;
+                }
+
+                /* Steps 1 and 2a */
+                for (col = 0; col<nOfColumns; col++)
+                    for (row = 0; row<nOfRows; row++)
+                        if (fabs(distMatrix[row + nOfRows*col]) < DBL_EPSILON)
+                            if (!coveredRows[row])
+                            {
+                                starMatrix[row + nOfRows*col] = true;
+                                coveredColumns[col] = true;
+                                coveredRows[row] = true;
+                                break;
+                            }
+                for (row = 0; row<nOfRows; row++)
+                    coveredRows[row] = false;
+
+            }
+
+            /* move to step 2b */
+            step2b(assignment, distMatrix, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, minDim);
+
+            /* compute cost and remove invalid assignments */
+            computeassignmentcost(assignment, cost, distMatrixIn, nOfRows);
+
+            /* free allocated memory */
+            free(distMatrix);
+            free(coveredColumns);
+            free(coveredRows);
+            free(starMatrix);
+            free(primeMatrix);
+            free(newStarMatrix);
+
+            return;
+        }
+
+        void buildassignmentvector(int *assignment, bool *starMatrix, int nOfRows, int nOfColumns)
+        {
+            int row, col;
+
+            for (row = 0; row<nOfRows; row++)
+                for (col = 0; col<nOfColumns; col++)
+                    if (starMatrix[row + nOfRows*col])
+                    {
+        #ifdef ONE_INDEXING
+                        assignment[row] = col + 1; /* MATLAB-Indexing */
+        #else
+                        assignment[row] = col;
+        #endif
+                        break;
+                    }
+        }
+
+        void computeassignmentcost(int *assignment, double *cost, double *distMatrix, int nOfRows)
+        {
+            int row, col;
+
+            for (row = 0; row<nOfRows; row++)
+            {
+                col = assignment[row];
+                if (col >= 0)
+                    *cost += distMatrix[row + nOfRows*col];
+            }
+        }
+
+        void step2a(int *assignment, double *distMatrix, bool *starMatrix, bool *newStarMatrix, bool *primeMatrix, bool *coveredColumns, bool *coveredRows, int nOfRows, int nOfColumns, int minDim)
+        {
+            bool *starMatrixTemp, *columnEnd;
+            int col;
+
+            /* cover every column containing a starred zero */
+            for (col = 0; col<nOfColumns; col++)
+            {
+                starMatrixTemp = starMatrix + nOfRows*col;
+                columnEnd = starMatrixTemp + nOfRows;
+                while (starMatrixTemp < columnEnd){
+                    if (*starMatrixTemp++)
+                    {
+                        coveredColumns[col] = true;
+                        break;
+                    }
+                }
+            }
+
+            /* move to step 3 */
+            step2b(assignment, distMatrix, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, minDim);
+        }
+
+        void step2b(int *assignment, double *distMatrix, bool *starMatrix, bool *newStarMatrix, bool *primeMatrix, bool *coveredColumns, bool *coveredRows, int nOfRows, int nOfColumns, int minDim)
+        {
+            int col, nOfCoveredColumns;
+
+            /* count covered columns */
+            nOfCoveredColumns = 0;
+            for (col = 0; col<nOfColumns; col++)
+                if (coveredColumns[col])
+                    nOfCoveredColumns++;
+
+            if (nOfCoveredColumns == minDim)
+            {
+                /* algorithm finished */
+                buildassignmentvector(assignment, starMatrix, nOfRows, nOfColumns);
+            }
+            else
+            {
+                /* move to step 3 */
+                step3(assignment, distMatrix, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, minDim);
+            }
+
+        }
+
+        void step3(int *assignment, double *distMatrix, bool *starMatrix, bool *newStarMatrix, bool *primeMatrix, bool *coveredColumns, bool *coveredRows, int nOfRows, int nOfColumns, int minDim)
+        {
+            bool zerosFound;
+            int row, col, starCol;
+
+            zerosFound = true;
+            while (zerosFound)
+            {
+                zerosFound = false;
+                for (col = 0; col<nOfColumns; col++)
+                    if (!coveredColumns[col])
+                        for (row = 0; row<nOfRows; row++)
+                            if ((!coveredRows[row]) && (fabs(distMatrix[row + nOfRows*col]) < DBL_EPSILON))
+                            {
+                                /* prime zero */
+                                primeMatrix[row + nOfRows*col] = true;
+
+                                /* find starred zero in current row */
+                                for (starCol = 0; starCol<nOfColumns; starCol++)
+                                    if (starMatrix[row + nOfRows*starCol])
+                                        break;
+
+                                if (starCol == nOfColumns) /* no starred zero found */
+                                {
+                                    /* move to step 4 */
+                                    step4(assignment, distMatrix, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, minDim, row, col);
+                                    return;
+                                }
+                                else
+                                {
+                                    coveredRows[row] = true;
+                                    coveredColumns[starCol] = false;
+                                    zerosFound = true;
+                                    break;
+                                }
+                            }
+            }
+
+            /* move to step 5 */
+            step5(assignment, distMatrix, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, minDim);
+        }
+
+        void step4(int *assignment, double *distMatrix, bool *starMatrix, bool *newStarMatrix, bool *primeMatrix, bool *coveredColumns, bool *coveredRows, int nOfRows, int nOfColumns, int minDim, int row, int col)
+        {
+            int n, starRow, starCol, primeRow, primeCol;
+            int nOfElements = nOfRows*nOfColumns;
+
+            /* generate temporary copy of starMatrix */
+            for (n = 0; n<nOfElements; n++)
+                newStarMatrix[n] = starMatrix[n];
+
+            /* star current zero */
+            newStarMatrix[row + nOfRows*col] = true;
+
+            /* find starred zero in current column */
+            starCol = col;
+            for (starRow = 0; starRow<nOfRows; starRow++)
+                if (starMatrix[starRow + nOfRows*starCol])
+                    break;
+
+            while (starRow<nOfRows)
+            {
+                /* unstar the starred zero */
+                newStarMatrix[starRow + nOfRows*starCol] = false;
+
+                /* find primed zero in current row */
+                primeRow = starRow;
+                for (primeCol = 0; primeCol<nOfColumns; primeCol++)
+                    if (primeMatrix[primeRow + nOfRows*primeCol])
+                        break;
+
+                /* star the primed zero */
+                newStarMatrix[primeRow + nOfRows*primeCol] = true;
+
+                /* find starred zero in current column */
+                starCol = primeCol;
+                for (starRow = 0; starRow<nOfRows; starRow++)
+                    if (starMatrix[starRow + nOfRows*starCol])
+                        break;
+            }
+
+            /* use temporary copy as new starMatrix */
+            /* delete all primes, uncover all rows */
+            for (n = 0; n<nOfElements; n++)
+            {
+                primeMatrix[n] = false;
+                starMatrix[n] = newStarMatrix[n];
+            }
+            for (n = 0; n<nOfRows; n++)
+                coveredRows[n] = false;
+
+            /* move to step 2a */
+            step2a(assignment, distMatrix, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, minDim);
+        }
+
+        void step5(int *assignment, double *distMatrix, bool *starMatrix, bool *newStarMatrix, bool *primeMatrix, bool *coveredColumns, bool *coveredRows, int nOfRows, int nOfColumns, int minDim)
+        {
+            double h, value;
+            int row, col;
+
+            /* find smallest uncovered element h */
+            h = DBL_MAX;
+            for (row = 0; row<nOfRows; row++)
+                if (!coveredRows[row])
+                    for (col = 0; col<nOfColumns; col++)
+                        if (!coveredColumns[col])
+                        {
+                            value = distMatrix[row + nOfRows*col];
+                            if (value < h)
+                                h = value;
+                        }
+
+            /* add h to each covered row */
+            for (row = 0; row<nOfRows; row++)
+                if (coveredRows[row])
+                    for (col = 0; col<nOfColumns; col++)
+                        distMatrix[row + nOfRows*col] += h;
+
+            /* subtract h from each uncovered column */
+            for (col = 0; col<nOfColumns; col++)
+                if (!coveredColumns[col])
+                    for (row = 0; row<nOfRows; row++)
+                        distMatrix[row + nOfRows*col] -= h;
+
+            /* move to step 3 */
+            step3(assignment, distMatrix, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, minDim);
+        }
+    };
+
+    double hungarian_reference(const float* cost, int rows, int cols, int* row_assignment){
+
+        for(int i = 0; i < rows; ++i) row_assignment[i] = -1;
+        if(rows == 0 || cols == 0)
+            return 0;
+
+        std::vector<std::vector<double>> cost_matrix(rows, std::vector<double>(cols));
+        for(int i = 0; i < rows; ++i)
+            for(int j = 0; j < cols; ++j)
+                cost_matrix[i][j] = cost[(size_t)i * cols + j];
+
+        HungarianAlgorithm solver;
+        std::vector<int> assignment;
+        double total = solver.Solve(cost_matrix, assignment);
+        for(int i = 0; i < rows; ++i)
+            row_assignment[i] = assignment[i];
+        return total;
+    }
+
+}; // namespace LinearAssignment
@@ -0,0 +1,75 @@
+#ifndef LINEAR_ASSIGNMENT_HPP
+#define LINEAR_ASSIGNMENT_HPP
+
+#include <vector>
+#include <limits>
+
+/**
+ * 线性指派(最小代价的二分图匹配)
+ * JonkerVolgenant：最短增广路(Jonker-Volgenant)，直接在连续的float代价矩阵上计算，
+ * 支持非方阵，以及代价上限(超过上限的配对不如不匹配)
+ * SparseAssignment：只有少数配对可以匹配时，按连通分量拆分为小的稠密问题
+ * hungarian_reference：原来DeepSORT使用的Munkres实现，作为对照与性能比较
+ **/
+namespace LinearAssignment{
+
+    class JonkerVolgenant{
+    public:
+        /* cost为行优先的[rows, cols]矩阵，row_assignment[i]为第i行匹配的列，没有匹配时为-1
+           col_assignment不为空时写入每列匹配的行
+           cost_limit为配对的代价上限：一对代价为c的配对只在c < cost_limit时才可能匹配，
+           等价于每个不匹配的行与列各付出cost_limit / 2的代价，求总代价最小
+           不设上限时匹配min(rows, cols)对，此时代价必须是有限值
+           返回匹配上的配对的代价之和
+        */
+        float solve(
+            const float* cost, int rows, int cols, int* row_assignment, int* col_assignment = nullptr,
+            float cost_limit = std::numeric_limits<float>::infinity()
+        );
+
+    private:
+        // 从行出发找到一条最短增广路，返回终点列
+        int augmenting_path(int row, double& min_value);
+
+    private:
+        // 工作矩阵[nrows_, ncols_]，行数不超过列数，有上限时在右侧补充nrows_个代价为上限的虚拟列
+        std::vector<float> matrix_;
+        std::vector<double> u_, v_, shortest_;
+        std::vector<int> path_, col4row_, row4col_, remaining_;
+        std::vector<unsigned char> visited_rows_, visited_cols_;
+        int nrows_ = 0;
+        int ncols_ = 0;
+    };
+
+    struct Edge{
+        int row, col;
+        float cost;
+    };
+
+    class SparseAssignment{
+    public:
+        /* 只有edges中代价小于cost_limit的配对可以匹配，其余的配对都视为无穷大，cost_limit必须是有限值
+           不同连通分量之间互不影响，分别求解后的结果与在整个[rows, cols]矩阵上求解一致
+           row_assignment、col_assignment与返回值的含义同JonkerVolgenant::solve
+        */
+        float solve(
+            const Edge* edges, int num_edges, int rows, int cols,
+            int* row_assignment, int* col_assignment, float cost_limit
+        );
+
+    private:
+        int find(int node);
+
+    private:
+        JonkerVolgenant solver_;
+        std::vector<int> parent_, component_, offsets_, cursor_, order_, local_;
+        std::vector<int> component_rows_, component_cols_, row_assignment_;
+        std::vector<float> matrix_;
+    };
+
+    // Munkres实现，row_assignment与返回值的含义同上，不支持代价上限
+    double hungarian_reference(const float* cost, int rows, int cols, int* row_assignment);
+
+}; // namespace LinearAssignment
+
+#endif // LINEAR_ASSIGNMENT_HPP
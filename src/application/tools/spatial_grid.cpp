@@ -0,0 +1,117 @@
+#include "spatial_grid.hpp"
+#include <cmath>
+#include <algorithm>
+
+namespace DeepSORT {
+
+    static bool valid_rect(const float* rect){
+        return rect[0] <= rect[2] && rect[1] <= rect[3] && std::isfinite(rect[0]) && std::isfinite(rect[1]) && std::isfinite(rect[2]) && std::isfinite(rect[3]);
+    }
+
+    void SpatialGrid::build(const float* rects, int num){
+
+        rects_ = rects;
+        cols_  = 0;
+        rows_  = 0;
+        offsets_.clear();
+        items_.clear();
+
+        float left = 0, top = 0, right = 0, bottom = 0;
+        float sum_width = 0, sum_height = 0;
+        int num_valid = 0;
+        for(int i = 0; i < num; ++i){
+            const float* rect = rects + i * 4;
+            if(!valid_rect(rect)) continue;
+
+            if(num_valid == 0){
+                left = rect[0]; top = rect[1]; right = rect[2]; bottom = rect[3];
+            }else{
+                left   = std::min(left, rect[0]);
+                top    = std::min(top, rect[1]);
+                right  = std::max(right, rect[2]);
+                bottom = std::max(bottom, rect[3]);
+            }
+            sum_width  += std::max(1.0f, rect[2] - rect[0]);
+            sum_height += std::max(1.0f, rect[3] - rect[1]);
+            num_valid++;
+        }
+
+        if(num_valid == 0)
+            return;
+
+        // 格子取矩形的平均大小，格子数量与矩形数量同阶
+        const int max_cells = 4 * num_valid + 64;
+        left_        = left;
+        top_         = top;
+        cell_width_  = sum_width / num_valid;
+        cell_height_ = sum_height / num_valid;
+        while(true){
+            cols_ = (int)((right - left) / cell_width_) + 1;
+            rows_ = (int)((bottom - top) / cell_height_) + 1;
+            if((long long)cols_ * rows_ <= max_cells) break;
+
+            cell_width_  *= 2;
+            cell_height_ *= 2;
+        }
+
+        // 先计数再填充，每个格子中的矩形按序号递增
+        int num_cells = cols_ * rows_;
+        offsets_.assign(num_cells + 1, 0);
+        for(int pass = 0; pass < 2; ++pass){
+            if(pass == 1){
+                for(int i = 0; i < num_cells; ++i)
+                    offsets_[i + 1] += offsets_[i];
+                items_.resize(offsets_[num_cells]);
+            }
+
+            std::vector<int> cursor;
+            if(pass == 1)
+                cursor.assign(offsets_.begin(), offsets_.end() - 1);
+
+            for(int i = 0; i < num; ++i){
+                const float* rect = rects + i * 4;
+                if(!valid_rect(rect)) continue;
+
+                int x0, y0, x1, y1;
+                cell_of(rect[0], rect[1], x0, y0);
+                cell_of(rect[2], rect[3], x1, y1);
+                for(int cy = y0; cy <= y1; ++cy){
+                    for(int cx = x0; cx <= x1; ++cx){
+                        int cell = cy * cols_ + cx;
+                        if(pass == 0)
+                            offsets_[cell + 1]++;
+                        else
+                            items_[cursor[cell]++] = i;
+                    }
+                }
+            }
+        }
+    }
+
+    bool SpatialGrid::cell_of(float x, float y, int& cx, int& cy) const{
+        float fx = (x - left_) / cell_width_;
+        float fy = (y - top_) / cell_height_;
+        bool inside = fx >= 0 && fy >= 0 && fx < cols_ && fy < rows_;
+        cx = std::max(0, std::min(cols_ - 1, (int)std::max(0.0f, std::min(fx, (float)cols_))));
+        cy = std::max(0, std::min(rows_ - 1, (int)std::max(0.0f, std::min(fy, (float)rows_))));
+        return inside;
+    }
+
+    void SpatialGrid::query(float x, float y, std::vector<int>& output) const{
+
+        if(cols_ == 0 || !(std::isfinite(x) && std::isfinite(y)))
+            return;
+
+        int cx, cy;
+        if(!cell_of(x, y, cx, cy))
+            return;
+
+        int cell = cy * cols_ + cx;
+        for(int it = offsets_[cell]; it < offsets_[cell + 1]; ++it){
+            const float* rect = rects_ + items_[it] * 4;
+            if(x >= rect[0] && x <= rect[2] && y >= rect[1] && y <= rect[3])
+                output.push_back(items_[it]);
+        }
+    }
+
+}; // namespace DeepSORT
@@ -0,0 +1,34 @@
+#ifndef SPATIAL_GRID_HPP
+#define SPATIAL_GRID_HPP
+
+#include <vector>
+
+/**
+ * 矩形的均匀网格索引，用于查询包含某个点的所有矩形
+ * 每个矩形登记到它覆盖的所有格子，格子的大小取矩形的平均大小，每个矩形只覆盖常数个格子
+ **/
+namespace DeepSORT {
+
+    class SpatialGrid{
+    public:
+        // rects为[num, 4]的(left, top, right, bottom)
+        void build(const float* rects, int num);
+
+        // 包含点(x, y)的矩形的序号，按序号递增追加到output
+        void query(float x, float y, std::vector<int>& output) const;
+
+    private:
+        bool cell_of(float x, float y, int& cx, int& cy) const;
+
+    private:
+        const float* rects_ = nullptr;
+        float left_ = 0, top_ = 0;
+        float cell_width_ = 1, cell_height_ = 1;
+        int cols_ = 0, rows_ = 0;
+        std::vector<int> offsets_;      // 每个格子的矩形在items_中的范围
+        std::vector<int> items_;
+    };
+
+}; // namespace DeepSORT
+
+#endif // SPATIAL_GRID_HPP
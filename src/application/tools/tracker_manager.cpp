@@ -0,0 +1,170 @@
+#include "tracker_manager.hpp"
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <algorithm>
+#include <common/ilogger.hpp>
+#include <common/thread_pool.hpp>
+
+namespace DeepSORT {
+
+    struct Stream{
+        std::shared_ptr<Tracker> tracker;
+        int worker = 0;
+
+        std::mutex lock;        // 保护latency与total_ms
+        StreamLatency latency;
+        double total_ms = 0;
+    };
+
+    // 一次update的完成计数
+    struct BatchState{
+        std::mutex lock;
+        std::condition_variable cv;
+        int remain = 0;
+    };
+
+    class TrackerManagerImpl : public TrackerManager{
+    public:
+        bool startup(const TrackerConfig& config, int num_workers){
+
+            config_ = config;
+            if(create_tracker(config_) == nullptr)
+                return false;
+
+            if(num_workers <= 0)
+                num_workers = std::max(1u, std::thread::hardware_concurrency());
+
+            // 每个工作线程是一个单线程的池，任务按提交顺序执行，保证stream的帧序
+            for(int i = 0; i < num_workers; ++i)
+                workers_.push_back(std::make_shared<ThreadPool>(1));
+            worker_load_.assign(num_workers, 0);
+            return true;
+        }
+
+        virtual void update(const std::vector<StreamBoxes>& batch) override{
+
+            if(batch.empty()) return;
+
+            int num_workers = workers_.size();
+            std::vector<std::vector<int>> shard_items(num_workers);
+            std::vector<std::shared_ptr<Stream>> streams(batch.size());
+            {
+                std::unique_lock<std::mutex> l(lock_);
+                for(int i = 0; i < batch.size(); ++i){
+                    streams[i] = get_or_create(batch[i].stream_id);
+                    shard_items[streams[i]->worker].push_back(i);
+                }
+            };
+
+            auto state    = std::make_shared<BatchState>();
+            state->remain = std::count_if(shard_items.begin(), shard_items.end(), [](const std::vector<int>& items){return !items.empty();});
+
+            // 等待全部完成后才返回，任务中可以直接引用batch与streams
+            double submit_time = iLogger::timestamp_now_float();
+            for(int worker = 0; worker < num_workers; ++worker){
+                if(shard_items[worker].empty()) continue;
+
+                const std::vector<int>* items = &shard_items[worker];
+                workers_[worker]->commit([&batch, &streams, items, state, submit_time](){
+                    for(int i : *items){
+                        auto& stream = streams[i];
+                        double t0    = iLogger::timestamp_now_float();
+                        stream->tracker->update(batch[i].boxes);
+                        double t1    = iLogger::timestamp_now_float();
+
+                        std::unique_lock<std::mutex> l(stream->lock);
+                        auto& latency = stream->latency;
+                        latency.frames++;
+                        latency.last_ms       = t1 - submit_time;
+                        latency.last_track_ms = t1 - t0;
+                        latency.max_ms        = std::max(latency.max_ms, latency.last_ms);
+                        stream->total_ms     += latency.last_ms;
+                        latency.average_ms    = stream->total_ms / latency.frames;
+                    }
+
+                    std::unique_lock<std::mutex> l(state->lock);
+                    if(--state->remain == 0)
+                        state->cv.notify_all();
+                });
+            }
+
+            std::unique_lock<std::mutex> l(state->lock);
+            state->cv.wait(l, [&](){return state->remain == 0;});
+        }
+
+        virtual std::vector<TrackObject*> get_objects(int stream_id) override{
+            auto stream = find(stream_id);
+            if(stream == nullptr) return {};
+            return stream->tracker->get_objects();
+        }
+
+        virtual bool remove_stream(int stream_id) override{
+            std::unique_lock<std::mutex> l(lock_);
+            auto iter = streams_.find(stream_id);
+            if(iter == streams_.end()) return false;
+
+            // 正在执行的任务持有stream的shared_ptr，执行完后才释放
+            worker_load_[iter->second->worker]--;
+            streams_.erase(iter);
+            return true;
+        }
+
+        virtual bool has_stream(int stream_id) override{
+            return find(stream_id) != nullptr;
+        }
+
+        virtual StreamLatency latency(int stream_id) override{
+            auto stream = find(stream_id);
+            if(stream == nullptr) return StreamLatency();
+
+            std::unique_lock<std::mutex> l(stream->lock);
+            return stream->latency;
+        }
+
+        virtual int num_streams() override{
+            std::unique_lock<std::mutex> l(lock_);
+            return streams_.size();
+        }
+
+        virtual int num_workers() override{
+            return workers_.size();
+        }
+
+    private:
+        std::shared_ptr<Stream> find(int stream_id){
+            std::unique_lock<std::mutex> l(lock_);
+            auto iter = streams_.find(stream_id);
+            return iter == streams_.end() ? nullptr : iter->second;
+        }
+
+        // 调用时需要持有lock_，新的stream分配到stream最少的工作线程
+        std::shared_ptr<Stream> get_or_create(int stream_id){
+            auto& stream = streams_[stream_id];
+            if(stream == nullptr){
+                stream          = std::make_shared<Stream>();
+                stream->tracker = create_tracker(config_);
+                stream->worker  = std::min_element(worker_load_.begin(), worker_load_.end()) - worker_load_.begin();
+                worker_load_[stream->worker]++;
+            }
+            return stream;
+        }
+
+    private:
+        TrackerConfig config_;
+        std::mutex lock_;
+        std::unordered_map<int, std::shared_ptr<Stream>> streams_;
+        std::vector<int> worker_load_;
+
+        // 最后声明，析构时最先停止工作线程，再释放stream
+        std::vector<std::shared_ptr<ThreadPool>> workers_;
+    };
+
+    std::shared_ptr<TrackerManager> create_tracker_manager(const TrackerConfig& config, int num_workers){
+        std::shared_ptr<TrackerManagerImpl> instance(new TrackerManagerImpl());
+        if(!instance->startup(config, num_workers))
+            instance.reset();
+        return instance;
+    }
+};
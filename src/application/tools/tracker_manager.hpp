@@ -0,0 +1,57 @@
+#ifndef TRACKER_MANAGER_HPP
+#define TRACKER_MANAGER_HPP
+
+#include <memory>
+#include <vector>
+#include "deepsort.hpp"
+
+/**
+ * 多路视频流的跟踪器管理
+ * 每个stream_id对应一个Tracker，stream在第一次出现时固定分配到负载最少的工作线程，
+ * 之后该stream的所有帧都在这个线程上按提交顺序执行，同一个stream不会被并发更新
+ **/
+namespace DeepSORT {
+
+struct StreamBoxes{
+    int stream_id = 0;
+    BBoxes boxes;
+
+    StreamBoxes() = default;
+    StreamBoxes(int stream_id, const BBoxes& boxes):stream_id(stream_id), boxes(boxes){}
+};
+
+// 时间单位为ms，latency为从update提交到该stream跟踪完成，包括在工作线程上的排队
+struct StreamLatency{
+    int frames          = 0;
+    float last_ms       = 0;
+    float average_ms    = 0;
+    float max_ms        = 0;
+    float last_track_ms = 0;    // 最近一帧Tracker::update本身的耗时
+};
+
+class TrackerManager{
+public:
+    /* 一批stream的检测结果，按stream分片到各自的工作线程并行跟踪，返回时全部执行完毕
+       同一批中同一个stream出现多次时按顺序逐帧更新，可以在多个线程中同时调用
+    */
+    virtual void update(const std::vector<StreamBoxes>& batch) = 0;
+
+    // 返回的指针在该stream下一次update或者remove之前有效，不能与该stream的update同时调用
+    virtual std::vector<TrackObject*> get_objects(int stream_id) = 0;
+
+    // stream不存在时返回false
+    virtual bool remove_stream(int stream_id) = 0;
+    virtual bool has_stream(int stream_id) = 0;
+    virtual StreamLatency latency(int stream_id) = 0;
+    virtual int num_streams() = 0;
+    virtual int num_workers() = 0;
+};
+
+// num_workers <= 0 时，使用std::thread::hardware_concurrency()
+std::shared_ptr<TrackerManager> create_tracker_manager(
+    const TrackerConfig& config = TrackerConfig(), int num_workers = 0
+);
+
+}
+
+#endif // TRACKER_MANAGER_HPP
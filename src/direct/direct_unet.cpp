@@ -3,6 +3,7 @@
 #include <infer/trt_infer.hpp>
 #include <common/preprocess_kernel.cuh>
 #include <common/ilogger.hpp>
+#include <common/segmentation.hpp>
 
 using namespace cv;
 using namespace std;
@@ -86,12 +87,7 @@ static tuple<cv::Mat, cv::Mat> post_process(shared_ptr<TRT::Tensor>& tensor, int
     float* pnet   = tensor->cpu<float>(ibatch);
     float* prob   = output_prob.ptr<float>(0);
     uint8_t* pidx = output_index.ptr<uint8_t>(0);
-
-    for(int k = 0; k < output_prob.cols * output_prob.rows; ++k, pnet+=num_class, ++prob, ++pidx){
-        int ic = std::max_element(pnet, pnet + num_class) - pnet;
-        *prob  = pnet[ic];
-        *pidx  = ic;
-    }
+    Segmentation::semantic_argmax(pnet, output_prob.cols * output_prob.rows, num_class, prob, pidx);
     return make_tuple(output_prob, output_index);
 }
 
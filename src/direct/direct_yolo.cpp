@@ -57,7 +57,7 @@ struct AffineMatrix{
 
 bool requires(const char* name);
 
-// code in application/app_yolo/yolo_decode.cu
+// code in application/app_yolo/yolo.cpp
 namespace Yolo{
     void decode_kernel_invoker(
         float* predict, int num_bboxes, int num_classes, float confidence_threshold, 
@@ -26,6 +26,9 @@ int direct_mae();
 int direct_classifier();
 int test_warpaffine();
 int test_yolo_map();
+int test_infer_controller();
+int test_yolo_postprocess();
+int test_tracker();
 
 int main(int argc, char** argv){
     
@@ -69,9 +72,15 @@ int main(int argc, char** argv){
     }else if(strcmp(method, "scrfd") == 0){
         app_scrfd();
     }else if(strcmp(method, "test_warpaffine") == 0){
-        test_warpaffine();
+        return test_warpaffine();
     }else if(strcmp(method, "test_yolo_map") == 0){
         test_yolo_map();
+    }else if(strcmp(method, "test_infer_controller") == 0){
+        return test_infer_controller();
+    }else if(strcmp(method, "test_yolo_postprocess") == 0){
+        return test_yolo_postprocess();
+    }else if(strcmp(method, "test_tracker") == 0){
+        return test_tracker();
     }else if(strcmp(method, "high_perf") == 0){
         app_high_performance();
     }else if(strcmp(method, "lesson") == 0){
@@ -0,0 +1,27 @@
+#include "box_decoder.cuh"
+
+// 各个应用使用的Head与box格式，新的Head在这里实例化后即可在.cpp中调用decode_gpu
+namespace BoxDecoder{
+
+#define INSTANTIATE_DECODER(Head)  \
+    template void decode_gpu<Head>(const Head&, int, float*, int, cudaStream_t);
+
+#define INSTANTIATE_FAST_NMS(Format)  \
+    template void fast_nms_gpu<Format>(float*, int, float, cudaStream_t);
+
+    INSTANTIATE_DECODER(YoloRowHead)
+    INSTANTIATE_DECODER(YoloRowHead80)
+    INSTANTIATE_DECODER(YoloV5FastHead)
+    INSTANTIATE_DECODER(YoloXFastHead)
+    INSTANTIATE_DECODER(YoloV8Head)
+    INSTANTIATE_DECODER(YoloV8Head80)
+    INSTANTIATE_DECODER(CenterNetHead)
+    INSTANTIATE_DECODER(RetinaFaceHead)
+    INSTANTIATE_DECODER(ScrfdHead)
+    INSTANTIATE_DECODER(DBFaceHead)
+
+    INSTANTIATE_FAST_NMS(ObjectBox)
+    INSTANTIATE_FAST_NMS(FaceBox)
+    INSTANTIATE_FAST_NMS(DBFaceBox)
+
+}; // namespace BoxDecoder
@@ -0,0 +1,57 @@
+#ifndef BOX_DECODER_CUH
+#define BOX_DECODER_CUH
+
+#include "box_decoder.hpp"
+#include "cuda_tools.hpp"
+
+// box_decoder.hpp中decode_gpu与fast_nms_gpu的定义，只在box_decoder.cu中包含并显式实例化
+namespace BoxDecoder{
+
+    template<class Head>
+    static __global__ void decode_kernel(Head head, int num_bboxes, float* parray, int max_objects){
+
+        int position = blockDim.x * blockIdx.x + threadIdx.x;
+        if(position >= num_bboxes) return;
+
+        typename Head::Candidate candidate;
+        if(!head.accept(position, candidate))
+            return;
+
+        int index = atomicAdd(parray, 1);
+        if(index >= max_objects)
+            return;
+
+        head.write(position, candidate, parray + 1 + index * Head::NUM_ELEMENT);
+    }
+
+    template<class Format>
+    static __global__ void fast_nms_kernel(float* bboxes, int max_objects, float threshold){
+
+        int position = (blockDim.x * blockIdx.x + threadIdx.x);
+        int count    = min((int)*bboxes, max_objects);
+        if(position >= count)
+            return;
+
+        if(fast_nms_suppressed<Format>(bboxes, count, position, threshold))
+            bboxes[1 + position * Format::NUM_ELEMENT + Format::KEEP_INDEX] = 0;  // 1=keep, 0=ignore
+    }
+
+    template<class Head>
+    void decode_gpu(const Head& head, int num_bboxes, float* parray, int max_objects, cudaStream_t stream){
+
+        auto grid  = CUDATools::grid_dims(num_bboxes);
+        auto block = CUDATools::block_dims(num_bboxes);
+        checkCudaKernel(decode_kernel<Head><<<grid, block, 0, stream>>>(head, num_bboxes, parray, max_objects));
+    }
+
+    template<class Format>
+    void fast_nms_gpu(float* parray, int max_objects, float threshold, cudaStream_t stream){
+
+        auto grid  = CUDATools::grid_dims(max_objects);
+        auto block = CUDATools::block_dims(max_objects);
+        checkCudaKernel(fast_nms_kernel<Format><<<grid, block, 0, stream>>>(parray, max_objects, threshold));
+    }
+
+}; // namespace BoxDecoder
+
+#endif // BOX_DECODER_CUH
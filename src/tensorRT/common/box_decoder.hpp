@@ -0,0 +1,636 @@
+#ifndef BOX_DECODER_HPP
+#define BOX_DECODER_HPP
+
+#include <cmath>
+#include <cuda_runtime.h>
+
+/**
+ * 各个模型共用的box解码与fast nms，同一份代码编译为CUDA kernel与CPU实现
+ * 模型之间的差异由Head描述，Head在编译期由张量布局(Layout)、类别数与anchor方案组合而成：
+ *   accept(position, candidate)       判断该位置是否输出box，并求出分数与类别
+ *   write(position, candidate, pout)  写出NUM_ELEMENT个float
+ * 输出格式为counter + boxes，每个box的前5个为left, top, right, bottom, confidence
+ * GPU实现见box_decoder.cuh，显式实例化在box_decoder.cu，新的Head需要在那里加一行
+ **/
+
+#if defined(__CUDACC__)
+#   define BOX_DECODER_FUNC __host__ __device__ inline
+#else
+#   define BOX_DECODER_FUNC inline
+#endif
+
+namespace BoxDecoder{
+
+    // 输出box的格式，LABEL_INDEX为-1时没有类别，fast nms不区分类别
+    template<int NumElement, int LabelIndex, int KeepIndex>
+    struct BoxFormat{
+        static const int NUM_ELEMENT = NumElement;
+        static const int LABEL_INDEX = LabelIndex;
+        static const int KEEP_INDEX  = KeepIndex;
+    };
+
+    typedef BoxFormat<7,  5, 6>  ObjectBox;     // left, top, right, bottom, confidence, class, keepflag
+    typedef BoxFormat<16, -1, 5> FaceBox;       // left, top, right, bottom, confidence, keepflag, 5 landmarks
+    typedef BoxFormat<17, 5, 6>  DBFaceBox;     // left, top, right, bottom, confidence, class, keepflag, 5 landmarks
+
+    BOX_DECODER_FUNC float sigmoid(float x){
+        return 1.0f / (1.0f + expf(-x));
+    }
+
+    BOX_DECODER_FUNC float desigmoid(float y){
+        return -logf(1.0f / y - 1.0f);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////
+    // 坐标变换，网络输入上的坐标映射回原图
+
+    // 2x3的仿射矩阵
+    struct AffineMatrix{
+        const float* m;
+
+        BOX_DECODER_FUNC AffineMatrix(const float* m = nullptr):m(m){}
+        BOX_DECODER_FUNC void project(float x, float y, float* ox, float* oy) const{
+            *ox = m[0] * x + m[1] * y + m[2];
+            *oy = m[3] * x + m[4] * y + m[5];
+        }
+    };
+
+    // 只有缩放与平移，m为scale, offset_x, offset_y
+    struct ScaleMatrix{
+        const float* m;
+
+        BOX_DECODER_FUNC ScaleMatrix(const float* m = nullptr):m(m){}
+        BOX_DECODER_FUNC void project(float x, float y, float* ox, float* oy) const{
+            *ox = m[0] * x + m[1];
+            *oy = m[0] * y + m[2];
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////
+    // 张量布局，item(position)为该位置第0个通道的地址，第c个通道为item[c * step()]
+
+    // [N, channels]，每个位置的通道连续
+    struct RowMajor{
+        const float* data;
+        int channels;
+
+        BOX_DECODER_FUNC RowMajor(const float* data = nullptr, int channels = 0):data(data), channels(channels){}
+        BOX_DECODER_FUNC const float* item(int position) const{return data + (size_t)channels * position;}
+        BOX_DECODER_FUNC int step() const{return 1;}
+    };
+
+    /* [anchors, channels, area]，每个通道连续，position = anchor * area + index
+       GPU上相邻线程读取同一通道的相邻元素，访问是合并的，不需要先转置为RowMajor
+    */
+    struct Planar{
+        const float* data;
+        int channels;
+        int area;
+
+        BOX_DECODER_FUNC Planar(const float* data = nullptr, int channels = 0, int area = 0):data(data), channels(channels), area(area){}
+        BOX_DECODER_FUNC const float* item(int position) const{
+            return data + (size_t)(position / area) * channels * area + position % area;
+        }
+        BOX_DECODER_FUNC int step() const{return area;}
+    };
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Yolo的anchor方案，把前4个通道解码为网络输入上的cx, cy, width, height
+    // LOGITS为true时分数为sigmoid之前的值
+
+    // 导出时已经解码(YoloV3/V5/V7/X的onnx)，输出即为cx, cy, width, height与概率
+    struct DecodedAnchor{
+        static const bool LOGITS = false;
+
+        BOX_DECODER_FUNC void box(const float* pitem, int step, int position, float& cx, float& cy, float& width, float& height) const{
+            cx     = pitem[step * 0];
+            cy     = pitem[step * 1];
+            width  = pitem[step * 2];
+            height = pitem[step * 3];
+        }
+    };
+
+    // YoloV5的原始输出，prior为每个位置的grid_x, grid_y, anchor_width, anchor_height, stride
+    struct YoloV5Anchor{
+        static const bool LOGITS = true;
+        const float* prior;
+
+        BOX_DECODER_FUNC YoloV5Anchor(const float* prior = nullptr):prior(prior){}
+        BOX_DECODER_FUNC void box(const float* pitem, int step, int position, float& cx, float& cy, float& width, float& height) const{
+            float predict_cx = sigmoid(pitem[step * 0]);
+            float predict_cy = sigmoid(pitem[step * 1]);
+            float predict_w  = sigmoid(pitem[step * 2]);
+            float predict_h  = sigmoid(pitem[step * 3]);
+
+            const float* prior_ptr = prior + position * 5;
+            float stride = prior_ptr[4];
+            cx     = (predict_cx * 2 - 0.5f + prior_ptr[0]) * stride;
+            cy     = (predict_cy * 2 - 0.5f + prior_ptr[1]) * stride;
+            width  = powf(predict_w * 2, 2.0f) * prior_ptr[2];
+            height = powf(predict_h * 2, 2.0f) * prior_ptr[3];
+        }
+    };
+
+    // YoloX的原始输出，prior为每个位置的grid_x, grid_y, stride
+    struct YoloXAnchor{
+        static const bool LOGITS = true;
+        const float* prior;
+
+        BOX_DECODER_FUNC YoloXAnchor(const float* prior = nullptr):prior(prior){}
+        BOX_DECODER_FUNC void box(const float* pitem, int step, int position, float& cx, float& cy, float& width, float& height) const{
+            const float* prior_ptr = prior + position * 3;
+            float stride = prior_ptr[2];
+            cx     = (pitem[step * 0] + prior_ptr[0]) * stride;
+            cy     = (pitem[step * 1] + prior_ptr[1]) * stride;
+            width  = expf(pitem[step * 2]) * stride;
+            height = expf(pitem[step * 3]) * stride;
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Heads
+
+    /* 通道为cx, cy, width, height, objectness, classes...的Yolo输出
+       NumClasses大于0时类别数在编译期确定，argmax的循环可以完全展开
+    */
+    template<class Layout, class Anchor, int NumClasses = 0, class Projection = AffineMatrix>
+    struct YoloHead : ObjectBox{
+        struct Candidate{
+            float confidence;
+            int label;
+        };
+
+        Layout layout;
+        Anchor anchor;
+        Projection matrix;
+        int num_classes;
+        float confidence_threshold;
+        float object_threshold;     // 与objectness比较的阈值，LOGITS时为desigmoid之后的值
+
+        YoloHead(const Layout& layout, const Anchor& anchor, const Projection& matrix, int num_classes, float confidence_threshold)
+        :layout(layout), anchor(anchor), matrix(matrix), num_classes(NumClasses > 0 ? NumClasses : num_classes),
+         confidence_threshold(confidence_threshold),
+         object_threshold(Anchor::LOGITS ? desigmoid(confidence_threshold) : confidence_threshold){}
+
+        BOX_DECODER_FUNC bool accept(int position, Candidate& candidate) const{
+
+            const float* pitem = layout.item(position);
+            int step           = layout.step();
+            float objectness   = pitem[step * 4];
+            if(objectness < object_threshold)
+                return false;
+
+            const int count  = NumClasses > 0 ? NumClasses : num_classes;
+            float confidence = pitem[step * 5];
+            int label        = 0;
+            for(int i = 1; i < count; ++i){
+                float class_confidence = pitem[step * (i + 5)];
+                if(class_confidence > confidence){
+                    confidence = class_confidence;
+                    label      = i;
+                }
+            }
+
+            if(Anchor::LOGITS){
+                confidence = sigmoid(confidence);
+                objectness = sigmoid(objectness);
+            }
+
+            confidence *= objectness;
+            if(confidence < confidence_threshold)
+                return false;
+
+            candidate.confidence = confidence;
+            candidate.label      = label;
+            return true;
+        }
+
+        BOX_DECODER_FUNC void write(int position, const Candidate& candidate, float* pout) const{
+
+            float cx, cy, width, height;
+            anchor.box(layout.item(position), layout.step(), position, cx, cy, width, height);
+
+            float left   = cx - width * 0.5f;
+            float top    = cy - height * 0.5f;
+            float right  = cx + width * 0.5f;
+            float bottom = cy + height * 0.5f;
+            matrix.project(left,  top,    &left,  &top);
+            matrix.project(right, bottom, &right, &bottom);
+
+            pout[0] = left;
+            pout[1] = top;
+            pout[2] = right;
+            pout[3] = bottom;
+            pout[4] = candidate.confidence;
+            pout[5] = candidate.label;
+            pout[6] = 1;    // 1 = keep, 0 = ignore
+        }
+    };
+
+    /* 通道为cx, cy, width, height, classes...的anchor free输出，没有objectness(YoloV8)
+       置信度为最大的类别分数
+    */
+    template<class Layout, int NumClasses = 0, class Projection = AffineMatrix>
+    struct AnchorFreeHead : ObjectBox{
+        struct Candidate{
+            float confidence;
+            int label;
+        };
+
+        Layout layout;
+        Projection matrix;
+        int num_classes;
+        float confidence_threshold;
+
+        AnchorFreeHead(const Layout& layout, const Projection& matrix, int num_classes, float confidence_threshold)
+        :layout(layout), matrix(matrix), num_classes(NumClasses > 0 ? NumClasses : num_classes), confidence_threshold(confidence_threshold){}
+
+        BOX_DECODER_FUNC bool accept(int position, Candidate& candidate) const{
+
+            const float* pitem = layout.item(position);
+            int step           = layout.step();
+            const int count    = NumClasses > 0 ? NumClasses : num_classes;
+            float confidence   = pitem[step * 4];
+            int label          = 0;
+            for(int i = 1; i < count; ++i){
+                float class_confidence = pitem[step * (i + 4)];
+                if(class_confidence > confidence){
+                    confidence = class_confidence;
+                    label      = i;
+                }
+            }
+
+            if(confidence < confidence_threshold)
+                return false;
+
+            candidate.confidence = confidence;
+            candidate.label      = label;
+            return true;
+        }
+
+        BOX_DECODER_FUNC void write(int position, const Candidate& candidate, float* pout) const{
+
+            float cx, cy, width, height;
+            DecodedAnchor().box(layout.item(position), layout.step(), position, cx, cy, width, height);
+
+            float left   = cx - width * 0.5f;
+            float top    = cy - height * 0.5f;
+            float right  = cx + width * 0.5f;
+            float bottom = cy + height * 0.5f;
+            matrix.project(left,  top,    &left,  &top);
+            matrix.project(right, bottom, &right, &bottom);
+
+            pout[0] = left;
+            pout[1] = top;
+            pout[2] = right;
+            pout[3] = bottom;
+            pout[4] = candidate.confidence;
+            pout[5] = candidate.label;
+            pout[6] = 1;    // 1 = keep, 0 = ignore
+        }
+    };
+
+    typedef YoloHead<RowMajor, DecodedAnchor>                    YoloRowHead;     // Yolo、YoloGPUPtr
+    typedef YoloHead<RowMajor, DecodedAnchor, 80>                YoloRowHead80;   // COCO的80类
+    typedef YoloHead<Planar, YoloV5Anchor, 0, ScaleMatrix>       YoloV5FastHead;  // YoloFast V5
+    typedef YoloHead<Planar, YoloXAnchor, 0, ScaleMatrix>        YoloXFastHead;   // YoloFast X
+    typedef AnchorFreeHead<Planar>                               YoloV8Head;      // [4 + C, N]的输出
+    typedef AnchorFreeHead<Planar, 80>                           YoloV8Head80;
+
+    /* CenterNet，每个位置的通道为reg_x, reg_y, width, height, heatmap[C], pooled_heatmap[C]
+       heatmap等于pooled_heatmap(局部最大值)且超过阈值的类别中取最大的
+    */
+    struct CenterNetHead : ObjectBox{
+        struct Candidate{
+            float confidence;
+            int label;
+        };
+
+        const float* predict;
+        int num_channels;
+        int num_classes;
+        int fm_width;
+        int stride;
+        float deconfidence_threshold;
+        AffineMatrix matrix;
+
+        CenterNetHead(const float* predict, int num_channels, int num_classes, int fm_width, int stride, float confidence_threshold, const float* invert_affine_matrix)
+        :predict(predict), num_channels(num_channels), num_classes(num_classes), fm_width(fm_width), stride(stride),
+         deconfidence_threshold(desigmoid(confidence_threshold)), matrix(invert_affine_matrix){}
+
+        BOX_DECODER_FUNC bool accept(int position, Candidate& candidate) const{
+
+            const float* pitem       = predict + (size_t)num_channels * position;
+            const float* hm_ptr      = pitem + 4;
+            const float* pool_hm_ptr = pitem + (num_classes + 4);
+            float max_conf = *hm_ptr;
+            int label      = 0;
+            bool has_obj   = false;
+            for(int i = 0; i < num_classes; ++i, ++hm_ptr, ++pool_hm_ptr){
+                float hm_conf = *hm_ptr;
+                if(hm_conf == *pool_hm_ptr && hm_conf >= deconfidence_threshold){
+                    has_obj = true;
+                    if(hm_conf > max_conf){
+                        max_conf = hm_conf;
+                        label    = i;
+                    }
+                }
+            }
+
+            if(!has_obj)
+                return false;
+
+            candidate.confidence = sigmoid(max_conf);
+            candidate.label      = label;
+            return true;
+        }
+
+        BOX_DECODER_FUNC void write(int position, const Candidate& candidate, float* pout) const{
+
+            // x_, y_为特征图尺度上的中心
+            const float* pitem = predict + (size_t)num_channels * position;
+            float x_ = (position % fm_width) + pitem[0];
+            float y_ = (position / fm_width) + pitem[1];
+            float w_ = pitem[2];
+            float h_ = pitem[3];
+
+            float left   = (x_ - w_ * 0.5f) * stride;
+            float right  = (x_ + w_ * 0.5f) * stride;
+            float top    = (y_ - h_ * 0.5f) * stride;
+            float bottom = (y_ + h_ * 0.5f) * stride;
+            matrix.project(left,  top,    &left,  &top);
+            matrix.project(right, bottom, &right, &bottom);
+
+            pout[0] = left;
+            pout[1] = top;
+            pout[2] = right;
+            pout[3] = bottom;
+            pout[4] = candidate.confidence;
+            pout[5] = candidate.label;
+            pout[6] = 1;
+        }
+    };
+
+    /* RetinaFace，每个位置16个通道：cx, cy, w, h, neg_conf, pos_conf, 5个landmark
+       prior为每个位置的cx, cy, w, h
+    */
+    struct RetinaFaceHead : FaceBox{
+        struct Candidate{
+            float deconfidence;
+        };
+
+        const float* predict;
+        const float* prior;
+        float deconfidence_threshold;
+        AffineMatrix matrix;
+
+        RetinaFaceHead(const float* predict, const float* prior, float confidence_threshold, const float* invert_affine_matrix)
+        :predict(predict), prior(prior), deconfidence_threshold(desigmoid(confidence_threshold)), matrix(invert_affine_matrix){}
+
+        BOX_DECODER_FUNC bool accept(int position, Candidate& candidate) const{
+            const float* pitem = predict + 16 * position;
+            candidate.deconfidence = pitem[5] - pitem[4];
+            return !(candidate.deconfidence < deconfidence_threshold);
+        }
+
+        BOX_DECODER_FUNC void write(int position, const Candidate& candidate, float* pout) const{
+
+            const float variances[] = {0.1f, 0.2f};
+            const float* pitem  = predict + 16 * position;
+            const float* pprior = prior   + 4  * position;
+            float cx     = pprior[0] + pitem[0] * variances[0] * pprior[2];
+            float cy     = pprior[1] + pitem[1] * variances[0] * pprior[3];
+            float width  = pprior[2] * expf(pitem[2] * variances[1]);
+            float height = pprior[3] * expf(pitem[3] * variances[1]);
+            float left   = cx - width  * 0.5f;
+            float top    = cy - height * 0.5f;
+            float right  = cx + width  * 0.5f;
+            float bottom = cy + height * 0.5f;
+            matrix.project(left,  top,    &left,  &top);
+            matrix.project(right, bottom, &right, &bottom);
+
+            pout[0] = left;
+            pout[1] = top;
+            pout[2] = right;
+            pout[3] = bottom;
+            pout[4] = sigmoid(candidate.deconfidence);
+            pout[5] = 1;    // 1 = keep, 0 = ignore
+
+            const float* landmark_predict = pitem + 6;
+            for(int i = 0; i < 5; ++i, landmark_predict += 2){
+                float x = pprior[0] + landmark_predict[0] * variances[0] * pprior[2];
+                float y = pprior[1] + landmark_predict[1] * variances[0] * pprior[3];
+                matrix.project(x, y, pout + 6 + i * 2, pout + 7 + i * 2);
+            }
+        }
+    };
+
+    /* Scrfd，每个位置15个通道：到prior中心的left, top, right, bottom距离, conf, 5个landmark
+       prior为每个位置的cx, cy, stride, stride
+    */
+    struct ScrfdHead : FaceBox{
+        struct Candidate{
+            float deconfidence;
+        };
+
+        const float* predict;
+        const float* prior;
+        float deconfidence_threshold;
+        AffineMatrix matrix;
+
+        ScrfdHead(const float* predict, const float* prior, float confidence_threshold, const float* invert_affine_matrix)
+        :predict(predict), prior(prior), deconfidence_threshold(desigmoid(confidence_threshold)), matrix(invert_affine_matrix){}
+
+        BOX_DECODER_FUNC bool accept(int position, Candidate& candidate) const{
+            candidate.deconfidence = predict[15 * position + 4];
+            return !(candidate.deconfidence < deconfidence_threshold);
+        }
+
+        BOX_DECODER_FUNC void write(int position, const Candidate& candidate, float* pout) const{
+
+            const float* pitem  = predict + 15 * position;
+            const float* pprior = prior   + 4  * position;
+            float left   = pprior[0] - pitem[0] * pprior[2];
+            float top    = pprior[1] - pitem[1] * pprior[2];
+            float right  = pprior[0] + pitem[2] * pprior[2];
+            float bottom = pprior[1] + pitem[3] * pprior[2];
+            matrix.project(left,  top,    &left,  &top);
+            matrix.project(right, bottom, &right, &bottom);
+
+            pout[0] = left;
+            pout[1] = top;
+            pout[2] = right;
+            pout[3] = bottom;
+            pout[4] = sigmoid(candidate.deconfidence);
+            pout[5] = 1;    // 1 = keep, 0 = ignore
+
+            const float* landmark_predict = pitem + 5;
+            for(int i = 0; i < 5; ++i, landmark_predict += 2){
+                float x = pprior[0] + landmark_predict[0] * pprior[2];
+                float y = pprior[1] + landmark_predict[1] * pprior[3];
+                matrix.project(x, y, pout + 6 + i * 2, pout + 7 + i * 2);
+            }
+        }
+    };
+
+    /* DBFace，heatmap、tlrb与landmark为各自的[C, H, W]输出
+       pool_hm为空(DBFaceSmall)时不做局部最大值的判断
+    */
+    struct DBFaceHead : DBFaceBox{
+        struct Candidate{
+            float confidence;
+        };
+
+        const float* pool_hm;
+        const float* hm;
+        const float* tlrb;
+        const float* landmark;
+        int num_bboxes;
+        int fm_width;
+        int fm_height;
+        int stride;
+        float confidence_threshold;
+        AffineMatrix matrix;
+
+        DBFaceHead(
+            const float* pool_hm, const float* hm, const float* tlrb, const float* landmark,
+            int fm_width, int fm_height, int stride, float confidence_threshold, const float* invert_affine_matrix
+        ):pool_hm(pool_hm), hm(hm), tlrb(tlrb), landmark(landmark), num_bboxes(fm_width * fm_height),
+          fm_width(fm_width), fm_height(fm_height), stride(stride), confidence_threshold(confidence_threshold), matrix(invert_affine_matrix){}
+
+        static BOX_DECODER_FUNC float common_exp(float value){
+            const float gate = 1;
+            if(fabsf(value) < gate)
+                return value * expf(gate);
+            return value > 0 ? expf(value) : -expf(-value);
+        }
+
+        BOX_DECODER_FUNC bool accept(int position, Candidate& candidate) const{
+            candidate.confidence = hm[position];
+            if(pool_hm && candidate.confidence != pool_hm[position])
+                return false;
+            return !(candidate.confidence < confidence_threshold);
+        }
+
+        BOX_DECODER_FUNC void write(int position, const Candidate& candidate, float* pout) const{
+
+            float cx     = position % fm_width;
+            float cy     = position / fm_height;
+            float left   = (cx - tlrb[num_bboxes * 0 + position]) * stride;
+            float top    = (cy - tlrb[num_bboxes * 1 + position]) * stride;
+            float right  = (cx + tlrb[num_bboxes * 2 + position]) * stride;
+            float bottom = (cy + tlrb[num_bboxes * 3 + position]) * stride;
+            matrix.project(left,  top,    &left,  &top);
+            matrix.project(right, bottom, &right, &bottom);
+
+            pout[0] = left;
+            pout[1] = top;
+            pout[2] = right;
+            pout[3] = bottom;
+            pout[4] = candidate.confidence;
+            pout[5] = 0;
+            pout[6] = 1;    // 1 = keep, 0 = ignore
+
+            for(int i = 0; i < 5; ++i){
+                float x = landmark[num_bboxes * i + position] * 4;
+                float y = landmark[num_bboxes * (5 + i) + position] * 4;
+                x = (common_exp(x) + cx) * stride;
+                y = (common_exp(y) + cy) * stride;
+                matrix.project(x, y, pout + 7 + i * 2, pout + 8 + i * 2);
+            }
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////
+    // fast nms：每个box只要与同类的更高分box的IoU大于阈值就被抑制，不依赖处理顺序
+
+    BOX_DECODER_FUNC float box_iou(
+        float aleft, float atop, float aright, float abottom,
+        float bleft, float btop, float bright, float bbottom
+    ){
+        float cleft   = fmaxf(aleft, bleft);
+        float ctop    = fmaxf(atop, btop);
+        float cright  = fminf(aright, bright);
+        float cbottom = fminf(abottom, bbottom);
+
+        float c_area = fmaxf(cright - cleft, 0.0f) * fmaxf(cbottom - ctop, 0.0f);
+        if(c_area == 0.0f)
+            return 0.0f;
+
+        float a_area = fmaxf(0.0f, aright - aleft) * fmaxf(0.0f, abottom - atop);
+        float b_area = fmaxf(0.0f, bright - bleft) * fmaxf(0.0f, bbottom - btop);
+        return c_area / (a_area + b_area - c_area);
+    }
+
+    // bboxes中第position个box是否被抑制，分数相等时序号小的优先
+    template<class Format>
+    BOX_DECODER_FUNC bool fast_nms_suppressed(const float* bboxes, int count, int position, float threshold){
+
+        const float* pcurrent = bboxes + 1 + position * Format::NUM_ELEMENT;
+        for(int i = 0; i < count; ++i){
+            const float* pitem = bboxes + 1 + i * Format::NUM_ELEMENT;
+            if(i == position || (Format::LABEL_INDEX >= 0 && pcurrent[Format::LABEL_INDEX] != pitem[Format::LABEL_INDEX]))
+                continue;
+
+            if(pitem[4] >= pcurrent[4]){
+                if(pitem[4] == pcurrent[4] && i < position)
+                    continue;
+
+                float iou = box_iou(
+                    pcurrent[0], pcurrent[1], pcurrent[2], pcurrent[3],
+                    pitem[0],    pitem[1],    pitem[2],    pitem[3]
+                );
+
+                if(iou > threshold)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////
+    // CPU实现，按位置顺序解码，结果与GPU的集合相同(GPU的顺序不确定)
+
+    // 写入parray，最多max_objects个，parray[0]为写入的数量并返回
+    template<class Head>
+    int decode_cpu(const Head& head, int num_bboxes, float* parray, int max_objects){
+
+        int count = 0;
+        for(int position = 0; position < num_bboxes && count < max_objects; ++position){
+            typename Head::Candidate candidate;
+            if(!head.accept(position, candidate))
+                continue;
+
+            head.write(position, candidate, parray + 1 + count * Head::NUM_ELEMENT);
+            count++;
+        }
+        parray[0] = count;
+        return count;
+    }
+
+    // 与fast_nms_gpu相同，被抑制的box的keepflag置为0
+    template<class Format>
+    void fast_nms_cpu(float* parray, int max_objects, float threshold){
+
+        int count = parray[0] < max_objects ? (int)parray[0] : max_objects;
+        for(int position = 0; position < count; ++position){
+            if(fast_nms_suppressed<Format>(parray, count, position, threshold))
+                parray[1 + position * Format::NUM_ELEMENT + Format::KEEP_INDEX] = 0;
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GPU实现，定义在box_decoder.cuh
+
+    /* 每个位置一个线程，通过的box用atomicAdd取得输出位置，parray[0]需要预先置0
+       parray[0]为通过的总数，可能大于max_objects，只有前max_objects个被写出
+    */
+    template<class Head>
+    void decode_gpu(const Head& head, int num_bboxes, float* parray, int max_objects, cudaStream_t stream);
+
+    template<class Format>
+    void fast_nms_gpu(float* parray, int max_objects, float threshold, cudaStream_t stream);
+
+}; // namespace BoxDecoder
+
+#endif // BOX_DECODER_HPP
@@ -0,0 +1,75 @@
+#ifndef COMPLETION_QUEUE_HPP
+#define COMPLETION_QUEUE_HPP
+
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+
+/* 完成队列，由使用者创建和持有
+   推理器完成一个job后把(tag, output)放入队列，使用者在自己的事件循环里取出结果
+   tag由使用者在commit时指定，例如帧号、连接id或者请求对象的指针
+*/
+template<class Output>
+class CompletionQueue{
+public:
+    struct Item{
+        uint64_t tag = 0;
+        Output output;
+    };
+
+    // 推理器的worker线程调用
+    void push(uint64_t tag, const Output& output){
+        {
+            std::unique_lock<std::mutex> l(lock_);
+            items_.emplace_back();
+            items_.back().tag    = tag;
+            items_.back().output = output;
+        };
+        cond_.notify_one();
+    }
+
+    /* 取出一个结果，timeout_ms < 0表示一直等待，0表示不等待
+       超时或者shutdown后队列为空时返回false
+    */
+    bool next(Item& item, int timeout_ms = -1){
+        std::unique_lock<std::mutex> l(lock_);
+        auto ready = [&](){return shutdown_ || !items_.empty();};
+        if(timeout_ms < 0)
+            cond_.wait(l, ready);
+        else if(!cond_.wait_for(l, std::chrono::milliseconds(timeout_ms), ready))
+            return false;
+
+        if(items_.empty()) return false;
+        item = std::move(items_.front());
+        items_.pop_front();
+        return true;
+    }
+
+    bool try_next(Item& item){
+        return next(item, 0);
+    }
+
+    // 唤醒所有在next中等待的线程，已经在队列中的结果仍然可以取出
+    void shutdown(){
+        {
+            std::unique_lock<std::mutex> l(lock_);
+            shutdown_ = true;
+        };
+        cond_.notify_all();
+    }
+
+    size_t size(){
+        std::unique_lock<std::mutex> l(lock_);
+        return items_.size();
+    }
+
+private:
+    std::mutex lock_;
+    std::condition_variable cond_;
+    std::deque<Item> items_;
+    bool shutdown_ = false;
+};
+
+#endif // COMPLETION_QUEUE_HPP
\ No newline at end of file
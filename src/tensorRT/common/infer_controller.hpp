@@ -6,127 +6,522 @@
 #include <memory>
 #include <mutex>
 #include <thread>
-#include <queue>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <functional>
 #include <condition_variable>
 #include <infer/trt_infer.hpp>
 #include "monopoly_allocator.hpp"
+#include "ilogger.hpp"
+#include "thread_pool.hpp"
+#include "job_admission.hpp"
+#include "completion_queue.hpp"
+#include "ring_queue.hpp"
 
 template<class Input, class Output, class StartParam=std::tuple<std::string, int>, class JobAdditional=int>
 class InferController{
 public:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    // 结果回调，在worker线程上执行，应当尽快返回
+    typedef std::function<void(const Output&)> Callback;
+
+    /* job结果的交付，每个job的结果只交付一次
+       future接口也是通过回调实现的，没有回调的JobPromise调用set_value无效果
+       callback的参数引用的是job记录中的output，仅在回调期间有效，需要保留时请拷贝
+       outstanding不为空时，构造时加1，交付时减1，用于统计未完成的job数量
+    */
+    class JobPromise{
+    public:
+        JobPromise() = default;
+        JobPromise(Callback callback, std::atomic<int>* outstanding = nullptr)
+        :callback_(std::move(callback)), outstanding_(outstanding){
+            if(outstanding_) (*outstanding_)++;
+        }
+
+        // 只能移动，保证同一个job只会被交付和计数一次
+        JobPromise(JobPromise&& other){
+            *this = std::move(other);
+        }
+
+        JobPromise& operator=(JobPromise&& other){
+            callback_    = std::move(other.callback_);
+            outstanding_ = other.outstanding_;
+            other.callback_    = nullptr;
+            other.outstanding_ = nullptr;
+            return *this;
+        }
+
+        void set_value(const Output& output){
+            if(!callback_) return;
+
+            Callback callback;
+            callback.swap(callback_);
+            if(outstanding_){
+                (*outstanding_)--;
+                outstanding_ = nullptr;
+            }
+            callback(output);
+        }
+
+        explicit operator bool() const{
+            return (bool)callback_;
+        }
+
+    private:
+        Callback callback_;
+        std::atomic<int>* outstanding_ = nullptr;
+    };
+
+    /* job记录在完成后回收到job_pool_中复用
+       回收时output被清空，支持clear()的类型(例如BoxArray)保留容量，这样稳态下不需要为结果申请内存
+    */
     struct Job{
         Input input;
         Output output;
         JobAdditional additional;
         MonopolyAllocator<TRT::Tensor>::MonopolyDataPointer mono_tensor;
-        std::shared_ptr<std::promise<Output>> pro;
+        JobPromise pro;
+        TimePoint commit_time;   // 进入commit的时间，deadline从这里开始计算
+        TimePoint queue_time;    // 预处理完成放入队列的时间，max_queue_delay_ms从这里开始计算
+        TimePoint deadline;
+        bool has_deadline = false;
+    };
+
+    /* 动态批处理策略，默认值与原来的行为一致：有job即取，不等待
+       max_queue_delay_ms：   队列中最早的job最多为凑batch等待的时间，0表示不等待
+       preferred_batch_size： 队列中job数达到该值时立即开始推理，<=0表示使用worker的max_batch_size
+       job_deadline_ms：      每个job从commit开始计算的截止时间，0表示不限制
+                              被取出时已经超时的job不再推理，直接返回空结果
+    */
+    struct BatchPolicy{
+        int max_queue_delay_ms   = 0;
+        int preferred_batch_size = 0;
+        int job_deadline_ms      = 0;
     };
 
     virtual ~InferController(){
         stop();
     }
 
+    /* tensor_allocator_在析构时才释放，stop只让它拒绝新的query并唤醒等待中的query
+       这样stop期间或者之后并发的commit与preprocess访问tensor_allocator_仍然是安全的
+    */
     void stop(){
         run_ = false;
         cond_.notify_all();
 
         ////////////////////////////////////////// cleanup jobs
+        // 回调可能再次调用commit，因此在锁外交付空结果
+        RingQueue<Job> remain_jobs;
+        std::shared_ptr<MonopolyAllocator<TRT::Tensor>> allocator;
         {
             std::unique_lock<std::mutex> l(jobs_lock_);
-            while(!jobs_.empty()){
-                auto& item = jobs_.front();
-                if(item.pro)
-                    item.pro->set_value(Output());
-                jobs_.pop();
-            }
+            remain_jobs.swap(jobs_);
+            num_pending_jobs_ = 0;
+            allocator = tensor_allocator_;
         };
+        queue_space_cond_.notify_all();
 
-        if(worker_){
-            worker_->join();
-            worker_.reset();
+        if(allocator)
+            allocator->shutdown();
+
+        while(!remain_jobs.empty()){
+            remain_jobs.front().pro.set_value(Output());
+            remain_jobs.pop();
         }
+
+        for(auto& worker : workers_)
+            worker->join();
+        workers_.clear();
+
+        // 多个worker共享的资源，需要等所有worker退出后再释放
+        shared_engine_.reset();
+    }
+
+    void set_batch_policy(const BatchPolicy& policy){
+        {
+            std::unique_lock<std::mutex> l(jobs_lock_);
+            batch_policy_ = policy;
+        };
+        cond_.notify_all();
+    }
+
+    BatchPolicy batch_policy(){
+        std::unique_lock<std::mutex> l(jobs_lock_);
+        return batch_policy_;
+    }
+
+    // 因为超过job_deadline_ms而被丢弃的job数量
+    size_t num_expired_jobs() const{
+        return num_expired_jobs_;
+    }
+
+    /* 限制队列长度，max_queue_size <= 0表示不限制(默认)
+       队列长度指已经commit但还没有被worker取走的job数量，包括正在预处理的job
+    */
+    void set_queue_limit(int max_queue_size, QueueFullPolicy policy = QueueFullPolicy::Block){
+        {
+            std::unique_lock<std::mutex> l(jobs_lock_);
+            max_queue_size_    = max_queue_size;
+            queue_full_policy_ = policy;
+        };
+        queue_space_cond_.notify_all();
+    }
+
+    int queue_size() const{
+        return num_pending_jobs_;
+    }
+
+    // 已经被接受但还没有交付结果的job数量，包括排队、预处理与推理中的job，用于多个推理器之间的负载均衡
+    int num_outstanding_jobs() const{
+        return num_outstanding_jobs_;
     }
 
-    bool startup(const StartParam& param){
+    // 因为QueueFullPolicy::Reject被拒绝的job数量
+    size_t num_rejected_jobs() const{
+        return num_rejected_jobs_;
+    }
+
+    // 因为QueueFullPolicy::DropOldest被丢弃的job数量
+    size_t num_dropped_jobs() const{
+        return num_dropped_jobs_;
+    }
+
+    /* 新建的job记录数量，job_pool_中没有可复用的记录时才会新建，稳态下不再增长
+       记录数不变时，使用回调的commit不申请内存(回调需要放得进std::function的内部缓冲)
+    */
+    size_t num_job_records() const{
+        return num_job_records_;
+    }
+
+    /* commits时使用num_threads个线程并行执行preprocess，<=0表示关闭，在调用线程上串行执行
+       要求子类的preprocess是线程安全的
+    */
+    void set_preprocess_threads(int num_threads){
+        std::shared_ptr<ThreadPool> pool;
+        if(num_threads > 0)
+            pool = std::make_shared<ThreadPool>(num_threads);
+
+        std::unique_lock<std::mutex> l(jobs_lock_);
+        preprocess_pool_.swap(pool);
+    }
+
+    /* num_workers > 1时启动多个worker从同一个job队列取数据，每个worker拥有独立的执行上下文
+       worker按顺序启动，0号worker(主worker)启动成功后才会启动其他worker
+    */
+    bool startup(const StartParam& param, int num_workers = 1){
         run_ = true;
 
-        std::promise<bool> pro;
         start_param_ = param;
-        worker_      = std::make_shared<std::thread>(&InferController::worker, this, std::ref(pro));
-        return pro.get_future().get();
+        num_workers_ = std::max(1, num_workers);
+        for(int i = 0; i < num_workers_; ++i){
+            std::promise<bool> pro;
+            workers_.emplace_back(std::make_shared<std::thread>([this, &pro, i](){
+                this->worker(pro, i);
+            }));
+
+            if(!pro.get_future().get())
+                return false;
+        }
+        return true;
+    }
+
+    int num_workers() const{
+        return num_workers_;
     }
 
     virtual std::shared_future<Output> commit(const Input& input){
+        return commit(input, (CommitError*)nullptr);
+    }
+
+    // error不为空时，返回该job的提交结果，被拒绝或者失败的job立即得到空结果
+    std::shared_future<Output> commit(const Input& input, CommitError* error){
+
+        auto pro = std::make_shared<std::promise<Output>>();
+        CommitError admission = commit_async(input, [pro](const Output& output){
+            pro->set_value(output);
+        });
+
+        if(error) *error = admission;
+        return pro->get_future();
+    }
 
+    /* 结果通过callback交付，每次commit的callback都会被调用且只调用一次
+       被拒绝或者预处理失败时，callback在commit返回前以空结果调用
+    */
+    CommitError commit_async(const Input& input, Callback callback){
+
+        TimePoint commit_time = std::chrono::steady_clock::now();
         Job job;
-        job.pro = std::make_shared<std::promise<Output>>();
-        if(!preprocess(job, input)){
-            job.pro->set_value(Output());
-            return job.pro->get_future();
+        CommitError admission = admit_job(job, commit_time);
+        bool admitted = admission == CommitError::None;
+        job.pro = JobPromise(std::move(callback), admitted ? &num_outstanding_jobs_ : nullptr);
+
+        // 预处理期间stop()时，allocator拒绝query导致的失败属于Stopped
+        if(admitted && !preprocess(job, input))
+            admission = run_ ? CommitError::PreprocessFailed : CommitError::Stopped;
+
+        if(admission != CommitError::None){
+            job.pro.set_value(Output());
+            if(admitted)
+                leave_job(job);
+            return admission;
         }
         
         ///////////////////////////////////////////////////////////
+        bool pushed = false;
         {
             std::unique_lock<std::mutex> l(jobs_lock_);
-            jobs_.push(job);
+            pushed = push_job(job);
         };
+
+        if(!pushed){
+            job.pro.set_value(Output());
+            return CommitError::Stopped;
+        }
         cond_.notify_one();
-        return job.pro->get_future();
+        return admission;
+    }
+
+    // 结果以(tag, output)的形式放入使用者持有的完成队列
+    CommitError commit(const Input& input, const std::shared_ptr<CompletionQueue<Output>>& queue, uint64_t tag){
+        return commit_async(input, [queue, tag](const Output& output){
+            queue->push(tag, output);
+        });
     }
 
     virtual std::vector<std::shared_future<Output>> commits(const std::vector<Input>& inputs){
+        return commits(inputs, (std::vector<CommitError>*)nullptr);
+    }
 
-        int batch_size = std::min((int)inputs.size(), this->tensor_allocator_->capacity());
-        std::vector<Job> jobs(inputs.size());
+    // errors不为空时，返回每个job的提交结果
+    std::vector<std::shared_future<Output>> commits(const std::vector<Input>& inputs, std::vector<CommitError>* errors){
+
+        std::vector<Callback> callbacks(inputs.size());
         std::vector<std::shared_future<Output>> results(inputs.size());
+        for(int i = 0; i < inputs.size(); ++i){
+            auto pro = std::make_shared<std::promise<Output>>();
+            results[i]   = pro->get_future();
+            callbacks[i] = [pro](const Output& output){
+                pro->set_value(output);
+            };
+        }
+
+        auto admission = commits_async(inputs, callbacks);
+        if(errors) *errors = std::move(admission);
+        return results;
+    }
+
+    // 第i个结果的tag为first_tag + i
+    std::vector<CommitError> commits(const std::vector<Input>& inputs, const std::shared_ptr<CompletionQueue<Output>>& queue, uint64_t first_tag){
+
+        std::vector<Callback> callbacks(inputs.size());
+        for(int i = 0; i < inputs.size(); ++i){
+            uint64_t tag = first_tag + i;
+            callbacks[i] = [queue, tag](const Output& output){
+                queue->push(tag, output);
+            };
+        }
+        return commits_async(inputs, callbacks);
+    }
+
+    // callbacks[i]交付inputs[i]的结果，语义与commit_async(input, callback)相同
+    std::vector<CommitError> commits_async(const std::vector<Input>& inputs, const std::vector<Callback>& callbacks){
+
+        if(inputs.empty())
+            return std::vector<CommitError>();
+
+        TimePoint commit_time = std::chrono::steady_clock::now();
+        std::shared_ptr<ThreadPool> preprocess_pool;
+        std::shared_ptr<MonopolyAllocator<TRT::Tensor>> allocator;
+        int max_queue_size = 0;
+        {
+            std::unique_lock<std::mutex> l(jobs_lock_);
+            preprocess_pool = preprocess_pool_;
+            allocator       = tensor_allocator_;
+            max_queue_size  = max_queue_size_;
+        };
+
+        // 没有启动或者已经停止
+        if(!run_ || allocator == nullptr){
+            for(auto& callback : callbacks)
+                callback(Output());
+            return std::vector<CommitError>(inputs.size(), CommitError::Stopped);
+        }
+
+        /* 每个epoch最多申请capacity个tensor，超出的部分在query时阻塞，保持allocator的反压语义
+           同一个epoch的job在全部预处理完成后才放入队列，因此epoch不能超过队列上限，否则Block策略会死锁
+        */
+        int batch_size = std::min((int)inputs.size(), allocator->capacity());
+        if(max_queue_size > 0)
+            batch_size = std::min(batch_size, max_queue_size);
+
+        std::vector<Job> jobs(inputs.size());
+        std::vector<CommitError> admission(inputs.size(), CommitError::None);
+
+        auto preprocess_one = [&](int i){
+            Job& job = jobs[i];
+            bool admitted = admission[i] == CommitError::None;
+            job.pro = JobPromise(callbacks[i], admitted ? &num_outstanding_jobs_ : nullptr);
+            if(admitted && !preprocess(job, inputs[i]))
+                admission[i] = run_ ? CommitError::PreprocessFailed : CommitError::Stopped;
+
+            if(admission[i] != CommitError::None){
+                job.pro.set_value(Output());
+                if(admitted)
+                    leave_job(job);
+            }
+        };
 
         int nepoch = (inputs.size() + batch_size - 1) / batch_size;
         for(int epoch = 0; epoch < nepoch; ++epoch){
             int begin = epoch * batch_size;
             int end   = std::min((int)inputs.size(), begin + batch_size);
 
-            for(int i = begin; i < end; ++i){
-                Job& job = jobs[i];
-                job.pro = std::make_shared<std::promise<Output>>();
-                if(!preprocess(job, inputs[i])){
-                    job.pro->set_value(Output());
-                }
-                results[i] = job.pro->get_future();
+            admit_jobs(jobs.data() + begin, admission.data() + begin, end - begin, commit_time);
+
+            if(preprocess_pool){
+                preprocess_pool->parallel_for(begin, end, preprocess_one);
+            }else{
+                for(int i = begin; i < end; ++i)
+                    preprocess_one(i);
             }
 
             ///////////////////////////////////////////////////////////
+            std::vector<JobPromise> stopped_jobs;
             {
                 std::unique_lock<std::mutex> l(jobs_lock_);
                 for(int i = begin; i < end; ++i){
-                    jobs_.emplace(std::move(jobs[i]));
+
+                    // 被拒绝或者预处理失败的job已经返回了空结果，不需要再交给worker
+                    if(admission[i] != CommitError::None) continue;
+
+                    if(!push_job(jobs[i])){
+                        admission[i] = CommitError::Stopped;
+                        stopped_jobs.emplace_back(std::move(jobs[i].pro));
+                    }
                 };
             }
-            cond_.notify_one();
+
+            for(auto& pro : stopped_jobs)
+                pro.set_value(Output());
+
+            // 一次放入了多个job，可能需要唤醒多个worker
+            cond_.notify_all();
         }
-        return results;
+
+        return admission;
     }
 
 protected:
     virtual void worker(std::promise<bool>& result) = 0;
+
+    /* 多worker时每个线程的入口，默认实现忽略worker_index，因此只支持单个worker
+       支持多worker的子类需要重写该函数：
+       0号worker负责加载引擎并赋值给shared_engine_，创建tensor_allocator_等共享资源
+       其他worker通过shared_engine_->clone_context()得到独立的context、stream和输入输出tensor
+    */
+    virtual void worker(std::promise<bool>& result, int worker_index){
+        if(worker_index > 0){
+            INFOE("This controller does not support multiple workers");
+            result.set_value(false);
+            return;
+        }
+        worker(result);
+    }
     virtual bool preprocess(Job& job, const Input& input) = 0;
     
     virtual bool get_jobs_and_wait(std::vector<Job>& fetch_jobs, int max_size){
 
+        std::vector<JobPromise> expired_jobs;
         std::unique_lock<std::mutex> l(jobs_lock_);
-        cond_.wait(l, [&](){
-            return !run_ || !jobs_.empty();
-        });
 
-        if(!run_) return false;
-        
+        // 上一次取出的job已经处理完，回收复用
+        for(auto& job : fetch_jobs)
+            recycle_job(job);
         fetch_jobs.clear();
-        for(int i = 0; i < max_size && !jobs_.empty(); ++i){
-            fetch_jobs.emplace_back(std::move(jobs_.front()));
-            jobs_.pop();
+
+        while(fetch_jobs.empty()){
+            cond_.wait(l, [&](){
+                return !run_ || !jobs_.empty();
+            });
+
+            if(!run_) return false;
+
+            int preferred_size = max_size;
+            if(batch_policy_.preferred_batch_size > 0)
+                preferred_size = std::min(max_size, batch_policy_.preferred_batch_size);
+
+            // 最早的job的等待时间没有用完之前，尽量凑满preferred_size
+            if(batch_policy_.max_queue_delay_ms > 0 && (int)jobs_.size() < preferred_size){
+                auto& oldest = jobs_.front();
+                TimePoint wait_until = oldest.queue_time + std::chrono::milliseconds(batch_policy_.max_queue_delay_ms);
+                if(oldest.has_deadline && oldest.deadline < wait_until)
+                    wait_until = oldest.deadline;
+
+                cond_.wait_until(l, wait_until, [&](){
+                    return !run_ || (int)jobs_.size() >= preferred_size;
+                });
+                if(!run_) return false;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            while((int)fetch_jobs.size() < max_size && !jobs_.empty()){
+                Job& job = jobs_.front();
+                if(job.has_deadline && job.deadline < now){
+                    if(job.mono_tensor)
+                        job.mono_tensor->release();
+
+                    expired_jobs.emplace_back(std::move(job.pro));
+                    recycle_job(job);
+                    num_expired_jobs_++;
+                }else{
+                    fetch_jobs.emplace_back(std::move(job));
+                }
+                jobs_.pop();
+                num_pending_jobs_--;
+            }
+            queue_space_cond_.notify_all();
+
+            if(!expired_jobs.empty()){
+                l.unlock();
+                for(auto& pro : expired_jobs)
+                    pro.set_value(Output());
+                expired_jobs.clear();
+                l.lock();
+            }
         }
         return true;
     }
 
+    /* 需要持有jobs_lock_，把预处理完成的job放入队列
+       预处理期间stop()已经取走了队列中的job，此时不再入队，返回false，由调用者在锁外交付空结果
+       stop()已经把队列长度清零，因此不再计数，tensor_allocator_在析构前一直有效，mono_tensor直接归还
+    */
+    bool push_job(Job& job){
+        if(!run_){
+            if(job.mono_tensor)
+                job.mono_tensor->release();
+            job.mono_tensor.reset();
+            return false;
+        }
+
+        job.queue_time = std::chrono::steady_clock::now();
+        jobs_.push(std::move(job));
+        return true;
+    }
+
+    // 在admit时调用，之后的阻塞、预处理都计入deadline
+    void stamp_job(Job& job, const TimePoint& commit_time){
+        job.commit_time  = commit_time;
+        job.has_deadline = batch_policy_.job_deadline_ms > 0;
+        if(job.has_deadline)
+            job.deadline = job.commit_time + std::chrono::milliseconds(batch_policy_.job_deadline_ms);
+    }
+
     virtual bool get_job_and_wait(Job& fetch_job){
 
         std::unique_lock<std::mutex> l(jobs_lock_);
@@ -138,17 +533,151 @@ protected:
         
         fetch_job = std::move(jobs_.front());
         jobs_.pop();
+        num_pending_jobs_--;
+        queue_space_cond_.notify_all();
         return true;
     }
 
+    /* 按照QueueFullPolicy决定是否接受一个新的job，接受后计入队列长度
+       接受时从job_pool_中取出一个回收的job记录放到job中，并记录commit_time与deadline
+    */
+    CommitError admit_job(Job& job, const TimePoint& commit_time){
+        CommitError admission = CommitError::None;
+        admit_jobs(&job, &admission, 1, commit_time);
+        return admission;
+    }
+
+    /* 一次决定n个job是否接受，结果写入admission
+       Block策略下等到队列能同时容纳n个job时一起接受，等待时不持有任何名额
+       否则多个线程同时commits时，各自持有一部分名额等待剩下的名额，会互相阻塞
+    */
+    void admit_jobs(Job* jobs, CommitError* admission, int n, const TimePoint& commit_time){
+
+        std::vector<JobPromise> dropped_jobs;
+        std::unique_lock<std::mutex> l(jobs_lock_);
+        if(max_queue_size_ > 0 && queue_full_policy_ == QueueFullPolicy::Block){
+
+            // 上限在等待期间被调小到n以下时，队列为空就接受，避免永远等待
+            queue_space_cond_.wait(l, [&](){
+                return !run_ || max_queue_size_ <= 0 || num_pending_jobs_ + n <= max_queue_size_ || num_pending_jobs_ == 0;
+            });
+        }
+
+        for(int i = 0; i < n; ++i){
+            admission[i] = CommitError::None;
+            if(!run_){
+                admission[i] = CommitError::Stopped;
+                continue;
+            }
+
+            if(max_queue_size_ > 0 && num_pending_jobs_ >= max_queue_size_){
+                if(queue_full_policy_ == QueueFullPolicy::Reject){
+                    num_rejected_jobs_++;
+                    admission[i] = CommitError::QueueFull;
+                    continue;
+                }else if(queue_full_policy_ == QueueFullPolicy::DropOldest){
+
+                    // 正在预处理的job无法丢弃，此时允许短暂超过上限，其数量受allocator的容量限制
+                    if(!jobs_.empty()){
+                        auto& oldest = jobs_.front();
+                        if(oldest.mono_tensor)
+                            oldest.mono_tensor->release();
+
+                        dropped_jobs.emplace_back(std::move(oldest.pro));
+                        recycle_job(oldest);
+                        jobs_.pop();
+                        num_pending_jobs_--;
+                        num_dropped_jobs_++;
+                    }
+                }
+            }
+
+            num_pending_jobs_++;
+            if(!job_pool_.empty()){
+                jobs[i] = std::move(job_pool_.back());
+                job_pool_.pop_back();
+            }else{
+                // 队列与记录池中的job都不超过记录总数，新建记录时一并预留，记录数不变时它们不再扩容
+                num_job_records_++;
+                job_pool_.reserve(num_job_records_);
+                jobs_.reserve(num_job_records_);
+            }
+            stamp_job(jobs[i], commit_time);
+        }
+        l.unlock();
+
+        for(auto& pro : dropped_jobs)
+            pro.set_value(Output());
+    }
+
+    // 已经计入队列长度的job没有放入队列(例如预处理失败)，stop()之后队列长度已经清零，不再减少
+    void leave_job(Job& job){
+        {
+            std::unique_lock<std::mutex> l(jobs_lock_);
+            if(run_)
+                num_pending_jobs_--;
+            recycle_job(job);
+        };
+        queue_space_cond_.notify_all();
+    }
+
+    // 自行管理job生命周期的worker(例如把job交给其他线程做后处理)，在结果交付后调用
+    void recycle_jobs(std::vector<Job>& jobs){
+        {
+            std::unique_lock<std::mutex> l(jobs_lock_);
+            for(auto& job : jobs)
+                recycle_job(job);
+        };
+        jobs.clear();
+    }
+
+    /* 需要持有jobs_lock_，字段恢复默认值，释放输入图像等资源
+       mono_tensor只是解除引用而不release，避免重复release已经被其他job占用的tensor
+    */
+    void recycle_job(Job& job){
+        reset_output(job.output, 0);
+        job.input       = Input();
+        job.additional  = JobAdditional();
+        job.pro         = JobPromise();
+        job.mono_tensor.reset();
+        job_pool_.emplace_back(std::move(job));
+    }
+
+    template<class _T>
+    static auto reset_output(_T& output, int) -> decltype(output.clear(), void()){
+        output.clear();
+    }
+
+    // 没有clear()的类型，例如cv::Mat，其数据可能仍被使用者持有，因此不能复用
+    template<class _T>
+    static void reset_output(_T& output, long){
+        output = _T();
+    }
+
 protected:
     StartParam start_param_;
     std::atomic<bool> run_;
     std::mutex jobs_lock_;
-    std::queue<Job> jobs_;
-    std::shared_ptr<std::thread> worker_;
+    RingQueue<Job> jobs_;
+    std::vector<Job> job_pool_;
+    std::vector<std::shared_ptr<std::thread>> workers_;
+    std::shared_ptr<TRT::Infer> shared_engine_;
+    std::shared_ptr<ThreadPool> preprocess_pool_;
+    int num_workers_ = 1;
     std::condition_variable cond_;
     std::shared_ptr<MonopolyAllocator<TRT::Tensor>> tensor_allocator_;
+    BatchPolicy batch_policy_;
+    std::atomic<size_t> num_expired_jobs_{0};
+
+    // 以下队列长度相关的状态由jobs_lock_保护，计数器除外
+    std::condition_variable queue_space_cond_;
+    std::atomic<int> num_pending_jobs_{0};
+    std::atomic<int> num_outstanding_jobs_{0};
+    int max_queue_size_ = 0;
+    QueueFullPolicy queue_full_policy_ = QueueFullPolicy::Block;
+    std::atomic<size_t> num_rejected_jobs_{0};
+    std::atomic<size_t> num_dropped_jobs_{0};
+    std::atomic<size_t> num_job_records_{0};
 };
 
 #endif // INFER_CONTROLLER_HPP
\ No newline at end of file
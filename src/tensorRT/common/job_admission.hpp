@@ -0,0 +1,28 @@
+#ifndef JOB_ADMISSION_HPP
+#define JOB_ADMISSION_HPP
+
+// 队列满时的处理策略，队列长度指已经commit但还没有被worker取走的job数量
+enum class QueueFullPolicy : int{
+    Block      = 0,     // 阻塞commit，直到队列有空位
+    Reject     = 1,     // 立即返回空结果，错误码为CommitError::QueueFull
+    DropOldest = 2      // 丢弃队列中最早的job(其结果为空)，放入新的job
+};
+
+enum class CommitError : int{
+    None             = 0,
+    QueueFull        = 1,   // 被QueueFullPolicy::Reject拒绝
+    PreprocessFailed = 2,   // 预处理失败，例如图像为空
+    Stopped          = 3    // 推理器已经停止
+};
+
+inline const char* commit_error_string(CommitError error){
+    switch(error){
+    case CommitError::None:             return "None";
+    case CommitError::QueueFull:        return "QueueFull";
+    case CommitError::PreprocessFailed: return "PreprocessFailed";
+    case CommitError::Stopped:          return "Stopped";
+    default: return "Unknow";
+    }
+}
+
+#endif // JOB_ADMISSION_HPP
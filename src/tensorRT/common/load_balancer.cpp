@@ -0,0 +1,169 @@
+#include "load_balancer.hpp"
+#include <algorithm>
+
+using namespace std;
+
+const char* route_policy_string(RoutePolicy policy){
+    switch(policy){
+    case RoutePolicy::RoundRobin:       return "RoundRobin";
+    case RoutePolicy::LeastOutstanding: return "LeastOutstanding";
+    case RoutePolicy::EWMALatency:      return "EWMALatency";
+    case RoutePolicy::PowerOfTwo:       return "PowerOfTwo";
+    default: return "Unknow";
+    }
+}
+
+LoadBalancer::LoadBalancer(int num_devices, const LoadQuery& query, RoutePolicy policy, float ewma_alpha)
+:num_devices_(max(1, num_devices)), query_(query), policy_(policy), ewma_alpha_(ewma_alpha){
+    job_latency_.resize(num_devices_, 0);
+}
+
+int LoadBalancer::select(){
+
+    if(num_devices_ == 1)
+        return 0;
+
+    switch(policy_.load()){
+    case RoutePolicy::LeastOutstanding: return select_least_outstanding();
+    case RoutePolicy::EWMALatency:      return select_ewma_latency();
+    case RoutePolicy::PowerOfTwo:       return select_power_of_two();
+    default:
+        return ((cursor_++) + 1) % num_devices_;
+    }
+}
+
+void LoadBalancer::report(int device, float latency_ms, int outstanding){
+
+    if(device < 0 || device >= num_devices_)
+        return;
+
+    float job_latency = latency_ms / (max(0, outstanding) + 1);
+    unique_lock<mutex> l(lock_);
+    float& value = job_latency_[device];
+    value = value == 0 ? job_latency : value * (1 - ewma_alpha_) + job_latency * ewma_alpha_;
+}
+
+float LoadBalancer::job_latency(int device){
+    unique_lock<mutex> l(lock_);
+    return job_latency_[device];
+}
+
+int LoadBalancer::select_least_outstanding(){
+
+    // 从轮询位置开始扫描，负载相同时请求仍然均匀分布
+    int start = (cursor_++) % num_devices_;
+    int best  = start;
+    int best_load = query_(start);
+    for(int i = 1; i < num_devices_ && best_load > 0; ++i){
+        int device = (start + i) % num_devices_;
+        int load   = query_(device);
+        if(load < best_load){
+            best      = device;
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+vector<int> LoadBalancer::split(int num_jobs){
+
+    vector<int> counts(num_devices_, 0);
+    if(num_jobs <= 0)
+        return counts;
+
+    RoutePolicy policy = policy_;
+    vector<int> loads(num_devices_, 0);
+    vector<float> latency(num_devices_, 1.0f);
+    if(policy != RoutePolicy::RoundRobin){
+        for(int i = 0; i < num_devices_; ++i)
+            loads[i] = query_(i);
+    }
+
+    if(policy == RoutePolicy::EWMALatency)
+        latency = estimate_job_latency();
+
+    // 逐个分配给预计完成时间最早的设备，分数相同时从轮询位置开始，避免余数总是落在0号设备
+    int start = (cursor_++) % num_devices_;
+    for(int ijob = 0; ijob < num_jobs; ++ijob){
+        int best = start;
+        float best_score = 0;
+        for(int i = 0; i < num_devices_; ++i){
+            int device  = (start + i) % num_devices_;
+            float score = (loads[device] + counts[device] + 1) * latency[device];
+            if(i == 0 || score < best_score){
+                best       = device;
+                best_score = score;
+            }
+        }
+        counts[best]++;
+    }
+    return counts;
+}
+
+vector<float> LoadBalancer::estimate_job_latency(){
+
+    vector<float> latency;
+    {
+        unique_lock<mutex> l(lock_);
+        latency = job_latency_;
+    };
+
+    float sum = 0;
+    int nknown = 0;
+    for(float value : latency){
+        if(value > 0){
+            sum += value;
+            nknown++;
+        }
+    }
+
+    float unknown_latency = nknown > 0 ? sum / nknown : 1.0f;
+    for(float& value : latency){
+        if(value <= 0)
+            value = unknown_latency;
+    }
+    return latency;
+}
+
+int LoadBalancer::select_ewma_latency(){
+
+    // 耗时都未知时退化为最少未完成job
+    vector<float> latency = estimate_job_latency();
+    int start = (cursor_++) % num_devices_;
+    int best  = start;
+    float best_score = 0;
+    for(int i = 0; i < num_devices_; ++i){
+        int device  = (start + i) % num_devices_;
+        float score = (query_(device) + 1) * latency[device];
+        if(i == 0 || score < best_score){
+            best       = device;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+int LoadBalancer::select_power_of_two(){
+
+    uint64_t random = next_random();
+    int a = random % num_devices_;
+    int b = (random >> 32) % (num_devices_ - 1);
+    if(b >= a) b++;
+
+    int load_a = query_(a);
+    int load_b = query_(b);
+    if(load_a != load_b)
+        return load_a < load_b ? a : b;
+
+    unique_lock<mutex> l(lock_);
+    return job_latency_[a] <= job_latency_[b] ? a : b;
+}
+
+uint64_t LoadBalancer::next_random(){
+
+    // splitmix64，多线程下只需要一次原子加法
+    uint64_t z = (random_state_ += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#ifndef LOAD_BALANCER_HPP
+#define LOAD_BALANCER_HPP
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+// 多个设备(推理器)之间的路由策略
+enum class RoutePolicy : int{
+    RoundRobin       = 0,   // 轮询，不考虑负载
+    LeastOutstanding = 1,   // 选择未完成job数最少的设备
+    EWMALatency      = 2,   // 选择预计完成时间最短的设备：(未完成job数 + 1) * 单个job耗时的指数滑动平均
+    PowerOfTwo       = 3    // 随机选择两个设备，取未完成job数较少的一个，避免所有请求同时涌向同一个设备
+};
+
+const char* route_policy_string(RoutePolicy policy);
+
+/**
+ * 设备选择器，只负责决策，不持有推理器
+ * 负载通过LoadQuery查询，设备的耗时由使用者在job完成时通过report上报
+ * 与具体的推理器解耦，因此可以用模拟的设备做单元测试
+ **/
+class LoadBalancer{
+public:
+    // 返回设备当前未完成(已提交但还没有交付结果)的job数量
+    typedef std::function<int(int device)> LoadQuery;
+
+    LoadBalancer(int num_devices, const LoadQuery& query, RoutePolicy policy = RoutePolicy::RoundRobin, float ewma_alpha = 0.2f);
+
+    void set_policy(RoutePolicy policy){policy_ = policy;}
+    RoutePolicy policy() const{return policy_;}
+    int num_devices() const{return num_devices_;}
+
+    // 选择一个设备，线程安全
+    int select();
+
+    /* 把num_jobs个job按照各个设备的处理能力分片，返回每个设备分到的数量
+       RoundRobin认为各设备能力相同且不考虑负载，均分
+       LeastOutstanding与PowerOfTwo均衡(未完成job数 + 分到的数量)
+       EWMALatency均衡预计完成时间(未完成job数 + 分到的数量) * 单个job耗时，即按照吞吐量的比例分配
+    */
+    std::vector<int> split(int num_jobs);
+
+    /* job完成时上报，latency_ms为从提交到交付的耗时
+       outstanding为提交时该设备的未完成job数，用于把排队时间折算为单个job的耗时
+    */
+    void report(int device, float latency_ms, int outstanding);
+
+    // 单个job耗时的指数滑动平均(ms)，还没有上报过时为0
+    float job_latency(int device);
+
+private:
+    int select_least_outstanding();
+    int select_ewma_latency();
+    int select_power_of_two();
+    uint64_t next_random();
+
+    // 单个job耗时，还没有上报过的设备使用已知设备的平均值，都没有时为1
+    std::vector<float> estimate_job_latency();
+
+private:
+    int num_devices_ = 0;
+    LoadQuery query_;
+    std::atomic<RoutePolicy> policy_;
+    float ewma_alpha_ = 0.2f;
+    std::atomic<unsigned int> cursor_{0};
+    std::atomic<uint64_t> random_state_{0};
+
+    std::mutex lock_;
+    std::vector<float> job_latency_;
+};
+
+#endif // LOAD_BALANCER_HPP
\ No newline at end of file
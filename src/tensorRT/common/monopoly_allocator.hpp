@@ -32,7 +32,15 @@
 #include <vector>
 #include <mutex>
 #include <memory>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
 
+/**
+ * 空闲对象使用无锁栈(free-list)管理，query/release的快速路径都是O(1)的CAS操作
+ * 只有当所有对象都被占用时，query才会进入互斥锁+条件变量的阻塞等待
+ * 栈顶head_为64位：高32位是版本号(防止ABA)，低32位是index + 1，0表示栈空
+ **/
 template<class _ItemType>
 class MonopolyAllocator{
 public:
@@ -45,14 +53,18 @@ public:
         std::shared_ptr<_ItemType>& data(){ return data_; }
         void release(){manager_->release_one(this);}
 
+        // 在allocator中的序号，[0, capacity)，可以用来索引与每个对象对应的其他资源
+        int index() const{ return index_; }
+
     private:
-        MonopolyData(MonopolyAllocator* pmanager){manager_ = pmanager;}
+        MonopolyData(MonopolyAllocator* pmanager, int index){manager_ = pmanager; index_ = index;}
 
     private:
         friend class MonopolyAllocator;
         MonopolyAllocator* manager_ = nullptr;
         std::shared_ptr<_ItemType> data_;
-        bool available_ = true;
+        std::atomic<bool> available_{true};
+        int index_ = 0;
     };
     typedef std::shared_ptr<MonopolyData> MonopolyDataPointer;
 
@@ -60,15 +72,20 @@ public:
         capacity_ = size;
         num_available_ = size;
         datas_.resize(size);
+        next_.reset(new std::atomic<uint32_t>[size]);
+
+        for(int i = 0; i < size; ++i){
+            datas_[i] = std::shared_ptr<MonopolyData>(new MonopolyData(this, i));
 
-        for(int i = 0; i < size; ++i)
-            datas_[i] = std::shared_ptr<MonopolyData>(new MonopolyData(this));
+            // 初始时栈内顺序为0, 1, 2 ... size-1
+            next_[i] = i + 1 < size ? i + 2 : 0;
+        }
+        head_ = size > 0 ? 1 : 0;
     }
 
     virtual ~MonopolyAllocator(){
-        run_ = false;
-        cv_.notify_all();
-        
+        shutdown();
+
         std::unique_lock<std::mutex> l(lock_);
         cv_exit_.wait(l, [&](){
             return num_wait_thread_ == 0;
@@ -81,31 +98,44 @@ public:
     */
     MonopolyDataPointer query(int timeout = 10000){
 
-        std::unique_lock<std::mutex> l(lock_);
         if(!run_) return nullptr;
-        
-        if(num_available_ == 0){
+
+        int index = pop_free();
+        if(index == -1){
+            std::unique_lock<std::mutex> l(lock_);
             num_wait_thread_++;
+            num_waits_++;
 
+            // 先登记等待线程，再重试，与release_one中的先归还、再检查等待线程数配合，保证不会丢失唤醒
             auto state = cv_.wait_for(l, std::chrono::milliseconds(timeout), [&](){
-                return num_available_ > 0 || !run_;
+                return !run_ || (index = pop_free()) != -1;
             });
 
             num_wait_thread_--;
             cv_exit_.notify_one();
 
+            if(index != -1 && !run_){
+                push_free(index);
+                index = -1;
+            }
+
             // timeout, no available, exit program
-            if(!state || num_available_ == 0 || !run_)
+            if(!state || index == -1){
+                if(!state) num_timeouts_++;
                 return nullptr;
+            }
         }
 
-        auto item = std::find_if(datas_.begin(), datas_.end(), [](MonopolyDataPointer& item){return item->available_;});
-        if(item == datas_.end())
-            return nullptr;
-        
-        (*item)->available_ = false;
-        num_available_--;
-        return *item;
+        auto& item = datas_[index];
+        item->available_ = false;
+        return item;
+    }
+
+    // 唤醒正在等待的query，之后的query都返回空指针，已经分配出去的对象仍然可以release
+    void shutdown(){
+        std::unique_lock<std::mutex> l(lock_);
+        run_ = false;
+        cv_.notify_all();
     }
 
     int num_available(){
@@ -116,25 +146,73 @@ public:
         return capacity_;
     }
 
+    // query因为没有可用对象而进入阻塞等待的次数
+    size_t num_waits() const{
+        return num_waits_;
+    }
+
+    // query等待超时返回空指针的次数
+    size_t num_timeouts() const{
+        return num_timeouts_;
+    }
+
 private:
     void release_one(MonopolyData* prq){
-        std::unique_lock<std::mutex> l(lock_);
-        if(!prq->available_){
-            prq->available_ = true;
-            num_available_++;
+
+        // 重复release是允许的，只有第一次有效
+        if(prq->available_.exchange(true))
+            return;
+
+        push_free(prq->index_);
+        if(num_wait_thread_ > 0){
+            std::unique_lock<std::mutex> l(lock_);
             cv_.notify_one();
         }
     }
 
+    int pop_free(){
+        uint64_t head = head_.load();
+        for(;;){
+            uint32_t top = (uint32_t)head;
+            if(top == 0)
+                return -1;
+
+            uint64_t tag  = (head >> 32) + 1;
+            uint64_t next = (tag << 32) | next_[top - 1].load();
+            if(head_.compare_exchange_weak(head, next)){
+                num_available_--;
+                return top - 1;
+            }
+        }
+    }
+
+    void push_free(int index){
+        uint64_t head = head_.load();
+        for(;;){
+            next_[index] = (uint32_t)head;
+
+            uint64_t tag = (head >> 32) + 1;
+            uint64_t top = (tag << 32) | (uint32_t)(index + 1);
+            if(head_.compare_exchange_weak(head, top)){
+                num_available_++;
+                return;
+            }
+        }
+    }
+
 private:
     std::mutex lock_;
     std::condition_variable cv_;
     std::condition_variable cv_exit_;
     std::vector<MonopolyDataPointer> datas_;
+    std::unique_ptr<std::atomic<uint32_t>[]> next_;
+    std::atomic<uint64_t> head_{0};
     int capacity_ = 0;
-    volatile int num_available_ = 0;
-    volatile int num_wait_thread_ = 0;
-    volatile bool run_ = true;
+    std::atomic<int> num_available_{0};
+    std::atomic<int> num_wait_thread_{0};
+    std::atomic<bool> run_{true};
+    std::atomic<size_t> num_waits_{0};
+    std::atomic<size_t> num_timeouts_{0};
 };
 
 #endif // MONOPOLY_ALLOCATOR_HPP
\ No newline at end of file
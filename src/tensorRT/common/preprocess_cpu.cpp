@@ -0,0 +1,747 @@
+#include "preprocess_cpu.hpp"
+#include "thread_pool.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   include <immintrin.h>
+#   define CPU_KERNEL_AVX2
+#elif defined(__aarch64__)
+#   include <arm_neon.h>
+#   define CPU_KERNEL_NEON
+#endif
+
+// SIMD与标量实现使用相同的运算顺序，并且禁止乘加融合，结果才能逐位一致
+#if defined(__clang__)
+#   pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#   pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace CPUKernel{
+
+    enum class SIMD : int{
+        Scalar = 0,
+        AVX2   = 1,
+        NEON   = 2
+    };
+
+    static SIMD detect_simd(){
+#if defined(CPU_KERNEL_AVX2)
+        static const SIMD simd = __builtin_cpu_supports("avx2") ? SIMD::AVX2 : SIMD::Scalar;
+        return simd;
+#elif defined(CPU_KERNEL_NEON)
+        return SIMD::NEON;
+#else
+        return SIMD::Scalar;
+#endif
+    }
+
+    const char* simd_name(){
+        switch(detect_simd()){
+        case SIMD::AVX2: return "AVX2";
+        case SIMD::NEON: return "NEON";
+        default: return "Scalar";
+        }
+    }
+
+    // 按行分块并行执行row(y)，块数取参与线程数的4倍，兼顾负载均衡与调度开销
+    template<class Row>
+    static void parallel_rows(int rows, ThreadPool* pool, const Row& row){
+
+        if(pool == nullptr || pool->size() == 0 || rows < 2){
+            for(int y = 0; y < rows; ++y)
+                row(y);
+            return;
+        }
+
+        int num_blocks = std::min(rows, (pool->size() + 1) * 4);
+        pool->parallel_for(0, num_blocks, [&](int iblock){
+            int begin = (int)((int64_t)rows * iblock / num_blocks);
+            int end   = (int)((int64_t)rows * (iblock + 1) / num_blocks);
+            for(int y = begin; y < end; ++y)
+                row(y);
+        });
+    }
+
+    static inline uint8_t saturate_cast_u8(float value){
+        return (uint8_t)std::min(std::max(value, 0.0f), 255.0f);
+    }
+
+    // 与convert_nv12_to_bgr_kernel相同的公式，浮点结果饱和并截断到uint8
+    static inline void nv12_pixel_to_bgr(uint8_t y, uint8_t u, uint8_t v, uint8_t bgr[3]){
+        bgr[0] = saturate_cast_u8(1.164f * (y - 16.0f) + 2.018f * (u - 128.0f));
+        bgr[1] = saturate_cast_u8(1.164f * (y - 16.0f) - 0.813f * (v - 128.0f) - 0.391f * (u - 128.0f));
+        bgr[2] = saturate_cast_u8(1.164f * (y - 16.0f) + 1.596f * (v - 128.0f));
+    }
+
+    // 交错存储的BGR图像
+    struct BGRSource{
+        const uint8_t* data;
+        int line_size, width, height;
+
+        inline void pixel(int x, int y, uint8_t bgr[3]) const{
+            const uint8_t* p = data + y * line_size + x * 3;
+            bgr[0] = p[0];
+            bgr[1] = p[1];
+            bgr[2] = p[2];
+        }
+    };
+
+    // NV12图像，采样时即时转换为BGR，luma与chroma两个平面的行宽都是line_size
+    struct NV12Source{
+        const uint8_t* luma;
+        const uint8_t* chroma;
+        int line_size, width, height;
+
+        inline void pixel(int x, int y, uint8_t bgr[3]) const{
+            const uint8_t* uv = chroma + (y >> 1) * line_size + (x & ~1);
+            nv12_pixel_to_bgr(luma[y * line_size + x], uv[0], uv[1], bgr);
+        }
+    };
+
+    template<class Source>
+    struct WarpAffineParam{
+        Source source;
+        float* dst;
+        int dst_width, dst_height;
+        float m[6];
+        uint8_t const_value;
+        Norm norm;
+    };
+
+    static inline void normalize_pixel(float& c0, float& c1, float& c2, const Norm& norm){
+
+        if(norm.channel_type == ChannelType::Invert)
+            std::swap(c0, c2);
+
+        if(norm.type == NormType::MeanStd){
+            c0 = (c0 * norm.alpha - norm.mean[0]) / norm.std[0];
+            c1 = (c1 * norm.alpha - norm.mean[1]) / norm.std[1];
+            c2 = (c2 * norm.alpha - norm.mean[2]) / norm.std[2];
+        }else if(norm.type == NormType::AlphaBeta){
+            c0 = c0 * norm.alpha + norm.beta;
+            c1 = c1 * norm.alpha + norm.beta;
+            c2 = c2 * norm.alpha + norm.beta;
+        }
+    }
+
+    // 与warp_affine_bilinear_and_normalize_plane_kernel的插值部分逐行对应
+    template<class Source>
+    static inline void warp_affine_pixel(const WarpAffineParam<Source>& p, int dx, int dy, float& c0, float& c1, float& c2){
+
+        const Source& s = p.source;
+        float src_x = p.m[0] * dx + p.m[1] * dy + p.m[2];
+        float src_y = p.m[3] * dx + p.m[4] * dy + p.m[5];
+        if(src_x <= -1 || src_x >= s.width || src_y <= -1 || src_y >= s.height){
+            // out of range
+            c0 = p.const_value;
+            c1 = p.const_value;
+            c2 = p.const_value;
+            return;
+        }
+
+        int y_low  = floorf(src_y);
+        int x_low  = floorf(src_x);
+        int y_high = y_low + 1;
+        int x_high = x_low + 1;
+
+        uint8_t v1[] = {p.const_value, p.const_value, p.const_value};
+        uint8_t v2[] = {p.const_value, p.const_value, p.const_value};
+        uint8_t v3[] = {p.const_value, p.const_value, p.const_value};
+        uint8_t v4[] = {p.const_value, p.const_value, p.const_value};
+        float ly    = src_y - y_low;
+        float lx    = src_x - x_low;
+        float hy    = 1 - ly;
+        float hx    = 1 - lx;
+        float w1    = hy * hx, w2 = hy * lx, w3 = ly * hx, w4 = ly * lx;
+        if(y_low >= 0){
+            if (x_low >= 0)
+                s.pixel(x_low, y_low, v1);
+
+            if (x_high < s.width)
+                s.pixel(x_high, y_low, v2);
+        }
+
+        if(y_high < s.height){
+            if (x_low >= 0)
+                s.pixel(x_low, y_high, v3);
+
+            if (x_high < s.width)
+                s.pixel(x_high, y_high, v4);
+        }
+
+        c0 = floorf(w1 * v1[0] + w2 * v2[0] + w3 * v3[0] + w4 * v4[0] + 0.5f);
+        c1 = floorf(w1 * v1[1] + w2 * v2[1] + w3 * v3[1] + w4 * v4[1] + 0.5f);
+        c2 = floorf(w1 * v1[2] + w2 * v2[2] + w3 * v3[2] + w4 * v4[2] + 0.5f);
+    }
+
+    template<class Source>
+    static void warp_affine_row_scalar(const WarpAffineParam<Source>& p, int dy, int dx_begin){
+
+        int area = p.dst_width * p.dst_height;
+        float* pdst_c0 = p.dst + dy * p.dst_width;
+        float* pdst_c1 = pdst_c0 + area;
+        float* pdst_c2 = pdst_c1 + area;
+        for(int dx = dx_begin; dx < p.dst_width; ++dx){
+            float c0, c1, c2;
+            warp_affine_pixel(p, dx, dy, c0, c1, c2);
+            normalize_pixel(c0, c1, c2, p.norm);
+            pdst_c0[dx] = c0;
+            pdst_c1[dx] = c1;
+            pdst_c2[dx] = c2;
+        }
+    }
+
+    static void nv12_to_bgr_row_scalar(const NV12Source& s, uint8_t* dst, int y, int x_begin){
+        uint8_t* pdst = dst + (y * s.width + x_begin) * 3;
+        for(int x = x_begin; x < s.width; ++x, pdst += 3)
+            s.pixel(x, y, pdst);
+    }
+
+#ifdef CPU_KERNEL_AVX2
+
+    /* 每个lane从base + offset读取4个字节，valid为0的lane取fallback
+       offset >= safe_limit的lane读取4个字节可能越过图像末尾，改为逐个读取需要的nbytes个字节
+    */
+    __attribute__((target("avx2")))
+    static __m256i gather_bytes(const uint8_t* base, __m256i offset, __m256i valid, int safe_limit, __m256i fallback, int nbytes){
+
+        __m256i safe  = _mm256_and_si256(valid, _mm256_cmpgt_epi32(_mm256_set1_epi32(safe_limit), offset));
+        __m256i value = _mm256_mask_i32gather_epi32(fallback, (const int*)base, offset, safe, 1);
+        int unsafe    = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_andnot_si256(safe, valid)));
+        if(unsafe != 0){
+            alignas(32) int values[8];
+            alignas(32) int offsets[8];
+            _mm256_store_si256((__m256i*)values, value);
+            _mm256_store_si256((__m256i*)offsets, offset);
+            for(int i = 0; i < 8; ++i){
+                if(unsafe & (1 << i)){
+                    const uint8_t* v = base + offsets[i];
+                    values[i] = 0;
+                    for(int ibyte = 0; ibyte < nbytes; ++ibyte)
+                        values[i] |= v[ibyte] << (ibyte * 8);
+                }
+            }
+            value = _mm256_load_si256((const __m256i*)values);
+        }
+        return value;
+    }
+
+    template<int ibyte>
+    __attribute__((target("avx2")))
+    static __m256 byte_to_float(__m256i value){
+        return _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(value, ibyte * 8), _mm256_set1_epi32(0xFF)));
+    }
+
+    // 与saturate_cast_u8相同：饱和到[0, 255]后向零截断
+    __attribute__((target("avx2")))
+    static __m256i saturate_cast_u8_avx2(__m256 value){
+        value = _mm256_min_ps(_mm256_set1_ps(255.0f), _mm256_max_ps(_mm256_setzero_ps(), value));
+        return _mm256_cvttps_epi32(value);
+    }
+
+    // 与nv12_pixel_to_bgr的运算顺序相同，输出为0~255的int32
+    __attribute__((target("avx2")))
+    static void nv12_to_bgr_avx2(__m256 fy, __m256 fu, __m256 fv, __m256i bgr[3]){
+        __m256 luma = _mm256_mul_ps(_mm256_set1_ps(1.164f), _mm256_sub_ps(fy, _mm256_set1_ps(16.0f)));
+        __m256 u    = _mm256_sub_ps(fu, _mm256_set1_ps(128.0f));
+        __m256 v    = _mm256_sub_ps(fv, _mm256_set1_ps(128.0f));
+        bgr[0] = saturate_cast_u8_avx2(_mm256_add_ps(luma, _mm256_mul_ps(_mm256_set1_ps(2.018f), u)));
+        bgr[1] = saturate_cast_u8_avx2(_mm256_sub_ps(_mm256_sub_ps(luma, _mm256_mul_ps(_mm256_set1_ps(0.813f), v)), _mm256_mul_ps(_mm256_set1_ps(0.391f), u)));
+        bgr[2] = saturate_cast_u8_avx2(_mm256_add_ps(luma, _mm256_mul_ps(_mm256_set1_ps(1.596f), v)));
+    }
+
+    // 读取8个lane的(x, y)像素的BGR，valid为0的lane取const_value
+    __attribute__((target("avx2")))
+    static void fetch_avx2(const BGRSource& s, __m256i x, __m256i y, __m256i valid, uint8_t const_value, __m256 bgr[3]){
+
+        __m256i offset = _mm256_add_epi32(_mm256_mullo_epi32(y, _mm256_set1_epi32(s.line_size)), _mm256_mullo_epi32(x, _mm256_set1_epi32(3)));
+        int safe_limit = (s.height - 1) * s.line_size + s.width * 3 - 3;
+        __m256i pixel  = gather_bytes(s.data, offset, valid, safe_limit, _mm256_set1_epi32(const_value * 0x010101), 3);
+        bgr[0] = byte_to_float<0>(pixel);
+        bgr[1] = byte_to_float<1>(pixel);
+        bgr[2] = byte_to_float<2>(pixel);
+    }
+
+    __attribute__((target("avx2")))
+    static void fetch_avx2(const NV12Source& s, __m256i x, __m256i y, __m256i valid, uint8_t const_value, __m256 bgr[3]){
+
+        __m256i line      = _mm256_set1_epi32(s.line_size);
+        __m256i y_offset  = _mm256_add_epi32(_mm256_mullo_epi32(y, line), x);
+        __m256i uv_offset = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srai_epi32(y, 1), line), _mm256_and_si256(x, _mm256_set1_epi32(~1)));
+        int y_limit       = (s.height - 1) * s.line_size + s.width - 3;
+        int uv_limit      = ((s.height - 1) >> 1) * s.line_size + ((s.width + 1) & ~1) - 3;
+        __m256i luma      = gather_bytes(s.luma,   y_offset,  valid, y_limit,  _mm256_setzero_si256(), 1);
+        __m256i chroma    = gather_bytes(s.chroma, uv_offset, valid, uv_limit, _mm256_setzero_si256(), 2);
+
+        __m256i converted[3];
+        __m256 fconst = _mm256_set1_ps((float)const_value);
+        __m256 mask   = _mm256_castsi256_ps(valid);
+        nv12_to_bgr_avx2(byte_to_float<0>(luma), byte_to_float<0>(chroma), byte_to_float<1>(chroma), converted);
+        for(int ic = 0; ic < 3; ++ic)
+            bgr[ic] = _mm256_blendv_ps(fconst, _mm256_cvtepi32_ps(converted[ic]), mask);
+    }
+
+    // (w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4 + 0.5)向下取整，运算顺序与标量实现相同
+    __attribute__((target("avx2")))
+    static __m256 bilinear_avx2(__m256 v1, __m256 v2, __m256 v3, __m256 v4, __m256 w1, __m256 w2, __m256 w3, __m256 w4){
+        __m256 value = _mm256_add_ps(_mm256_mul_ps(w1, v1), _mm256_mul_ps(w2, v2));
+        value = _mm256_add_ps(value, _mm256_mul_ps(w3, v3));
+        value = _mm256_add_ps(value, _mm256_mul_ps(w4, v4));
+        return _mm256_floor_ps(_mm256_add_ps(value, _mm256_set1_ps(0.5f)));
+    }
+
+    __attribute__((target("avx2")))
+    static void normalize_avx2(__m256& c0, __m256& c1, __m256& c2, const Norm& norm){
+
+        if(norm.channel_type == ChannelType::Invert)
+            std::swap(c0, c2);
+
+        __m256 alpha = _mm256_set1_ps(norm.alpha);
+        if(norm.type == NormType::MeanStd){
+            c0 = _mm256_div_ps(_mm256_sub_ps(_mm256_mul_ps(c0, alpha), _mm256_set1_ps(norm.mean[0])), _mm256_set1_ps(norm.std[0]));
+            c1 = _mm256_div_ps(_mm256_sub_ps(_mm256_mul_ps(c1, alpha), _mm256_set1_ps(norm.mean[1])), _mm256_set1_ps(norm.std[1]));
+            c2 = _mm256_div_ps(_mm256_sub_ps(_mm256_mul_ps(c2, alpha), _mm256_set1_ps(norm.mean[2])), _mm256_set1_ps(norm.std[2]));
+        }else if(norm.type == NormType::AlphaBeta){
+            __m256 beta = _mm256_set1_ps(norm.beta);
+            c0 = _mm256_add_ps(_mm256_mul_ps(c0, alpha), beta);
+            c1 = _mm256_add_ps(_mm256_mul_ps(c1, alpha), beta);
+            c2 = _mm256_add_ps(_mm256_mul_ps(c2, alpha), beta);
+        }
+    }
+
+    // 一次处理8个dst像素，不足8个的尾部使用标量实现
+    template<class Source>
+    __attribute__((target("avx2")))
+    static void warp_affine_row_avx2(const WarpAffineParam<Source>& p, int dy){
+
+        const Source& s = p.source;
+        int area = p.dst_width * p.dst_height;
+        float* pdst_c0 = p.dst + dy * p.dst_width;
+        float* pdst_c1 = pdst_c0 + area;
+        float* pdst_c2 = pdst_c1 + area;
+
+        const __m256 lane     = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256 one      = _mm256_set1_ps(1.0f);
+        const __m256 fdy      = _mm256_set1_ps((float)dy);
+        const __m256 m0       = _mm256_set1_ps(p.m[0]);
+        const __m256 m2       = _mm256_set1_ps(p.m[2]);
+        const __m256 m3       = _mm256_set1_ps(p.m[3]);
+        const __m256 m5       = _mm256_set1_ps(p.m[5]);
+        const __m256 row_x    = _mm256_mul_ps(_mm256_set1_ps(p.m[1]), fdy);
+        const __m256 row_y    = _mm256_mul_ps(_mm256_set1_ps(p.m[4]), fdy);
+        const __m256 low      = _mm256_set1_ps(-1.0f);
+        const __m256 fwidth   = _mm256_set1_ps((float)s.width);
+        const __m256 fheight  = _mm256_set1_ps((float)s.height);
+        const __m256 fconst   = _mm256_set1_ps((float)p.const_value);
+        const __m256i iwidth  = _mm256_set1_epi32(s.width);
+        const __m256i iheight = _mm256_set1_epi32(s.height);
+        const __m256i ione    = _mm256_set1_epi32(1);
+        const __m256i minus   = _mm256_set1_epi32(-1);
+
+        int dx = 0;
+        for(; dx + 8 <= p.dst_width; dx += 8){
+
+            __m256 fdx     = _mm256_add_ps(_mm256_set1_ps((float)dx), lane);
+            __m256 src_x   = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m0, fdx), row_x), m2);
+            __m256 src_y   = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m3, fdx), row_y), m5);
+            __m256 outside = _mm256_or_ps(
+                _mm256_or_ps(_mm256_cmp_ps(src_x, low, _CMP_LE_OQ), _mm256_cmp_ps(src_x, fwidth,  _CMP_GE_OQ)),
+                _mm256_or_ps(_mm256_cmp_ps(src_y, low, _CMP_LE_OQ), _mm256_cmp_ps(src_y, fheight, _CMP_GE_OQ))
+            );
+
+            __m256 c0 = fconst, c1 = fconst, c2 = fconst;
+            if(_mm256_movemask_ps(outside) != 0xFF){
+                __m256 fx_low  = _mm256_floor_ps(src_x);
+                __m256 fy_low  = _mm256_floor_ps(src_y);
+                __m256i x_low  = _mm256_cvttps_epi32(fx_low);
+                __m256i y_low  = _mm256_cvttps_epi32(fy_low);
+                __m256i x_high = _mm256_add_epi32(x_low, ione);
+                __m256i y_high = _mm256_add_epi32(y_low, ione);
+
+                __m256 ly = _mm256_sub_ps(src_y, fy_low);
+                __m256 lx = _mm256_sub_ps(src_x, fx_low);
+                __m256 hy = _mm256_sub_ps(one, ly);
+                __m256 hx = _mm256_sub_ps(one, lx);
+                __m256 w1 = _mm256_mul_ps(hy, hx);
+                __m256 w2 = _mm256_mul_ps(hy, lx);
+                __m256 w3 = _mm256_mul_ps(ly, hx);
+                __m256 w4 = _mm256_mul_ps(ly, lx);
+
+                __m256i inside    = _mm256_andnot_si256(_mm256_castps_si256(outside), minus);
+                __m256i x_low_ok  = _mm256_cmpgt_epi32(x_low, minus);
+                __m256i x_high_ok = _mm256_cmpgt_epi32(iwidth, x_high);
+                __m256i y_low_ok  = _mm256_and_si256(inside, _mm256_cmpgt_epi32(y_low, minus));
+                __m256i y_high_ok = _mm256_and_si256(inside, _mm256_cmpgt_epi32(iheight, y_high));
+
+                __m256 v1[3], v2[3], v3[3], v4[3];
+                fetch_avx2(s, x_low,  y_low,  _mm256_and_si256(y_low_ok,  x_low_ok),  p.const_value, v1);
+                fetch_avx2(s, x_high, y_low,  _mm256_and_si256(y_low_ok,  x_high_ok), p.const_value, v2);
+                fetch_avx2(s, x_low,  y_high, _mm256_and_si256(y_high_ok, x_low_ok),  p.const_value, v3);
+                fetch_avx2(s, x_high, y_high, _mm256_and_si256(y_high_ok, x_high_ok), p.const_value, v4);
+
+                c0 = _mm256_blendv_ps(bilinear_avx2(v1[0], v2[0], v3[0], v4[0], w1, w2, w3, w4), fconst, outside);
+                c1 = _mm256_blendv_ps(bilinear_avx2(v1[1], v2[1], v3[1], v4[1], w1, w2, w3, w4), fconst, outside);
+                c2 = _mm256_blendv_ps(bilinear_avx2(v1[2], v2[2], v3[2], v4[2], w1, w2, w3, w4), fconst, outside);
+            }
+
+            normalize_avx2(c0, c1, c2, p.norm);
+            _mm256_storeu_ps(pdst_c0 + dx, c0);
+            _mm256_storeu_ps(pdst_c1 + dx, c1);
+            _mm256_storeu_ps(pdst_c2 + dx, c2);
+        }
+        warp_affine_row_scalar(p, dy, dx);
+    }
+
+    // 8个int32(0~255)压缩为8个字节
+    __attribute__((target("avx2")))
+    static __m128i pack_u8x8(__m256i value){
+        return _mm_packus_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+    }
+
+    // 一次转换8个像素，uv一次读取4对，输出的24个字节通过shuffle交错为BGR
+    __attribute__((target("avx2")))
+    static void nv12_to_bgr_row_avx2(const NV12Source& s, uint8_t* dst, int y){
+
+        const uint8_t* py  = s.luma + y * s.line_size;
+        const uint8_t* puv = s.chroma + (y >> 1) * s.line_size;
+        uint8_t* pdst      = dst + y * s.width * 3;
+
+        const __m128i dup_u   = _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i dup_v   = _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i bg_lo   = _mm_setr_epi8(0, 8, -1, 1, 9, -1, 2, 10, -1, 3, 11, -1, 4, 12, -1, 5);
+        const __m128i r_lo    = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+        const __m128i bg_hi   = _mm_setr_epi8(13, -1, 6, 14, -1, 7, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i r_hi    = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+
+        int x = 0;
+        for(; x + 8 <= s.width; x += 8){
+            __m128i luma   = _mm_loadl_epi64((const __m128i*)(py + x));
+            __m128i chroma = _mm_loadl_epi64((const __m128i*)(puv + x));
+            __m256 fy = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(luma));
+            __m256 fu = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_shuffle_epi8(chroma, dup_u)));
+            __m256 fv = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_shuffle_epi8(chroma, dup_v)));
+
+            __m256i bgr[3];
+            nv12_to_bgr_avx2(fy, fu, fv, bgr);
+
+            __m128i bg = _mm_packus_epi16(pack_u8x8(bgr[0]), pack_u8x8(bgr[1]));
+            __m128i r  = _mm_packus_epi16(pack_u8x8(bgr[2]), pack_u8x8(bgr[2]));
+            _mm_storeu_si128((__m128i*)pdst, _mm_or_si128(_mm_shuffle_epi8(bg, bg_lo), _mm_shuffle_epi8(r, r_lo)));
+            _mm_storel_epi64((__m128i*)(pdst + 16), _mm_or_si128(_mm_shuffle_epi8(bg, bg_hi), _mm_shuffle_epi8(r, r_hi)));
+            pdst += 24;
+        }
+        nv12_to_bgr_row_scalar(s, dst, y, x);
+    }
+#endif // CPU_KERNEL_AVX2
+
+#ifdef CPU_KERNEL_NEON
+
+    static void normalize_neon(float32x4_t& c0, float32x4_t& c1, float32x4_t& c2, const Norm& norm){
+
+        if(norm.channel_type == ChannelType::Invert)
+            std::swap(c0, c2);
+
+        float32x4_t alpha = vdupq_n_f32(norm.alpha);
+        if(norm.type == NormType::MeanStd){
+            c0 = vdivq_f32(vsubq_f32(vmulq_f32(c0, alpha), vdupq_n_f32(norm.mean[0])), vdupq_n_f32(norm.std[0]));
+            c1 = vdivq_f32(vsubq_f32(vmulq_f32(c1, alpha), vdupq_n_f32(norm.mean[1])), vdupq_n_f32(norm.std[1]));
+            c2 = vdivq_f32(vsubq_f32(vmulq_f32(c2, alpha), vdupq_n_f32(norm.mean[2])), vdupq_n_f32(norm.std[2]));
+        }else if(norm.type == NormType::AlphaBeta){
+            float32x4_t beta = vdupq_n_f32(norm.beta);
+            c0 = vaddq_f32(vmulq_f32(c0, alpha), beta);
+            c1 = vaddq_f32(vmulq_f32(c1, alpha), beta);
+            c2 = vaddq_f32(vmulq_f32(c2, alpha), beta);
+        }
+    }
+
+    // 一次处理4个dst像素，NEON没有gather，4个邻居逐lane读取，坐标、权重、插值与归一化向量化
+    template<class Source>
+    static void warp_affine_row_neon(const WarpAffineParam<Source>& p, int dy){
+
+        const Source& s = p.source;
+        int area = p.dst_width * p.dst_height;
+        float* pdst_c0 = p.dst + dy * p.dst_width;
+        float* pdst_c1 = pdst_c0 + area;
+        float* pdst_c2 = pdst_c1 + area;
+
+        const float lane_values[] = {0, 1, 2, 3};
+        const float32x4_t lane    = vld1q_f32(lane_values);
+        const float32x4_t one     = vdupq_n_f32(1.0f);
+        const float32x4_t half    = vdupq_n_f32(0.5f);
+        const float32x4_t fdy     = vdupq_n_f32((float)dy);
+        const float32x4_t m0      = vdupq_n_f32(p.m[0]);
+        const float32x4_t m2      = vdupq_n_f32(p.m[2]);
+        const float32x4_t m3      = vdupq_n_f32(p.m[3]);
+        const float32x4_t m5      = vdupq_n_f32(p.m[5]);
+        const float32x4_t row_x   = vmulq_f32(vdupq_n_f32(p.m[1]), fdy);
+        const float32x4_t row_y   = vmulq_f32(vdupq_n_f32(p.m[4]), fdy);
+        const float32x4_t low     = vdupq_n_f32(-1.0f);
+        const float32x4_t fwidth  = vdupq_n_f32((float)s.width);
+        const float32x4_t fheight = vdupq_n_f32((float)s.height);
+        const float32x4_t fconst  = vdupq_n_f32((float)p.const_value);
+
+        int dx = 0;
+        for(; dx + 4 <= p.dst_width; dx += 4){
+
+            float32x4_t fdx    = vaddq_f32(vdupq_n_f32((float)dx), lane);
+            float32x4_t src_x  = vaddq_f32(vaddq_f32(vmulq_f32(m0, fdx), row_x), m2);
+            float32x4_t src_y  = vaddq_f32(vaddq_f32(vmulq_f32(m3, fdx), row_y), m5);
+            uint32x4_t outside = vorrq_u32(
+                vorrq_u32(vcleq_f32(src_x, low), vcgeq_f32(src_x, fwidth)),
+                vorrq_u32(vcleq_f32(src_y, low), vcgeq_f32(src_y, fheight))
+            );
+
+            float32x4_t c0 = fconst, c1 = fconst, c2 = fconst;
+            if(vminvq_u32(outside) == 0){
+                float32x4_t fx_low = vrndmq_f32(src_x);
+                float32x4_t fy_low = vrndmq_f32(src_y);
+                float32x4_t ly = vsubq_f32(src_y, fy_low);
+                float32x4_t lx = vsubq_f32(src_x, fx_low);
+                float32x4_t hy = vsubq_f32(one, ly);
+                float32x4_t hx = vsubq_f32(one, lx);
+                float32x4_t w1 = vmulq_f32(hy, hx);
+                float32x4_t w2 = vmulq_f32(hy, lx);
+                float32x4_t w3 = vmulq_f32(ly, hx);
+                float32x4_t w4 = vmulq_f32(ly, lx);
+
+                int x_lows[4], y_lows[4];
+                uint32_t outsides[4];
+                vst1q_s32(x_lows, vcvtq_s32_f32(fx_low));
+                vst1q_s32(y_lows, vcvtq_s32_f32(fy_low));
+                vst1q_u32(outsides, outside);
+
+                // values[邻居][通道][lane]
+                float values[4][3][4];
+                for(int i = 0; i < 4; ++i){
+                    uint8_t v[4][3];
+                    memset(v, p.const_value, sizeof(v));
+                    if(!outsides[i]){
+                        int x_low  = x_lows[i];
+                        int y_low  = y_lows[i];
+                        int x_high = x_low + 1;
+                        int y_high = y_low + 1;
+                        if(y_low >= 0){
+                            if(x_low >= 0)       s.pixel(x_low,  y_low, v[0]);
+                            if(x_high < s.width) s.pixel(x_high, y_low, v[1]);
+                        }
+                        if(y_high < s.height){
+                            if(x_low >= 0)       s.pixel(x_low,  y_high, v[2]);
+                            if(x_high < s.width) s.pixel(x_high, y_high, v[3]);
+                        }
+                    }
+
+                    for(int k = 0; k < 4; ++k){
+                        values[k][0][i] = v[k][0];
+                        values[k][1][i] = v[k][1];
+                        values[k][2][i] = v[k][2];
+                    }
+                }
+
+                float32x4_t c[3];
+                for(int ic = 0; ic < 3; ++ic){
+                    float32x4_t value = vaddq_f32(vmulq_f32(w1, vld1q_f32(values[0][ic])), vmulq_f32(w2, vld1q_f32(values[1][ic])));
+                    value = vaddq_f32(value, vmulq_f32(w3, vld1q_f32(values[2][ic])));
+                    value = vaddq_f32(value, vmulq_f32(w4, vld1q_f32(values[3][ic])));
+                    c[ic] = vbslq_f32(outside, fconst, vrndmq_f32(vaddq_f32(value, half)));
+                }
+                c0 = c[0];
+                c1 = c[1];
+                c2 = c[2];
+            }
+
+            normalize_neon(c0, c1, c2, p.norm);
+            vst1q_f32(pdst_c0 + dx, c0);
+            vst1q_f32(pdst_c1 + dx, c1);
+            vst1q_f32(pdst_c2 + dx, c2);
+        }
+        warp_affine_row_scalar(p, dy, dx);
+    }
+
+    // 与saturate_cast_u8相同：饱和到[0, 255]后向零截断
+    static uint16x4_t saturate_cast_u8_neon(float32x4_t value){
+        value = vminq_f32(vmaxq_f32(value, vdupq_n_f32(0.0f)), vdupq_n_f32(255.0f));
+        return vmovn_u32(vcvtq_u32_f32(value));
+    }
+
+    // 4个像素的BGR，与nv12_pixel_to_bgr的运算顺序相同
+    static void nv12_to_bgr_neon(uint16x4_t y, uint16x4_t u, uint16x4_t v, uint16x4_t bgr[3]){
+        float32x4_t luma = vmulq_f32(vdupq_n_f32(1.164f), vsubq_f32(vcvtq_f32_u32(vmovl_u16(y)), vdupq_n_f32(16.0f)));
+        float32x4_t fu   = vsubq_f32(vcvtq_f32_u32(vmovl_u16(u)), vdupq_n_f32(128.0f));
+        float32x4_t fv   = vsubq_f32(vcvtq_f32_u32(vmovl_u16(v)), vdupq_n_f32(128.0f));
+        bgr[0] = saturate_cast_u8_neon(vaddq_f32(luma, vmulq_f32(vdupq_n_f32(2.018f), fu)));
+        bgr[1] = saturate_cast_u8_neon(vsubq_f32(vsubq_f32(luma, vmulq_f32(vdupq_n_f32(0.813f), fv)), vmulq_f32(vdupq_n_f32(0.391f), fu)));
+        bgr[2] = saturate_cast_u8_neon(vaddq_f32(luma, vmulq_f32(vdupq_n_f32(1.596f), fv)));
+    }
+
+    // 一次转换16个像素，vst3q_u8直接交错写出BGR
+    static void nv12_to_bgr_row_neon(const NV12Source& s, uint8_t* dst, int y){
+
+        const uint8_t* py  = s.luma + y * s.line_size;
+        const uint8_t* puv = s.chroma + (y >> 1) * s.line_size;
+        uint8_t* pdst      = dst + y * s.width * 3;
+
+        int x = 0;
+        for(; x + 16 <= s.width; x += 16){
+            uint8x16_t luma    = vld1q_u8(py + x);
+            uint8x8x2_t chroma = vld2_u8(puv + x);
+            uint8x8x2_t u      = vzip_u8(chroma.val[0], chroma.val[0]);
+            uint8x8x2_t v      = vzip_u8(chroma.val[1], chroma.val[1]);
+            uint16x8_t y16[]   = {vmovl_u8(vget_low_u8(luma)), vmovl_u8(vget_high_u8(luma))};
+            uint16x8_t u16[]   = {vmovl_u8(u.val[0]), vmovl_u8(u.val[1])};
+            uint16x8_t v16[]   = {vmovl_u8(v.val[0]), vmovl_u8(v.val[1])};
+
+            uint8x8_t channels[3][2];
+            for(int half = 0; half < 2; ++half){
+                uint16x4_t lo[3], hi[3];
+                nv12_to_bgr_neon(vget_low_u16(y16[half]),  vget_low_u16(u16[half]),  vget_low_u16(v16[half]),  lo);
+                nv12_to_bgr_neon(vget_high_u16(y16[half]), vget_high_u16(u16[half]), vget_high_u16(v16[half]), hi);
+                for(int ic = 0; ic < 3; ++ic)
+                    channels[ic][half] = vmovn_u16(vcombine_u16(lo[ic], hi[ic]));
+            }
+
+            uint8x16x3_t bgr;
+            for(int ic = 0; ic < 3; ++ic)
+                bgr.val[ic] = vcombine_u8(channels[ic][0], channels[ic][1]);
+            vst3q_u8(pdst, bgr);
+            pdst += 48;
+        }
+        nv12_to_bgr_row_scalar(s, dst, y, x);
+    }
+#endif // CPU_KERNEL_NEON
+
+    template<class Source>
+    static void warp_affine_plane(const WarpAffineParam<Source>& param, ThreadPool* pool){
+
+        typedef void (*Row)(const WarpAffineParam<Source>& param, int dy);
+        Row row = nullptr;
+        switch(detect_simd()){
+#if defined(CPU_KERNEL_AVX2)
+        case SIMD::AVX2: row = warp_affine_row_avx2<Source>; break;
+#elif defined(CPU_KERNEL_NEON)
+        case SIMD::NEON: row = warp_affine_row_neon<Source>; break;
+#endif
+        default: break;
+        }
+
+        parallel_rows(param.dst_height, pool, [&](int dy){
+            if(row) row(param, dy);
+            else    warp_affine_row_scalar(param, dy, 0);
+        });
+    }
+
+    template<class Source>
+    static void warp_affine_plane_reference(const WarpAffineParam<Source>& param){
+
+        int area = param.dst_width * param.dst_height;
+        for(int position = 0; position < area; ++position){
+            int dx = position % param.dst_width;
+            int dy = position / param.dst_width;
+            float c0, c1, c2;
+            warp_affine_pixel(param, dx, dy, c0, c1, c2);
+            normalize_pixel(c0, c1, c2, param.norm);
+            param.dst[position]            = c0;
+            param.dst[position + area]     = c1;
+            param.dst[position + area * 2] = c2;
+        }
+    }
+
+    template<class Source>
+    static WarpAffineParam<Source> make_param(
+        const Source& source, float* dst, int dst_width, int dst_height,
+        const float* matrix_2_3, uint8_t const_value, const Norm& norm
+    ){
+        WarpAffineParam<Source> param;
+        param.source      = source;
+        param.dst         = dst;
+        param.dst_width   = dst_width;
+        param.dst_height  = dst_height;
+        param.const_value = const_value;
+        param.norm        = norm;
+        std::copy(matrix_2_3, matrix_2_3 + 6, param.m);
+        return param;
+    }
+
+    static BGRSource make_bgr_source(const uint8_t* src, int src_line_size, int src_width, int src_height){
+        BGRSource source;
+        source.data      = src;
+        source.line_size = src_line_size;
+        source.width     = src_width;
+        source.height    = src_height;
+        return source;
+    }
+
+    static NV12Source make_nv12_source(const uint8_t* y, const uint8_t* uv, int width, int height, int linesize){
+        NV12Source source;
+        source.luma      = y;
+        source.chroma    = uv;
+        source.line_size = linesize;
+        source.width     = width;
+        source.height    = height;
+        return source;
+    }
+
+    void warp_affine_bilinear_and_normalize_plane(
+        const uint8_t* src, int src_line_size, int src_width, int src_height,
+        float* dst  , int dst_width, int dst_height,
+        const float* matrix_2_3, uint8_t const_value, const Norm& norm,
+        ThreadPool* pool
+    ){
+        auto source = make_bgr_source(src, src_line_size, src_width, src_height);
+        warp_affine_plane(make_param(source, dst, dst_width, dst_height, matrix_2_3, const_value, norm), pool);
+    }
+
+    void warp_affine_bilinear_and_normalize_plane_reference(
+        const uint8_t* src, int src_line_size, int src_width, int src_height,
+        float* dst  , int dst_width, int dst_height,
+        const float* matrix_2_3, uint8_t const_value, const Norm& norm
+    ){
+        auto source = make_bgr_source(src, src_line_size, src_width, src_height);
+        warp_affine_plane_reference(make_param(source, dst, dst_width, dst_height, matrix_2_3, const_value, norm));
+    }
+
+    void warp_affine_bilinear_and_normalize_plane_nv12(
+        const uint8_t* y, const uint8_t* uv, int src_width, int src_height, int linesize,
+        float* dst  , int dst_width, int dst_height,
+        const float* matrix_2_3, uint8_t const_value, const Norm& norm,
+        ThreadPool* pool
+    ){
+        auto source = make_nv12_source(y, uv, src_width, src_height, linesize);
+        warp_affine_plane(make_param(source, dst, dst_width, dst_height, matrix_2_3, const_value, norm), pool);
+    }
+
+    void convert_nv12_to_bgr(
+        const uint8_t* y, const uint8_t* uv, int width, int height, int linesize,
+        uint8_t* dst, ThreadPool* pool
+    ){
+        auto source = make_nv12_source(y, uv, width, height, linesize);
+        typedef void (*Row)(const NV12Source& source, uint8_t* dst, int y);
+        Row row = nullptr;
+        switch(detect_simd()){
+#if defined(CPU_KERNEL_AVX2)
+        case SIMD::AVX2: row = nv12_to_bgr_row_avx2; break;
+#elif defined(CPU_KERNEL_NEON)
+        case SIMD::NEON: row = nv12_to_bgr_row_neon; break;
+#endif
+        default: break;
+        }
+
+        parallel_rows(height, pool, [&](int iy){
+            if(row) row(source, dst, iy);
+            else    nv12_to_bgr_row_scalar(source, dst, iy, 0);
+        });
+    }
+
+    void convert_nv12_to_bgr_reference(
+        const uint8_t* y, const uint8_t* uv, int width, int height, int linesize,
+        uint8_t* dst
+    ){
+        auto source = make_nv12_source(y, uv, width, height, linesize);
+        for(int iy = 0; iy < height; ++iy)
+            nv12_to_bgr_row_scalar(source, dst, iy, 0);
+    }
+
+}; // namespace CPUKernel
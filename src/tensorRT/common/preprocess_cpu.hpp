@@ -0,0 +1,64 @@
+#ifndef PREPROCESS_CPU_HPP
+#define PREPROCESS_CPU_HPP
+
+#include "preprocess_kernel.cuh"
+
+class ThreadPool;
+
+/**
+ * 预处理kernel的CPU实现，语义与CUDAKernel中的同名函数完全一致
+ * x86上运行时检测AVX2，aarch64上使用NEON，其他平台使用标量实现
+ **/
+namespace CPUKernel{
+
+    using CUDAKernel::Norm;
+    using CUDAKernel::NormType;
+    using CUDAKernel::ChannelType;
+
+    /* 仿射变换 + 双线性插值 + 归一化 + BGR交错转planar，一次遍历直接写入dst的3个通道平面
+       matrix_2_3为dst到src的变换矩阵，超出src范围的像素取const_value
+       pool不为空时按行分块并行，为空时在调用线程上执行
+    */
+    void warp_affine_bilinear_and_normalize_plane(
+        const uint8_t* src, int src_line_size, int src_width, int src_height,
+        float* dst  , int dst_width, int dst_height,
+        const float* matrix_2_3, uint8_t const_value, const Norm& norm,
+        ThreadPool* pool = nullptr
+    );
+
+    // 逐像素的标量实现，与CUDA kernel一一对应，作为SIMD实现的对照
+    void warp_affine_bilinear_and_normalize_plane_reference(
+        const uint8_t* src, int src_line_size, int src_width, int src_height,
+        float* dst  , int dst_width, int dst_height,
+        const float* matrix_2_3, uint8_t const_value, const Norm& norm
+    );
+
+    /* NV12直接经仿射变换写入planar float tensor，采样时即时转换为BGR，不产生中间的BGR图像
+       y为width x height的亮度平面，uv为交错的色度平面，两个平面的行宽都是linesize
+       结果与先convert_nv12_to_bgr再warp_affine_bilinear_and_normalize_plane逐位一致
+    */
+    void warp_affine_bilinear_and_normalize_plane_nv12(
+        const uint8_t* y, const uint8_t* uv, int src_width, int src_height, int linesize,
+        float* dst  , int dst_width, int dst_height,
+        const float* matrix_2_3, uint8_t const_value, const Norm& norm,
+        ThreadPool* pool = nullptr
+    );
+
+    // 与CUDAKernel::convert_nv12_to_bgr_invoke相同，dst为连续存储的width x height x 3的BGR图像，可直接用于显示
+    void convert_nv12_to_bgr(
+        const uint8_t* y, const uint8_t* uv, int width, int height, int linesize,
+        uint8_t* dst, ThreadPool* pool = nullptr
+    );
+
+    // 逐像素的标量实现，作为SIMD实现的对照
+    void convert_nv12_to_bgr_reference(
+        const uint8_t* y, const uint8_t* uv, int width, int height, int linesize,
+        uint8_t* dst
+    );
+
+    // 当前使用的指令集，"AVX2"、"NEON"或"Scalar"
+    const char* simd_name();
+
+}; // namespace CPUKernel
+
+#endif // PREPROCESS_CPU_HPP
@@ -0,0 +1,391 @@
+#include "remap_cache.hpp"
+#include "thread_pool.hpp"
+#include "ilogger.hpp"
+#include <cmath>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   include <immintrin.h>
+#   define REMAP_CACHE_AVX2
+#endif
+
+namespace CPUKernel{
+
+    #define REMAP_COEF_BITS  11
+    #define REMAP_COEF_SCALE (1 << REMAP_COEF_BITS)
+    #define REMAP_CAST_BITS  (REMAP_COEF_BITS << 1)
+
+    enum AxisState : uint8_t{
+        Outside = 0,    // 超出图像，整个像素取填充值
+        Edge    = 1,    // 有一个邻居超出图像，该邻居取填充值
+        Inner   = 2     // 两个邻居都在图像内
+    };
+
+    void letterbox_matrix(int src_width, int src_height, int dst_width, int dst_height, float i2d[6], float d2i[6]){
+
+        float scale_x = dst_width / (float)src_width;
+        float scale_y = dst_height / (float)src_height;
+        float scale   = std::min(scale_x, scale_y);
+        i2d[0] = scale;  i2d[1] = 0;  i2d[2] = -scale * src_width  * 0.5  + dst_width * 0.5 + scale * 0.5 - 0.5;
+        i2d[3] = 0;  i2d[4] = scale;  i2d[5] = -scale * src_height * 0.5 + dst_height * 0.5 + scale * 0.5 - 0.5;
+
+        // 与cv::invertAffineTransform相同，使用double计算
+        double D   = i2d[0] * i2d[4] - i2d[1] * i2d[3];
+        D          = D != 0 ? 1.0 / D : 0;
+        double A11 = i2d[4] * D, A22 = i2d[0] * D, A12 = -i2d[1] * D, A21 = -i2d[3] * D;
+        double b1  = -A11 * i2d[2] - A12 * i2d[5];
+        double b2  = -A21 * i2d[2] - A22 * i2d[5];
+        d2i[0] = A11;  d2i[1] = A12;  d2i[2] = b1;
+        d2i[3] = A21;  d2i[4] = A22;  d2i[5] = b2;
+    }
+
+#ifdef REMAP_CACHE_AVX2
+
+    static bool support_avx2(){
+        static const bool support = __builtin_cpu_supports("avx2");
+        return support;
+    }
+
+    /* 内部区域的8个像素一组，每行gather两次：offset处的4个字节为左邻居BGR，offset + 3处为右邻居BGR
+       返回处理到的位置，剩余不足8个的像素由调用者处理
+    */
+    __attribute__((target("avx2")))
+    static int remap_inner_avx2(
+        const uint8_t* row0, const uint8_t* row1, const int* x_low, const int* x_weight, int ly,
+        int begin, int end, const float* luts[3], const int channels[3], float* planes[3]
+    ){
+        __m256i byte_mask = _mm256_set1_epi32(0xFF);
+        __m256i high_mask = _mm256_set1_epi32(0xFF0000);
+        __m256i coef      = _mm256_set1_epi32(REMAP_COEF_SCALE);
+        __m256i round     = _mm256_set1_epi32(1 << (REMAP_CAST_BITS - 1));
+        __m256i wly       = _mm256_set1_epi32(ly);
+        __m256i why       = _mm256_set1_epi32(REMAP_COEF_SCALE - ly);
+
+        int dx = begin;
+        for(; dx + 8 <= end; dx += 8){
+            __m256i low    = _mm256_loadu_si256((const __m256i*)(x_low + dx));
+            __m256i offset = _mm256_add_epi32(low, _mm256_add_epi32(low, low));
+            __m256i lx     = _mm256_loadu_si256((const __m256i*)(x_weight + dx));
+            __m256i wx     = _mm256_or_si256(_mm256_sub_epi32(coef, lx), _mm256_slli_epi32(lx, 16));
+            __m256i v1     = _mm256_i32gather_epi32((const int*)row0, offset, 1);
+            __m256i v2     = _mm256_i32gather_epi32((const int*)(row0 + 3), offset, 1);
+            __m256i v3     = _mm256_i32gather_epi32((const int*)row1, offset, 1);
+            __m256i v4     = _mm256_i32gather_epi32((const int*)(row1 + 3), offset, 1);
+
+            // 左右邻居组成16位的一对，与(hx, lx)做madd得到水平插值
+            __m256i value[3];
+            for(int ic = 0; ic < 3; ++ic){
+                __m256i p12 = _mm256_or_si256(_mm256_and_si256(v1, byte_mask), _mm256_and_si256(_mm256_slli_epi32(v2, 16), high_mask));
+                __m256i p34 = _mm256_or_si256(_mm256_and_si256(v3, byte_mask), _mm256_and_si256(_mm256_slli_epi32(v4, 16), high_mask));
+                __m256i top = _mm256_madd_epi16(p12, wx);
+                __m256i bot = _mm256_madd_epi16(p34, wx);
+                __m256i sum = _mm256_add_epi32(_mm256_mullo_epi32(why, top), _mm256_mullo_epi32(wly, bot));
+                value[ic]   = _mm256_srli_epi32(_mm256_add_epi32(sum, round), REMAP_CAST_BITS);
+                v1 = _mm256_srli_epi32(v1, 8);
+                v2 = _mm256_srli_epi32(v2, 8);
+                v3 = _mm256_srli_epi32(v3, 8);
+                v4 = _mm256_srli_epi32(v4, 8);
+            }
+
+            for(int ic = 0; ic < 3; ++ic)
+                _mm256_storeu_ps(planes[ic] + dx, _mm256_i32gather_ps(luts[ic], value[channels[ic]], 4));
+        }
+        return dx;
+    }
+
+#endif // REMAP_CACHE_AVX2
+
+    static bool same_norm(const Norm& a, const Norm& b){
+
+        if(a.type != b.type || a.channel_type != b.channel_type)
+            return false;
+
+        if(a.type == NormType::MeanStd)
+            return a.alpha == b.alpha && std::equal(a.mean, a.mean + 3, b.mean) && std::equal(a.std, a.std + 3, b.std);
+        else if(a.type == NormType::AlphaBeta)
+            return a.alpha == b.alpha && a.beta == b.beta;
+        return true;
+    }
+
+    RemapTable::RemapTable(int src_width, int src_height, int src_line_size, int dst_width, int dst_height, uint8_t const_value, const Norm& norm)
+    :src_width_(src_width), src_height_(src_height), src_line_size_(src_line_size),
+     dst_width_(dst_width), dst_height_(dst_height), const_value_(const_value), norm_(norm){
+
+        letterbox_matrix(src_width, src_height, dst_width, dst_height, i2d_, d2i_);
+        build_axis(x_axis_, dst_width,  src_width,  d2i_[0], d2i_[2]);
+        build_axis(y_axis_, dst_height, src_height, d2i_[4], d2i_[5]);
+
+        bool invert = norm.channel_type == ChannelType::Invert;
+        for(int ic = 0; ic < 3; ++ic){
+            plane_channel_[ic] = invert ? 2 - ic : ic;
+            for(int value = 0; value < 256; ++value){
+                float c = value;
+                if(norm.type == NormType::MeanStd)
+                    c = (c * norm.alpha - norm.mean[ic]) / norm.std[ic];
+                else if(norm.type == NormType::AlphaBeta)
+                    c = c * norm.alpha + norm.beta;
+                lut_[ic][value] = c;
+            }
+        }
+    }
+
+    void RemapTable::build_axis(Axis& axis, int dst_size, int src_size, float scale, float offset){
+
+        axis.low.resize(dst_size);
+        axis.weight.resize(dst_size);
+        axis.state.resize(dst_size);
+        axis.inner_begin = dst_size;
+        axis.inner_end   = 0;
+        axis.valid_begin = dst_size;
+        axis.valid_end   = 0;
+
+        for(int d = 0; d < dst_size; ++d){
+            // 与浮点kernel的坐标计算与越界判断相同，letterbox矩阵的交叉项为0
+            float src = scale * d + offset;
+            if(src <= -1 || src >= src_size){
+                axis.state[d]  = Outside;
+                axis.low[d]    = 0;
+                axis.weight[d] = 0;
+                continue;
+            }
+
+            axis.valid_begin = std::min(axis.valid_begin, d);
+            axis.valid_end   = std::max(axis.valid_end, d + 1);
+
+            int low        = floorf(src);
+            axis.low[d]    = low;
+            axis.weight[d] = (int)rintf((src - low) * REMAP_COEF_SCALE);
+            if(low >= 0 && low + 1 < src_size){
+                axis.state[d]    = Inner;
+                axis.inner_begin = std::min(axis.inner_begin, d);
+                axis.inner_end   = std::max(axis.inner_end, d + 1);
+            }else{
+                axis.state[d] = Edge;
+            }
+        }
+
+        if(axis.valid_begin >= axis.valid_end)
+            axis.valid_begin = axis.valid_end = 0;
+
+        if(axis.inner_begin >= axis.inner_end)
+            axis.inner_begin = axis.inner_end = axis.valid_begin;
+
+        // 右邻居整读4个字节到(low + 1) * 3 + 3，low <= src_size - 3时不越过行尾
+        axis.gather_end = axis.inner_begin;
+        while(axis.gather_end < axis.inner_end && axis.low[axis.gather_end] <= src_size - 3)
+            axis.gather_end++;
+    }
+
+    void RemapTable::remap_pixel(const uint8_t* src, int dx, int dy, int value[3]) const{
+
+        if(x_axis_.state[dx] == Outside || y_axis_.state[dy] == Outside){
+            value[0] = value[1] = value[2] = const_value_;
+            return;
+        }
+
+        int x_low  = x_axis_.low[dx];
+        int y_low  = y_axis_.low[dy];
+        int x_high = x_low + 1;
+        int y_high = y_low + 1;
+        int lx     = x_axis_.weight[dx];
+        int ly     = y_axis_.weight[dy];
+        int hx     = REMAP_COEF_SCALE - lx;
+        int hy     = REMAP_COEF_SCALE - ly;
+
+        const uint8_t const_pixel[] = {const_value_, const_value_, const_value_};
+        const uint8_t* v1 = const_pixel;
+        const uint8_t* v2 = const_pixel;
+        const uint8_t* v3 = const_pixel;
+        const uint8_t* v4 = const_pixel;
+        if(y_low >= 0){
+            if(x_low >= 0)          v1 = src + y_low * src_line_size_ + x_low * 3;
+            if(x_high < src_width_) v2 = src + y_low * src_line_size_ + x_high * 3;
+        }
+        if(y_high < src_height_){
+            if(x_low >= 0)          v3 = src + y_high * src_line_size_ + x_low * 3;
+            if(x_high < src_width_) v4 = src + y_high * src_line_size_ + x_high * 3;
+        }
+
+        for(int ic = 0; ic < 3; ++ic)
+            value[ic] = (hy * (hx * v1[ic] + lx * v2[ic]) + ly * (hx * v3[ic] + lx * v4[ic]) + (1 << (REMAP_CAST_BITS - 1))) >> REMAP_CAST_BITS;
+    }
+
+    void RemapTable::remap_row(const uint8_t* src, float* dst, int dy) const{
+
+        int area = dst_width_ * dst_height_;
+        float* planes[] = {dst + dy * dst_width_, dst + dy * dst_width_ + area, dst + dy * dst_width_ + area * 2};
+        const float* lut0 = lut_[0];
+        const float* lut1 = lut_[1];
+        const float* lut2 = lut_[2];
+        int ch0 = plane_channel_[0];
+        int ch1 = plane_channel_[1];
+        int ch2 = plane_channel_[2];
+
+        // letterbox的填充行整行都是填充值
+        if(y_axis_.state[dy] == Outside){
+            for(int ic = 0; ic < 3; ++ic)
+                std::fill(planes[ic], planes[ic] + dst_width_, lut_[ic][const_value_]);
+            return;
+        }
+
+        // 左右的填充列
+        for(int ic = 0; ic < 3; ++ic){
+            std::fill(planes[ic], planes[ic] + x_axis_.valid_begin, lut_[ic][const_value_]);
+            std::fill(planes[ic] + x_axis_.valid_end, planes[ic] + dst_width_, lut_[ic][const_value_]);
+        }
+
+        int inner_begin = x_axis_.valid_begin, inner_end = x_axis_.valid_begin;
+        if(y_axis_.state[dy] == Inner && x_axis_.inner_begin < x_axis_.inner_end){
+            inner_begin = x_axis_.inner_begin;
+            inner_end   = x_axis_.inner_end;
+        }
+
+        int value[3];
+        for(int dx = x_axis_.valid_begin; dx < inner_begin; ++dx){
+            remap_pixel(src, dx, dy, value);
+            planes[0][dx] = lut0[value[ch0]];
+            planes[1][dx] = lut1[value[ch1]];
+            planes[2][dx] = lut2[value[ch2]];
+        }
+
+        // 内部区域：4个邻居都在图像内，没有任何判断，按表读取并查表归一化
+        if(inner_begin < inner_end){
+            const uint8_t* row0 = src + y_axis_.low[dy] * src_line_size_;
+            const uint8_t* row1 = row0 + src_line_size_;
+            const int* x_low    = x_axis_.low.data();
+            const int* x_weight = x_axis_.weight.data();
+            int ly = y_axis_.weight[dy];
+            int hy = REMAP_COEF_SCALE - ly;
+            int dx = inner_begin;
+
+#ifdef REMAP_CACHE_AVX2
+            if(support_avx2()){
+                const float* luts[] = {lut0, lut1, lut2};
+                dx = remap_inner_avx2(row0, row1, x_low, x_weight, ly, inner_begin, x_axis_.gather_end, luts, plane_channel_, planes);
+            }
+#endif
+
+            for(; dx < inner_end; ++dx){
+                int offset = x_low[dx] * 3;
+                int lx     = x_weight[dx];
+                int hx     = REMAP_COEF_SCALE - lx;
+                const uint8_t* p0 = row0 + offset;
+                const uint8_t* p1 = row1 + offset;
+                int c0 = (hy * (hx * p0[0] + lx * p0[3]) + ly * (hx * p1[0] + lx * p1[3]) + (1 << (REMAP_CAST_BITS - 1))) >> REMAP_CAST_BITS;
+                int c1 = (hy * (hx * p0[1] + lx * p0[4]) + ly * (hx * p1[1] + lx * p1[4]) + (1 << (REMAP_CAST_BITS - 1))) >> REMAP_CAST_BITS;
+                int c2 = (hy * (hx * p0[2] + lx * p0[5]) + ly * (hx * p1[2] + lx * p1[5]) + (1 << (REMAP_CAST_BITS - 1))) >> REMAP_CAST_BITS;
+                int pixel[] = {c0, c1, c2};
+                planes[0][dx] = lut0[pixel[ch0]];
+                planes[1][dx] = lut1[pixel[ch1]];
+                planes[2][dx] = lut2[pixel[ch2]];
+            }
+        }
+
+        for(int dx = inner_end; dx < x_axis_.valid_end; ++dx){
+            remap_pixel(src, dx, dy, value);
+            planes[0][dx] = lut0[value[ch0]];
+            planes[1][dx] = lut1[value[ch1]];
+            planes[2][dx] = lut2[value[ch2]];
+        }
+    }
+
+    void RemapTable::remap(const uint8_t* src, float* dst, ThreadPool* pool) const{
+
+        if(pool == nullptr || pool->size() == 0 || dst_height_ < 2){
+            for(int dy = 0; dy < dst_height_; ++dy)
+                remap_row(src, dst, dy);
+            return;
+        }
+
+        int num_blocks = std::min(dst_height_, (pool->size() + 1) * 4);
+        pool->parallel_for(0, num_blocks, [&](int iblock){
+            int begin = (int)((int64_t)dst_height_ * iblock / num_blocks);
+            int end   = (int)((int64_t)dst_height_ * (iblock + 1) / num_blocks);
+            for(int dy = begin; dy < end; ++dy)
+                remap_row(src, dst, dy);
+        });
+    }
+
+    size_t RemapTable::memory_size() const{
+        size_t size = sizeof(*this);
+        for(const Axis* axis : {&x_axis_, &y_axis_})
+            size += axis->low.capacity() * sizeof(int) + axis->weight.capacity() * sizeof(int) + axis->state.capacity();
+        return size;
+    }
+
+    bool RemapTable::match(int src_width, int src_height, int src_line_size, int dst_width, int dst_height, uint8_t const_value, const Norm& norm) const{
+        return src_width_  == src_width  && src_height_ == src_height && src_line_size_ == src_line_size &&
+               dst_width_  == dst_width  && dst_height_ == dst_height && const_value_   == const_value &&
+               same_norm(norm_, norm);
+    }
+
+    RemapCache::RemapCache(int capacity):capacity_(std::max(1, capacity)){}
+
+    std::shared_ptr<const RemapTable> RemapCache::query(
+        int src_width, int src_height, int src_line_size, int dst_width, int dst_height,
+        uint8_t const_value, const Norm& norm
+    ){
+        std::unique_lock<std::mutex> l(lock_);
+        for(auto& entry : entries_){
+            if(entry.table->match(src_width, src_height, src_line_size, dst_width, dst_height, const_value, norm)){
+                entry.last_used = ++clock_;
+                hits_++;
+                return entry.table;
+            }
+        }
+
+        // 建表只与dst的宽高成正比，开销很小，在锁内完成，避免同一尺寸被多个线程重复建表
+        misses_++;
+        Entry entry;
+        entry.table     = std::make_shared<RemapTable>(src_width, src_height, src_line_size, dst_width, dst_height, const_value, norm);
+        entry.last_used = ++clock_;
+        if((int)entries_.size() < capacity_){
+            entries_.emplace_back(entry);
+        }else{
+            auto oldest = std::min_element(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b){
+                return a.last_used < b.last_used;
+            });
+            *oldest = entry;
+        }
+        return entry.table;
+    }
+
+    size_t RemapCache::num_hits(){
+        std::unique_lock<std::mutex> l(lock_);
+        return hits_;
+    }
+
+    size_t RemapCache::num_misses(){
+        std::unique_lock<std::mutex> l(lock_);
+        return misses_;
+    }
+
+    float RemapCache::hit_rate(){
+        std::unique_lock<std::mutex> l(lock_);
+        size_t total = hits_ + misses_;
+        return total == 0 ? 0 : hits_ / (float)total;
+    }
+
+    size_t RemapCache::memory_size(){
+        std::unique_lock<std::mutex> l(lock_);
+        size_t size = 0;
+        for(auto& entry : entries_)
+            size += entry.table->memory_size();
+        return size;
+    }
+
+    int RemapCache::size(){
+        std::unique_lock<std::mutex> l(lock_);
+        return entries_.size();
+    }
+
+    std::string RemapCache::description(){
+        size_t hits   = num_hits();
+        size_t misses = num_misses();
+        return iLogger::format(
+            "Remap cache, tables = %d, hits = %d, misses = %d, hit rate = %.2f%%, memory = %.1f KB",
+            size(), (int)hits, (int)misses, hits + misses == 0 ? 0.0f : hits * 100.0f / (hits + misses), memory_size() / 1024.0f
+        );
+    }
+
+}; // namespace CPUKernel
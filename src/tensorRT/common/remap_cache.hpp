@@ -0,0 +1,103 @@
+#ifndef REMAP_CACHE_HPP
+#define REMAP_CACHE_HPP
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "preprocess_cpu.hpp"
+
+namespace CPUKernel{
+
+    // 等比缩放居中(letterbox)的仿射矩阵，与app中的AffineMatrix::compute相同，i2d为src到dst，d2i为dst到src
+    void letterbox_matrix(int src_width, int src_height, int dst_width, int dst_height, float i2d[6], float d2i[6]);
+
+    /**
+     * letterbox几何的重映射表，只与(src尺寸、行宽，dst尺寸，填充值，归一化)有关，与图像内容无关
+     * letterbox矩阵没有旋转，x、y可分离，表按列、按行分别保存源坐标与11位定点的插值权重
+     * 插值结果为0~255的整数，归一化预先展开为每个输出通道256项的查找表
+     * 因此每帧的预处理只剩下按表读取4个邻居、整数加权与查表，支持AVX2时每次gather 8个像素
+     *
+     * 插值使用与resize_bilinear_and_normalize_kernel(以及OpenCV)相同的定点取整
+     * 与浮点的warp_affine_bilinear_and_normalize_plane相比，插值结果可能相差1
+     **/
+    class RemapTable{
+    public:
+        RemapTable(int src_width, int src_height, int src_line_size, int dst_width, int dst_height, uint8_t const_value, const Norm& norm);
+
+        // src为BGR交错图像，dst为3个通道平面的float，pool不为空时按行并行
+        void remap(const uint8_t* src, float* dst, ThreadPool* pool = nullptr) const;
+
+        const float* i2d() const{return i2d_;}
+        const float* d2i() const{return d2i_;}
+        size_t memory_size() const;
+
+        bool match(int src_width, int src_height, int src_line_size, int dst_width, int dst_height, uint8_t const_value, const Norm& norm) const;
+
+    private:
+        // 一个轴上每个dst坐标的映射，low为左(上)邻居的坐标，weight为右(下)邻居的定点权重
+        struct Axis{
+            std::vector<int> low;
+            std::vector<int> weight;
+            std::vector<uint8_t> state;
+            int valid_begin = 0;    // [valid_begin, valid_end)以外的坐标超出图像，取填充值
+            int valid_end   = 0;
+            int inner_begin = 0;    // [inner_begin, inner_end)内的坐标两个邻居都在图像内
+            int inner_end   = 0;
+            int gather_end  = 0;    // [inner_begin, gather_end)内的坐标每个邻居可以整读4个字节而不越过行尾
+        };
+
+        void build_axis(Axis& axis, int dst_size, int src_size, float scale, float offset);
+        void remap_row(const uint8_t* src, float* dst, int dy) const;
+        void remap_pixel(const uint8_t* src, int dx, int dy, int value[3]) const;
+
+    private:
+        int src_width_ = 0, src_height_ = 0, src_line_size_ = 0;
+        int dst_width_ = 0, dst_height_ = 0;
+        uint8_t const_value_ = 0;
+        Norm norm_;
+        float i2d_[6], d2i_[6];
+        Axis x_axis_, y_axis_;
+        int plane_channel_[3];      // 输出通道平面对应的源通道，Invert时交换0与2
+        float lut_[3][256];         // 每个输出通道平面的归一化查找表
+    };
+
+    /**
+     * 重映射表缓存，按(src尺寸、行宽，dst尺寸，填充值，归一化)查找，最多保留capacity个表，超出时淘汰最久未使用的
+     * 视频流的尺寸固定，除第一帧外都会命中，线程安全
+     **/
+    class RemapCache{
+    public:
+        RemapCache(int capacity = 8);
+
+        std::shared_ptr<const RemapTable> query(
+            int src_width, int src_height, int src_line_size, int dst_width, int dst_height,
+            uint8_t const_value, const Norm& norm
+        );
+
+        size_t num_hits();
+        size_t num_misses();
+        float hit_rate();
+        size_t memory_size();
+        int size();
+
+        // 命中率与占用内存的描述，用于日志
+        std::string description();
+
+    private:
+        struct Entry{
+            std::shared_ptr<const RemapTable> table;
+            size_t last_used = 0;
+        };
+
+        std::mutex lock_;
+        int capacity_ = 8;
+        size_t clock_ = 0;
+        size_t hits_ = 0, misses_ = 0;
+        std::vector<Entry> entries_;
+    };
+
+}; // namespace CPUKernel
+
+#endif // REMAP_CACHE_HPP
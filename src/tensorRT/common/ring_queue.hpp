@@ -0,0 +1,73 @@
+#ifndef RING_QUEUE_HPP
+#define RING_QUEUE_HPP
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+/* 环形队列，接口与std::queue一致
+   std::queue(deque)在push/pop时会周期性地申请和释放内存块，这里只在容量不足时翻倍扩容，稳态下不申请内存
+   pop会把元素恢复为默认值，及时释放其持有的资源(例如cv::Mat的引用)
+*/
+template<class _T>
+class RingQueue{
+public:
+    RingQueue(size_t capacity = 16){
+        items_.resize(std::max<size_t>(1, capacity));
+    }
+
+    bool empty() const{return size_ == 0;}
+    size_t size() const{return size_;}
+    size_t capacity() const{return items_.size();}
+
+    _T& front(){return items_[head_];}
+    _T& back(){return items_[(head_ + size_ - 1) % items_.size()];}
+
+    void push(_T&& item){
+        if(size_ == items_.size())
+            grow();
+
+        items_[(head_ + size_) % items_.size()] = std::move(item);
+        size_++;
+    }
+
+    void push(const _T& item){
+        _T copyed = item;
+        push(std::move(copyed));
+    }
+
+    // 容量至少为capacity，已经足够时不做任何事
+    void reserve(size_t capacity){
+        while(items_.size() < capacity)
+            grow();
+    }
+
+    void pop(){
+        items_[head_] = _T();
+        head_ = (head_ + 1) % items_.size();
+        size_--;
+    }
+
+    void swap(RingQueue& other){
+        items_.swap(other.items_);
+        std::swap(head_, other.head_);
+        std::swap(size_, other.size_);
+    }
+
+private:
+    void grow(){
+        std::vector<_T> items(items_.size() * 2);
+        for(size_t i = 0; i < size_; ++i)
+            items[i] = std::move(items_[(head_ + i) % items_.size()]);
+
+        items_.swap(items);
+        head_ = 0;
+    }
+
+private:
+    std::vector<_T> items_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+};
+
+#endif // RING_QUEUE_HPP
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "thread_pool.hpp"
+#include <atomic>
+#include <algorithm>
+
+using namespace std;
+
+ThreadPool::ThreadPool(int num_threads){
+
+    if(num_threads <= 0)
+        num_threads = max(1u, thread::hardware_concurrency());
+
+    for(int i = 0; i < num_threads; ++i)
+        threads_.emplace_back(&ThreadPool::worker, this);
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        unique_lock<mutex> l(lock_);
+        run_ = false;
+    };
+    cv_.notify_all();
+
+    for(auto& t : threads_)
+        t.join();
+}
+
+void ThreadPool::commit(const function<void()>& task){
+    {
+        unique_lock<mutex> l(lock_);
+        tasks_.push(task);
+    };
+    cv_.notify_one();
+}
+
+void ThreadPool::worker(){
+
+    for(;;){
+        function<void()> task;
+        {
+            unique_lock<mutex> l(lock_);
+            cv_.wait(l, [&](){return !run_ || !tasks_.empty();});
+
+            // 退出前把队列中剩余的任务执行完
+            if(tasks_.empty()) return;
+
+            task = move(tasks_.front());
+            tasks_.pop();
+        };
+        task();
+    }
+}
+
+namespace{
+    // parallel_for的共享状态，晚启动的helper可能在parallel_for返回后才执行，因此用shared_ptr管理
+    struct ParallelState{
+        atomic<int> cursor{0};
+        atomic<int> remain{0};
+        int end = 0;
+        function<void(int)> func;
+        mutex lock;
+        condition_variable cv;
+
+        void run(){
+            int i = 0;
+            while((i = cursor++) < end){
+                func(i);
+                if(--remain == 0){
+                    unique_lock<mutex> l(lock);
+                    cv.notify_all();
+                }
+            }
+        }
+    };
+};
+
+void ThreadPool::parallel_for(int begin, int end, const function<void(int)>& func){
+
+    int count = end - begin;
+    if(count <= 0) return;
+
+    if(count == 1 || threads_.empty()){
+        for(int i = begin; i < end; ++i)
+            func(i);
+        return;
+    }
+
+    auto state    = make_shared<ParallelState>();
+    state->cursor = begin;
+    state->remain = count;
+    state->end    = end;
+    state->func   = func;
+
+    int num_helper = min(count - 1, (int)threads_.size());
+    for(int i = 0; i < num_helper; ++i)
+        commit([state](){state->run();});
+
+    state->run();
+
+    unique_lock<mutex> l(state->lock);
+    state->cv.wait(l, [&](){return state->remain == 0;});
+}
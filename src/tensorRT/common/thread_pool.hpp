@@ -0,0 +1,43 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+/**
+ * 固定线程数的线程池
+ * 主要用于把一批独立的计算(例如一个batch的预处理)分摊到多个线程
+ **/
+class ThreadPool{
+public:
+    // num_threads <= 0 时，使用std::thread::hardware_concurrency()
+    ThreadPool(int num_threads = 0);
+    virtual ~ThreadPool();
+
+    int size() const{return (int)threads_.size();}
+
+    // 提交一个任务，异步执行
+    void commit(const std::function<void()>& task);
+
+    /* 并行执行func(i)，i属于[begin, end)，返回时全部执行完毕
+       调用线程也会参与计算，因此在池内线程中嵌套调用也不会死锁
+    */
+    void parallel_for(int begin, int end, const std::function<void(int)>& func);
+
+private:
+    void worker();
+
+private:
+    std::vector<std::thread> threads_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex lock_;
+    std::condition_variable cv_;
+    bool run_ = true;
+};
+
+#endif // THREAD_POOL_HPP
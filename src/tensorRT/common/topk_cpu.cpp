@@ -0,0 +1,98 @@
+#include "topk_cpu.hpp"
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+
+namespace CPUKernel{
+
+    // float的位转换为无符号整数，保持大小顺序，与GPU实现相同
+    static inline uint32_t score_key(float score){
+        uint32_t bits;
+        memcpy(&bits, &score, sizeof(bits));
+        return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    }
+
+    // 按原顺序保留分数大于threshold的box，以及前remain个等于threshold的box
+    static int compact(const float* candidates, float* parray, int count, uint32_t threshold, int remain, int num_element, int score_index){
+
+        const float* pitems = candidates + 1;
+        float* poutput      = parray + 1;
+        int output_count    = 0;
+        for(int i = 0; i < count; ++i){
+            const float* pitem = pitems + i * num_element;
+            uint32_t key = score_key(pitem[score_index]);
+            if(key > threshold || (key == threshold && remain-- > 0)){
+                // 写入位置不会超过读取位置，可以原地进行
+                if(poutput + output_count * num_element != pitem)
+                    memmove(poutput + output_count * num_element, pitem, num_element * sizeof(float));
+                output_count++;
+            }
+        }
+        parray[0] = output_count;
+        return output_count;
+    }
+
+    int topk_boxes(const float* candidates, float* parray, int max_objects, int num_element, int score_index){
+
+        int count = std::max(0, (int)candidates[0]);
+        if(count <= max_objects){
+            if(parray != candidates)
+                memcpy(parray, candidates, (1 + count * num_element) * sizeof(float));
+            parray[0] = count;
+            return count;
+        }
+
+        if(max_objects <= 0){
+            parray[0] = 0;
+            return 0;
+        }
+
+        // 从高位到低位，每轮8位，确定第max_objects大的分数
+        const float* pitems = candidates + 1;
+        uint32_t prefix = 0, prefix_mask = 0;
+        int remain = max_objects;
+        int histogram[256];
+        for(int shift = 24; shift >= 0; shift -= 8){
+            memset(histogram, 0, sizeof(histogram));
+            for(int i = 0; i < count; ++i){
+                uint32_t key = score_key(pitems[i * num_element + score_index]);
+                if((key & prefix_mask) == prefix)
+                    histogram[(key >> shift) & 0xFF]++;
+            }
+
+            int digit = 255;
+            for(; digit > 0; --digit){
+                if(histogram[digit] >= remain) break;
+                remain -= histogram[digit];
+            }
+            prefix      |= (uint32_t)digit << shift;
+            prefix_mask |= 0xFFu << shift;
+        }
+        return compact(candidates, parray, count, prefix, remain, num_element, score_index);
+    }
+
+    int topk_boxes_reference(const float* candidates, float* parray, int max_objects, int num_element, int score_index){
+
+        int count = std::max(0, (int)candidates[0]);
+        const float* pitems = candidates + 1;
+        std::vector<int> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b){
+            return pitems[a * num_element + score_index] > pitems[b * num_element + score_index];
+        });
+
+        order.resize(std::min(count, std::max(0, max_objects)));
+        std::sort(order.begin(), order.end());
+
+        std::vector<float> output(1 + order.size() * num_element);
+        for(int i = 0; i < (int)order.size(); ++i)
+            memcpy(output.data() + 1 + i * num_element, pitems + order[i] * num_element, num_element * sizeof(float));
+
+        output[0] = order.size();
+        memcpy(parray, output.data(), output.size() * sizeof(float));
+        return order.size();
+    }
+
+}; // namespace CPUKernel
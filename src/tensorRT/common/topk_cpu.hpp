@@ -0,0 +1,20 @@
+#ifndef TOPK_CPU_HPP
+#define TOPK_CPU_HPP
+
+/**
+ * CUDAKernel::topk_boxes的CPU实现，同样按分数的位做基数选择，复杂度O(N)
+ * 保留的box按在candidates中的顺序输出，分数与第K个相等时保留靠前的，结果是确定的
+ **/
+namespace CPUKernel{
+
+    /* candidates与parray都是counter + boxes的格式，每个box为num_element个float，分数在score_index处
+       保留分数最高的max_objects个写入parray，返回保留的数量，candidates与parray可以是同一个缓冲区
+    */
+    int topk_boxes(const float* candidates, float* parray, int max_objects, int num_element, int score_index);
+
+    // 排序实现的对照，保留分数最高的max_objects个，分数相等时保留靠前的，按原顺序输出
+    int topk_boxes_reference(const float* candidates, float* parray, int max_objects, int num_element, int score_index);
+
+}; // namespace CPUKernel
+
+#endif // TOPK_CPU_HPP
@@ -0,0 +1,95 @@
+#include "topk_kernel.cuh"
+
+namespace CUDAKernel{
+
+    static const int TOPK_NUM_THREADS = 512;
+
+    // float的位转换为无符号整数，保持大小顺序
+    static __device__ unsigned int score_key(float score){
+        unsigned int bits = __float_as_uint(score);
+        return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+    }
+
+    static __device__ void copy_box(const float* src, float* dst, int num_element){
+        for(int i = 0; i < num_element; ++i)
+            dst[i] = src[i];
+    }
+
+    /* 一个block处理一张图，每轮按8位统计直方图，从高位到低位确定第K大的分数
+       之后分数大于它的全部保留，等于它的保留剩余的个数
+    */
+    static __global__ void topk_boxes_kernel(
+        const float* candidates, int candidate_capacity, float* parray, int max_objects,
+        int num_element, int score_index
+    ){
+        __shared__ int histogram[256];
+        __shared__ unsigned int prefix, prefix_mask;
+        __shared__ int remain, output_index, tie_index;
+
+        int count = min((int)*candidates, candidate_capacity);
+        const float* pitems = candidates + 1;
+        float* poutput      = parray + 1;
+        if(count <= max_objects){
+            for(int i = threadIdx.x; i < count * num_element; i += blockDim.x)
+                poutput[i] = pitems[i];
+
+            if(threadIdx.x == 0)
+                *parray = count;
+            return;
+        }
+
+        if(threadIdx.x == 0){
+            prefix       = 0;
+            prefix_mask  = 0;
+            remain       = max_objects;
+            output_index = 0;
+            tie_index    = 0;
+        }
+
+        for(int shift = 24; shift >= 0; shift -= 8){
+            for(int i = threadIdx.x; i < 256; i += blockDim.x)
+                histogram[i] = 0;
+            __syncthreads();
+
+            for(int i = threadIdx.x; i < count; i += blockDim.x){
+                unsigned int key = score_key(pitems[i * num_element + score_index]);
+                if((key & prefix_mask) == prefix)
+                    atomicAdd(&histogram[(key >> shift) & 0xFF], 1);
+            }
+            __syncthreads();
+
+            if(threadIdx.x == 0){
+                int digit = 255;
+                for(; digit > 0; --digit){
+                    if(histogram[digit] >= remain) break;
+                    remain -= histogram[digit];
+                }
+                prefix      |= (unsigned int)digit << shift;
+                prefix_mask |= 0xFFu << shift;
+            }
+            __syncthreads();
+        }
+
+        for(int i = threadIdx.x; i < count; i += blockDim.x){
+            const float* pitem = pitems + i * num_element;
+            unsigned int key   = score_key(pitem[score_index]);
+            if(key > prefix || (key == prefix && atomicAdd(&tie_index, 1) < remain)){
+                int index = atomicAdd(&output_index, 1);
+                copy_box(pitem, poutput + index * num_element, num_element);
+            }
+        }
+
+        if(threadIdx.x == 0)
+            *parray = max_objects;
+    }
+
+    void topk_boxes(
+        const float* candidates, int candidate_capacity, float* parray, int max_objects,
+        int num_element, int score_index, cudaStream_t stream
+    ){
+        checkCudaKernel(topk_boxes_kernel<<<1, TOPK_NUM_THREADS, 0, stream>>>(
+            candidates, candidate_capacity, parray, max_objects, num_element, score_index
+        ));
+    }
+
+};
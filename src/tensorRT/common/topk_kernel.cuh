@@ -0,0 +1,20 @@
+#ifndef TOPK_KERNEL_CUH
+#define TOPK_KERNEL_CUH
+
+#include "cuda_tools.hpp"
+
+namespace CUDAKernel{
+
+    /* 从decode输出的候选box中保留分数最高的max_objects个
+       candidates与parray都是counter + boxes的格式，每个box为num_element个float，分数在score_index处
+       candidates最多candidate_capacity个box，数量不超过max_objects时原样拷贝，否则按分数基数选择
+       分数与第K个相等的box，保留哪几个不确定，其余保留的box顺序也不确定，后续的NMS与排序不依赖顺序
+    */
+    void topk_boxes(
+        const float* candidates, int candidate_capacity, float* parray, int max_objects,
+        int num_element, int score_index, cudaStream_t stream
+    );
+
+};
+
+#endif // TOPK_KERNEL_CUH
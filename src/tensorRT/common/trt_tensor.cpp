@@ -33,6 +33,9 @@ namespace TRT{
 	}
 
 	inline static int get_device(int device_id){
+		if(device_id == CPU_DEVICE_ID)
+			return device_id;
+
 		if(device_id != CURRENT_DEVICE_ID){
 			CUDATools::check_device_id(device_id);
 			return device_id;
@@ -70,7 +73,8 @@ namespace TRT{
 
 		this->owner_cpu_ = !(cpu && cpu_size > 0);
 		this->owner_gpu_ = !(gpu && gpu_size > 0);
-		checkCudaRuntime(cudaGetDevice(&device_id_));
+		if(device_id_ != CPU_DEVICE_ID)
+			checkCudaRuntime(cudaGetDevice(&device_id_));
 	}
 
 	MixMemory::~MixMemory() {
@@ -79,6 +83,11 @@ namespace TRT{
 
 	void* MixMemory::gpu(size_t size) {
 
+		if(device_id_ == CPU_DEVICE_ID){
+			INFOE("CPU memory can not allocate gpu memory");
+			return nullptr;
+		}
+
 		if (gpu_size_ < size) {
 			release_gpu();
 
@@ -96,8 +105,12 @@ namespace TRT{
 			release_cpu();
 
 			cpu_size_ = size;
-			CUDATools::AutoDevice auto_device_exchange(device_id_);
-			checkCudaRuntime(cudaMallocHost(&cpu_, size));
+			if(device_id_ == CPU_DEVICE_ID){
+				cpu_ = malloc(size);
+			}else{
+				CUDATools::AutoDevice auto_device_exchange(device_id_);
+				checkCudaRuntime(cudaMallocHost(&cpu_, size));
+			}
 			Assert(cpu_ != nullptr);
 			memset(cpu_, 0, size);
 		}
@@ -107,8 +120,12 @@ namespace TRT{
 	void MixMemory::release_cpu() {
 		if (cpu_) {
 			if(owner_cpu_){
-				CUDATools::AutoDevice auto_device_exchange(device_id_);
-				checkCudaRuntime(cudaFreeHost(cpu_));
+				if(device_id_ == CPU_DEVICE_ID){
+					free(cpu_);
+				}else{
+					CUDATools::AutoDevice auto_device_exchange(device_id_);
+					checkCudaRuntime(cudaFreeHost(cpu_));
+				}
 			}
 			cpu_ = nullptr;
 		}
@@ -249,7 +266,7 @@ namespace TRT{
 	}
 
 	shared_ptr<Tensor> Tensor::clone() const{
-		auto new_tensor = make_shared<Tensor>(shape_, dtype_);
+		auto new_tensor = make_shared<Tensor>(shape_, dtype_, nullptr, device_id_);
 		if(head_ == DataHead::Init)
 			return new_tensor;
 		
@@ -422,6 +439,9 @@ namespace TRT{
 	}
 
 	Tensor& Tensor::synchronize(){ 
+		if(device_id_ == CPU_DEVICE_ID)
+			return *this;
+
 		CUDATools::AutoDevice auto_device_exchange(this->device());
 		checkCudaRuntime(cudaStreamSynchronize(stream_));
 		return *this;
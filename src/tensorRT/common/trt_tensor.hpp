@@ -13,6 +13,9 @@ typedef CUstream_st CUStreamRaw;
 
 #define CURRENT_DEVICE_ID           -1
 
+// 只使用主机内存的tensor，不调用任何cuda函数，用于在没有GPU的机器上推理(例如OpenCV dnn后端)
+#define CPU_DEVICE_ID               -2
+
 namespace TRT {
 
     typedef struct{unsigned short _;} float16;
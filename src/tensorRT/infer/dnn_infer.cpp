@@ -0,0 +1,324 @@
+
+#include "dnn_infer.hpp"
+#include <opencv2/dnn.hpp>
+#include <common/ilogger.hpp>
+
+using namespace std;
+
+namespace TRT {
+
+	class DNNInferImpl : public DNNInfer {
+
+	public:
+		virtual ~DNNInferImpl();
+		bool load(const std::string& file, int max_batch_size, const std::string& input_name, const std::vector<int>& input_dims);
+
+		virtual void forward(bool sync = true) override;
+		virtual bool try_forward() override;
+		virtual int get_max_batch_size() override;
+		virtual CUStream get_stream() override;
+		virtual void set_stream(CUStream stream) override;
+		virtual void synchronize() override;
+		virtual size_t get_device_memory_size() override;
+		virtual std::shared_ptr<MixMemory> get_workspace() override;
+		virtual std::shared_ptr<Tensor> input(int index = 0) override;
+		virtual std::string get_input_name(int index = 0) override;
+		virtual std::shared_ptr<Tensor> output(int index = 0) override;
+		virtual std::string get_output_name(int index = 0) override;
+		virtual std::shared_ptr<Tensor> tensor(const std::string& name) override;
+		virtual bool is_output_name(const std::string& name) override;
+		virtual bool is_input_name(const std::string& name) override;
+		virtual void set_input (int index, std::shared_ptr<Tensor> tensor) override;
+		virtual void set_output(int index, std::shared_ptr<Tensor> tensor) override;
+		virtual std::shared_ptr<std::vector<uint8_t>> serial_engine() override;
+		virtual std::shared_ptr<Infer> clone_context() override;
+
+		virtual void print() override;
+
+		virtual int num_output() override;
+		virtual int num_input() override;
+		virtual int device() override;
+
+	private:
+		bool forward_batch();
+
+	private:
+		std::string file_;
+		cv::dnn::Net net_;
+		int max_batch_size_ = 1;
+		std::vector<int> input_dims_;
+		std::vector<std::shared_ptr<Tensor>> inputs_;
+		std::vector<std::shared_ptr<Tensor>> outputs_;
+		std::vector<std::string> inputs_name_;
+		std::vector<std::string> outputs_name_;
+		std::shared_ptr<MixMemory> workspace_;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////////
+	DNNInferImpl::~DNNInferImpl(){
+		inputs_.clear();
+		outputs_.clear();
+		workspace_.reset();
+	}
+
+	bool DNNInferImpl::load(const std::string& file, int max_batch_size, const std::string& input_name, const std::vector<int>& input_dims){
+
+		if(!iLogger::exists(file)){
+			INFOE("Onnx file %s not exists", file.c_str());
+			return false;
+		}
+
+		try{
+			net_ = cv::dnn::readNetFromONNX(file);
+			net_.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+			net_.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+		}catch(const cv::Exception& e){
+			INFOE("Load onnx %s failed: %s", file.c_str(), e.what());
+			return false;
+		}
+
+		if(net_.empty()){
+			INFOE("Load onnx %s failed", file.c_str());
+			return false;
+		}
+
+		// 没有指定输入维度时，使用onnx导入时记录的静态输入维度(0号layer为输入层)
+		input_dims_ = input_dims;
+		if(input_dims_.empty()){
+			try{
+				std::vector<cv::dnn::MatShape> in_shapes, out_shapes;
+				net_.getLayerShapes(cv::dnn::MatShape(), 0, in_shapes, out_shapes);
+				if(!out_shapes.empty() && out_shapes[0].size() > 1)
+					input_dims_.assign(out_shapes[0].begin() + 1, out_shapes[0].end());
+			}catch(const cv::Exception& e){
+				INFOW("Get input shape from %s failed: %s", file.c_str(), e.what());
+			}
+
+			for(int dim : input_dims_){
+				if(dim <= 0){
+					input_dims_.clear();
+					break;
+				}
+			}
+
+			if(input_dims_.empty()){
+				INFOE("Onnx %s has no static input shape, please specify input_dims", file.c_str());
+				return false;
+			}
+		}
+
+		file_           = file;
+		max_batch_size_ = std::max(1, max_batch_size);
+		workspace_.reset(new MixMemory(CPU_DEVICE_ID));
+
+		std::vector<int> dims = input_dims_;
+		dims.insert(dims.begin(), max_batch_size_);
+		inputs_.emplace_back(new Tensor(dims, DataType::Float, nullptr, CPU_DEVICE_ID));
+		inputs_name_.emplace_back(input_name);
+
+		outputs_name_ = net_.getUnconnectedOutLayersNames();
+		for(int i = 0; i < outputs_name_.size(); ++i)
+			outputs_.emplace_back(new Tensor(DataType::Float, nullptr, CPU_DEVICE_ID));
+
+		// 用batch = 1推理一次，得到输出的维度，同时检查模型是否可以运行
+		inputs_[0]->resize_single_dim(0, 1).set_to(0);
+		if(!forward_batch())
+			return false;
+
+		for(auto& output : outputs_)
+			output->resize_single_dim(0, max_batch_size_);
+		inputs_[0]->resize_single_dim(0, max_batch_size_);
+		return true;
+	}
+
+	bool DNNInferImpl::forward_batch(){
+
+		auto& input = inputs_[0];
+		if(input->size(0) > max_batch_size_){
+			INFOE("Batch size %d > max batch size %d", input->size(0), max_batch_size_);
+			return false;
+		}
+
+		try{
+			cv::Mat blob(input->ndims(), input->dims().data(), CV_32F, input->cpu<float>());
+			net_.setInput(blob, inputs_name_[0]);
+
+			std::vector<cv::Mat> outputs;
+			net_.forward(outputs, outputs_name_);
+			for(int i = 0; i < outputs.size(); ++i){
+				cv::Mat output = outputs[i].isContinuous() ? outputs[i] : outputs[i].clone();
+				if(output.depth() != CV_32F)
+					output.convertTo(output, CV_32F);
+
+				std::vector<int> dims(output.size.p, output.size.p + output.dims);
+				outputs_[i]->resize(dims);
+				memcpy(outputs_[i]->cpu(), output.ptr(), outputs_[i]->bytes());
+			}
+		}catch(const cv::Exception& e){
+			INFOE("Forward %s failed: %s", file_.c_str(), e.what());
+			return false;
+		}
+		return true;
+	}
+
+	void DNNInferImpl::forward(bool sync){
+		try_forward();
+	}
+
+	bool DNNInferImpl::try_forward(){
+
+		if(forward_batch())
+			return true;
+
+		// 失败时清零输出，避免使用者把上一个batch的结果当作本次的结果
+		int batch_size = inputs_[0]->size(0);
+		for(auto& output : outputs_){
+			if(output->ndims() > 0)
+				output->resize_single_dim(0, batch_size).set_to(0);
+		}
+		return false;
+	}
+
+	int DNNInferImpl::get_max_batch_size(){
+		return max_batch_size_;
+	}
+
+	CUStream DNNInferImpl::get_stream(){
+		return nullptr;
+	}
+
+	void DNNInferImpl::set_stream(CUStream stream){
+		if(stream != nullptr)
+			INFOW("DNN backend runs on CPU, stream is ignored");
+	}
+
+	void DNNInferImpl::synchronize(){
+	}
+
+	size_t DNNInferImpl::get_device_memory_size(){
+		return 0;
+	}
+
+	std::shared_ptr<MixMemory> DNNInferImpl::get_workspace(){
+		return workspace_;
+	}
+
+	int DNNInferImpl::num_input(){
+		return this->inputs_.size();
+	}
+
+	int DNNInferImpl::num_output(){
+		return this->outputs_.size();
+	}
+
+	void DNNInferImpl::set_input (int index, std::shared_ptr<Tensor> tensor){
+		if(index < 0 || index >= inputs_.size()){
+			INFOF("Input index[%d] out of range [size=%d]", index, inputs_.size());
+		}
+		this->inputs_[index] = tensor;
+	}
+
+	void DNNInferImpl::set_output(int index, std::shared_ptr<Tensor> tensor){
+		if(index < 0 || index >= outputs_.size()){
+			INFOF("Output index[%d] out of range [size=%d]", index, outputs_.size());
+		}
+		this->outputs_[index] = tensor;
+	}
+
+	std::shared_ptr<Tensor> DNNInferImpl::input(int index){
+		if(index < 0 || index >= inputs_.size()){
+			INFOF("Input index[%d] out of range [size=%d]", index, inputs_.size());
+		}
+		return this->inputs_[index];
+	}
+
+	std::string DNNInferImpl::get_input_name(int index){
+		if(index < 0 || index >= inputs_name_.size()){
+			INFOF("Input index[%d] out of range [size=%d]", index, inputs_name_.size());
+		}
+		return inputs_name_[index];
+	}
+
+	std::shared_ptr<Tensor> DNNInferImpl::output(int index){
+		if(index < 0 || index >= outputs_.size()){
+			INFOF("Output index[%d] out of range [size=%d]", index, outputs_.size());
+		}
+		return outputs_[index];
+	}
+
+	std::string DNNInferImpl::get_output_name(int index){
+		if(index < 0 || index >= outputs_name_.size()){
+			INFOF("Output index[%d] out of range [size=%d]", index, outputs_name_.size());
+		}
+		return outputs_name_[index];
+	}
+
+	bool DNNInferImpl::is_output_name(const std::string& name){
+		return std::find(outputs_name_.begin(), outputs_name_.end(), name) != outputs_name_.end();
+	}
+
+	bool DNNInferImpl::is_input_name(const std::string& name){
+		return std::find(inputs_name_.begin(), inputs_name_.end(), name) != inputs_name_.end();
+	}
+
+	std::shared_ptr<Tensor> DNNInferImpl::tensor(const std::string& name){
+
+		for(int i = 0; i < inputs_name_.size(); ++i){
+			if(inputs_name_[i] == name)
+				return inputs_[i];
+		}
+
+		for(int i = 0; i < outputs_name_.size(); ++i){
+			if(outputs_name_[i] == name)
+				return outputs_[i];
+		}
+
+		INFOF("Could not found the input/output node '%s', please makesure your model", name.c_str());
+		return nullptr;
+	}
+
+	std::shared_ptr<std::vector<uint8_t>> DNNInferImpl::serial_engine(){
+		INFOE("DNN backend does not support serial engine");
+		return nullptr;
+	}
+
+	std::shared_ptr<Infer> DNNInferImpl::clone_context(){
+
+		// cv::dnn::Net不能在多个线程上同时forward，因此每个context重新加载一份模型
+		std::shared_ptr<DNNInferImpl> infer(new DNNInferImpl());
+		if(!infer->load(file_, max_batch_size_, inputs_name_[0], input_dims_))
+			infer.reset();
+		return infer;
+	}
+
+	int DNNInferImpl::device(){
+		return CPU_DEVICE_ID;
+	}
+
+	void DNNInferImpl::print(){
+		INFO("Infer %p detail", this);
+		INFO("\tBase device: CPU, OpenCV dnn");
+		INFO("\tMax Batch Size: %d", this->get_max_batch_size());
+		INFO("\tInputs: %d", inputs_.size());
+		for(int i = 0; i < inputs_.size(); ++i){
+			auto& tensor = inputs_[i];
+			auto& name = inputs_name_[i];
+			INFO("\t\t%d.%s : shape {%s}, %s", i, name.c_str(), tensor->shape_string(), data_type_string(tensor->type()));
+		}
+
+		INFO("\tOutputs: %d", outputs_.size());
+		for(int i = 0; i < outputs_.size(); ++i){
+			auto& tensor = outputs_[i];
+			auto& name = outputs_name_[i];
+			INFO("\t\t%d.%s : shape {%s}, %s", i, name.c_str(), tensor->shape_string(), data_type_string(tensor->type()));
+		}
+	}
+
+	std::shared_ptr<DNNInfer> load_dnn_infer(const std::string& onnx_file, int max_batch_size, const std::string& input_name, const std::vector<int>& input_dims){
+
+		std::shared_ptr<DNNInferImpl> Infer(new DNNInferImpl());
+		if (!Infer->load(onnx_file, max_batch_size, input_name, input_dims))
+			Infer.reset();
+		return Infer;
+	}
+};
\ No newline at end of file
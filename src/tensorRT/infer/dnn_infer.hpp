@@ -0,0 +1,33 @@
+
+
+#ifndef DNN_INFER_HPP
+#define DNN_INFER_HPP
+
+#include "trt_infer.hpp"
+
+namespace TRT {
+
+	/* 使用OpenCV dnn在CPU上推理onnx模型，实现与TensorRT引擎相同的Infer接口
+	   输入输出tensor都是CPU_DEVICE_ID的主机内存，stream为nullptr，forward总是同步执行
+	   input_name:     onnx的输入节点名称，tensor(input_name)得到输入tensor
+	   input_dims:     不含batch的输入维度，例如{3, 640, 640}，为空时使用onnx中记录的静态维度
+	   max_batch_size: 一次forward的最大batch，onnx的batch维度为静态时只能为1
+	   目前只有Yolo的OpenCVDNN后端使用，并且使用默认的max_batch_size = 1
+	*/
+	class DNNInfer : public Infer {
+	public:
+		/* 与forward相同，cv::dnn推理失败时返回false，此时输出tensor被清零，不会保留上一次的结果
+		   Infer::forward没有返回值，使用者需要通过它判断结果是否有效
+		*/
+		virtual bool try_forward() = 0;
+	};
+
+	std::shared_ptr<DNNInfer> load_dnn_infer(
+		const std::string& onnx_file, int max_batch_size = 1,
+		const std::string& input_name = "images", const std::vector<int>& input_dims = std::vector<int>()
+	);
+
+};	//TRTInfer
+
+
+#endif //DNN_INFER_HPP
\ No newline at end of file
@@ -80,6 +80,23 @@ namespace TRT {
 			return context_ != nullptr;
 		}
 
+		bool share_model(const EngineContext& other) {
+			destroy();
+
+			if(other.engine_ == nullptr)
+				return false;
+
+			owner_stream_ = true;
+			checkCudaRuntime(cudaStreamCreate(&stream_));
+			if(stream_ == nullptr)
+				return false;
+
+			runtime_ = other.runtime_;
+			engine_  = other.engine_;
+			context_ = shared_ptr<IExecutionContext>(engine_->createExecutionContext(), destroy_nvidia_pointer<IExecutionContext>);
+			return context_ != nullptr;
+		}
+
 	private:
 		void destroy() {
 			context_.reset();
@@ -124,6 +141,7 @@ namespace TRT {
 		virtual void set_input (int index, std::shared_ptr<Tensor> tensor) override;
 		virtual void set_output(int index, std::shared_ptr<Tensor> tensor) override;
 		virtual std::shared_ptr<std::vector<uint8_t>> serial_engine() override;
+		virtual std::shared_ptr<Infer> clone_context() override;
 
 		virtual void print() override;
 
@@ -218,6 +236,28 @@ namespace TRT {
 		return true;
 	}
 
+	std::shared_ptr<Infer> InferImpl::clone_context() {
+
+		if(!context_){
+			INFOE("Infer clone context, nullptr.");
+			return nullptr;
+		}
+
+		CUDATools::AutoDevice auto_device_exchange(device_);
+		std::shared_ptr<InferImpl> infer(new InferImpl());
+		infer->context_.reset(new EngineContext());
+		if (!infer->context_->share_model(*context_)) {
+			INFOE("Create execution context failed.");
+			infer->context_.reset();
+			return nullptr;
+		}
+
+		infer->workspace_.reset(new MixMemory());
+		infer->device_ = device_;
+		infer->build_engine_input_and_outputs_mapper();
+		return infer;
+	}
+
 	bool InferImpl::load(const std::string& file) {
 
 		auto data = iLogger::load_file(file);
@@ -431,6 +471,14 @@ namespace TRT {
 		return orderdBlobs_[node->second];
 	}
 
+	const char* backend_string(Backend backend){
+		switch(backend){
+			case Backend::TensorRT:  return "TensorRT";
+			case Backend::OpenCVDNN: return "OpenCVDNN";
+			default: return "Unknow";
+		}
+	}
+
 	std::shared_ptr<Infer> load_infer_from_memory(const void* pdata, size_t size){
 
 		std::shared_ptr<InferImpl> Infer(new InferImpl());
@@ -11,6 +11,14 @@
 
 namespace TRT {
 
+	// 推理后端，应用在create_infer时选择，目前只有Yolo::create_infer支持OpenCVDNN
+	enum class Backend : int{
+		TensorRT  = 0,	// GPU，加载TensorRT引擎文件
+		OpenCVDNN = 1	// CPU，使用OpenCV dnn加载onnx文件，用于没有GPU的机器
+	};
+
+	const char* backend_string(Backend backend);
+
 	class Infer {
 	public:
 		virtual void     forward(bool sync = true) = 0;
@@ -34,6 +42,10 @@ namespace TRT {
 		virtual void set_input (int index, std::shared_ptr<Tensor> tensor) = 0;
 		virtual void set_output(int index, std::shared_ptr<Tensor> tensor) = 0;
 		virtual std::shared_ptr<std::vector<uint8_t>> serial_engine() = 0;
+
+		// 创建共享同一个引擎(权重)的新推理对象，拥有独立的execution context、stream、输入输出tensor和workspace
+		// 用于同一个显卡上多个线程并行推理，失败返回nullptr
+		virtual std::shared_ptr<Infer> clone_context() = 0;
 	};
 
 	struct DeviceMemorySummary {